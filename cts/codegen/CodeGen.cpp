@@ -1,8 +1,11 @@
 #include "cts/codegen/CodeGen.hpp"
 #include "cts/infra/QueryGraph.hpp"
-#include "cts/plangen/Plan.hpp"
+#include "cts/plangen/PlanGen.hpp"
+#include "infra/util/Regex.hpp"
 #include "rts/operator/AggregatedIndexScan.hpp"
+#include "rts/operator/Checkpoint.hpp"
 #include "rts/operator/EmptyScan.hpp"
+#include "rts/operator/Exchange.hpp"
 #include "rts/operator/Filter.hpp"
 #include "rts/operator/FullyAggregatedIndexScan.hpp"
 #include "rts/operator/HashGroupify.hpp"
@@ -13,6 +16,7 @@
 #include "rts/operator/NestedLoopFilter.hpp"
 #include "rts/operator/NestedLoopJoin.hpp"
 #include "rts/operator/HashOptional.hpp"
+#include "rts/operator/PlanPrinter.hpp"
 #include "rts/operator/ResultsPrinter.hpp"
 #include "rts/operator/Selection.hpp"
 #include "rts/operator/SingletonScan.hpp"
@@ -21,7 +25,10 @@
 #include "rts/operator/Union.hpp"
 #include "rts/runtime/Runtime.hpp"
 #include "rts/runtime/DifferentialIndex.hpp"
+#include "rts/segment/DictionarySegment.hpp"
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <map>
 #include <set>
 #include <cassert>
@@ -54,6 +61,21 @@ using namespace std;
 
 using namespace std;
 //---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The range of the partitioning variable produced by a partition
+struct ScanRange {
+   /// The partitioning variable
+   unsigned variable;
+   /// The range [low,high)
+   unsigned low,high;
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+/// The range of the partition currently translated (if any)
+static const ScanRange* partitionRange = 0;
+//---------------------------------------------------------------------------
 static Operator* translatePlan(Runtime& runtime,const map<unsigned,Register*>& context,const set<unsigned>& projection,map<unsigned,Register*>& bindings,const map<const QueryGraph::Node*,unsigned>& registers,Plan* plan);
 //---------------------------------------------------------------------------
 static void resolveScanVariable(Runtime& runtime,const map<unsigned,Register*>& context,const set<unsigned>& projection,map<unsigned,Register*>& bindings,const map<const QueryGraph::Node*,unsigned>& registers,unsigned slot,const QueryGraph::Node& node,Register*& reg,bool& bound,bool unused=false)
@@ -96,11 +118,16 @@ static Operator* translateIndexScan(Runtime& runtime,const map<unsigned,Register
    // And return the operator
    if (runtime.hasDifferentialIndex())
       return runtime.getDifferentialIndex().createScan(static_cast<Database::DataOrder>(plan->opArg),subject,constSubject,predicate,constPredicate,object,constObject,plan->cardinality);
-   return IndexScan::create(runtime.getDatabase(),static_cast<Database::DataOrder>(plan->opArg),
-                            subject,constSubject,
-                            predicate,constPredicate,
-                            object,constObject,
-			    plan->cardinality);
+   IndexScan* scan=IndexScan::create(runtime.getDatabase(),static_cast<Database::DataOrder>(plan->opArg),
+                                     subject,constSubject,
+                                     predicate,constPredicate,
+                                     object,constObject,
+                                     plan->cardinality);
+
+   // Scans ordered by the partitioning variable produce only the range of the partition
+   if (partitionRange&&(plan->ordering==partitionRange->variable))
+      scan->restrictRange(partitionRange->low,partitionRange->high);
+   return scan;
 }
 //---------------------------------------------------------------------------
 static Operator* translateAggregatedIndexScan(Runtime& runtime,const map<unsigned,Register*>& context,const set<unsigned>& projection,map<unsigned,Register*>& bindings,const map<const QueryGraph::Node*,unsigned>& registers,Plan* plan)
@@ -119,11 +146,16 @@ static Operator* translateAggregatedIndexScan(Runtime& runtime,const map<unsigne
    // And return the operator
    if (runtime.hasDifferentialIndex())
       return runtime.getDifferentialIndex().createAggregatedScan(static_cast<Database::DataOrder>(plan->opArg),subject,constSubject,predicate,constPredicate,object,constObject,plan->cardinality);
-   return AggregatedIndexScan::create(runtime.getDatabase(),order,
-                                      subject,constSubject,
-                                      predicate,constPredicate,
-                                      object,constObject,
-				      plan->cardinality);
+   AggregatedIndexScan* scan=AggregatedIndexScan::create(runtime.getDatabase(),order,
+                                                         subject,constSubject,
+                                                         predicate,constPredicate,
+                                                         object,constObject,
+                                                         plan->cardinality);
+
+   // Scans ordered by the partitioning variable produce only the range of the partition
+   if (partitionRange&&(plan->ordering==partitionRange->variable))
+      scan->restrictRange(partitionRange->low,partitionRange->high);
+   return scan;
 }
 //---------------------------------------------------------------------------
 static Operator* translateFullyAggregatedIndexScan(Runtime& runtime,const map<unsigned,Register*>& context,const set<unsigned>& projection,map<unsigned,Register*>& bindings,const map<const QueryGraph::Node*,unsigned>& registers,Plan* plan)
@@ -183,6 +215,7 @@ static void collectVariables(const map<unsigned,Register*>& context,set<unsigned
          break;
       case Plan::HashGroupify:
       case Plan::Filter:
+      case Plan::Exchange:
          collectVariables(context,variables,plan->left);
          break;
       case Plan::TableFunction: {
@@ -194,6 +227,13 @@ static void collectVariables(const map<unsigned,Register*>& context,set<unsigned
       }
       case Plan::Singleton:
          break;
+      case Plan::Materialized: {
+         const PlanGen::Intermediate& intermediate=*reinterpret_cast<PlanGen::Intermediate*>(plan->right);
+         for (vector<unsigned>::const_iterator iter=intermediate.variables.begin(),limit=intermediate.variables.end();iter!=limit;++iter)
+            if (!context.count(*iter))
+               variables.insert(*iter);
+         break;
+      }
    }
 }
 //---------------------------------------------------------------------------
@@ -433,7 +473,7 @@ static Selection::Predicate* buildSelection(const map<unsigned,Register*>& bindi
       case QueryGraph::Filter::Or: return new Selection::Or(buildSelection(bindings,*filter.arg1),buildSelection(bindings,*filter.arg2));
       case QueryGraph::Filter::And: return new Selection::And(buildSelection(bindings,*filter.arg1),buildSelection(bindings,*filter.arg2));
       case QueryGraph::Filter::Equal: return new Selection::Equal(buildSelection(bindings,*filter.arg1),buildSelection(bindings,*filter.arg2));
-      case QueryGraph::Filter::NotEqual: return new Selection::And(buildSelection(bindings,*filter.arg1),buildSelection(bindings,*filter.arg2));
+      case QueryGraph::Filter::NotEqual: return new Selection::NotEqual(buildSelection(bindings,*filter.arg1),buildSelection(bindings,*filter.arg2));
       case QueryGraph::Filter::Less: return new Selection::Less(buildSelection(bindings,*filter.arg1),buildSelection(bindings,*filter.arg2));
       case QueryGraph::Filter::LessOrEqual: return new Selection::LessOrEqual(buildSelection(bindings,*filter.arg1),buildSelection(bindings,*filter.arg2));
       case QueryGraph::Filter::Greater: return new Selection::Less(buildSelection(bindings,*filter.arg2),buildSelection(bindings,*filter.arg1));
@@ -478,10 +518,53 @@ static Selection::Predicate* buildSelection(const map<unsigned,Register*>& bindi
          vector<Selection::Predicate*> args;
          collectSelectionArgs(bindings,args,filter.arg2);
          return new Selection::BuiltinIn(buildSelection(bindings,*filter.arg1),args); }
+      case QueryGraph::Filter::Builtin_contains: return new Selection::BuiltinContains(buildSelection(bindings,*filter.arg1),buildSelection(bindings,*filter.arg2));
+      case QueryGraph::Filter::Builtin_strstarts: return new Selection::BuiltinStrStarts(buildSelection(bindings,*filter.arg1),buildSelection(bindings,*filter.arg2));
    }
    throw; // Cannot happen
 }
 //---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Matches strings like the string match builtins of Selection
+class PatternMatcher : public DictionarySegment::StringMatcher
+{
+   public:
+   /// The match kinds
+   enum Mode { Contains, StartsWith, RegEx };
+
+   private:
+   /// The pattern
+   string pattern;
+   /// The match kind
+   Mode mode;
+   /// The compiled pattern (for RegEx)
+   const Regex* regex;
+
+   public:
+   /// Constructor
+   PatternMatcher(const string& pattern,Mode mode) : pattern(pattern),mode(mode),regex((mode==RegEx)?Regex::acquire(pattern,""):0) {}
+   /// Destructor
+   ~PatternMatcher() { Regex::release(regex); }
+
+   /// Does the string qualify?
+   bool matches(const char* start,const char* stop,Type::ID type,unsigned subType);
+};
+//---------------------------------------------------------------------------
+bool PatternMatcher::matches(const char* start,const char* stop,Type::ID /*type*/,unsigned /*subType*/)
+   // Does the string qualify?
+{
+   if (mode==RegEx)
+      return regex&&regex->matches(start,stop);
+   if (pattern.empty())
+      return true;
+   if (mode==StartsWith)
+      return (static_cast<unsigned>(stop-start)>=pattern.size())&&(memcmp(start,pattern.data(),pattern.size())==0);
+   return search(start,stop,pattern.begin(),pattern.end())!=stop;
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
 static Operator* translateFilter(Runtime& runtime,const map<unsigned,Register*>& context,const set<unsigned>& projection,map<unsigned,Register*>& bindings,const map<const QueryGraph::Node*,unsigned>& registers,Plan* plan)
    // Translate a filter into an operator tree
 {
@@ -532,6 +615,20 @@ static Operator* translateFilter(Runtime& runtime,const map<unsigned,Register*>&
          result=new Filter(tree,bindings[filter.arg1->id],values,false,plan->cardinality);
       }
    }
+   if ((!result)&&(plan->opArg==1)&&filter.isStringMatch()&&(bindings.count(filter.arg1->id))&&(!runtime.hasDifferentialIndex())) {
+      // The plan generator decided to evaluate the match once against the whole dictionary
+      // Prefixes can use the sorted string index if available
+      vector<unsigned> values;
+      DictionarySegment& dict=runtime.getDatabase().getDictionary();
+      if ((filter.type!=QueryGraph::Filter::Builtin_strstarts)||(!dict.findByPrefix(filter.arg2->value,values))) {
+         PatternMatcher::Mode mode=PatternMatcher::Contains;
+         if (filter.type==QueryGraph::Filter::Builtin_strstarts) mode=PatternMatcher::StartsWith; else
+         if (filter.type==QueryGraph::Filter::Builtin_regex) mode=PatternMatcher::RegEx;
+         PatternMatcher matcher(filter.arg2->value,mode);
+         dict.findMatching(matcher,values);
+      }
+      result=new Filter(tree,bindings[filter.arg1->id],values,false,plan->cardinality);
+   }
    if (!result) {
       result=new Selection(tree,runtime,buildSelection(bindings,filter),plan->cardinality);
    }
@@ -656,6 +753,115 @@ static Operator* translateTableFunction(Runtime& runtime,const map<unsigned,Regi
 
    return result;
 }
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// An intermediate result materialized during query execution
+struct MaterializedResult : public PlanGen::Intermediate
+{
+   /// The plan node standing in for the result
+   Plan plan;
+   /// The checkpoint computing the result. Owned by the operator tree
+   Checkpoint* checkpoint;
+   /// Was the checkpoint handed over to the operator tree?
+   bool consumed;
+   /// The registers bound by the checkpoint
+   map<unsigned,Register*> checkpointBindings;
+   /// The materialized tuples
+   vector<unsigned> tuples;
+   /// The registers used when replaying the tuples, one per variable
+   vector<Register*> registers;
+   /// The operator tree that computed the tuples, once materialized. Kept for printing
+   Operator* origin;
+
+   /// Constructor
+   MaterializedResult() : checkpoint(0),consumed(false),origin(0) {}
+   /// Destructor
+   ~MaterializedResult() { delete origin; }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+static Operator* translateMaterialized(const set<unsigned>& projection,map<unsigned,Register*>& bindings,Plan* plan)
+   // Translate the access to a materialized intermediate result into an operator tree
+{
+   // Materialized plans are only produced by the re-optimization below
+   MaterializedResult& result=*static_cast<MaterializedResult*>(reinterpret_cast<PlanGen::Intermediate*>(plan->right));
+
+   // Still to be computed?
+   if (!result.consumed) {
+      Operator* checkpoint=result.checkpoint;
+      result.consumed=true;
+      for (map<unsigned,Register*>::const_iterator iter=result.checkpointBindings.begin(),limit=result.checkpointBindings.end();iter!=limit;++iter)
+         if (projection.count((*iter).first))
+            bindings[(*iter).first]=(*iter).second;
+      return checkpoint;
+   }
+
+   // Replay the tuples
+   for (unsigned index=0;index<result.variables.size();index++)
+      if (projection.count(result.variables[index]))
+         bindings[result.variables[index]]=result.registers[index];
+   return new Checkpoint(result.tuples,result.registers,result.cardinality,result.origin);
+}
+//---------------------------------------------------------------------------
+static void collectNodes(Plan* plan,vector<const QueryGraph::Node*>& nodes)
+   // Collect the patterns scanned by a partitionable plan
+{
+   if ((plan->op==Plan::IndexScan)||(plan->op==Plan::AggregatedIndexScan)||(plan->op==Plan::FullyAggregatedIndexScan)) {
+      nodes.push_back(reinterpret_cast<QueryGraph::Node*>(plan->right));
+   } else {
+      collectNodes(plan->left,nodes);
+      collectNodes(plan->right,nodes);
+   }
+}
+//---------------------------------------------------------------------------
+static Operator* translateExchange(Runtime& runtime,const map<unsigned,Register*>& context,const set<unsigned>& projection,map<unsigned,Register*>& bindings,const map<const QueryGraph::Node*,unsigned>& registers,Plan* plan)
+   // Translate a partitioned subplan into an operator tree
+{
+   // Scans of the differential index cannot be restricted, evaluate serially then
+   unsigned partitionCount=plan->right-static_cast<Plan*>(0);
+   if (runtime.hasDifferentialIndex()||(partitionCount<2))
+      return translatePlan(runtime,context,projection,bindings,registers,plan->left);
+
+   // The first partition uses the regular registers. Their domains are shared with
+   // the rest of the query and must not be updated concurrently
+   vector<const QueryGraph::Node*> nodes;
+   collectNodes(plan->left,nodes);
+   for (vector<const QueryGraph::Node*>::const_iterator iter=nodes.begin(),limit=nodes.end();iter!=limit;++iter)
+      for (unsigned slot=0;slot<3;slot++)
+         runtime.getRegister((*registers.find(*iter)).second+slot)->domain=0;
+
+   // Split the id range evenly, the other partitions use private registers
+   uint64_t ids=runtime.getDatabase().getDictionary().getNextId();
+   vector<Exchange::Partition> partitions;
+   for (unsigned index=0;index<partitionCount;index++) {
+      ScanRange range;
+      range.variable=plan->opArg;
+      range.low=static_cast<unsigned>((ids*index)/partitionCount);
+      range.high=(index+1<partitionCount)?static_cast<unsigned>((ids*(index+1))/partitionCount):~0u;
+
+      Exchange::Partition partition;
+      partition.runtime=0;
+      Runtime* partitionRuntime=&runtime;
+      if (index) {
+         partitionRuntime=partition.runtime=new Runtime(runtime.getDatabase());
+         partitionRuntime->allocateRegisters(runtime.getRegisterCount());
+      }
+      map<unsigned,Register*> partitionBindings;
+      partitionRange=&range;
+      partition.input=translatePlan(*partitionRuntime,context,projection,partitionBindings,registers,plan->left);
+      partitionRange=0;
+      for (map<unsigned,Register*>::const_iterator iter=partitionBindings.begin(),limit=partitionBindings.end();iter!=limit;++iter)
+         partition.registers.push_back((*iter).second);
+      if (!index)
+         bindings.insert(partitionBindings.begin(),partitionBindings.end());
+      partitions.push_back(partition);
+   }
+
+   return new Exchange(partitions,partitions.front().registers,partitionCount/Exchange::partitionsPerThread,plan->cardinality);
+}
+//---------------------------------------------------------------------------
 
 //---------------------------------------------------------------------------
 // Name: translatePlan
@@ -682,6 +888,8 @@ static Operator* translatePlan(Runtime& runtime,const map<unsigned,Register*>& c
       case Plan::TableFunction: result=translateTableFunction(runtime,context,projection,bindings,registers,plan); break;
       case Plan::Singleton: result=new SingletonScan(); break;
       case Plan::HashOptional: result=translateHashOptional(runtime,context,projection,bindings,registers,plan); break;
+      case Plan::Materialized: result=translateMaterialized(projection,bindings,plan); break;
+      case Plan::Exchange: result=translateExchange(runtime,context,projection,bindings,registers,plan); break;
    }
    return result;
 }
@@ -718,6 +926,343 @@ static unsigned allocateRegisters(map<const QueryGraph::Node*,unsigned>& registe
    return id;
 }
 //---------------------------------------------------------------------------
+static bool canReoptimize(Plan* plan)
+   // Can the plan be re-optimized during execution?
+{
+   switch (plan->op) {
+      case Plan::IndexScan:
+      case Plan::AggregatedIndexScan:
+      case Plan::FullyAggregatedIndexScan:
+      case Plan::Materialized:
+         return true;
+      case Plan::NestedLoopJoin:
+      case Plan::MergeJoin:
+      case Plan::HashJoin:
+         return canReoptimize(plan->left)&&canReoptimize(plan->right);
+      case Plan::HashGroupify:
+      case Plan::Filter:
+         return canReoptimize(plan->left);
+      default:
+         return false;
+   }
+}
+//---------------------------------------------------------------------------
+static bool isJoin(Plan* plan)
+   // Is the plan a join?
+{
+   return (plan->op==Plan::NestedLoopJoin)||(plan->op==Plan::MergeJoin)||(plan->op==Plan::HashJoin);
+}
+//---------------------------------------------------------------------------
+static void findCheckpoint(Plan*& slot,bool belowJoin,Plan**& best)
+   // Find the cheapest join whose result is joined again
+{
+   Plan* plan=slot;
+   if (isJoin(plan)) {
+      if (belowJoin&&((!best)||(plan->costs<(*best)->costs)))
+         best=&slot;
+      findCheckpoint(plan->left,true,best);
+      findCheckpoint(plan->right,true,best);
+   } else if ((plan->op==Plan::Filter)||(plan->op==Plan::HashGroupify)) {
+      findCheckpoint(plan->left,belowJoin,best);
+   }
+}
+//---------------------------------------------------------------------------
+static void collectIntermediate(const QueryGraph& query,Plan* plan,PlanGen::Intermediate& intermediate)
+   // Collect the relations and the applied filters of a subplan
+{
+   switch (plan->op) {
+      case Plan::IndexScan:
+      case Plan::AggregatedIndexScan:
+      case Plan::FullyAggregatedIndexScan:
+         intermediate.relations.set(reinterpret_cast<QueryGraph::Node*>(plan->right)-&(query.getQuery().nodes.front()));
+         break;
+      case Plan::Materialized: {
+         const PlanGen::Intermediate& input=*reinterpret_cast<PlanGen::Intermediate*>(plan->right);
+         intermediate.relations=intermediate.relations.unionWith(input.relations);
+         intermediate.filters.insert(intermediate.filters.end(),input.filters.begin(),input.filters.end());
+         break;
+      }
+      case Plan::Filter:
+         intermediate.filters.push_back(reinterpret_cast<QueryGraph::Filter*>(plan->right));
+         collectIntermediate(query,plan->left,intermediate);
+         break;
+      default:
+         collectIntermediate(query,plan->left,intermediate);
+         if ((plan->op!=Plan::HashGroupify)&&(plan->op!=Plan::Exchange))
+            collectIntermediate(query,plan->right,intermediate);
+         break;
+   }
+}
+//---------------------------------------------------------------------------
+static MaterializedResult* buildCheckpoint(Runtime& runtime,const QueryGraph& query,const map<const QueryGraph::Node*,unsigned>& registers,Plan* plan)
+   // Materialize the result of a subplan
+{
+   MaterializedResult* result=new MaterializedResult();
+   collectIntermediate(query,plan,*result);
+   result->cardinality=plan->cardinality;
+   result->ordering=plan->ordering;
+
+   // Translate the subplan, keeping all its variables
+   map<unsigned,Register*> context;
+   set<unsigned> projection;
+   collectVariables(context,projection,plan);
+   Operator* tree=translatePlan(runtime,context,projection,result->checkpointBindings,registers,plan);
+   vector<Register*> regs;
+   for (map<unsigned,Register*>::const_iterator iter=result->checkpointBindings.begin(),limit=result->checkpointBindings.end();iter!=limit;++iter) {
+      result->variables.push_back((*iter).first);
+      regs.push_back((*iter).second);
+   }
+   result->checkpoint=new Checkpoint(tree,regs,plan->cardinality);
+   result->consumed=false;
+
+   // Replays use the registers of the first pattern producing a variable
+   const vector<QueryGraph::Node>& nodes=query.getQuery().nodes;
+   for (vector<unsigned>::const_iterator iter=result->variables.begin(),limit=result->variables.end();iter!=limit;++iter) {
+      Register* reg=0;
+      for (unsigned index=0;(index<nodes.size())&&(!reg);index++) {
+         if (!result->relations.test(index))
+            continue;
+         const QueryGraph::Node& node=nodes[index];
+         unsigned slot=~0u;
+         if ((!node.constSubject)&&(node.subject==(*iter))) slot=0; else
+         if ((!node.constPredicate)&&(node.predicate==(*iter))) slot=1; else
+         if ((!node.constObject)&&(node.object==(*iter))) slot=2;
+         if (~slot)
+            reg=runtime.getRegister((*registers.find(&node)).second+slot);
+      }
+      result->registers.push_back(reg);
+   }
+
+   // The plan node standing in for the subplan
+   result->plan.op=Plan::Materialized;
+   result->plan.opArg=0;
+   result->plan.left=0;
+   result->plan.right=reinterpret_cast<Plan*>(static_cast<PlanGen::Intermediate*>(result));
+   result->plan.cardinality=plan->cardinality;
+   result->plan.costs=plan->costs;
+   result->plan.ordering=plan->ordering;
+   result->plan.next=0;
+
+   return result;
+}
+//---------------------------------------------------------------------------
+static Operator* translateWithCheckpoint(Runtime& runtime,const QueryGraph& query,const set<unsigned>& projection,map<unsigned,Register*>& bindings,const map<const QueryGraph::Node*,unsigned>& registers,Plan* plan,MaterializedResult*& checkpoint)
+   // Translate a plan, materializing the cheapest join result that is joined again
+{
+   checkpoint=0;
+   Plan** slot=0;
+   if (canReoptimize(plan))
+      findCheckpoint(plan,false,slot);
+   if (!slot) {
+      map<unsigned,Register*> context;
+      return translatePlan(runtime,context,projection,bindings,registers,plan);
+   }
+
+   // Translate the subplan first and let the materialized result stand in for it. The plan
+   // itself is left unchanged, it might be cached
+   checkpoint=buildCheckpoint(runtime,query,registers,*slot);
+   Plan* original=*slot;
+   *slot=&(checkpoint->plan);
+   map<unsigned,Register*> context;
+   Operator* tree=translatePlan(runtime,context,projection,bindings,registers,plan);
+   *slot=original;
+
+   return tree;
+}
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Re-optimizes the rest of a query if a checkpoint reveals a misestimated intermediate result
+class Reoptimizer : public Operator
+{
+   private:
+   /// The maximum number of re-optimizations
+   static const unsigned maxRounds = 8;
+
+   /// The runtime
+   Runtime& runtime;
+   /// The query
+   const QueryGraph& query;
+   /// The registers of the patterns
+   map<const QueryGraph::Node*,unsigned> registers;
+   /// The projection
+   set<unsigned> projection;
+   /// The output registers
+   map<unsigned,Register*> output;
+   /// The current operator tree
+   Operator* tree;
+   /// Registers that must be copied to the output
+   vector<pair<Register*,Register*> > copy;
+   /// The pending checkpoint (if any)
+   MaterializedResult* pending;
+   /// The materialized results used by the current tree
+   vector<MaterializedResult*> results;
+   /// Results that are no longer used. Their operator trees are still shown when printing
+   vector<MaterializedResult*> retired;
+   /// The plan generator for the current tree
+   PlanGen* planGen;
+   /// The tolerated estimation error
+   double factor;
+   /// The number of re-optimizations
+   unsigned rounds;
+
+   /// Examine the pending checkpoint and re-optimize if needed
+   void reoptimize();
+
+   public:
+   /// Constructor
+   Reoptimizer(Runtime& runtime,const QueryGraph& query,const map<const QueryGraph::Node*,unsigned>& registers,const set<unsigned>& projection,const map<unsigned,Register*>& bindings,Operator* tree,MaterializedResult* pending,double factor);
+   /// Destructor
+   ~Reoptimizer();
+
+   /// Produce the first tuple
+   unsigned first();
+   /// Produce the next tuple
+   unsigned next();
+
+   /// Print the operator tree. Debugging only.
+   void print(PlanPrinter& out);
+   /// Add a merge join hint
+   void addMergeHint(Register* reg1,Register* reg2);
+   /// Register parts of the tree that can be executed asynchronous
+   void getAsyncInputCandidates(Scheduler& scheduler);
+};
+//---------------------------------------------------------------------------
+Reoptimizer::Reoptimizer(Runtime& runtime,const QueryGraph& query,const map<const QueryGraph::Node*,unsigned>& registers,const set<unsigned>& projection,const map<unsigned,Register*>& bindings,Operator* tree,MaterializedResult* pending,double factor)
+   : Operator(tree->getExpectedOutputCardinality()),runtime(runtime),query(query),registers(registers),projection(projection),output(bindings),tree(tree),pending(pending),planGen(0),factor(factor),rounds(0)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+Reoptimizer::~Reoptimizer()
+   // Destructor
+{
+   delete tree;
+   delete pending;
+   for (vector<MaterializedResult*>::const_iterator iter=results.begin(),limit=results.end();iter!=limit;++iter)
+      delete *iter;
+   for (vector<MaterializedResult*>::const_iterator iter=retired.begin(),limit=retired.end();iter!=limit;++iter)
+      delete *iter;
+   delete planGen;
+}
+//---------------------------------------------------------------------------
+void Reoptimizer::reoptimize()
+   // Examine the pending checkpoint and re-optimize if needed
+{
+   // Compute the intermediate result
+   Checkpoint* checkpoint=pending->checkpoint;
+   checkpoint->materialize();
+
+   // Was the estimate good enough?
+   double observed=checkpoint->getCardinality(),expected=pending->cardinality;
+   if (observed<1) observed=1;
+   if (expected<1) expected=1;
+   if ((++rounds>maxRounds)||(((observed/expected)<=factor)&&((expected/observed)<=factor))) {
+      retired.push_back(pending);
+      pending=0;
+      return;
+   }
+
+
+   // Plan the rest of the query using the result. Results contained in it are no longer needed
+   pending->cardinality=checkpoint->getCardinality();
+   vector<MaterializedResult*> live,subsumed;
+   for (vector<MaterializedResult*>::const_iterator iter=results.begin(),limit=results.end();iter!=limit;++iter)
+      if ((*iter)->relations.subsetOf(pending->relations))
+         subsumed.push_back(*iter); else
+         live.push_back(*iter);
+   live.push_back(pending);
+   vector<PlanGen::Intermediate*> intermediates(live.begin(),live.end());
+   PlanGen* newPlanGen=new PlanGen();
+   Plan* plan=newPlanGen->translate(runtime.getDatabase(),query,intermediates);
+   if (!plan) {
+      delete newPlanGen;
+      retired.push_back(pending);
+      pending=0;
+      return;
+   }
+
+   // Build the new tree. The registers must not contain values from the old tree, they would be
+   // taken as scan hints
+   checkpoint->releaseTuples(pending->tuples);
+   pending->origin=checkpoint->releaseInput();
+   pending->checkpoint=0;
+   for (unsigned index=0,limit=runtime.getRegisterCount();index<limit;index++)
+      runtime.getRegister(index)->value=~0u;
+   map<unsigned,Register*> bindings;
+   MaterializedResult* next;
+   Operator* newTree=translateWithCheckpoint(runtime,query,projection,bindings,registers,plan,next);
+
+   // And replace the old one
+   delete tree;
+   tree=newTree;
+   for (vector<MaterializedResult*>::const_iterator iter=subsumed.begin(),limit=subsumed.end();iter!=limit;++iter) {
+      vector<unsigned>().swap((*iter)->tuples);
+      retired.push_back(*iter);
+   }
+   results.swap(live);
+   delete planGen;
+   planGen=newPlanGen;
+   pending=next;
+   copy.clear();
+   for (map<unsigned,Register*>::const_iterator iter=output.begin(),limit=output.end();iter!=limit;++iter)
+      if (bindings.count((*iter).first)&&(bindings[(*iter).first]!=(*iter).second))
+         copy.push_back(pair<Register*,Register*>(bindings[(*iter).first],(*iter).second));
+}
+//---------------------------------------------------------------------------
+unsigned Reoptimizer::first()
+   // Produce the first tuple
+{
+   while (pending)
+      reoptimize();
+
+   observedOutputCardinality=0;
+   unsigned count=tree->first();
+   if (!count)
+      return false;
+   for (vector<pair<Register*,Register*> >::const_iterator iter=copy.begin(),limit=copy.end();iter!=limit;++iter)
+      (*iter).second->value=(*iter).first->value;
+   observedOutputCardinality+=count;
+   return count;
+}
+//---------------------------------------------------------------------------
+unsigned Reoptimizer::next()
+   // Produce the next tuple
+{
+   unsigned count=tree->next();
+   if (!count)
+      return false;
+   for (vector<pair<Register*,Register*> >::const_iterator iter=copy.begin(),limit=copy.end();iter!=limit;++iter)
+      (*iter).second->value=(*iter).first->value;
+   observedOutputCardinality+=count;
+   return count;
+}
+//---------------------------------------------------------------------------
+void Reoptimizer::print(PlanPrinter& out)
+   // Print the operator tree. Debugging only.
+{
+   out.beginOperator("Reoptimizer",expectedOutputCardinality,observedOutputCardinality);
+   tree->print(out);
+   out.endOperator();
+}
+//---------------------------------------------------------------------------
+void Reoptimizer::addMergeHint(Register* reg1,Register* reg2)
+   // Add a merge join hint
+{
+   tree->addMergeHint(reg1,reg2);
+}
+//---------------------------------------------------------------------------
+void Reoptimizer::getAsyncInputCandidates(Scheduler& scheduler)
+   // Register parts of the tree that can be executed asynchronous
+{
+   // Only the input of the checkpoint is known to be executed
+   if (pending)
+      pending->checkpoint->getAsyncInputCandidates(scheduler); else
+      tree->getAsyncInputCandidates(scheduler);
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
 Operator* CodeGen::translateIntern(Runtime& runtime,const QueryGraph& query,Plan* plan,vector<Register*>& output)
    // Perform a naive translation of a query into an operator tree without output generation
 {
@@ -769,9 +1314,23 @@ Operator* CodeGen::translateIntern(Runtime& runtime,const QueryGraph& query,Plan
          if (~(*iter).id)
             projection.insert((*iter).id);
 
-      // And build the tree
-      map<unsigned,Register*> context,bindings;
-      tree=translatePlan(runtime,context,projection,bindings,registers,plan);
+      // And build the tree. If enabled via REOPTIMIZE, conjunctive queries check their intermediate results
+      // against the estimates and re-optimize the rest of the query if they are off by more than that factor.
+      // Not done with a limit, the checkpoint would materialize far more than the limit needs
+      map<unsigned,Register*> bindings;
+      const QueryGraph::SubQuery& body=query.getQuery();
+      double factor=0;
+      if (getenv("REOPTIMIZE"))
+         factor=atof(getenv("REOPTIMIZE"));
+      if ((factor>0)&&(query.getLimit()==~0u)&&body.optional.empty()&&body.unions.empty()&&body.gjoins.empty()&&body.tableFunctions.empty()) {
+         MaterializedResult* checkpoint;
+         tree=translateWithCheckpoint(runtime,query,projection,bindings,registers,plan,checkpoint);
+         if (checkpoint)
+            tree=new Reoptimizer(runtime,query,registers,projection,bindings,tree,checkpoint,factor);
+      } else {
+         map<unsigned,Register*> context;
+         tree=translatePlan(runtime,context,projection,bindings,registers,plan);
+      }
 
       // Sort if necessary
       if (query.orderBegin()!=query.orderEnd()) {
@@ -783,7 +1342,15 @@ Operator* CodeGen::translateIntern(Runtime& runtime,const QueryGraph& query,Plan
             if (~(*iter).id)
                order.push_back(pair<Register*,bool>(bindings[(*iter).id],(*iter).descending)); else
                order.push_back(pair<Register*,bool>(0,(*iter).descending));
-         tree=new Sort(runtime.getDatabase(),tree,regs,order,tree->getExpectedOutputCardinality());
+         // With a limit only the top tuples have to be kept. Not possible when showing duplicates,
+         // as the output skips tuples there
+         unsigned limit=~0u;
+         double card=tree->getExpectedOutputCardinality();
+         if ((query.getLimit()!=~0u)&&(query.getLimit())&&(query.getDuplicateHandling()!=QueryGraph::ShowDuplicates)) {
+            limit=query.getLimit();
+            if (card>limit) card=limit;
+         }
+         tree=new Sort(runtime.getDatabase(),tree,regs,order,card,limit);
       }
 
       // Remember the output registers
@@ -818,6 +1385,13 @@ Operator* CodeGen::translate(Runtime& runtime,const QueryGraph& query,Plan* plan
    return tree;
 }
 //---------------------------------------------------------------------------
+void CodeGen::getPatternRegisters(const QueryGraph& query,map<const QueryGraph::Node*,unsigned>& registers)
+   // The registers the translation uses for the patterns of a query
+{
+   map<unsigned,set<unsigned> > registerClasses;
+   allocateRegisters(registers,registerClasses,query.getQuery(),0);
+}
+//---------------------------------------------------------------------------
 void CodeGen::collectVariables(set<unsigned>& variables,Plan* plan)
    // Collect all variables contained in a plan
 {
@@ -1,4 +1,5 @@
 #include "cts/infra/QueryGraph.hpp"
+#include <algorithm>
 #include <set>
 using namespace std;
 
@@ -117,6 +118,20 @@ bool QueryGraph::Filter::isApplicable(const std::set<unsigned>& variables) const
    return true;
 }
 //---------------------------------------------------------------------------
+bool QueryGraph::Filter::isStringMatch() const
+   // Is it a string match of a variable against a constant pattern?
+{
+   switch (type) {
+      case Builtin_regex:
+         if (arg3) return false;
+         // fallthrough
+      case Builtin_contains: case Builtin_strstarts:
+         return (arg1->type==Variable)&&(arg2->type==Literal);
+      default:
+         return false;
+   }
+}
+//---------------------------------------------------------------------------
 QueryGraph::QueryGraph()
    : duplicateHandling(AllDuplicates),limit(~0u),knownEmptyResult(false)
    // Constructor
@@ -136,6 +151,29 @@ void QueryGraph::clear()
    knownEmptyResult=false;
 }
 //---------------------------------------------------------------------------
+static void swapSubQuery(QueryGraph::SubQuery& a,QueryGraph::SubQuery& b)
+   // Exchange two subqueries without copying their elements
+{
+   a.nodes.swap(b.nodes);
+   a.edges.swap(b.edges);
+   a.filters.swap(b.filters);
+   a.optional.swap(b.optional);
+   a.unions.swap(b.unions);
+   a.gjoins.swap(b.gjoins);
+   a.tableFunctions.swap(b.tableFunctions);
+}
+//---------------------------------------------------------------------------
+void QueryGraph::swap(QueryGraph& other)
+   // Exchange the contents with another graph
+{
+   swapSubQuery(query,other.query);
+   projection.swap(other.projection);
+   std::swap(duplicateHandling,other.duplicateHandling);
+   order.swap(other.order);
+   std::swap(limit,other.limit);
+   std::swap(knownEmptyResult,other.knownEmptyResult);
+}
+//---------------------------------------------------------------------------
 static bool intersects(const set<unsigned>& a,const set<unsigned>& b,vector<unsigned>& common)
    // Check if two sets overlap
 {
@@ -0,0 +1,167 @@
+#include "cts/parser/PreparedQuery.hpp"
+#include "cts/parser/SPARQLLexer.hpp"
+#include "cts/parser/SPARQLParser.hpp"
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+static bool isValueToken(SPARQLLexer::Token token)
+   // Can the token be part of a constant?
+{
+   switch (token) {
+      case SPARQLLexer::IRI: case SPARQLLexer::String: case SPARQLLexer::Identifier: case SPARQLLexer::Colon:
+      case SPARQLLexer::At: case SPARQLLexer::Type: case SPARQLLexer::Minus: case SPARQLLexer::Plus:
+      case SPARQLLexer::Integer: case SPARQLLexer::Decimal: case SPARQLLexer::Double:
+         return true;
+      default:
+         return false;
+   }
+}
+//---------------------------------------------------------------------------
+static bool isConstant(SPARQLLexer& lexer)
+   // Check for a single constant: an IRI, a prefixed name, a signed number, or a string with an optional language or type
+{
+   SPARQLLexer::Token token=lexer.getNext();
+   switch (token) {
+      case SPARQLLexer::IRI:
+         return true;
+      case SPARQLLexer::Identifier:
+         if (lexer.getNext()!=SPARQLLexer::Colon)
+            return false;
+         return lexer.getNext()==SPARQLLexer::Identifier;
+      case SPARQLLexer::Colon:
+         return lexer.getNext()==SPARQLLexer::Identifier;
+      case SPARQLLexer::Plus: case SPARQLLexer::Minus:
+         token=lexer.getNext();
+         // fallthrough
+      case SPARQLLexer::Integer: case SPARQLLexer::Decimal: case SPARQLLexer::Double:
+         return (token==SPARQLLexer::Integer)||(token==SPARQLLexer::Decimal)||(token==SPARQLLexer::Double);
+      case SPARQLLexer::String:
+         token=lexer.getNext();
+         if (token==SPARQLLexer::At)
+            return lexer.getNext()==SPARQLLexer::Identifier;
+         if (token==SPARQLLexer::Type)
+            return lexer.getNext()==SPARQLLexer::IRI;
+         lexer.unget(token);
+         return true;
+      default:
+         return false;
+   }
+}
+//---------------------------------------------------------------------------
+static void checkValue(const string& name,const string& value)
+   // Make sure that a bound value is a single constant and cannot change the query structure
+{
+   SPARQLLexer lexer(value);
+   if ((!isConstant(lexer))||(lexer.getNext()!=SPARQLLexer::Eof))
+      throw SPARQLParser::ParserException("invalid value for %"+name);
+}
+//---------------------------------------------------------------------------
+PreparedQuery::PreparedQuery()
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+PreparedQuery::PreparedQuery(const string& text)
+   : text(text)
+   // Constructor
+{
+   // Collect the placeholders and build the key
+   SPARQLLexer lexer(text);
+   for (SPARQLLexer::Token token=lexer.getNext();token!=SPARQLLexer::Eof;token=lexer.getNext()) {
+      if (token==SPARQLLexer::Error)
+         throw SPARQLParser::ParserException("lexer error in '"+lexer.getRawValue()+"'");
+      if (token==SPARQLLexer::Parameter) {
+         string name=lexer.getTokenValue();
+         bool known=false;
+         for (vector<string>::const_iterator iter=parameters.begin(),limit=parameters.end();iter!=limit;++iter)
+            if ((*iter)==name) { known=true; break; }
+         if (!known)
+            parameters.push_back(name);
+      }
+      if (!key.empty())
+         key+=' ';
+      key+=lexer.getRawValue();
+   }
+}
+//---------------------------------------------------------------------------
+string PreparedQuery::instantiate(const Bindings& bindings) const
+   // Substitute the placeholders
+{
+   // Check the values first
+   for (vector<string>::const_iterator iter=parameters.begin(),limit=parameters.end();iter!=limit;++iter) {
+      Bindings::const_iterator value=bindings.find(*iter);
+      if (value==bindings.end())
+         throw SPARQLParser::ParserException("no value bound for %"+(*iter));
+      checkValue(*iter,(*value).second);
+   }
+
+   // Copy the template, replacing the placeholders
+   string result;
+   SPARQLLexer lexer(text);
+   string::const_iterator last=lexer.getReader();
+   for (SPARQLLexer::Token token=lexer.getNext();token!=SPARQLLexer::Eof;token=lexer.getNext()) {
+      if (token!=SPARQLLexer::Parameter)
+         continue;
+      string raw=lexer.getRawValue();
+      result.append(last,lexer.getReader()-raw.length());
+      result+=' ';
+      result+=(*bindings.find(lexer.getTokenValue())).second;
+      result+=' ';
+      last=lexer.getReader();
+   }
+   result.append(last,lexer.getReader());
+   return result;
+}
+//---------------------------------------------------------------------------
+string PreparedQuery::normalize(const string& text)
+   // Normalize the query text
+{
+   string result;
+   SPARQLLexer lexer(text);
+   for (SPARQLLexer::Token token=lexer.getNext();token!=SPARQLLexer::Eof;token=lexer.getNext()) {
+      // The lexer might not advance after an error, keep the text as it is
+      if (token==SPARQLLexer::Error)
+         return text;
+      if (!result.empty())
+         result+=' ';
+      result+=lexer.getRawValue();
+   }
+   return result;
+}
+//---------------------------------------------------------------------------
+void PreparedQuery::parseBindings(const string& text,Bindings& bindings)
+   // Parse bindings of the form '%name=value ...'
+{
+   SPARQLLexer lexer(text);
+   SPARQLLexer::Token token=lexer.getNext();
+   while (token!=SPARQLLexer::Eof) {
+      if (token!=SPARQLLexer::Parameter)
+         throw SPARQLParser::ParserException("placeholder expected");
+      string name=lexer.getTokenValue();
+      if (lexer.getNext()!=SPARQLLexer::Equal)
+         throw SPARQLParser::ParserException("'=' expected after %"+name);
+
+      // The value extends up to the next placeholder
+      string::const_iterator start=lexer.getReader(),stop=start;
+      for (token=lexer.getNext();isValueToken(token);token=lexer.getNext()) {
+         if (start==stop)
+            start=lexer.getReader()-lexer.getRawValue().length();
+         stop=lexer.getReader();
+      }
+      if ((token!=SPARQLLexer::Eof)&&(token!=SPARQLLexer::Parameter))
+         throw SPARQLParser::ParserException("invalid value for %"+name);
+      if (start==stop)
+         throw SPARQLParser::ParserException("value expected for %"+name);
+      bindings[name]=string(start,stop);
+   }
+}
+//---------------------------------------------------------------------------
@@ -28,7 +28,7 @@ using namespace std;
 //--------------------------------------------------------------------------
 
 SPARQLLexer::SPARQLLexer(const std::string& input)
-   : input(input),pos(this->input.begin()),tokenStart(pos),tokenEnd(pos),
+   : input(input),pos(this->input.begin()),tokenStart(pos),tokenEnd(pos),rawStart(pos),
      putBack(None),hasTokenEnd(false)
    // Constructor
 {
@@ -68,7 +68,7 @@ SPARQLLexer::Token SPARQLLexer::getNext()
 
    // Read the string
    while (pos!=input.end()) {
-      tokenStart=pos;
+      rawStart=tokenStart=pos;
       // Interpret the first character
       switch (*(pos++)) {
          // Whitespace
@@ -223,6 +223,19 @@ SPARQLLexer::Token SPARQLLexer::getNext()
             }
             tokenEnd=pos; hasTokenEnd=true;
             return Variable;
+         // Placeholders in prepared queries
+         case '%':
+            tokenStart=pos;
+            while (pos!=input.end()) {
+               char c=*pos;
+               if (((c>='0')&&(c<='9'))||((c>='A')&&(c<='Z'))||((c>='a')&&(c<='z'))) {
+                  ++pos;
+               } else break;
+            }
+            if (pos==tokenStart)
+               return Error;
+            tokenEnd=pos; hasTokenEnd=true;
+            return Parameter;
          // Number
          case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
            while (pos!=input.end()) {
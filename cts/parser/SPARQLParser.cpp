@@ -1,5 +1,6 @@
 #include "cts/parser/SPARQLParser.hpp"
 #include "cts/parser/SPARQLLexer.hpp"
+#include <algorithm>
 #include <memory>
 #include <cstdlib>
 #include <iostream>
@@ -110,7 +111,7 @@ SPARQLParser::Filter& SPARQLParser::Filter::operator=(const Filter& other)
 }
 //---------------------------------------------------------------------------
 SPARQLParser::SPARQLParser(SPARQLLexer& lexer)
-   : lexer(lexer),variableCount(0),projectionModifier(Modifier_None),limit(~0u)
+   : lexer(lexer),variableCount(0),projectionModifier(Modifier_None),countArgument(~0u),limit(~0u)
    // Constructor
 {
 }
@@ -187,6 +188,31 @@ void SPARQLParser::parseProjection()
       } else if (token==SPARQLLexer::Mul) {
          // We do nothing here. Empty projections will be filled with all
          // named variables after parsing
+      } else if (token==SPARQLLexer::LParen) {
+         // A count aggregate, i.e. (count(*) as ?x) or (count(?y) as ?x)
+         if ((lexer.getNext()!=SPARQLLexer::Identifier)||(!lexer.isKeyword("count")))
+            throw ParserException("only count aggregates are supported");
+         if (!countName.empty())
+            throw ParserException("only one count aggregate is supported");
+         if ((projectionModifier!=Modifier_None)&&(projectionModifier!=Modifier_Count))
+            throw ParserException("count aggregates cannot be combined with projection modifiers");
+         if (lexer.getNext()!=SPARQLLexer::LParen)
+            throw ParserException("'(' expected");
+         token=lexer.getNext();
+         if (token==SPARQLLexer::Variable)
+            countArgument=nameVariable(lexer.getTokenValue()); else
+         if (token!=SPARQLLexer::Mul)
+            throw ParserException("'*' or variable expected in count aggregate");
+         if (lexer.getNext()!=SPARQLLexer::RParen)
+            throw ParserException("')' expected");
+         if ((lexer.getNext()!=SPARQLLexer::Identifier)||(!lexer.isKeyword("as")))
+            throw ParserException("'as' expected");
+         if (lexer.getNext()!=SPARQLLexer::Variable)
+            throw ParserException("variable expected after 'as'");
+         countName=lexer.getTokenValue();
+         if (lexer.getNext()!=SPARQLLexer::RParen)
+            throw ParserException("')' expected");
+         projectionModifier=Modifier_Count;
       } else {
          if (first)
             throw ParserException("projection required after select");
@@ -371,6 +397,16 @@ SPARQLParser::Filter* SPARQLParser::parseBuiltInCall(std::map<std::string,unsign
       }
       if (lexer.getNext()!=SPARQLLexer::RParen)
          throw ParserException("')' expected");
+   } else if (lexer.isKeyword("CONTAINS")||lexer.isKeyword("STRSTARTS")) {
+      result->type=lexer.isKeyword("CONTAINS")?Filter::Builtin_contains:Filter::Builtin_strstarts;
+      if (lexer.getNext()!=SPARQLLexer::LParen)
+         throw ParserException("'(' expected");
+      result->arg1=parseExpression(localVars);
+      if (lexer.getNext()!=SPARQLLexer::Comma)
+         throw ParserException("',' expected");
+      result->arg2=parseExpression(localVars);
+      if (lexer.getNext()!=SPARQLLexer::RParen)
+         throw ParserException("')' expected");
    } else if (lexer.isKeyword("in")) {
       result->type=Filter::Builtin_in;
       if (lexer.getNext()!=SPARQLLexer::LParen)
@@ -965,6 +1001,92 @@ void SPARQLParser::parseWhere()
    parseGroupGraphPattern(patterns);
 }
 
+//---------------------------------------------------------------------------
+void SPARQLParser::parseGroupBy()
+   // Parse the group by part if any
+{
+   SPARQLLexer::Token token=lexer.getNext();
+   if ((token!=SPARQLLexer::Identifier)||(!lexer.isKeyword("group"))) {
+      lexer.unget(token);
+      return;
+   }
+   if ((lexer.getNext()!=SPARQLLexer::Identifier)||(!lexer.isKeyword("by")))
+      throw ParserException("'by' expected");
+
+   while (true) {
+      token=lexer.getNext();
+      if (token==SPARQLLexer::Variable) {
+         groupBy.push_back(nameVariable(lexer.getTokenValue()));
+      } else {
+         if (groupBy.empty())
+            throw ParserException("variable expected in group-by clause");
+         lexer.unget(token);
+         return;
+      }
+   }
+}
+//---------------------------------------------------------------------------
+static bool bindsVariable(const SPARQLParser::Element& element,unsigned id)
+   // Is the element the variable?
+{
+   return (element.type==SPARQLParser::Element::Variable)&&(element.id==id);
+}
+//---------------------------------------------------------------------------
+static bool alwaysBinds(const SPARQLParser::PatternGroup& group,unsigned id)
+   // Is the variable bound in every result of the group?
+{
+   // Required patterns
+   for (vector<SPARQLParser::Pattern>::const_iterator iter=group.patterns.begin(),limit=group.patterns.end();iter!=limit;++iter)
+      if (bindsVariable((*iter).subject,id)||bindsVariable((*iter).predicate,id)||bindsVariable((*iter).object,id))
+         return true;
+
+   // A union binds it if all its parts do
+   for (vector<vector<SPARQLParser::PatternGroup> >::const_iterator iter=group.unions.begin(),limit=group.unions.end();iter!=limit;++iter) {
+      bool all=!(*iter).empty();
+      for (vector<SPARQLParser::PatternGroup>::const_iterator iter2=(*iter).begin(),limit2=(*iter).end();all&&(iter2!=limit2);++iter2)
+         all=alwaysBinds(*iter2,id);
+      if (all)
+         return true;
+   }
+
+   // A gjoin binds it if any of its parts does
+   for (vector<vector<SPARQLParser::PatternGroup> >::const_iterator iter=group.gjoins.begin(),limit=group.gjoins.end();iter!=limit;++iter)
+      for (vector<SPARQLParser::PatternGroup>::const_iterator iter2=(*iter).begin(),limit2=(*iter).end();iter2!=limit2;++iter2)
+         if (alwaysBinds(*iter2,id))
+            return true;
+
+   // Optional parts do not guarantee a binding
+   return false;
+}
+//---------------------------------------------------------------------------
+void SPARQLParser::checkAggregates()
+   // Check the use of aggregates
+{
+   // Without aggregate grouping is not supported
+   if (countName.empty()) {
+      if (!groupBy.empty())
+         throw ParserException("group-by requires a count aggregate");
+      return;
+   }
+
+   // The aggregate must be bound to a fresh variable
+   if (namedVariables.count(countName))
+      throw ParserException("the count aggregate must be bound to a new variable");
+
+   // The grouping must match the other projected variables. A count
+   // aggregate is answered by counting the duplicates of the projection.
+   vector<unsigned> p=projection,g=groupBy;
+   sort(p.begin(),p.end());
+   p.resize(unique(p.begin(),p.end())-p.begin());
+   sort(g.begin(),g.end());
+   g.resize(unique(g.begin(),g.end())-g.begin());
+   if (p!=g)
+      throw ParserException("the projection must consist of the group-by variables and the count aggregate");
+
+   // count(?x) is answered by counting rows, which is only correct if ?x is bound in all of them
+   if ((~countArgument)&&(!alwaysBinds(patterns,countArgument)))
+      throw ParserException("count of a variable is only supported if the variable is bound in every result");
+}
 //---------------------------------------------------------------------------
 void SPARQLParser::parseOrderBy()
    // Parse the order by part if any
@@ -989,7 +1111,7 @@ void SPARQLParser::parseOrderBy()
             if ((token==SPARQLLexer::Identifier)&&(lexer.isKeyword("count"))) {
                o.id=~0u;
             } else if (token==SPARQLLexer::Variable) {
-               o.id=nameVariable(lexer.getTokenValue());
+               o.id=(lexer.getTokenValue()==countName)?~0u:nameVariable(lexer.getTokenValue());
             } else throw ParserException("variable expected in order-by clause");
             if (lexer.getNext()!=SPARQLLexer::RParen)
                throw ParserException("')' expected");
@@ -1003,7 +1125,7 @@ void SPARQLParser::parseOrderBy()
          }
       } else if (token==SPARQLLexer::Variable) {
          Order o;
-         o.id=nameVariable(lexer.getTokenValue());
+         o.id=(lexer.getTokenValue()==countName)?~0u:nameVariable(lexer.getTokenValue());
          o.descending=false;
          order.push_back(o);
       } else if (token==SPARQLLexer::Eof) {
@@ -1046,6 +1168,10 @@ void SPARQLParser::parse(bool multiQuery)
    // Parse the where clause
    parseWhere();
 
+   // Parse the group by clause
+   parseGroupBy();
+   checkAggregates();
+
    // Parse the order by clause
    parseOrderBy();
 
@@ -1056,8 +1182,8 @@ void SPARQLParser::parse(bool multiQuery)
    if ((!multiQuery)&&(lexer.getNext()!=SPARQLLexer::Eof))
       throw ParserException("syntax error");
 
-   // Fixup empty projections (i.e. *)
-   if (!projection.size()) {
+   // Fixup empty projections (i.e. *). A lone count aggregate keeps the projection empty
+   if ((!projection.size())&&(countName.empty())) {
       for (map<string,unsigned>::const_iterator iter=namedVariables.begin(),limit=namedVariables.end();iter!=limit;++iter)
          projection.push_back((*iter).second);
    }
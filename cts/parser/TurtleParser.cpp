@@ -29,8 +29,8 @@ TurtleParser::Exception::~Exception()
 {
 }
 //---------------------------------------------------------------------------
-TurtleParser::Lexer::Lexer(istream& in)
-   : in(in),putBack(Eof),line(1),readBufferStart(0),readBufferEnd(0)
+TurtleParser::Lexer::Lexer(istream& in,unsigned firstLine)
+   : in(in),putBack(Eof),line(firstLine),readBufferStart(0),readBufferEnd(0)
    // Constructor
 {
 }
@@ -350,7 +350,13 @@ TurtleParser::Lexer::Token TurtleParser::Lexer::next(std::string& token)
 }
 //---------------------------------------------------------------------------
 TurtleParser::TurtleParser(istream& in)
-   : lexer(in),triplesReader(0),nextBlank(0)
+   : lexer(in,1),triplesReader(0),nextBlank(0),blankPrefix("_:_")
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+TurtleParser::TurtleParser(istream& in,unsigned firstLine,const string& blankPrefix)
+   : lexer(in,firstLine),triplesReader(0),nextBlank(0),blankPrefix(blankPrefix)
    // Constructor
 {
 }
@@ -372,7 +378,7 @@ void TurtleParser::newBlankNode(std::string& node)
    // Construct a new blank node
 {
    stringstream buffer;
-   buffer << "_:_" << (nextBlank++);
+   buffer << blankPrefix << (nextBlank++);
    node=buffer.str();
 }
 //---------------------------------------------------------------------------
@@ -635,6 +641,8 @@ void TurtleParser::parseObject(std::string& object,Type::ID& objectType,std::str
                   objectType=Type::Double;
                } else if (type=="http://www.w3.org/2001/XMLSchema#boolean") {
                   objectType=Type::Boolean;
+               } else if (type=="http://www.w3.org/2001/XMLSchema#dateTime") {
+                  objectType=Type::Date;
                } else {
                   objectType=Type::CustomType;
                   objectSubType=type;
@@ -0,0 +1,372 @@
+#include "cts/plangen/CardinalityFeedback.hpp"
+#include "cts/codegen/CodeGen.hpp"
+#include "rts/database/Database.hpp"
+#include "rts/operator/Operator.hpp"
+#include "rts/operator/PlanPrinter.hpp"
+#include "rts/runtime/Runtime.hpp"
+#include "rts/segment/FactsSegment.hpp"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <vector>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// The file header
+static const char fileHeader[] = "RDF-3X cardinality feedback 1";
+//---------------------------------------------------------------------------
+/// Collects the observations from an operator tree.
+/** The operators are visited using the plan printing mechanism. The patterns
+  * below an operator are derived from the registers of the scans, using the
+  * register allocation of the code generator, and an
+  * observed cardinality is only used if the operator was known to be executed
+  * completely.
+  */
+class CardinalityFeedback::Collector : public PlanPrinter
+{
+   private:
+   /// An operator
+   struct Frame {
+      /// The name
+      string name;
+      /// The cardinalities
+      double expected,observed;
+      /// The patterns below the operator
+      BitSet relations;
+      /// Is the operator understood?
+      bool valid;
+      /// Was the operator executed completely?
+      bool complete;
+      /// The number of inputs seen so far
+      unsigned inputs;
+      /// The observed cardinality of the first input
+      double firstInput;
+   };
+
+   /// The store
+   CardinalityFeedback& feedback;
+   /// The pattern of each scan register
+   map<const Register*,unsigned> patterns;
+   /// The query
+   const QueryGraph::SubQuery& query;
+   /// Is the output of the tree consumed completely?
+   bool unlimited;
+   /// The currently open operators
+   vector<Frame> frames;
+
+   public:
+   /// Constructor
+   Collector(CardinalityFeedback& feedback,Runtime& runtime,const QueryGraph& query,bool unlimited);
+
+   /// Begin a new operator
+   void beginOperator(const string& name,double expectedOutputCardinality,unsigned observedOutputCardinality);
+   /// Add an operator argument annotation
+   void addArgumentAnnotation(const string& /*argument*/) {}
+   /// Add a scan annotation
+   void addScanAnnotation(const Register* reg,bool bound);
+   /// Add a predicate annotate
+   void addEqualPredicateAnnotation(const Register* /*reg1*/,const Register* /*reg2*/) {}
+   /// Add a materialization annotation
+   void addMaterializationAnnotation(const vector<Register*>& /*regs*/) {}
+   /// Add a generic annotation
+   void addGenericAnnotation(const string& /*text*/) {}
+   /// Close the current operator
+   void endOperator();
+
+   /// Format a register (for generic annotations)
+   string formatRegister(const Register* /*reg*/) { return string(); }
+   /// Format a constant value (for generic annotations)
+   string formatValue(unsigned /*value*/) { return string(); }
+};
+//---------------------------------------------------------------------------
+CardinalityFeedback::Collector::Collector(CardinalityFeedback& feedback,Runtime& runtime,const QueryGraph& query,bool unlimited)
+   : feedback(feedback),query(query.getQuery()),unlimited(unlimited)
+   // Constructor
+{
+   map<const QueryGraph::Node*,unsigned> registers;
+   CodeGen::getPatternRegisters(query,registers);
+   for (unsigned index=0;(index<this->query.nodes.size())&&(index<BitSet::maxWidth);index++) {
+      unsigned reg=registers[&(this->query.nodes[index])];
+      for (unsigned slot=0;slot<3;slot++)
+         if (reg+slot<runtime.getRegisterCount())
+            patterns[runtime.getRegister(reg+slot)]=index;
+   }
+}
+//---------------------------------------------------------------------------
+static bool isScan(const string& name)
+   // Is the operator a scan?
+{
+   return (name=="IndexScan")||(name=="AggregatedIndexScan")||(name=="FullyAggregatedIndexScan");
+}
+//---------------------------------------------------------------------------
+static bool isJoin(const string& name)
+   // Does the operator produce a join result? Selections check additional join predicates
+{
+   return (name=="MergeJoin")||(name=="HashJoin")||(name=="Selection");
+}
+//---------------------------------------------------------------------------
+static bool isPipeline(const string& name)
+   // Does the operator pass on its input without changing the join result?
+{
+   return (name=="Selection")||(name=="HashGroupify")||(name=="Reoptimizer")||(name=="ResultsPrinter");
+}
+//---------------------------------------------------------------------------
+void CardinalityFeedback::Collector::beginOperator(const string& name,double expectedOutputCardinality,unsigned observedOutputCardinality)
+   // Begin a new operator
+{
+   Frame frame;
+   frame.name=name;
+   frame.expected=expectedOutputCardinality;
+   frame.observed=observedOutputCardinality;
+   frame.valid=isScan(name)||isJoin(name)||isPipeline(name)||(name=="Checkpoint")||(name=="Sort")||(name=="TopK");
+   frame.inputs=0;
+   frame.firstInput=0;
+
+   // Determine if the input was consumed completely
+   if (frames.empty()) {
+      frame.complete=true;
+   } else {
+      Frame& parent=frames.back();
+      if ((parent.name=="Checkpoint")||(parent.name=="Sort")||(parent.name=="TopK")) {
+         // Materializing operators
+         frame.complete=true;
+      } else if (parent.name=="ResultsPrinter") {
+         frame.complete=unlimited;
+      } else if (isPipeline(parent.name)) {
+         frame.complete=parent.complete;
+      } else if (parent.name=="HashJoin") {
+         // The probe input is only read if the hash table is not empty
+         frame.complete=parent.complete&&((!parent.inputs)||(parent.firstInput>0));
+      } else {
+         // Merge joins stop once one input is exhausted
+         frame.complete=false;
+      }
+      if (!(parent.inputs++))
+         parent.firstInput=observedOutputCardinality;
+   }
+
+   frames.push_back(frame);
+}
+//---------------------------------------------------------------------------
+void CardinalityFeedback::Collector::addScanAnnotation(const Register* reg,bool /*bound*/)
+   // Add a scan annotation
+{
+   map<const Register*,unsigned>::const_iterator pos=patterns.find(reg);
+   if (pos!=patterns.end())
+      frames.back().relations.set((*pos).second);
+}
+//---------------------------------------------------------------------------
+void CardinalityFeedback::Collector::endOperator()
+   // Close the current operator
+{
+   Frame frame=frames.back();
+   frames.pop_back();
+   if (isScan(frame.name)&&frame.relations.empty())
+      frame.valid=false;
+
+   // Record join results
+   if (frame.valid&&frame.complete&&isJoin(frame.name)&&(!frame.relations.empty())) {
+      BitSet single;
+      single.set(frame.relations.first());
+      if (frame.relations!=single)
+         feedback.record(signature(query,frame.relations),frame.expected,frame.observed);
+   }
+
+   // Propagate to the parent
+   if (!frames.empty()) {
+      Frame& parent=frames.back();
+      parent.relations=parent.relations.unionWith(frame.relations);
+      parent.valid=parent.valid&&frame.valid;
+   }
+}
+//---------------------------------------------------------------------------
+static uint64_t computeDatabaseVersion(Database& db)
+   // Fingerprint of the database contents
+{
+   uint64_t result=0;
+   for (unsigned index=0;index<6;index++) {
+      Database::DataOrder order=static_cast<Database::DataOrder>(index);
+      result=(result*31)+db.getFacts(order).getCardinality();
+      result=(result*31)+db.getFacts(order).getPages();
+   }
+   return result;
+}
+//---------------------------------------------------------------------------
+CardinalityFeedback::CardinalityFeedback()
+   : maxEntries(10000),clock(0),version(0),storedVersion(0),databaseVersion(0)
+   // Constructor
+{
+   if (getenv("FEEDBACKSIZE"))
+      maxEntries=atoi(getenv("FEEDBACKSIZE"));
+}
+//---------------------------------------------------------------------------
+CardinalityFeedback::~CardinalityFeedback()
+   // Destructor
+{
+}
+//---------------------------------------------------------------------------
+string CardinalityFeedback::signature(const QueryGraph::SubQuery& query,const BitSet& relations)
+   // The signature of a set of patterns of the query
+{
+   ostringstream out;
+   map<unsigned,unsigned> variables;
+   bool first=true;
+   for (unsigned index=0;(index<query.nodes.size())&&(index<BitSet::maxWidth);index++) {
+      if (!relations.test(index))
+         continue;
+      if (first)
+         first=false; else
+         out << " . ";
+
+      // Constants are kept, variables are numbered by their first occurrence
+      const QueryGraph::Node& node=query.nodes[index];
+      for (unsigned slot=0;slot<3;slot++) {
+         bool constant=(slot==0)?node.constSubject:((slot==1)?node.constPredicate:node.constObject);
+         unsigned value=(slot==0)?node.subject:((slot==1)?node.predicate:node.object);
+         if (slot)
+            out << ' ';
+         if (constant) {
+            out << value;
+         } else {
+            if (!variables.count(value)) {
+               unsigned id=variables.size();
+               variables[value]=id;
+            }
+            out << '?' << variables[value];
+         }
+      }
+   }
+   return out.str();
+}
+//---------------------------------------------------------------------------
+bool CardinalityFeedback::lookup(const string& signature,double& cardinality) const
+   // Look up the observed cardinality
+{
+   map<string,Entry>::const_iterator pos=entries.find(signature);
+   if (pos==entries.end())
+      return false;
+   (*pos).second.lastUse=++clock;
+   cardinality=(*pos).second.observed;
+   return true;
+}
+//---------------------------------------------------------------------------
+void CardinalityFeedback::record(const string& signature,double expected,double observed)
+   // Record an observation
+{
+   map<string,Entry>::iterator pos=entries.find(signature);
+   if (pos!=entries.end()) {
+      // Only substantial changes invalidate plans
+      Entry& entry=(*pos).second;
+      double a=(entry.observed<1)?1:entry.observed,b=(observed<1)?1:observed;
+      if ((a>2*b)||(b>2*a))
+         version++;
+      entry.observed=observed;
+      entry.expected=expected;
+      entry.observations++;
+      entry.lastUse=++clock;
+      return;
+   }
+
+   // Make room for a new entry, dropping the least recently used one
+   if (!maxEntries)
+      return;
+   if (entries.size()>=maxEntries) {
+      map<string,Entry>::iterator victim=entries.begin();
+      for (map<string,Entry>::iterator iter=entries.begin(),limit=entries.end();iter!=limit;++iter)
+         if ((*iter).second.lastUse<(*victim).second.lastUse)
+            victim=iter;
+      entries.erase(victim);
+   }
+   Entry& entry=entries[signature];
+   entry.observed=observed;
+   entry.expected=expected;
+   entry.observations=1;
+   entry.lastUse=++clock;
+   version++;
+}
+//---------------------------------------------------------------------------
+void CardinalityFeedback::observe(Runtime& runtime,const QueryGraph& query,Operator* tree)
+   // Record the join cardinalities of an executed operator tree
+{
+   // Only conjunctive queries without filters are understood
+   const QueryGraph::SubQuery& body=query.getQuery();
+   if (query.knownEmpty()||(!tree)||body.filters.size()||body.optional.size()||body.unions.size()||body.gjoins.size()||body.tableFunctions.size())
+      return;
+
+   Collector collector(*this,runtime,query,query.getLimit()==~0u);
+   tree->print(collector);
+}
+//---------------------------------------------------------------------------
+bool CardinalityFeedback::load(Database& db,const char* fileName)
+   // Load the observations for a database
+{
+   clear();
+   storedVersion=version;
+   databaseVersion=computeDatabaseVersion(db);
+
+   ifstream in(fileName);
+   if (!in.is_open())
+      return false;
+   string header;
+   uint64_t fileVersion;
+   if ((!getline(in,header))||(header.substr(0,sizeof(fileHeader)-1)!=fileHeader))
+      return false;
+   istringstream headerIn(header.substr(sizeof(fileHeader)-1));
+   if ((!(headerIn >> fileVersion))||(fileVersion!=databaseVersion))
+      return true;
+
+   // Read the entries
+   while (true) {
+      Entry entry;
+      string signature;
+      if (!(in >> entry.observed >> entry.expected >> entry.observations))
+         break;
+      in.get();
+      if (!getline(in,signature))
+         break;
+      entry.lastUse=++clock;
+      entries[signature]=entry;
+   }
+   return true;
+}
+//---------------------------------------------------------------------------
+bool CardinalityFeedback::store(const char* fileName) const
+   // Store the observations
+{
+   ofstream out(fileName);
+   if (!out.is_open())
+      return false;
+   out << fileHeader << " " << databaseVersion << endl;
+   out.precision(17);
+   for (map<string,Entry>::const_iterator iter=entries.begin(),limit=entries.end();iter!=limit;++iter)
+      out << (*iter).second.observed << " " << (*iter).second.expected << " " << (*iter).second.observations << " " << (*iter).first << endl;
+   if (!out.good())
+      return false;
+   storedVersion=version;
+   return true;
+}
+//---------------------------------------------------------------------------
+bool CardinalityFeedback::storeChanges(const char* fileName,unsigned minChanges) const
+   // Store the observations if enough estimates changed
+{
+   if ((version-storedVersion)<(minChanges?minChanges:1))
+      return true;
+   return store(fileName);
+}
+//---------------------------------------------------------------------------
+void CardinalityFeedback::clear()
+   // Remove all observations
+{
+   entries.clear();
+   version++;
+}
+//---------------------------------------------------------------------------
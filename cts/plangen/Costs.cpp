@@ -0,0 +1,70 @@
+#include "cts/plangen/Costs.hpp"
+#include <fstream>
+#include <sstream>
+#include <string>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+Costs::Profile Costs::profile;
+//---------------------------------------------------------------------------
+Costs::Profile::Profile()
+   : seekCosts(95),scanCosts(17),cpuSpeed(100000),hashSetup(300000),hashBuild(0.1),hashProbe(0.01),exchangeSetup(1000)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+bool Costs::Profile::load(const char* fileName)
+   // Read a profile
+{
+   ifstream in(fileName);
+   if (!in.is_open())
+      return false;
+
+   // One 'name value' pair per line, # starts a comment
+   string line;
+   while (getline(in,line)) {
+      if (line.empty()||(line[0]=='#'))
+         continue;
+      istringstream lineIn(line);
+      string name;
+      double value;
+      if ((!(lineIn >> name >> value))||(value<=0))
+         return false;
+      if (name=="seek") seekCosts=value; else
+      if (name=="scan") scanCosts=value; else
+      if (name=="cpuSpeed") cpuSpeed=value; else
+      if (name=="hashSetup") hashSetup=value; else
+      if (name=="hashBuild") hashBuild=value; else
+      if (name=="hashProbe") hashProbe=value; else
+      if (name=="exchangeSetup") exchangeSetup=value; else
+         return false;
+   }
+   return true;
+}
+//---------------------------------------------------------------------------
+bool Costs::Profile::store(const char* fileName) const
+   // Write a profile
+{
+   ofstream out(fileName);
+   if (!out.is_open())
+      return false;
+   out << "# RDF-3X cost profile, costs in 1/10ms" << endl
+       << "seek " << seekCosts << endl
+       << "scan " << scanCosts << endl
+       << "cpuSpeed " << cpuSpeed << endl
+       << "hashSetup " << hashSetup << endl
+       << "hashBuild " << hashBuild << endl
+       << "hashProbe " << hashProbe << endl
+       << "exchangeSetup " << exchangeSetup << endl;
+   return out.good();
+}
+//---------------------------------------------------------------------------
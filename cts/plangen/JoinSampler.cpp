@@ -0,0 +1,344 @@
+#include "cts/plangen/JoinSampler.hpp"
+#include "rts/database/Database.hpp"
+#include "rts/segment/AggregatedFactsSegment.hpp"
+#include "rts/segment/ExactStatisticsSegment.hpp"
+#include "rts/segment/FactsSegment.hpp"
+#include "rts/segment/FullyAggregatedFactsSegment.hpp"
+#include <algorithm>
+#include <set>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// The positions of subject (0), predicate (1) and object (2) in the data orders
+static const unsigned layouts[6][3] = {{0,1,2},{0,2,1},{2,1,0},{2,0,1},{1,0,2},{1,2,0}};
+//---------------------------------------------------------------------------
+static void decompose(const QueryGraph::Node& node,bool* constant,unsigned* value)
+   // Get the entries of a pattern
+{
+   constant[0]=node.constSubject; value[0]=node.subject;
+   constant[1]=node.constPredicate; value[1]=node.predicate;
+   constant[2]=node.constObject; value[2]=node.object;
+}
+//---------------------------------------------------------------------------
+static unsigned lookupKey(const QueryGraph::Node& node,const map<unsigned,unsigned>& bindings,bool* constant,unsigned* value,unsigned* key,unsigned& boundCount)
+   // Determine the known values of a pattern. Returns an order that has them as prefix
+{
+   bool bound[3];
+   decompose(node,constant,value);
+   boundCount=0;
+   for (unsigned index=0;index<3;index++) {
+      if (constant[index]) {
+         bound[index]=true;
+         key[index]=value[index];
+      } else {
+         map<unsigned,unsigned>::const_iterator pos=bindings.find(value[index]);
+         if ((bound[index]=(pos!=bindings.end())))
+            key[index]=(*pos).second;
+      }
+      if (bound[index])
+         boundCount++;
+   }
+
+   unsigned order=0;
+   for (;order<6;order++) {
+      bool prefix=true;
+      for (unsigned index=0;index<boundCount;index++)
+         if (!bound[layouts[order][index]])
+            prefix=false;
+      if (prefix)
+         break;
+   }
+   return order;
+}
+//---------------------------------------------------------------------------
+JoinSampler::JoinSampler(Database& db,const QueryGraph::SubQuery& query,unsigned budget,unsigned walks)
+   : db(db),query(query),walks(walks),budget(budget),seed(88172645463325252ull),exhausted(!budget)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+JoinSampler::~JoinSampler()
+   // Destructor
+{
+}
+//---------------------------------------------------------------------------
+unsigned JoinSampler::random(unsigned limit)
+   // A random number in [0,limit)
+{
+   // xorshift, the fixed seed keeps the plans reproducible
+   seed^=seed<<13;
+   seed^=seed>>7;
+   seed^=seed<<17;
+   return static_cast<unsigned>((seed>>11)%limit);
+}
+//---------------------------------------------------------------------------
+bool JoinSampler::timeUp()
+   // Check the time budget
+{
+   if ((!exhausted)&&((Timestamp()-start)>=budget))
+      exhausted=true;
+   return exhausted;
+}
+//---------------------------------------------------------------------------
+bool JoinSampler::scan(const QueryGraph::Node& node,const map<unsigned,unsigned>& bindings,unsigned size,vector<unsigned>& sample,double& count)
+   // Scan the matches of a pattern consistent with the bindings
+{
+   // Determine the known values and an order that has them as prefix
+   bool constant[3];
+   unsigned value[3],key[3],boundCount;
+   unsigned order=lookupKey(node,bindings,constant,value,key,boundCount);
+   const unsigned* layout=layouts[order];
+
+   // Scan the range, keeping a reservoir sample
+   sample.clear();
+   count=0;
+   FactsSegment::Scan scan;
+   unsigned start[3];
+   for (unsigned index=0;index<3;index++)
+      start[index]=(index<boundCount)?key[layout[index]]:0;
+   if (!scan.first(db.getFacts(static_cast<Database::DataOrder>(order)),start[0],start[1],start[2]))
+      return true;
+   unsigned triple[3];
+   do {
+      triple[layout[0]]=scan.getValue1();
+      triple[layout[1]]=scan.getValue2();
+      triple[layout[2]]=scan.getValue3();
+      bool inRange=true;
+      for (unsigned index=0;index<boundCount;index++)
+         if (triple[layout[index]]!=key[layout[index]])
+            inRange=false;
+      if (!inRange)
+         break;
+
+      // Variables occurring twice in the pattern must agree
+      bool matches=true;
+      for (unsigned index=0;index<3;index++)
+         for (unsigned index2=index+1;index2<3;index2++)
+            if ((!constant[index])&&(!constant[index2])&&(value[index]==value[index2])&&(triple[index]!=triple[index2]))
+               matches=false;
+      if (!matches)
+         continue;
+
+      // Reservoir sampling
+      count+=1;
+      if (sample.size()<3*size) {
+         sample.insert(sample.end(),triple,triple+3);
+      } else {
+         unsigned slot=random(static_cast<unsigned>(count));
+         if (slot<size)
+            for (unsigned index=0;index<3;index++)
+               sample[3*slot+index]=triple[index];
+      }
+      if ((!(static_cast<unsigned>(count)&4095))&&timeUp())
+         return false;
+   } while (scan.next());
+
+   return true;
+}
+//---------------------------------------------------------------------------
+bool JoinSampler::pick(const QueryGraph::Node& node,const map<unsigned,unsigned>& bindings,vector<unsigned>& choice,double& fanout)
+   // Pick a random match of a pattern consistent with the bindings
+{
+   // Determine the known values and an order that has them as prefix
+   bool constant[3];
+   unsigned value[3],key[3],boundCount;
+   unsigned order=lookupKey(node,bindings,constant,value,key,boundCount);
+   const unsigned* layout=layouts[order];
+   Database::DataOrder dataOrder=static_cast<Database::DataOrder>(order);
+
+   // The aggregated counts do not know about unbound variables occurring twice
+   for (unsigned index=0;index<3;index++)
+      for (unsigned index2=index+1;index2<3;index2++)
+         if ((!constant[index])&&(!constant[index2])&&(value[index]==value[index2])&&(!bindings.count(value[index])))
+            return scan(node,bindings,1,choice,fanout);
+   if (!boundCount)
+      return scan(node,bindings,1,choice,fanout);
+
+   // Take the fan-out from the aggregated indexes and choose a position within it
+   choice.clear();
+   fanout=0;
+   unsigned prefix[3],position=0;
+   for (unsigned index=0;index<boundCount;index++)
+      prefix[index]=key[layout[index]];
+   if (boundCount==2) {
+      AggregatedFactsSegment::Scan scan;
+      if ((!scan.first(db.getAggregatedFacts(dataOrder),prefix[0],prefix[1]))||(scan.getValue1()!=prefix[0])||(scan.getValue2()!=prefix[1]))
+         return true;
+      fanout=scan.getCount();
+      position=random(scan.getCount());
+      prefix[2]=0;
+   } else if (boundCount==1) {
+      FullyAggregatedFactsSegment::Scan scan;
+      if ((!scan.first(db.getFullyAggregatedFacts(dataOrder),prefix[0]))||(scan.getValue1()!=prefix[0]))
+         return true;
+      fanout=scan.getCount();
+      position=random(scan.getCount());
+
+      // Skip whole groups of the second value
+      AggregatedFactsSegment::Scan groups;
+      bool found=groups.first(db.getAggregatedFacts(dataOrder),prefix[0],0);
+      for (;found&&(groups.getValue1()==prefix[0]);found=groups.next()) {
+         if (position<groups.getCount())
+            break;
+         position-=groups.getCount();
+      }
+      if ((!found)||(groups.getValue1()!=prefix[0])) {
+         fanout=0;
+         return true;
+      }
+      prefix[1]=groups.getValue2();
+      prefix[2]=0;
+   }
+
+   // Step to the chosen triple, the facts themselves have no positional access
+   FactsSegment::Scan scan;
+   bool found=scan.first(db.getFacts(dataOrder),prefix[0],prefix[1],prefix[2]);
+   for (;found&&position;--position) {
+      found=scan.next();
+      if ((!(position&4095))&&timeUp())
+         return false;
+   }
+   if ((!found)||(scan.getValue1()!=prefix[0])||(scan.getValue2()!=prefix[1])||((boundCount==3)&&(scan.getValue3()!=prefix[2]))) {
+      fanout=0;
+      return true;
+   }
+   if (boundCount==3)
+      fanout=1;
+   choice.resize(3);
+   choice[layout[0]]=scan.getValue1();
+   choice[layout[1]]=scan.getValue2();
+   choice[layout[2]]=scan.getValue3();
+   return true;
+}
+//---------------------------------------------------------------------------
+const JoinSampler::Sample& JoinSampler::getSample(unsigned node)
+   // Get the sample of a start pattern
+{
+   if (samples.count(node))
+      return samples[node];
+
+   Sample& sample=samples[node];
+   map<unsigned,unsigned> bindings;
+   sample.valid=scan(query.nodes[node],bindings,walks,sample.triples,sample.cardinality);
+   return sample;
+}
+//---------------------------------------------------------------------------
+double JoinSampler::estimate(const BitSet& relations)
+   // Estimate the cardinality of the join of some patterns
+{
+   if (timeUp())
+      return -1;
+
+   // Start with the most selective pattern
+   vector<unsigned> nodes;
+   unsigned startNode=~0u;
+   double startCardinality=0;
+   for (unsigned index=0;index<BitSet::maxWidth;index++) {
+      if (!relations.test(index))
+         continue;
+      if (index>=query.nodes.size())
+         return -1;
+      const QueryGraph::Node& node=query.nodes[index];
+      double cardinality=db.getExactStatistics().getCardinality(node.constSubject?node.subject:~0u,node.constPredicate?node.predicate:~0u,node.constObject?node.object:~0u);
+      if ((!~startNode)||(cardinality<startCardinality)) {
+         startNode=index;
+         startCardinality=cardinality;
+      }
+      nodes.push_back(index);
+   }
+   if (nodes.size()<2)
+      return -1;
+
+   // Extend the walk by connected patterns, preferring the ones with most known values
+   vector<unsigned> walk;
+   set<unsigned> variables;
+   walk.push_back(startNode);
+   while (true) {
+      const QueryGraph::Node& last=query.nodes[walk.back()];
+      if (!last.constSubject) variables.insert(last.subject);
+      if (!last.constPredicate) variables.insert(last.predicate);
+      if (!last.constObject) variables.insert(last.object);
+      if (walk.size()==nodes.size())
+         break;
+
+      unsigned best=~0u,bestKnown=0;
+      for (vector<unsigned>::const_iterator iter=nodes.begin(),limit=nodes.end();iter!=limit;++iter) {
+         if (find(walk.begin(),walk.end(),*iter)!=walk.end())
+            continue;
+         bool constant[3]; unsigned value[3];
+         decompose(query.nodes[*iter],constant,value);
+         unsigned known=0;
+         bool connected=false;
+         for (unsigned index=0;index<3;index++)
+            if (constant[index]) {
+               known++;
+            } else if (variables.count(value[index])) {
+               known++;
+               connected=true;
+            }
+         if (connected&&((!~best)||(known>bestKnown))) {
+            best=*iter;
+            bestKnown=known;
+         }
+      }
+      if (!~best)
+         return -1;
+      walk.push_back(best);
+   }
+
+   // Sample the start pattern
+   const Sample& sample=getSample(startNode);
+   if (!sample.valid)
+      return -1;
+   if (sample.triples.empty())
+      return 0;
+
+   // Perform the walks
+   double sum=0;
+   unsigned done=0;
+   map<unsigned,unsigned> bindings;
+   vector<unsigned> choice;
+   const QueryGraph::Node& first=query.nodes[startNode];
+   for (unsigned walkIndex=0,starts=sample.triples.size()/3;walkIndex<walks;walkIndex++) {
+      // Small samples are used repeatedly
+      unsigned index=walkIndex%starts;
+      bindings.clear();
+      if (!first.constSubject) bindings[first.subject]=sample.triples[3*index];
+      if (!first.constPredicate) bindings[first.predicate]=sample.triples[3*index+1];
+      if (!first.constObject) bindings[first.object]=sample.triples[3*index+2];
+
+      double weight=1;
+      for (unsigned step=1;step<walk.size();step++) {
+         const QueryGraph::Node& node=query.nodes[walk[step]];
+         double fanout;
+         if (!pick(node,bindings,choice,fanout))
+            break;
+         if (!(weight*=fanout))
+            break;
+         if (!node.constSubject) bindings[node.subject]=choice[0];
+         if (!node.constPredicate) bindings[node.predicate]=choice[1];
+         if (!node.constObject) bindings[node.object]=choice[2];
+      }
+      if (exhausted)
+         break;
+      sum+=weight;
+      done++;
+      if (timeUp())
+         break;
+   }
+
+   // Walks that found nothing carry no information about rare results
+   if ((!done)||(sum<=0))
+      return -1;
+   return sample.cardinality*sum/done;
+}
+//---------------------------------------------------------------------------
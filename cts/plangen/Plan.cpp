@@ -47,6 +47,8 @@ void Plan::print(unsigned indent) const
       case MergeUnion: cout << "MergeUnion"; break;
       case TableFunction: cout << "TableFunction"; break;
       case Singleton: cout << "Singleton"; break;
+      case Materialized: cout << "Materialized"; break;
+      case Exchange: cout << "Exchange " << (right-static_cast<Plan*>(0)); break;
    }
    cout << " cardinality=" << cardinality << " costs=" << costs << endl;
    switch (op) {
@@ -63,6 +65,8 @@ void Plan::print(unsigned indent) const
       case MergeUnion: left->print(indent+1); right->print(indent+1); break;
       case TableFunction: left->print(indent+1); break;
       case Singleton: break;
+      case Materialized: break;
+      case Exchange: left->print(indent+1); break;
    }
 }
 //---------------------------------------------------------------------------
@@ -0,0 +1,266 @@
+#include "cts/plangen/PlanCache.hpp"
+#include "cts/infra/QueryGraph.hpp"
+#include "cts/plangen/PlanGen.hpp"
+#include "cts/plangen/CardinalityFeedback.hpp"
+#include "rts/database/Database.hpp"
+#include "rts/segment/AggregatedFactsSegment.hpp"
+#include "rts/segment/ExactStatisticsSegment.hpp"
+#include "rts/segment/FactsSegment.hpp"
+#include <algorithm>
+#include <cstdlib>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// A cached plan
+struct PlanCache::Entry {
+   /// The key
+   string key;
+   /// The query graph the plan refers to
+   QueryGraph query;
+   /// The plan generator owning the plan
+   PlanGen plangen;
+   /// The plan
+   Plan* plan;
+   /// The cardinalities of the constant patterns the plan was built for
+   vector<unsigned> cardinalities;
+   /// The version of the observed cardinalities the plan was built for
+   unsigned feedbackVersion;
+   /// The position in the LRU list
+   list<Entry*>::iterator position;
+};
+//---------------------------------------------------------------------------
+static uint64_t computeStatisticsVersion(Database& db)
+   // Fingerprint of the statistics used by the plan generator
+{
+   uint64_t result=0;
+   for (unsigned index=0;index<6;index++) {
+      Database::DataOrder order=static_cast<Database::DataOrder>(index);
+      result=(result*31)+db.getFacts(order).getCardinality();
+      result=(result*31)+db.getFacts(order).getPages();
+      result=(result*31)+db.getAggregatedFacts(order).getPages();
+   }
+   return result;
+}
+//---------------------------------------------------------------------------
+static void collectCardinalities(Database& db,const QueryGraph::SubQuery& query,vector<unsigned>& cardinalities)
+   // Collect the cardinalities of all constant patterns
+{
+   ExactStatisticsSegment& stats=db.getExactStatistics();
+   for (vector<QueryGraph::Node>::const_iterator iter=query.nodes.begin(),limit=query.nodes.end();iter!=limit;++iter) {
+      const QueryGraph::Node& n=*iter;
+      if (n.constSubject||n.constPredicate||n.constObject)
+         cardinalities.push_back(stats.getCardinality(n.constSubject?n.subject:~0u,n.constPredicate?n.predicate:~0u,n.constObject?n.object:~0u));
+   }
+   for (vector<QueryGraph::SubQuery>::const_iterator iter=query.optional.begin(),limit=query.optional.end();iter!=limit;++iter)
+      collectCardinalities(db,*iter,cardinalities);
+   for (vector<vector<QueryGraph::SubQuery> >::const_iterator iter=query.unions.begin(),limit=query.unions.end();iter!=limit;++iter)
+      for (vector<QueryGraph::SubQuery>::const_iterator iter2=(*iter).begin(),limit2=(*iter).end();iter2!=limit2;++iter2)
+         collectCardinalities(db,*iter2,cardinalities);
+   for (vector<vector<QueryGraph::SubQuery> >::const_iterator iter=query.gjoins.begin(),limit=query.gjoins.end();iter!=limit;++iter)
+      for (vector<QueryGraph::SubQuery>::const_iterator iter2=(*iter).begin(),limit2=(*iter).end();iter2!=limit2;++iter2)
+         collectCardinalities(db,*iter2,cardinalities);
+}
+//---------------------------------------------------------------------------
+static bool sameShape(const QueryGraph::Filter* a,const QueryGraph::Filter* b)
+   // Do two filters differ only in their constants?
+{
+   if ((!a)||(!b))
+      return a==b;
+   if (a->type!=b->type)
+      return false;
+   switch (a->type) {
+      case QueryGraph::Filter::Literal: case QueryGraph::Filter::IRI: case QueryGraph::Filter::Null: break;
+      default: if ((a->id!=b->id)||(a->value!=b->value)) return false;
+   }
+   return sameShape(a->arg1,b->arg1)&&sameShape(a->arg2,b->arg2)&&sameShape(a->arg3,b->arg3);
+}
+//---------------------------------------------------------------------------
+static bool sameShape(const QueryGraph::SubQuery& a,const QueryGraph::SubQuery& b)
+   // Do two subqueries differ only in their constants?
+{
+   if ((a.nodes.size()!=b.nodes.size())||(a.edges.size()!=b.edges.size())||(a.filters.size()!=b.filters.size())||
+       (a.optional.size()!=b.optional.size())||(a.unions.size()!=b.unions.size())||(a.gjoins.size()!=b.gjoins.size())||(a.tableFunctions.size()!=b.tableFunctions.size()))
+      return false;
+
+   for (unsigned index=0;index<a.nodes.size();index++) {
+      const QueryGraph::Node& n1=a.nodes[index],&n2=b.nodes[index];
+      if ((n1.constSubject!=n2.constSubject)||(n1.constPredicate!=n2.constPredicate)||(n1.constObject!=n2.constObject))
+         return false;
+      if (((!n1.constSubject)&&(n1.subject!=n2.subject))||((!n1.constPredicate)&&(n1.predicate!=n2.predicate))||((!n1.constObject)&&(n1.object!=n2.object)))
+         return false;
+   }
+   for (unsigned index=0;index<a.edges.size();index++)
+      if ((a.edges[index].from!=b.edges[index].from)||(a.edges[index].to!=b.edges[index].to)||(a.edges[index].common!=b.edges[index].common))
+         return false;
+   for (unsigned index=0;index<a.filters.size();index++)
+      if (!sameShape(&a.filters[index],&b.filters[index]))
+         return false;
+   for (unsigned index=0;index<a.optional.size();index++)
+      if (!sameShape(a.optional[index],b.optional[index]))
+         return false;
+   for (unsigned index=0;index<a.unions.size();index++) {
+      if (a.unions[index].size()!=b.unions[index].size())
+         return false;
+      for (unsigned index2=0;index2<a.unions[index].size();index2++)
+         if (!sameShape(a.unions[index][index2],b.unions[index][index2]))
+            return false;
+   }
+   for (unsigned index=0;index<a.gjoins.size();index++) {
+      if (a.gjoins[index].size()!=b.gjoins[index].size())
+         return false;
+      for (unsigned index2=0;index2<a.gjoins[index].size();index2++)
+         if (!sameShape(a.gjoins[index][index2],b.gjoins[index][index2]))
+            return false;
+   }
+   for (unsigned index=0;index<a.tableFunctions.size();index++) {
+      const QueryGraph::TableFunction& f1=a.tableFunctions[index],&f2=b.tableFunctions[index];
+      if ((f1.name!=f2.name)||(f1.input.size()!=f2.input.size())||(f1.output!=f2.output))
+         return false;
+      for (unsigned index2=0;index2<f1.input.size();index2++)
+         if (f1.input[index2].id!=f2.input[index2].id)
+            return false;
+   }
+   return true;
+}
+//---------------------------------------------------------------------------
+static bool sameShape(const QueryGraph& a,const QueryGraph& b)
+   // Do two queries differ only in their constants?
+{
+   if ((a.getDuplicateHandling()!=b.getDuplicateHandling())||(a.getLimit()!=b.getLimit()))
+      return false;
+   if (!equal(a.projectionBegin(),a.projectionEnd(),b.projectionBegin())||((a.projectionEnd()-a.projectionBegin())!=(b.projectionEnd()-b.projectionBegin())))
+      return false;
+   if ((a.orderEnd()-a.orderBegin())!=(b.orderEnd()-b.orderBegin()))
+      return false;
+   for (QueryGraph::order_iterator iter=a.orderBegin(),iter2=b.orderBegin(),limit=a.orderEnd();iter!=limit;++iter,++iter2)
+      if (((*iter).id!=(*iter2).id)||((*iter).descending!=(*iter2).descending))
+         return false;
+   return sameShape(a.getQuery(),b.getQuery());
+}
+//---------------------------------------------------------------------------
+static void copyConstants(QueryGraph::SubQuery& target,const QueryGraph::SubQuery& source)
+   // Copy the constants of an equally shaped subquery. The elements keep their addresses
+{
+   for (unsigned index=0;index<target.nodes.size();index++)
+      target.nodes[index]=source.nodes[index];
+   for (unsigned index=0;index<target.filters.size();index++)
+      target.filters[index]=source.filters[index];
+   for (unsigned index=0;index<target.tableFunctions.size();index++)
+      target.tableFunctions[index]=source.tableFunctions[index];
+   for (unsigned index=0;index<target.optional.size();index++)
+      copyConstants(target.optional[index],source.optional[index]);
+   for (unsigned index=0;index<target.unions.size();index++)
+      for (unsigned index2=0;index2<target.unions[index].size();index2++)
+         copyConstants(target.unions[index][index2],source.unions[index][index2]);
+   for (unsigned index=0;index<target.gjoins.size();index++)
+      for (unsigned index2=0;index2<target.gjoins[index].size();index2++)
+         copyConstants(target.gjoins[index][index2],source.gjoins[index][index2]);
+}
+//---------------------------------------------------------------------------
+bool PlanCache::deviates(const vector<unsigned>& planned,const vector<unsigned>& current,double factor)
+   // Does any cardinality differ by more than the factor?
+{
+   if (factor<=0)
+      return false;
+   for (unsigned index=0;index<planned.size();index++) {
+      double a=planned[index]?planned[index]:1,b=current[index]?current[index]:1;
+      if ((a>b*factor)||(b>a*factor))
+         return true;
+   }
+   return false;
+}
+//---------------------------------------------------------------------------
+PlanCache::PlanCache()
+   : maxEntries(256),replanFactor(10),statisticsVersion(0),feedback(0),hits(0),misses(0),replans(0)
+   // Constructor
+{
+   if (getenv("PLANCACHESIZE"))
+      maxEntries=atoi(getenv("PLANCACHESIZE"));
+   if (getenv("REPLANFACTOR"))
+      replanFactor=atof(getenv("REPLANFACTOR"));
+}
+//---------------------------------------------------------------------------
+PlanCache::~PlanCache()
+   // Destructor
+{
+   clear();
+}
+//---------------------------------------------------------------------------
+void PlanCache::drop(Entry* entry)
+   // Remove an entry
+{
+   entries.erase(entry->key);
+   lru.erase(entry->position);
+   delete entry;
+}
+//---------------------------------------------------------------------------
+void PlanCache::clear()
+   // Remove all entries
+{
+   while (!lru.empty())
+      drop(lru.back());
+}
+//---------------------------------------------------------------------------
+Plan* PlanCache::translate(Database& db,const string& key,QueryGraph& query,const QueryGraph*& planQuery)
+   // Get a plan for a query graph
+{
+   // Flush the cache if the statistics changed
+   uint64_t version=computeStatisticsVersion(db);
+   if (version!=statisticsVersion) {
+      clear();
+      statisticsVersion=version;
+   }
+
+   // Try to reuse an existing plan
+   vector<unsigned> cardinalities;
+   collectCardinalities(db,query.getQuery(),cardinalities);
+   map<string,Entry*>::iterator pos=entries.find(key);
+   if (pos!=entries.end()) {
+      Entry* entry=(*pos).second;
+      bool current=(!feedback)||(feedback->getVersion()==entry->feedbackVersion);
+      if (current&&sameShape(entry->query,query)&&(!deviates(entry->cardinalities,cardinalities,replanFactor))) {
+         copyConstants(entry->query.getQuery(),query.getQuery());
+         lru.erase(entry->position);
+         lru.push_front(entry);
+         entry->position=lru.begin();
+         ++hits;
+         planQuery=&entry->query;
+         return entry->plan;
+      }
+      drop(entry);
+      ++replans;
+   } else ++misses;
+
+   // Build a new plan. The graph is moved into the entry first, as the plan points into it
+   Entry* entry=new Entry();
+   entry->key=key;
+   entry->query.swap(query);
+   entry->cardinalities.swap(cardinalities);
+   entry->feedbackVersion=feedback?feedback->getVersion():0;
+   entry->plangen.setFeedback(feedback);
+   entry->plan=entry->plangen.translate(db,entry->query);
+   if (!entry->plan) {
+      query.swap(entry->query);
+      delete entry;
+      return 0;
+   }
+
+   // Register it, the most recent plan is always kept
+   while ((!lru.empty())&&(lru.size()>=maxEntries))
+      drop(lru.back());
+   lru.push_front(entry);
+   entry->position=lru.begin();
+   entries[key]=entry;
+   planQuery=&entry->query;
+   return entry->plan;
+}
+//---------------------------------------------------------------------------
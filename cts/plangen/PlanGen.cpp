@@ -1,14 +1,22 @@
 #include "cts/plangen/PlanGen.hpp"
+#include "cts/plangen/CardinalityFeedback.hpp"
 #include "cts/plangen/Costs.hpp"
+#include "cts/plangen/JoinSampler.hpp"
 #include "cts/codegen/CodeGen.hpp"
+#include "infra/osdep/Timestamp.hpp"
+#include "rts/operator/Exchange.hpp"
+#include "rts/operator/Scheduler.hpp"
 #include "rts/segment/AggregatedFactsSegment.hpp"
+#include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/FullyAggregatedFactsSegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
 #include "rts/segment/ExactStatisticsSegment.hpp"
+#include "rts/segment/PredicateSetSegment.hpp"
 #include <map>
 #include <set>
 #include <algorithm>
 #include <iostream>
+#include <cstdlib>
 
 //---------------------------------------------------------------------------
 // RDF-3X
@@ -36,7 +44,7 @@
 
 using namespace std;
 //---------------------------------------------------------------------------
-// XXX integrate DPhyper-based optimization, query path statistics
+// XXX integrate query path statistics
 //---------------------------------------------------------------------------
 /// Description for a join
 struct PlanGen::JoinDescription
@@ -52,8 +60,27 @@ struct PlanGen::JoinDescription
 };
 //---------------------------------------------------------------------------
 PlanGen::PlanGen()
+   : maxDPRelations(48),maxDPPairs(50000),planningTime(0),joinPairs(0),greedy(false),intermediates(0),feedback(0),samplingTime(20),samplingWalks(100),sampler(0),threads(0)
    // Constructor
 {
+   if (getenv("SAMPLINGTIME"))
+      samplingTime=atoi(getenv("SAMPLINGTIME"));
+   // Plan for the same number of threads as the scheduler
+   threads=Scheduler::getMaxThreads();
+
+   // Use the measured cost profile (if any), read once per process
+   static bool profileLoaded=false;
+   if ((!profileLoaded)&&getenv("COSTPROFILE")) {
+      profileLoaded=true;
+      Costs::Profile profile;
+      if (profile.load(getenv("COSTPROFILE")))
+         Costs::setProfile(profile); else
+         cerr << "warning: unable to read cost profile " << getenv("COSTPROFILE") << endl;
+   }
+   if (getenv("MAXDPRELATIONS"))
+      maxDPRelations=atoi(getenv("MAXDPRELATIONS"));
+   if (getenv("MAXDPPAIRS"))
+      maxDPPairs=atoi(getenv("MAXDPPAIRS"));
 }
 //---------------------------------------------------------------------------
 PlanGen::~PlanGen()
@@ -112,7 +139,30 @@ void PlanGen::addPlan(Problem* problem,Plan* plan)
    problem->plans=plan;
 }
 //---------------------------------------------------------------------------
-static Plan* buildFilters(PlanContainer& plans,const QueryGraph::SubQuery& query,Plan* plan,unsigned value1,unsigned value2,unsigned value3)
+static void computeFilterCosts(Database& db,const QueryGraph::Filter& filter,Plan* plan)
+   // Compute the costs of a filter, string matches might be evaluated against the dictionary
+{
+   double inputCard=plan->left->cardinality;
+   plan->costs=plan->left->costs+Costs::filter(inputCard);
+   plan->opArg=0;
+   if (filter.isStringMatch()) {
+      DictionarySegment& dict=db.getDictionary();
+      Costs::cost_t perTuple=Costs::stringFilter(inputCard),once=Costs::dictionaryFilter(dict.getNextId());
+      if ((filter.type==QueryGraph::Filter::Builtin_strstarts)&&(dict.hasStringIndex())) {
+         unsigned leaves=dict.countPrefixLeaves(filter.arg2->value);
+         if (leaves)
+            once=Costs::prefixIndexFilter(leaves);
+      }
+      if (once<perTuple) {
+         plan->costs=plan->left->costs+Costs::filter(inputCard)+once;
+         plan->opArg=1;
+      } else {
+         plan->costs=plan->left->costs+perTuple;
+      }
+   }
+}
+//---------------------------------------------------------------------------
+static Plan* buildFilters(Database& db,PlanContainer& plans,const QueryGraph::SubQuery& query,Plan* plan,unsigned value1,unsigned value2,unsigned value3)
    // Apply filters to index scans
 {
    // Collect variables
@@ -127,12 +177,10 @@ static Plan* buildFilters(PlanContainer& plans,const QueryGraph::SubQuery& query
    for (vector<QueryGraph::Filter>::const_iterator iter=query.filters.begin(),limit=query.filters.end();iter!=limit;++iter)
       if ((*iter).isApplicable(orderingOnly)) {
          Plan* p2=plans.alloc();
-         double cost1=plan->costs+Costs::filter(plan->cardinality);
          p2->op=Plan::Filter;
-         p2->costs=cost1;
-         p2->opArg=(*iter).id;
          p2->left=plan;
          p2->right=reinterpret_cast<Plan*>(const_cast<QueryGraph::Filter*>(&(*iter)));
+         computeFilterCosts(db,*iter,p2);
          p2->next=0;
          p2->cardinality=plan->cardinality*0.5;
          p2->ordering=plan->ordering;
@@ -143,12 +191,11 @@ static Plan* buildFilters(PlanContainer& plans,const QueryGraph::SubQuery& query
       if ((*iter).isApplicable(allAttributes)&&(!(*iter).isApplicable(orderingOnly))) {
          Plan* p2=plans.alloc();
          p2->op=Plan::Filter;
-         p2->opArg=(*iter).id;
          p2->left=plan;
          p2->right=reinterpret_cast<Plan*>(const_cast<QueryGraph::Filter*>(&(*iter)));
+         computeFilterCosts(db,*iter,p2);
          p2->next=0;
          p2->cardinality=plan->cardinality*0.5;
-         p2->costs=plan->costs+Costs::filter(plan->cardinality);
          p2->ordering=plan->ordering;
          plan=p2;
       }
@@ -206,7 +253,7 @@ void PlanGen::buildIndexScan(const QueryGraph::SubQuery& query,Database::DataOrd
    plan->costs=Costs::seekBtree()+Costs::scan(pages);
 
    // Apply filters
-   plan=buildFilters(plans,query,plan,value1,value2,value3);
+   plan=buildFilters(*db,plans,query,plan,value1,value2,value3);
 
    // And store it
    addPlan(result,plan);
@@ -244,7 +291,7 @@ void PlanGen::buildAggregatedIndexScan(const QueryGraph::SubQuery& query,Databas
    plan->costs=Costs::seekBtree()+Costs::scan(pages);
 
    // Apply filters
-   plan=buildFilters(plans,query,plan,value1,value2,~0u);
+   plan=buildFilters(*db,plans,query,plan,value1,value2,~0u);
 
    // And store it
    addPlan(result,plan);
@@ -277,7 +324,7 @@ void PlanGen::buildFullyAggregatedIndexScan(const QueryGraph::SubQuery& query,Da
    plan->costs=Costs::seekBtree()+Costs::scan(pages);
 
    // Apply filters
-   plan=buildFilters(plans,query,plan,value1,~0u,~0u);
+   plan=buildFilters(*db,plans,query,plan,value1,~0u,~0u);
 
    // And store it
    addPlan(result,plan);
@@ -418,6 +465,80 @@ PlanGen::JoinDescription PlanGen::buildJoinInfo(const QueryGraph::SubQuery& quer
 
    return result;
 }
+//---------------------------------------------------------------------------
+double PlanGen::estimateStar(const QueryGraph::SubQuery& query,const BitSet& relations)
+   // Estimate the cardinality of a subject star using the characteristic sets. Negative if not applicable
+{
+   PredicateSetSegment* predicateSets=db->getPredicateSets();
+   if ((!predicateSets)||query.optional.size()||((&query==&fullQuery->getQuery())&&relations.overlapsWith(materialized)))
+      return -1;
+
+   // All patterns must share the subject variable and have constant predicates
+   ExactStatisticsSegment& statistics=db->getExactStatistics();
+   vector<unsigned> predicates;
+   set<unsigned> objects;
+   unsigned subject=~0u;
+   double selectivity=1;
+   for (unsigned index=0;index<BitSet::maxWidth;index++) {
+      if (!relations.test(index))
+         continue;
+      if (index>=query.nodes.size())
+         return -1;
+      const QueryGraph::Node& node=query.nodes[index];
+      if (node.constSubject||(!node.constPredicate))
+         return -1;
+      if (predicates.empty())
+         subject=node.subject; else
+      if (node.subject!=subject)
+         return -1;
+      predicates.push_back(node.predicate);
+
+      if (node.constObject) {
+         // A bound object keeps its fraction of the predicate occurrences
+         double all=statistics.getCardinality(~0u,node.predicate,~0u);
+         if (all>0)
+            selectivity*=statistics.getCardinality(~0u,node.predicate,node.object)/all;
+      } else {
+         // Objects shared within the star are additional join predicates
+         if ((node.object==subject)||objects.count(node.object))
+            return -1;
+         objects.insert(node.object);
+      }
+   }
+   if (predicates.size()<2)
+      return -1;
+
+   // Sum over all characteristic sets containing the predicates
+   unsigned subjects; double cardinality;
+   if (!predicateSets->getStarCardinality(predicates,subjects,cardinality))
+      return -1;
+   return cardinality*selectivity;
+}
+//---------------------------------------------------------------------------
+double PlanGen::estimateCardinality(const QueryGraph::SubQuery& query,const BitSet& relations)
+   // The cardinality of a join result if observed before, a subject star or sampled. Negative if not known
+{
+   // Observations are only collected for the join patterns of conjunctive queries
+   if (feedback&&(&query==&fullQuery->getQuery())&&(!relations.overlapsWith(materialized))&&query.filters.empty()&&query.optional.empty()&&query.unions.empty()&&query.gjoins.empty()&&query.tableFunctions.empty()) {
+      double cardinality;
+      if (feedback->lookup(CardinalityFeedback::signature(query,relations),cardinality))
+         return (cardinality<1)?1:cardinality;
+   }
+   double cardinality=estimateStar(query,relations);
+   if (cardinality>=0)
+      return cardinality;
+
+   // The join statistics only cover pairs of patterns. Larger joins are sampled while the budget lasts
+   if (sampler&&(&query==&fullQuery->getQuery())&&(!relations.overlapsWith(materialized))) {
+      unsigned count=0;
+      for (unsigned index=0;index<BitSet::maxWidth;index++)
+         if (relations.test(index))
+            count++;
+      if (count>=3)
+         return sampler->estimate(relations);
+   }
+   return -1;
+}
 
 //---------------------------------------------------------------------------
 // Name: buildOptional 
@@ -661,6 +782,29 @@ PlanGen::Problem* PlanGen::buildTableFunction(const QueryGraph::TableFunction& /
    return result;
 }
 //---------------------------------------------------------------------------
+PlanGen::Problem* PlanGen::buildMaterialized(const Intermediate& intermediate,unsigned index)
+   // Generate the access to an intermediate result
+{
+   Plan* plan=plans.alloc();
+   plan->op=Plan::Materialized;
+   plan->opArg=index;
+   plan->left=0;
+   plan->right=reinterpret_cast<Plan*>(const_cast<Intermediate*>(&intermediate));
+   plan->next=0;
+   plan->cardinality=(intermediate.cardinality<1)?1:intermediate.cardinality;
+   plan->costs=Costs::materializedScan(plan->cardinality);
+   plan->ordering=intermediate.ordering;
+
+   // The result replaces all its relations
+   Problem* result=problems.alloc();
+   result->next=0;
+   result->plans=plan;
+   result->relations=intermediate.relations;
+   result->knownCardinality=-1;
+
+   return result;
+}
+//---------------------------------------------------------------------------
 static void findFilters(Plan* plan,set<const QueryGraph::Filter*>& filters)
    // Find all filters already applied in a plan
 {  
@@ -676,6 +820,12 @@ static void findFilters(Plan* plan,set<const QueryGraph::Filter*>& filters)
       case Plan::Singleton:
          // We reached a leaf.
          break;
+      case Plan::Materialized: {
+         // The filters were applied before materializing
+         const PlanGen::Intermediate* intermediate=reinterpret_cast<PlanGen::Intermediate*>(plan->right);
+         filters.insert(intermediate->filters.begin(),intermediate->filters.end());
+         break;
+      }
       case Plan::Filter:
          filters.insert(reinterpret_cast<QueryGraph::Filter*>(plan->right));
          findFilters(plan->left,filters);
@@ -687,7 +837,7 @@ static void findFilters(Plan* plan,set<const QueryGraph::Filter*>& filters)
          findFilters(plan->left,filters);
          findFilters(plan->right,filters);
          break;
-      case Plan::HashGroupify: case Plan::TableFunction:
+      case Plan::HashGroupify: case Plan::TableFunction: case Plan::Exchange:
          findFilters(plan->left,filters);
          break;
    }
@@ -751,6 +901,399 @@ PlanGen::Problem* PlanGen::buildGJoin(const vector<QueryGraph::SubQuery>& query,
 // Description: Create the query plan for a graph pattern. This consider 
 //              OPTIONAL and GJOIN clause.
 //---------------------------------------------------------------------------
+PlanGen::Problem* PlanGen::buildJoin(const QueryGraph::SubQuery& query,const vector<JoinDescription>& joins,Problem* left,Problem* right,map<BitSet,Problem*>& lookup)
+   // Join two disjoint subproblems. Returns 0 if no join predicate connects them
+{
+   vector<unsigned> joinOrderings;
+
+   // Investigate all join candidates
+   Problem* problem=0;
+   double selectivity=1;
+   for (vector<JoinDescription>::const_iterator iter3=joins.begin(),limit3=joins.end();iter3!=limit3;++iter3)
+      if (((*iter3).left.subsetOf(left->relations))&&((*iter3).right.subsetOf(right->relations))) {
+         if (!left->plans) return 0;
+         // We can join it...
+         BitSet relations=left->relations.unionWith(right->relations);
+         if (lookup.count(relations)) {
+            problem=lookup[relations];
+         } else {
+            lookup[relations]=problem=problems.alloc();
+            problem->relations=relations;
+            problem->plans=0;
+            problem->knownCardinality=estimateCardinality(query,relations);
+            problem->next=0;
+         }
+         // Table function call?
+         if ((*iter3).tableFunction) {
+            for (Plan* leftPlan=left->plans;leftPlan;leftPlan=leftPlan->next) {
+               Plan* p=plans.alloc();
+               p->op=Plan::TableFunction;
+               p->opArg=0;
+               p->left=leftPlan;
+               p->right=reinterpret_cast<Plan*>(const_cast<QueryGraph::TableFunction*>((*iter3).tableFunction));
+               p->next=0;
+               p->cardinality=leftPlan->cardinality;
+               p->costs=leftPlan->costs+Costs::tableFunction(leftPlan->cardinality);
+               p->ordering=leftPlan->ordering;
+               addPlan(problem,p);
+            }
+
+            return problem;
+         }
+         // Collect selectivities and join order candidates
+         joinOrderings.clear();
+         joinOrderings.push_back((*iter3).ordering);
+         selectivity=(*iter3).selectivity;
+         for (++iter3;iter3!=limit3;++iter3) {
+            joinOrderings.push_back((*iter3).ordering);
+            // selectivity*=(*iter3).selectivity;
+         }
+         break;
+      }
+   if (!problem) return 0;
+
+   // Observed results and subject stars are not estimated assuming independence. Empty inputs give no usable selectivity
+   if ((problem->knownCardinality>=0)&&(selectivity>=0)&&right->plans) {
+      double inputs=left->plans->cardinality*right->plans->cardinality;
+      if (inputs>0)
+         selectivity=problem->knownCardinality/inputs;
+   }
+
+   // Combine phyiscal plans
+   for (Plan* leftPlan=left->plans;leftPlan;leftPlan=leftPlan->next) {
+      for (Plan* rightPlan=right->plans;rightPlan;rightPlan=rightPlan->next) {
+         // Try a merge joins
+         if (leftPlan->ordering==rightPlan->ordering) {
+            for (vector<unsigned>::const_iterator iter=joinOrderings.begin(),limit=joinOrderings.end();iter!=limit;++iter) {
+               if (leftPlan->ordering==(*iter)) {
+                  Plan* p=plans.alloc();
+                  p->op=Plan::MergeJoin;
+                  p->opArg=*iter;
+                  p->left=leftPlan;
+                  p->right=rightPlan;
+                  p->next=0;
+                  if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
+                  p->costs=leftPlan->costs+rightPlan->costs+Costs::mergeJoin(leftPlan->cardinality,rightPlan->cardinality);
+                  p->ordering=leftPlan->ordering;
+                  addPlan(problem,p);
+                  break;
+               }
+            }
+         }
+         if (!query.gjoins.size()) {
+           // Try a hash join
+           if (selectivity>=0 && !query.optional.size()) {
+              Plan* p=plans.alloc();
+              p->op=Plan::HashJoin;
+              p->opArg=0;
+              p->left=leftPlan;
+              p->right=rightPlan;
+              p->next=0;
+              if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
+              p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(leftPlan->cardinality,rightPlan->cardinality);
+              p->ordering=~0u;
+              addPlan(problem,p);
+              // Second order
+              p=plans.alloc();
+              p->op=Plan::HashJoin;
+              p->opArg=0;
+              p->left=rightPlan;
+              p->right=leftPlan;
+              p->next=0;
+              if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
+              p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(rightPlan->cardinality,leftPlan->cardinality);
+              p->ordering=~0u;
+              addPlan(problem,p);
+           } else {
+              // Nested loop join
+              Plan* p=plans.alloc();
+              p->op=Plan::NestedLoopJoin;
+              p->opArg=0;
+              p->left=leftPlan;
+              p->right=rightPlan;
+              p->next=0;
+              if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality)<1) p->cardinality=1;
+              p->costs=leftPlan->costs+rightPlan->costs+leftPlan->cardinality*rightPlan->costs;
+              p->ordering=leftPlan->ordering;
+              addPlan(problem,p);
+           }
+         }
+       else {
+            Plan* p=plans.alloc();
+            p->op=Plan::HashJoin;
+            p->opArg=0;
+            p->left=leftPlan;
+            p->right=rightPlan;
+            p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity;
+            p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(leftPlan->cardinality,rightPlan->cardinality);
+            p->ordering=~0u;
+            addPlan(problem,p);
+            // Second order
+            p=plans.alloc();
+            p->op=Plan::HashJoin;
+            p->opArg=0;
+            p->left=rightPlan;
+            p->right=leftPlan;
+            p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity;
+            p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(rightPlan->cardinality,leftPlan->cardinality);
+            p->ordering=~0u;
+            addPlan(problem,p);
+         }
+     }
+   }
+
+   return problem;
+}
+//---------------------------------------------------------------------------
+bool PlanGen::findJoin(const vector<JoinDescription>& joins,const BitSet& left,const BitSet& right,double& selectivity)
+   // Find the join predicate connecting two subproblems in any direction
+{
+   for (unsigned direction=0;direction<2;direction++) {
+      const BitSet& l=direction?right:left,&r=direction?left:right;
+      for (vector<JoinDescription>::const_iterator iter=joins.begin(),limit=joins.end();iter!=limit;++iter)
+         if (((*iter).left.subsetOf(l))&&((*iter).right.subsetOf(r))) {
+            selectivity=(*iter).tableFunction?1:(*iter).selectivity;
+            return true;
+         }
+   }
+   return false;
+}
+//---------------------------------------------------------------------------
+/// Enumerates all pairs of connected subgraphs and their connected complements (DPhyp)
+class PlanGen::JoinEnumerator
+{
+   private:
+   /// The plan generator
+   PlanGen& planGen;
+   /// The query
+   const QueryGraph::SubQuery& query;
+   /// The join hyperedges
+   const vector<JoinDescription>& joins;
+   /// The solved subproblems
+   map<BitSet,Problem*>& lookup;
+   /// The maximum number of pairs
+   unsigned maxPairs;
+
+   /// Compute the neighborhood of a set, excluding the set and x
+   BitSet neighborhood(const BitSet& s,const BitSet& x) const;
+   /// Is there a join predicate between s1 and s2?
+   bool connected(const BitSet& s1,const BitSet& s2) const;
+   /// Join two subgraphs
+   void emitCsgCmp(const BitSet& s1,const BitSet& s2);
+   /// Enumerate the complements of a connected subgraph
+   void emitCsg(const BitSet& s1);
+   /// Grow a connected subgraph
+   void enumerateCsgRec(const BitSet& s1,const BitSet& x);
+   /// Grow a complement
+   void enumerateCmpRec(const BitSet& s1,const BitSet& s2,const BitSet& x);
+
+   public:
+   /// The number of pairs joined
+   unsigned pairs;
+   /// Was the enumeration aborted?
+   bool aborted;
+
+   /// Constructor
+   JoinEnumerator(PlanGen& planGen,const QueryGraph::SubQuery& query,const vector<JoinDescription>& joins,map<BitSet,Problem*>& lookup,unsigned maxPairs)
+      : planGen(planGen),query(query),joins(joins),lookup(lookup),maxPairs(maxPairs),pairs(0),aborted(false) {}
+
+   /// Enumerate all connected subgraphs of the relations
+   void run(const BitSet& relations);
+};
+//---------------------------------------------------------------------------
+BitSet PlanGen::JoinEnumerator::neighborhood(const BitSet& s,const BitSet& x) const
+   // Compute the neighborhood of a set, excluding the set and x
+{
+   // Hyperedges are represented by their smallest relation
+   BitSet excluded=s.unionWith(x),result;
+   for (vector<JoinDescription>::const_iterator iter=joins.begin(),limit=joins.end();iter!=limit;++iter) {
+      if (((*iter).left.subsetOf(s))&&(!(*iter).right.overlapsWith(excluded)))
+         result.set((*iter).right.first());
+      if (((*iter).right.subsetOf(s))&&(!(*iter).left.overlapsWith(excluded)))
+         result.set((*iter).left.first());
+   }
+   return result;
+}
+//---------------------------------------------------------------------------
+bool PlanGen::JoinEnumerator::connected(const BitSet& s1,const BitSet& s2) const
+   // Is there a join predicate between s1 and s2?
+{
+   for (vector<JoinDescription>::const_iterator iter=joins.begin(),limit=joins.end();iter!=limit;++iter)
+      if ((((*iter).left.subsetOf(s1))&&((*iter).right.subsetOf(s2)))||(((*iter).left.subsetOf(s2))&&((*iter).right.subsetOf(s1))))
+         return true;
+   return false;
+}
+//---------------------------------------------------------------------------
+void PlanGen::JoinEnumerator::emitCsgCmp(const BitSet& s1,const BitSet& s2)
+   // Join two subgraphs
+{
+   if ((++pairs)>maxPairs) {
+      aborted=true;
+      return;
+   }
+
+   // Both sides are complete at this point, try both join directions
+   map<BitSet,Problem*>::const_iterator left=lookup.find(s1),right=lookup.find(s2);
+   if ((left==lookup.end())||(right==lookup.end()))
+      return;
+   planGen.buildJoin(query,joins,(*left).second,(*right).second,lookup);
+   planGen.buildJoin(query,joins,(*right).second,(*left).second,lookup);
+}
+//---------------------------------------------------------------------------
+void PlanGen::JoinEnumerator::emitCsg(const BitSet& s1)
+   // Enumerate the complements of a connected subgraph
+{
+   BitSet x=s1.unionWith(BitSet::upTo(s1.first()));
+   BitSet n=neighborhood(s1,x);
+   for (unsigned index=BitSet::maxWidth;index>0;index--) {
+      if (!n.test(index-1))
+         continue;
+      BitSet s2; s2.set(index-1);
+      if (connected(s1,s2))
+         emitCsgCmp(s1,s2);
+      enumerateCmpRec(s1,s2,x.unionWith(n.intersectWith(BitSet::upTo(index-1))));
+      if (aborted) return;
+   }
+}
+//---------------------------------------------------------------------------
+void PlanGen::JoinEnumerator::enumerateCsgRec(const BitSet& s1,const BitSet& x)
+   // Grow a connected subgraph
+{
+   BitSet n=neighborhood(s1,x);
+   if (n.empty())
+      return;
+   for (BitSet subset=BitSet().nextSubsetOf(n);!subset.empty();subset=subset.nextSubsetOf(n)) {
+      BitSet s=s1.unionWith(subset);
+      if (lookup.count(s))
+         emitCsg(s);
+      if (aborted) return;
+   }
+   BitSet x2=x.unionWith(n);
+   for (BitSet subset=BitSet().nextSubsetOf(n);!subset.empty();subset=subset.nextSubsetOf(n)) {
+      enumerateCsgRec(s1.unionWith(subset),x2);
+      if (aborted) return;
+   }
+}
+//---------------------------------------------------------------------------
+void PlanGen::JoinEnumerator::enumerateCmpRec(const BitSet& s1,const BitSet& s2,const BitSet& x)
+   // Grow a complement
+{
+   BitSet n=neighborhood(s2,x);
+   if (n.empty())
+      return;
+   for (BitSet subset=BitSet().nextSubsetOf(n);!subset.empty();subset=subset.nextSubsetOf(n)) {
+      BitSet s=s2.unionWith(subset);
+      if (lookup.count(s)&&connected(s1,s))
+         emitCsgCmp(s1,s);
+      if (aborted) return;
+   }
+   BitSet x2=x.unionWith(n);
+   for (BitSet subset=BitSet().nextSubsetOf(n);!subset.empty();subset=subset.nextSubsetOf(n)) {
+      enumerateCmpRec(s1,s2.unionWith(subset),x2);
+      if (aborted) return;
+   }
+}
+//---------------------------------------------------------------------------
+void PlanGen::JoinEnumerator::run(const BitSet& relations)
+   // Enumerate all connected subgraphs of the relations
+{
+   for (unsigned index=BitSet::maxWidth;index>0;index--) {
+      if (!relations.test(index-1))
+         continue;
+      BitSet s; s.set(index-1);
+      emitCsg(s);
+      enumerateCsgRec(s,BitSet::upTo(index-1));
+      if (aborted) return;
+   }
+}
+//---------------------------------------------------------------------------
+PlanGen::Problem* PlanGen::buildGreedy(const QueryGraph::SubQuery& query,const vector<JoinDescription>& joins,vector<Problem*> current,map<BitSet,Problem*>& lookup)
+   // Combine the subproblems greedily, always performing the join with the smallest result first
+{
+   while (current.size()>1) {
+      // Find the join with the smallest result
+      unsigned bestLeft=0,bestRight=0;
+      double bestCardinality=0;
+      bool found=false;
+      for (unsigned index=0;index<current.size();index++) {
+         Plan* leftPlan=current[index]->plans;
+         if (!leftPlan) continue;
+         for (unsigned index2=index+1;index2<current.size();index2++) {
+            Plan* rightPlan=current[index2]->plans;
+            double selectivity;
+            if ((!rightPlan)||(!findJoin(joins,current[index]->relations,current[index2]->relations,selectivity)))
+               continue;
+            double cardinality=estimateCardinality(query,current[index]->relations.unionWith(current[index2]->relations));
+            if (cardinality<0)
+               cardinality=leftPlan->cardinality*rightPlan->cardinality*((selectivity>=0)?selectivity:1);
+            if ((!found)||(cardinality<bestCardinality)) {
+               bestLeft=index;
+               bestRight=index2;
+               bestCardinality=cardinality;
+               found=true;
+            }
+         }
+      }
+      if (!found)
+         return 0;
+
+      // And perform it
+      Problem* left=current[bestLeft],*right=current[bestRight];
+      Problem* problem=buildJoin(query,joins,left,right,lookup);
+      if (Problem* other=buildJoin(query,joins,right,left,lookup))
+         problem=other;
+      if ((!problem)||(!problem->plans))
+         return 0;
+      joinPairs++;
+      current[bestLeft]=problem;
+      current.erase(current.begin()+bestRight);
+   }
+   return current.empty()?0:current.front();
+}
+//---------------------------------------------------------------------------
+PlanGen::Problem* PlanGen::buildJoinTree(const QueryGraph::SubQuery& query,Problem* base,const vector<JoinDescription>& joins)
+   // Combine the base problems into a complete join tree
+{
+   // Collect the base problems
+   map<BitSet,Problem*> lookup;
+   vector<Problem*> current;
+   BitSet relations;
+   for (Problem* iter=base;iter;iter=iter->next) {
+      if (lookup.count(iter->relations))
+         continue;
+      lookup[iter->relations]=iter;
+      current.push_back(iter);
+      relations=relations.unionWith(iter->relations);
+   }
+
+   // Hyperedges with an empty side can connect to any relation
+   vector<JoinDescription> edges;
+   for (vector<JoinDescription>::const_iterator iter=joins.begin(),limit=joins.end();iter!=limit;++iter) {
+      if (!(*iter).left.empty()) {
+         edges.push_back(*iter);
+         continue;
+      }
+      for (unsigned index=0;index<BitSet::maxWidth;index++)
+         if (relations.test(index)&&(!(*iter).right.test(index))) {
+            edges.push_back(*iter);
+            edges.back().left.set(index);
+         }
+   }
+
+   // Enumerate all connected subgraphs if the query is small enough
+   if (current.size()<=maxDPRelations) {
+      JoinEnumerator enumerator(*this,query,edges,lookup,maxDPPairs);
+      enumerator.run(relations);
+      joinPairs+=enumerator.pairs;
+      if ((!enumerator.aborted)&&lookup.count(relations))
+         return lookup[relations];
+   }
+
+   // Fall back to greedy join ordering
+   greedy=true;
+   return buildGreedy(query,edges,current,lookup);
+}
+//---------------------------------------------------------------------------
 Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
    // Translate a query into an operator tree
 {
@@ -760,35 +1303,39 @@ Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
    if ((query.nodes.size()+query.optional.size()+query.unions.size()+query.tableFunctions.size()+query.gjoins.size()+singletonNeeded)>BitSet::maxWidth)
       return 0;
 
-   // Seed the DP table with scans
-   vector<Problem*> dpTable;
-   if (query.optional.size())
-     dpTable.resize(query.optional.size()+query.unions.size()+query.tableFunctions.size()+query.gjoins.size()+singletonNeeded);
-   else
-     dpTable.resize(query.nodes.size()+query.optional.size()+query.unions.size()+query.tableFunctions.size()+query.gjoins.size()+singletonNeeded);
-     
-   Problem* last=0;
+   // Seed the base problems with scans. Already computed intermediate results replace their relations
+   Problem* base=0,*last=0;
    unsigned id=0;
+   bool useIntermediates=intermediates&&(&query==&fullQuery->getQuery());
    if (!query.optional.size())
      for (vector<QueryGraph::Node>::const_iterator iter=query.nodes.begin(),limit=query.nodes.end();iter!=limit;++iter,++id) {
-        Problem* p=buildScan(query,*iter,id);
+        Problem* p;
+        if (useIntermediates&&materialized.test(id)) {
+           p=0;
+           for (unsigned index=0;index<intermediates->size();index++)
+              if ((*intermediates)[index]->relations.first()==id)
+                 p=buildMaterialized(*(*intermediates)[index],index);
+           if (!p) continue;
+        } else {
+           p=buildScan(query,*iter,id);
+        }
         if (last)
            last->next=p; else
-           dpTable[0]=p;
+           base=p;
         last=p;
      }
    else {
       Problem* p=buildOptional(query,id);
       if (last)
          last->next=p; else
-         dpTable[0]=p;
+         base=p;
       last=p;
    } 
    for (vector<vector<QueryGraph::SubQuery> >::const_iterator iter=query.unions.begin(),limit=query.unions.end();iter!=limit;++iter,++id) {
       Problem* p=buildUnion(*iter,id);
       if (last)
          last->next=p; else
-         dpTable[0]=p;
+         base=p;
       last=p;
    }
    // Hancel y Giuseppe
@@ -796,7 +1343,7 @@ Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
       Problem* p=buildGJoin(*iter,id);
       if (last)
          last->next=p; else
-         dpTable[0]=p;
+         base=p;
       last=p;
    }
    unsigned functionIds=id;
@@ -804,7 +1351,7 @@ Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
       Problem* p=buildTableFunction(*iter,id);
       if (last)
          last->next=p; else
-         dpTable[0]=p;
+         base=p;
       last=p;
    }
    
@@ -827,7 +1374,7 @@ Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
       problem->relations.set(id);
       if (last)
          last->next=problem; else
-         dpTable[0]=problem;
+         base=problem;
       last=problem;
    }
 
@@ -869,163 +1416,20 @@ Plan* PlanGen::translate(const QueryGraph::SubQuery& query)
    }
 
    // Build larger join trees
-   vector<unsigned> joinOrderings;
-   for (unsigned index=1;index<dpTable.size();index++) {
-      map<BitSet,Problem*> lookup;
-      for (unsigned index2=0;index2<index;index2++) {
-         for (Problem* iter=dpTable[index2];iter;iter=iter->next) {
-            BitSet leftRel=iter->relations;
-            for (Problem* iter2=dpTable[index-index2-1];iter2;iter2=iter2->next) {
-               // Overlapping subproblem?
-               BitSet rightRel=iter2->relations;
-               if (leftRel.overlapsWith(rightRel))
-                  continue;
-
-               // Investigate all join candidates
-               Problem* problem=0;
-               double selectivity=1;
-               for (vector<JoinDescription>::const_iterator iter3=joins.begin(),limit3=joins.end();iter3!=limit3;++iter3)
-                  if (((*iter3).left.subsetOf(leftRel))&&((*iter3).right.subsetOf(rightRel))) {
-                     if (!iter->plans) break;
-                     // We can join it...
-                     BitSet relations=leftRel.unionWith(rightRel);
-                     if (lookup.count(relations)) {
-                        problem=lookup[relations];
-                     } else {
-                        lookup[relations]=problem=problems.alloc();
-                        problem->relations=relations;
-                        problem->plans=0;
-                        problem->next=dpTable[index];
-                        dpTable[index]=problem; 
-                     }
-                     // Table function call?
-                     if ((*iter3).tableFunction) {
-                        for (Plan* leftPlan=iter->plans;leftPlan;leftPlan=leftPlan->next) {
-                           Plan* p=plans.alloc();
-                           p->op=Plan::TableFunction;
-                           p->opArg=0;
-                           p->left=leftPlan;
-                           p->right=reinterpret_cast<Plan*>(const_cast<QueryGraph::TableFunction*>((*iter3).tableFunction));
-			   p->next=0;
-                           p->cardinality=leftPlan->cardinality;
-                           p->costs=leftPlan->costs+Costs::tableFunction(leftPlan->cardinality);
-                           p->ordering=leftPlan->ordering;
-                           addPlan(problem,p);
-                        }
-
-                        problem=0;
-                        break;
-                     }
-                     // Collect selectivities and join order candidates
-                     joinOrderings.clear();
-                     joinOrderings.push_back((*iter3).ordering);
-                     selectivity=(*iter3).selectivity;
-                     for (++iter3;iter3!=limit3;++iter3) {
-                        joinOrderings.push_back((*iter3).ordering);
-                        // selectivity*=(*iter3).selectivity;
-                     }
-                     break;
-                  }
-               if (!problem) continue;
-
-               // Combine phyiscal plans
-               for (Plan* leftPlan=iter->plans;leftPlan;leftPlan=leftPlan->next) {
-                  for (Plan* rightPlan=iter2->plans;rightPlan;rightPlan=rightPlan->next) {
-                     // Try a merge joins
-                     if (leftPlan->ordering==rightPlan->ordering) {
-                        for (vector<unsigned>::const_iterator iter=joinOrderings.begin(),limit=joinOrderings.end();iter!=limit;++iter) {
-                           if (leftPlan->ordering==(*iter)) {
-                              Plan* p=plans.alloc();
-                              p->op=Plan::MergeJoin;
-                              p->opArg=*iter;
-                              p->left=leftPlan;
-                              p->right=rightPlan;
-			      p->next=0;
-                              if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
-                              p->costs=leftPlan->costs+rightPlan->costs+Costs::mergeJoin(leftPlan->cardinality,rightPlan->cardinality);
-                              p->ordering=leftPlan->ordering;
-                              addPlan(problem,p);
-                              break;
-                           }
-                        }
-                     }
-                     if (!query.gjoins.size()) {
-                       // Try a hash join
-                       if (selectivity>=0 && !query.optional.size()) {
-                          Plan* p=plans.alloc();
-                          p->op=Plan::HashJoin;
-                          p->opArg=0;
-                          p->left=leftPlan;
-                          p->right=rightPlan;
-		  	  p->next=0;
-                          if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
-                          p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(leftPlan->cardinality,rightPlan->cardinality);
-                          p->ordering=~0u;
-                          addPlan(problem,p);
-                          // Second order
-                          p=plans.alloc();
-                          p->op=Plan::HashJoin;
-                          p->opArg=0;
-                          p->left=rightPlan;
-                          p->right=leftPlan;
-			  p->next=0;
-                          if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
-                          p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(rightPlan->cardinality,leftPlan->cardinality);
-                          p->ordering=~0u;
-                          addPlan(problem,p);
-                       } else {
-                          // Nested loop join
-                          Plan* p=plans.alloc();
-                          p->op=Plan::NestedLoopJoin;
-                          p->opArg=0;
-                          p->left=leftPlan;
-                          p->right=rightPlan;
-	      		  p->next=0;
-                          if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality)<1) p->cardinality=1;
-                          p->costs=leftPlan->costs+rightPlan->costs+leftPlan->cardinality*rightPlan->costs;
-                          p->ordering=leftPlan->ordering;
-                          addPlan(problem,p);
-                       }
-                     }
-                   else {
-                        Plan* p=plans.alloc();
-                        p->op=Plan::HashJoin;
-                        p->opArg=0;
-                        p->left=leftPlan;
-                        p->right=rightPlan;
-                        p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity;
-                        p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(leftPlan->cardinality,rightPlan->cardinality);
-                        p->ordering=~0u;
-                        addPlan(problem,p);
-                        // Second order
-                        p=plans.alloc();
-                        p->op=Plan::HashJoin;
-                        p->opArg=0;
-                        p->left=rightPlan;
-                        p->right=leftPlan;
-                        p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity;
-                        p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(rightPlan->cardinality,leftPlan->cardinality);
-                        p->ordering=~0u;
-                        addPlan(problem,p);
-                     }
-                 }
-               }
-            }
-         }
-      }
-   }
+   Problem* root=base?buildJoinTree(query,base,joins):0;
+
    // Extract the bestplan
    Plan* plan;
-   if (query.optional.size() && dpTable.empty())
+   if (query.optional.size() && (!base))
      return 0;
    
-   if (!query.optional.size()&& (dpTable.empty()||(!dpTable.back())))
+   if (!query.optional.size()&& (!root))
      return 0;
 
-   if(dpTable.back())
-     plan=dpTable.back()->plans;
+   if(root)
+     plan=root->plans;
    else
-     plan=dpTable[0]->plans;
+     plan=base->plans;
    
    
    if (!plan)
@@ -1070,17 +1474,14 @@ Plan* PlanGen::translate2(const QueryGraph::SubQuery& query)
    if ((query.nodes.size()+query.tableFunctions.size()+singletonNeeded)>BitSet::maxWidth)
       return 0;
 
-   // Seed the DP table with scans
-   vector<Problem*> dpTable;
-   dpTable.resize(query.nodes.size()+query.tableFunctions.size()+singletonNeeded);
-     
-   Problem* last=0;
+   // Seed the base problems with scans
+   Problem* base=0,*last=0;
    unsigned id=0;
    for (vector<QueryGraph::Node>::const_iterator iter=query.nodes.begin(),limit=query.nodes.end();iter!=limit;++iter,++id) {
       Problem* p=buildScan(query,*iter,id);
       if (last)
          last->next=p; else
-         dpTable[0]=p;
+         base=p;
       last=p;
    }
 
@@ -1089,7 +1490,7 @@ Plan* PlanGen::translate2(const QueryGraph::SubQuery& query)
       Problem* p=buildTableFunction(*iter,id);
       if (last)
          last->next=p; else
-         dpTable[0]=p;
+         base=p;
       last=p;
    }
    
@@ -1112,7 +1513,7 @@ Plan* PlanGen::translate2(const QueryGraph::SubQuery& query)
       problem->relations.set(id);
       if (last)
          last->next=problem; else
-         dpTable[0]=problem;
+         base=problem;
       last=problem;
    }
 
@@ -1154,165 +1555,12 @@ Plan* PlanGen::translate2(const QueryGraph::SubQuery& query)
    }
 
    // Build larger join trees
-   vector<unsigned> joinOrderings;
-   for (unsigned index=1;index<dpTable.size();index++) {
-      map<BitSet,Problem*> lookup;
-      for (unsigned index2=0;index2<index;index2++) {
-         for (Problem* iter=dpTable[index2];iter;iter=iter->next) {
-            BitSet leftRel=iter->relations;
-            for (Problem* iter2=dpTable[index-index2-1];iter2;iter2=iter2->next) {
-               // Overlapping subproblem?
-               BitSet rightRel=iter2->relations;
-               if (leftRel.overlapsWith(rightRel))
-                  continue;
-
-               // Investigate all join candidates
-               Problem* problem=0;
-               double selectivity=1;
-               for (vector<JoinDescription>::const_iterator iter3=joins.begin(),limit3=joins.end();iter3!=limit3;++iter3)
-                  if (((*iter3).left.subsetOf(leftRel))&&((*iter3).right.subsetOf(rightRel))) {
-                     if (!iter->plans) break;
-                     // We can join it...
-                     BitSet relations=leftRel.unionWith(rightRel);
-                     if (lookup.count(relations)) {
-                        problem=lookup[relations];
-                     } else {
-                        lookup[relations]=problem=problems.alloc();
-                        problem->relations=relations;
-                        problem->plans=0;
-                        problem->next=dpTable[index];
-                        dpTable[index]=problem; 
-                     }
-                     // Table function call?
-                     if ((*iter3).tableFunction) {
-                        for (Plan* leftPlan=iter->plans;leftPlan;leftPlan=leftPlan->next) {
-                           Plan* p=plans.alloc();
-                           p->op=Plan::TableFunction;
-                           p->opArg=0;
-                           p->left=leftPlan;
-                           p->right=reinterpret_cast<Plan*>(const_cast<QueryGraph::TableFunction*>((*iter3).tableFunction));
-			   p->next=0;
-                           p->cardinality=leftPlan->cardinality;
-                           p->costs=leftPlan->costs+Costs::tableFunction(leftPlan->cardinality);
-                           p->ordering=leftPlan->ordering;
-                           addPlan(problem,p);
-                        }
-
-                        problem=0;
-                        break;
-                     }
-                     // Collect selectivities and join order candidates
-                     joinOrderings.clear();
-                     joinOrderings.push_back((*iter3).ordering);
-                     selectivity=(*iter3).selectivity;
-                     for (++iter3;iter3!=limit3;++iter3) {
-                        joinOrderings.push_back((*iter3).ordering);
-                        // selectivity*=(*iter3).selectivity;
-                     }
-                     break;
-                  }
-               if (!problem) continue;
-
-               // Combine phyiscal plans
-               for (Plan* leftPlan=iter->plans;leftPlan;leftPlan=leftPlan->next) {
-                  for (Plan* rightPlan=iter2->plans;rightPlan;rightPlan=rightPlan->next) {
-                     // Try a merge joins
-                     if (leftPlan->ordering==rightPlan->ordering) {
-                        for (vector<unsigned>::const_iterator iter=joinOrderings.begin(),limit=joinOrderings.end();iter!=limit;++iter) {
-                           if (leftPlan->ordering==(*iter)) {
-                              Plan* p=plans.alloc();
-                              p->op=Plan::MergeJoin;
-                              p->opArg=*iter;
-                              p->left=leftPlan;
-                              p->right=rightPlan;
-			      p->next=0;
-                              if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
-                              p->costs=leftPlan->costs+rightPlan->costs+Costs::mergeJoin(leftPlan->cardinality,rightPlan->cardinality);
-                              p->ordering=leftPlan->ordering;
-                              addPlan(problem,p);
-                              break;
-                           }
-                        }
-                     }
-                     if (!query.gjoins.size()) {
-                       // Try a hash join
-                       if (selectivity>=0 && !query.optional.size()) {
-                          Plan* p=plans.alloc();
-                          p->op=Plan::HashJoin;
-                          p->opArg=0;
-                          p->left=leftPlan;
-                          p->right=rightPlan;
-		  	  p->next=0;
-                          if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
-                          p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(leftPlan->cardinality,rightPlan->cardinality);
-                          p->ordering=~0u;
-                          addPlan(problem,p);
-                          // Second order
-                          p=plans.alloc();
-                          p->op=Plan::HashJoin;
-                          p->opArg=0;
-                          p->left=rightPlan;
-                          p->right=leftPlan;
-			  p->next=0;
-                          if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity)<1) p->cardinality=1;
-                          p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(rightPlan->cardinality,leftPlan->cardinality);
-                          p->ordering=~0u;
-                          addPlan(problem,p);
-                       } else {
-                          // Nested loop join
-                          Plan* p=plans.alloc();
-                          p->op=Plan::NestedLoopJoin;
-                          p->opArg=0;
-                          p->left=leftPlan;
-                          p->right=rightPlan;
-	      		  p->next=0;
-                          if ((p->cardinality=leftPlan->cardinality*rightPlan->cardinality)<1) p->cardinality=1;
-                          p->costs=leftPlan->costs+rightPlan->costs+leftPlan->cardinality*rightPlan->costs;
-                          p->ordering=leftPlan->ordering;
-                          addPlan(problem,p);
-                       }
-                     }
-                   else {
-                        Plan* p=plans.alloc();
-                        p->op=Plan::HashJoin;
-                        p->opArg=0;
-                        p->left=leftPlan;
-                        p->right=rightPlan;
-                        p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity;
-                        p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(leftPlan->cardinality,rightPlan->cardinality);
-                        p->ordering=~0u;
-                        addPlan(problem,p);
-                        // Second order
-                        p=plans.alloc();
-                        p->op=Plan::HashJoin;
-                        p->opArg=0;
-                        p->left=rightPlan;
-                        p->right=leftPlan;
-                        p->cardinality=leftPlan->cardinality*rightPlan->cardinality*selectivity;
-                        p->costs=leftPlan->costs+rightPlan->costs+Costs::hashJoin(rightPlan->cardinality,leftPlan->cardinality);
-                        p->ordering=~0u;
-                        addPlan(problem,p);
-                     }
-                 }
-               }
-            }
-         }
-      }
-   }
-   
+   Problem* root=base?buildJoinTree(query,base,joins):0;
+
    // Extract the bestplan
-   Plan* plan;
-   if (query.optional.size() && (dpTable.empty()||(!dpTable.back())))
+   if (!root)
      return 0;
-   
-   if (!query.optional.size()&& (dpTable.empty()||(!dpTable.back())))
-     return 0;
-
-   if(dpTable.back())
-     plan=dpTable.back()->plans;
-   else
-     plan=dpTable[0]->plans;
- 
+   Plan* plan=root->plans;
    
    if (!plan)
       return 0;
@@ -1321,17 +1569,180 @@ Plan* PlanGen::translate2(const QueryGraph::SubQuery& query)
    return plan;
 }
 //---------------------------------------------------------------------------
+static bool producesUniqueTuples(const QueryGraph& query,Plan* plan)
+   // Does a plan produce tuples that are unique within the projection?
+{
+   // Only single scans are considered, filters do not introduce duplicates
+   while (plan->op==Plan::Filter)
+      plan=plan->left;
+   if ((plan->op!=Plan::IndexScan)&&(plan->op!=Plan::AggregatedIndexScan)&&(plan->op!=Plan::FullyAggregatedIndexScan))
+      return false;
+
+   // Determine the pattern positions produced by the scan. The scans return
+   // each combination of these positions exactly once
+   const QueryGraph::Node& node=*reinterpret_cast<QueryGraph::Node*>(plan->right);
+   Database::DataOrder order=static_cast<Database::DataOrder>(plan->opArg);
+   bool subject=true,predicate=true,object=true;
+   if (plan->op==Plan::AggregatedIndexScan) {
+      subject=(order!=Database::Order_Object_Predicate_Subject)&&(order!=Database::Order_Predicate_Object_Subject);
+      predicate=(order!=Database::Order_Subject_Object_Predicate)&&(order!=Database::Order_Object_Subject_Predicate);
+      object=(order!=Database::Order_Subject_Predicate_Object)&&(order!=Database::Order_Predicate_Subject_Object);
+   } else if (plan->op==Plan::FullyAggregatedIndexScan) {
+      subject=(order==Database::Order_Subject_Predicate_Object)||(order==Database::Order_Subject_Object_Predicate);
+      predicate=(order==Database::Order_Predicate_Subject_Object)||(order==Database::Order_Predicate_Object_Subject);
+      object=(order==Database::Order_Object_Subject_Predicate)||(order==Database::Order_Object_Predicate_Subject);
+   }
+
+   // All produced variables must be projected, otherwise dropping them creates duplicates
+   set<unsigned> projection(query.projectionBegin(),query.projectionEnd());
+   if (subject&&(!node.constSubject)&&(!projection.count(node.subject))) return false;
+   if (predicate&&(!node.constPredicate)&&(!projection.count(node.predicate))) return false;
+   if (object&&(!node.constObject)&&(!projection.count(node.object))) return false;
+   return true;
+}
+//---------------------------------------------------------------------------
+static bool isReplicable(Plan* plan)
+   // Can a plan be evaluated independently by every partition?
+{
+   switch (plan->op) {
+      case Plan::IndexScan:
+      case Plan::AggregatedIndexScan:
+      case Plan::FullyAggregatedIndexScan:
+         return true;
+      case Plan::MergeJoin:
+      case Plan::HashJoin:
+         return isReplicable(plan->left)&&isReplicable(plan->right);
+      default:
+         return false;
+   }
+}
+//---------------------------------------------------------------------------
+static unsigned partitionVariable(Plan* plan)
+   // The variable a plan can be range partitioned on, ~0u if none
+{
+   switch (plan->op) {
+      case Plan::IndexScan:
+      case Plan::AggregatedIndexScan:
+         // The ordering is the first unbound column of the scan
+         return plan->ordering;
+      case Plan::MergeJoin:
+         // Both inputs are partitioned on the join variable
+         if ((partitionVariable(plan->left)==plan->opArg)&&(partitionVariable(plan->right)==plan->opArg))
+            return plan->opArg;
+         return ~0u;
+      case Plan::HashJoin:
+         // The probe side is partitioned, the build side is replicated
+         if (isReplicable(plan->left))
+            return partitionVariable(plan->right);
+         return ~0u;
+      default:
+         return ~0u;
+   }
+}
+//---------------------------------------------------------------------------
+static Plan::cost_t replicatedCosts(Plan* plan)
+   // The costs of the replicated parts of a partitioned plan
+{
+   switch (plan->op) {
+      case Plan::MergeJoin: return replicatedCosts(plan->left)+replicatedCosts(plan->right);
+      case Plan::HashJoin: return plan->left->costs+replicatedCosts(plan->right);
+      default: return 0;
+   }
+}
+//---------------------------------------------------------------------------
+static unsigned partitionedScans(Plan* plan)
+   // The number of partitioned scans in a partitioned plan
+{
+   switch (plan->op) {
+      case Plan::IndexScan: case Plan::AggregatedIndexScan: return 1;
+      case Plan::MergeJoin: return partitionedScans(plan->left)+partitionedScans(plan->right);
+      case Plan::HashJoin: return partitionedScans(plan->right);
+      default: return 0;
+   }
+}
+//---------------------------------------------------------------------------
+Plan* PlanGen::addExchange(Plan* plan,unsigned threads)
+   // Evaluate the expensive partitionable parts of a plan in parallel
+{
+   // Partition the whole plan if that is cheaper
+   unsigned variable=partitionVariable(plan);
+   if ((~variable)&&(threads>1)) {
+      unsigned partitions=Exchange::partitionsPerThread*threads;
+      Plan::cost_t costs=Costs::exchange(plan->costs,replicatedCosts(plan),plan->cardinality,partitionedScans(plan),partitions,threads);
+      if (costs<plan->costs) {
+         Plan* p=plans.alloc();
+         p->op=Plan::Exchange;
+         p->opArg=variable;
+         p->left=plan;
+         p->right=static_cast<Plan*>(0)+partitions;
+         p->next=0;
+         p->cardinality=plan->cardinality;
+         p->costs=costs;
+         p->ordering=plan->ordering;
+         return p;
+      }
+   }
+
+   // Otherwise try the inputs. Nested loop joins are not considered, they restart their inner input
+   switch (plan->op) {
+      case Plan::MergeJoin: {
+         // Both inputs run concurrently and share the threads
+         Plan::cost_t before=plan->left->costs+plan->right->costs;
+         plan->left=addExchange(plan->left,threads/2);
+         plan->right=addExchange(plan->right,threads-(threads/2));
+         plan->costs+=plan->left->costs+plan->right->costs-before;
+         break;
+      }
+      case Plan::HashJoin: {
+         // The hash table is built before the probe side is read beyond its first tuple
+         Plan::cost_t before=plan->left->costs+plan->right->costs;
+         plan->left=addExchange(plan->left,threads);
+         plan->right=addExchange(plan->right,threads);
+         plan->costs+=plan->left->costs+plan->right->costs-before;
+         break;
+      }
+      case Plan::Filter:
+      case Plan::HashGroupify: {
+         Plan::cost_t before=plan->left->costs;
+         plan->left=addExchange(plan->left,threads);
+         plan->costs+=plan->left->costs-before;
+         break;
+      }
+      default: break;
+   }
+   return plan;
+}
+//---------------------------------------------------------------------------
 Plan* PlanGen::translate(Database& db,const QueryGraph& query)
    // Translate a query into an operator tree
+{
+   return translate(db,query,vector<Intermediate*>());
+}
+//---------------------------------------------------------------------------
+Plan* PlanGen::translate(Database& db,const QueryGraph& query,const vector<Intermediate*>& intermediates)
+   // Translate a query into an operator tree, reusing already computed intermediate results
 {
    // Reset the plan generator
    plans.clear();
    problems.freeAll();
    this->db=&db;
    fullQuery=&query;
+   joinPairs=0;
+   greedy=false;
+   this->intermediates=&intermediates;
+   materialized=BitSet();
+   for (vector<Intermediate*>::const_iterator iter=intermediates.begin(),limit=intermediates.end();iter!=limit;++iter)
+      materialized=materialized.unionWith((*iter)->relations);
 
    // Retrieve the base plan
+   Timestamp start;
+   JoinSampler joinSampler(db,query.getQuery(),samplingTime,samplingWalks);
+   sampler=&joinSampler;
    Plan* plan=translate(query.getQuery());
+   planningTime=Timestamp()-start;
+   this->intermediates=0;
+   materialized=BitSet();
+   sampler=0;
  
    if (!plan)
       return 0;
@@ -1343,8 +1754,8 @@ Plan* PlanGen::translate(Database& db,const QueryGraph& query)
    if (!best)
       return 0;
 
-   // Aggregate, if required
-   if ((query.getDuplicateHandling()==QueryGraph::CountDuplicates)||(query.getDuplicateHandling()==QueryGraph::NoDuplicates)||(query.getDuplicateHandling()==QueryGraph::ShowDuplicates)) {
+   // Aggregate, if required. Counts taken directly from the aggregated indexes need no further grouping
+   if (((query.getDuplicateHandling()==QueryGraph::CountDuplicates)||(query.getDuplicateHandling()==QueryGraph::NoDuplicates)||(query.getDuplicateHandling()==QueryGraph::ShowDuplicates))&&(!producesUniqueTuples(query,best))) {
       Plan* p=plans.alloc();
       p->op=Plan::HashGroupify;
       p->opArg=0;
@@ -1356,7 +1767,11 @@ Plan* PlanGen::translate(Database& db,const QueryGraph& query)
       p->ordering=~0u;
       best=p;
    }
-   
+
+   // Use the available cores
+   if (threads)
+      best=addExchange(best,threads);
+
    return best;
 }
 //---------------------------------------------------------------------------
@@ -111,7 +111,7 @@ static bool encode(DictionarySegment& dict,DifferentialIndex* diffIndex,const SP
                type=Type::Double;
             } else if (element.subTypeValue=="http://www.w3.org/2001/XMLSchema#boolean") {
                type=Type::Boolean;
-            } else if (element.subTypeValue=="http://www.w3.org/2001/XMLSchema#dateTime") {
+            } else if ((element.subTypeValue=="http://www.w3.org/2001/XMLSchema#dateTime")&&dict.hasTypedDates()) {
                type=Type::Date;
             } else {
                if (!lookup(dict,diffIndex,element.subTypeValue,Type::URI,0,subType))
@@ -269,6 +269,8 @@ static bool encodeFilter(DictionarySegment& dict,DifferentialIndex* diffIndex,co
       case SPARQLParser::Filter::Builtin_isliteral: return encodeUnaryFilter(QueryGraph::Filter::Builtin_isliteral,dict,diffIndex,group,input,output);
       case SPARQLParser::Filter::Builtin_regex: return encodeTernaryFilter(QueryGraph::Filter::Builtin_regex,dict,diffIndex,group,input,output);
       case SPARQLParser::Filter::Builtin_in: return encodeBinaryFilter(QueryGraph::Filter::Builtin_in,dict,diffIndex,group,input,output);
+      case SPARQLParser::Filter::Builtin_contains: return encodeBinaryFilter(QueryGraph::Filter::Builtin_contains,dict,diffIndex,group,input,output);
+      case SPARQLParser::Filter::Builtin_strstarts: return encodeBinaryFilter(QueryGraph::Filter::Builtin_strstarts,dict,diffIndex,group,input,output);
    }
    return false; // XXX cannot happen
 }
@@ -416,16 +418,7 @@ void SemanticAnalysis::transform(const SPARQLParser& input,QueryGraph& output)
 {
    output.clear();
 
-   if (!transformSubquery(dict,diffIndex,input.getPatterns(),output.getQuery())) {
-      // A constant could not be resolved. This will produce an empty result
-      output.markAsKnownEmpty();
-      return;
-   }
-
-   // Compute the edges
-   output.constructEdges();
-
-   // Add the projection entry
+   // Add the projection entry. Known empty queries keep it, a lone count still reports 0
    for (SPARQLParser::projection_iterator iter=input.projectionBegin(),limit=input.projectionEnd();iter!=limit;++iter)
       output.addProjection(*iter);
 
@@ -438,6 +431,15 @@ void SemanticAnalysis::transform(const SPARQLParser& input,QueryGraph& output)
       case SPARQLParser::Modifier_Duplicates: output.setDuplicateHandling(QueryGraph::ShowDuplicates); break;
    }
 
+   if (!transformSubquery(dict,diffIndex,input.getPatterns(),output.getQuery())) {
+      // A constant could not be resolved. This will produce an empty result
+      output.markAsKnownEmpty();
+      return;
+   }
+
+   // Compute the edges
+   output.constructEdges();
+
    // Order by clause
    for (SPARQLParser::order_iterator iter=input.orderBegin(),limit=input.orderEnd();iter!=limit;++iter) {
       QueryGraph::Order o;
@@ -10,6 +10,8 @@
 // or send a letter to Creative Commons, 171 Second Street, Suite 300,
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
+#include "cts/infra/QueryGraph.hpp"
+#include <map>
 #include <set>
 #include <vector>
 //---------------------------------------------------------------------------
@@ -17,7 +19,6 @@ class Operator;
 class Plan;
 class Register;
 class Runtime;
-class QueryGraph;
 //---------------------------------------------------------------------------
 /// Interfact to the code generation part of the compiletime system
 class CodeGen
@@ -29,6 +30,8 @@ class CodeGen
    static Operator* translateIntern(Runtime& runtime,const QueryGraph& query,Plan* plan,std::vector<Register*>& output);
    /// Translate an execution plan into an operator tree
    static Operator* translate(Runtime& runtime,const QueryGraph& query,Plan* plan,bool silent=false);
+   /// The registers the translation uses for the patterns of a query. Each pattern gets three consecutive registers (subject, predicate, object), starting at the mapped one
+   static void getPatternRegisters(const QueryGraph& query,std::map<const QueryGraph::Node*,unsigned>& registers);
 };
 //---------------------------------------------------------------------------
 #endif
@@ -41,6 +41,12 @@ class BitSet
    void clear(unsigned i) { value&=~(one<<i); }
    /// Test a specific entry
    bool test(unsigned i) const { return value&(one<<i); }
+   /// Empty?
+   bool empty() const { return !value; }
+   /// The smallest entry. Undefined if empty
+   unsigned first() const { unsigned i=0; while (!test(i)) ++i; return i; }
+   /// All entries up to and including i
+   static BitSet upTo(unsigned i) { return BitSet((i+1<maxWidth)?((one<<(i+1))-1):~static_cast<value_t>(0)); }
 
    /// Equal
    bool operator==(const BitSet& o) const { return value==o.value; }
@@ -60,6 +66,8 @@ class BitSet
    BitSet differenceWith(const BitSet& o) const { return BitSet(value&(~o.value)); }
    /// Intersection
    BitSet intersectWith(const BitSet& o) const { return BitSet(value&o.value); }
+   /// The next non-empty subset of o in ascending order. Starting from the empty set, returns the empty set after the last subset
+   BitSet nextSubsetOf(const BitSet& o) const { return BitSet((value-o.value)&o.value); }
 };
 //---------------------------------------------------------------------------
 #endif
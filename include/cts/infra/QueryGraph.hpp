@@ -65,7 +65,7 @@ class QueryGraph
          Or, And, Equal, NotEqual, Less, LessOrEqual, Greater, GreaterOrEqual, Plus, Minus, Mul, Div,
          Not, UnaryPlus, UnaryMinus, Literal, Variable, IRI, Null, Function, ArgumentList,
          Builtin_str, Builtin_lang, Builtin_langmatches, Builtin_datatype, Builtin_bound, Builtin_sameterm,
-         Builtin_isiri, Builtin_isblank, Builtin_isliteral, Builtin_regex, Builtin_in
+         Builtin_isiri, Builtin_isblank, Builtin_isliteral, Builtin_regex, Builtin_in, Builtin_contains, Builtin_strstarts
       };
 
       /// The type
@@ -89,6 +89,8 @@ class QueryGraph
 
       /// Could be applied?
       bool isApplicable(const std::set<unsigned>& variables) const;
+      /// Is it a string match of a variable against a constant pattern? These can be evaluated against the dictionary
+      bool isStringMatch() const;
    };
    /// A table function
    struct TableFunction {
@@ -155,6 +157,8 @@ class QueryGraph
 
    /// Clear the graph
    void clear();
+   /// Exchange the contents with another graph. Nodes and filters keep their addresses
+   void swap(QueryGraph& other);
    /// Construct the edges
    void constructEdges();
 
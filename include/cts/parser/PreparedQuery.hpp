@@ -0,0 +1,57 @@
+#ifndef H_cts_parser_PreparedQuery
+#define H_cts_parser_PreparedQuery
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include <map>
+#include <string>
+#include <vector>
+//---------------------------------------------------------------------------
+/// A SPARQL query template with named placeholders (%name).
+/** Each placeholder stands for a single constant (IRI, literal, or number)
+  * that is bound when the query is executed. All instantiations of a template
+  * share the same normalized key, which allows for reusing the plan.
+  * Errors are reported as SPARQLParser::ParserException.
+  */
+class PreparedQuery
+{
+   public:
+   /// Values for the placeholders, in SPARQL syntax
+   typedef std::map<std::string,std::string> Bindings;
+
+   private:
+   /// The template
+   std::string text;
+   /// The normalized template
+   std::string key;
+   /// The placeholder names
+   std::vector<std::string> parameters;
+
+   public:
+   /// Constructor
+   PreparedQuery();
+   /// Constructor
+   explicit PreparedQuery(const std::string& text);
+
+   /// The normalized template, usable as plan cache key
+   const std::string& getKey() const { return key; }
+   /// The placeholder names in order of first occurrence
+   const std::vector<std::string>& getParameters() const { return parameters; }
+
+   /// Substitute the placeholders
+   std::string instantiate(const Bindings& bindings) const;
+
+   /// Normalize the query text. Ignores whitespace and comments
+   static std::string normalize(const std::string& text);
+   /// Parse bindings of the form '%name=value ...'
+   static void parseBindings(const std::string& text,Bindings& bindings);
+};
+//---------------------------------------------------------------------------
+#endif
@@ -32,7 +32,7 @@ class SPARQLLexer
 {
    public:
    /// Possible tokens
-   enum Token { None, Error, Eof, IRI, String, Variable, Identifier, Colon, Semicolon, Comma, Dot, Underscore, LCurly, RCurly, LParen, RParen, LBracket, RBracket, Anon, Equal, NotEqual, Less, LessOrEqual, Greater, GreaterOrEqual, At, Type, Not, Or, And, Plus, Minus, Mul, Div, Integer, Decimal, Double, Date  };
+   enum Token { None, Error, Eof, IRI, String, Variable, Identifier, Colon, Semicolon, Comma, Dot, Underscore, LCurly, RCurly, LParen, RParen, LBracket, RBracket, Anon, Equal, NotEqual, Less, LessOrEqual, Greater, GreaterOrEqual, At, Type, Not, Or, And, Plus, Minus, Mul, Div, Integer, Decimal, Double, Date, Parameter  };
 
    private:
    /// The input
@@ -43,6 +43,8 @@ class SPARQLLexer
    std::string::const_iterator tokenStart;
    /// The end of the curent token. Only set if delimiters are stripped
    std::string::const_iterator tokenEnd;
+   /// The start of the current token including delimiters
+   std::string::const_iterator rawStart;
    /// The token put back with unget
    Token putBack;
    /// Was the doken end set?
@@ -58,6 +60,8 @@ class SPARQLLexer
    Token getNext();
    /// Get the value of the current token
    std::string getTokenValue() const;
+   /// Get the text of the current token including delimiters
+   std::string getRawValue() const { return std::string(rawStart,pos); }
    /// Get the value of the current token interpreting IRI escapes
    std::string getIRIValue() const;
    /// Get the value of the current token interpreting literal escapes
@@ -82,7 +82,7 @@ class SPARQLParser
          Or, And, Equal, NotEqual, Less, LessOrEqual, Greater, GreaterOrEqual, Plus, Minus, Mul, Div,
          Not, UnaryPlus, UnaryMinus, Literal, Variable, IRI, Function, ArgumentList,
          Builtin_str, Builtin_lang, Builtin_langmatches, Builtin_datatype, Builtin_bound, Builtin_sameterm,
-         Builtin_isiri, Builtin_isblank, Builtin_isliteral, Builtin_regex, Builtin_in
+         Builtin_isiri, Builtin_isblank, Builtin_isliteral, Builtin_regex, Builtin_in, Builtin_contains, Builtin_strstarts
       };
 
       /// The type
@@ -143,6 +143,12 @@ class SPARQLParser
    ProjectionModifier projectionModifier;
    /// The projection clause
    std::vector<unsigned> projection;
+   /// The name of the count aggregate in the projection (if any)
+   std::string countName;
+   /// The argument of the count aggregate (~0u for *)
+   unsigned countArgument;
+   /// The group by clause
+   std::vector<unsigned> groupBy;
    /// The pattern
    PatternGroup patterns;
    /// The sort order
@@ -202,6 +208,10 @@ class SPARQLParser
    void parseFrom();
    /// Parse the where part if any
    void parseWhere();
+   /// Parse the group by part if any
+   void parseGroupBy();
+   /// Check the use of aggregates
+   void checkAggregates();
    /// Parse the order by part if any
    void parseOrderBy();
    /// Parse the limit part if any
@@ -82,7 +82,7 @@ class TurtleParser
 
       public:
       /// Constructor
-      Lexer(std::istream& in);
+      Lexer(std::istream& in,unsigned firstLine);
       /// Destructor
       ~Lexer();
 
@@ -120,6 +120,8 @@ class TurtleParser
    unsigned triplesReader;
    /// The next blank node id
    unsigned nextBlank;
+   /// The prefix of generated blank nodes
+   std::string blankPrefix;
 
    /// Is a (generalized) name token?
    static inline bool isName(Lexer::Token token);
@@ -148,11 +150,16 @@ class TurtleParser
    public:
    /// Constructor
    TurtleParser(std::istream& in);
+   /// Constructor. Parses a fragment of a larger input starting at the given line. Generated
+   /// blank nodes use the prefix instead of "_:_"
+   TurtleParser(std::istream& in,unsigned firstLine,const std::string& blankPrefix);
    /// Destructor
    ~TurtleParser();
 
    /// Read the next triple
    bool parse(std::string& subject,std::string& predicate,std::string& object,Type::ID& objectType,std::string& objectSubType);
+   /// The number of blank nodes generated so far
+   unsigned getBlankNodeCount() const { return nextBlank; }
 };
 //---------------------------------------------------------------------------
 #endif
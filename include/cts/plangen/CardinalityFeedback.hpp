@@ -0,0 +1,94 @@
+#ifndef H_cts_plangen_CardinalityFeedback
+#define H_cts_plangen_CardinalityFeedback
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "cts/infra/BitSet.hpp"
+#include "cts/infra/QueryGraph.hpp"
+#include "infra/Config.hpp"
+#include <map>
+#include <string>
+//---------------------------------------------------------------------------
+class Database;
+class Operator;
+class Runtime;
+//---------------------------------------------------------------------------
+/// Cardinalities of join results observed while executing queries.
+/** A join result is identified by the signature of its triple patterns. The
+  * signature keeps the constants and numbers the variables by their first
+  * occurrence. The plan generator prefers an observed cardinality over its
+  * estimates, recurring queries therefore converge to good plans. The store
+  * can be saved to a file and is discarded if the database changed.
+  * Not thread safe.
+  */
+class CardinalityFeedback
+{
+   private:
+   /// An observation
+   struct Entry {
+      /// The observed cardinality
+      double observed;
+      /// The cardinality estimated by the plan generator
+      double expected;
+      /// The number of observations
+      unsigned observations;
+      /// The last use
+      mutable unsigned lastUse;
+   };
+   /// Collects the observations from an operator tree
+   class Collector;
+
+   /// The observations
+   std::map<std::string,Entry> entries;
+   /// The maximum number of entries
+   unsigned maxEntries;
+   /// The use counter
+   mutable unsigned clock;
+   /// Incremented whenever an observation changes an estimate
+   unsigned version;
+   /// The version last loaded or stored
+   mutable unsigned storedVersion;
+   /// The database the observations belong to
+   uint64_t databaseVersion;
+
+   CardinalityFeedback(const CardinalityFeedback&);
+   void operator=(const CardinalityFeedback&);
+
+   public:
+   /// Constructor
+   CardinalityFeedback();
+   /// Destructor
+   ~CardinalityFeedback();
+
+   /// The signature of a set of patterns of the query
+   static std::string signature(const QueryGraph::SubQuery& query,const BitSet& relations);
+   /// Look up the observed cardinality
+   bool lookup(const std::string& signature,double& cardinality) const;
+   /// Record an observation
+   void record(const std::string& signature,double expected,double observed);
+   /// Record the join cardinalities of an executed operator tree
+   void observe(Runtime& runtime,const QueryGraph& query,Operator* tree);
+
+   /// Load the observations for a database. A missing or outdated file results in an empty store
+   bool load(Database& db,const char* fileName);
+   /// Store the observations
+   bool store(const char* fileName) const;
+   /// Store the observations if at least the given number of estimates changed since the last load or store. Allows for writing in batches
+   bool storeChanges(const char* fileName,unsigned minChanges) const;
+   /// Remove all observations
+   void clear();
+
+   /// The number of observations
+   unsigned getSize() const { return entries.size(); }
+   /// The version. Changes if an estimate changes
+   unsigned getVersion() const { return version; }
+};
+//---------------------------------------------------------------------------
+#endif
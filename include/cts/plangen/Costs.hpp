@@ -11,36 +11,78 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 /// A cost model used by the plan generator
+/** The hardware dependent constants form a cost profile. The defaults were
+  * tuned for disks, a profile measured with rdf3xcalibrate can be loaded
+  * instead.
+  */
 class Costs
 {
    public:
    /// Data type for costs
    typedef double cost_t;
 
+   /// The hardware dependent constants. Costs are in 1/10ms
+   struct Profile {
+      /// Costs for a seek
+      double seekCosts;
+      /// Costs for a sequential page read
+      double scanCosts;
+      /// Number of CPU operations per 1/10ms
+      double cpuSpeed;
+      /// Fixed costs of a hash join
+      double hashSetup;
+      /// Costs per tuple inserted into a hash table
+      double hashBuild;
+      /// Costs per tuple probing a hash table
+      double hashProbe;
+      /// Fixed costs of evaluating a plan in parallel
+      double exchangeSetup;
+
+      /// Constructor. Initializes the default profile
+      Profile();
+
+      /// Read a profile. Missing entries keep their values
+      bool load(const char* fileName);
+      /// Write a profile
+      bool store(const char* fileName) const;
+   };
+
    private:
-   /// Costs for a seek in 1/10ms
-   static const unsigned seekCosts = 95;
-   /// Costs for a sequential page read in 1/10ms
-   static const unsigned scanCosts = 17;
-   /// Number of CPU operations per 1/10ms
-   static const unsigned cpuSpeed = 100000;
+   /// The profile in use
+   static Profile profile;
 
    public:
+   /// The profile in use
+   static const Profile& getProfile() { return profile; }
+   /// Change the profile
+   static void setProfile(const Profile& newProfile) { profile=newProfile; }
+
    /// Costs for traversing a btree
-   static cost_t seekBtree() { return 3*seekCosts; }
+   static cost_t seekBtree() { return 3*profile.seekCosts; }
    /// Costs for scanning a number of pages
-   static cost_t scan(unsigned pages) { return pages*scanCosts; }
+   static cost_t scan(unsigned pages) { return pages*profile.scanCosts; }
 
    /// Costs for a merge join
-   static cost_t mergeJoin(double leftCard,double rightCard) { return (leftCard/cpuSpeed)+(rightCard/cpuSpeed); }
+   static cost_t mergeJoin(double leftCard,double rightCard) { return (leftCard/profile.cpuSpeed)+(rightCard/profile.cpuSpeed); }
    /// Costs for a hash join
-   static cost_t hashJoin(double leftCard,double rightCard) { return 300000+(leftCard/10)+(rightCard/100); }
+   static cost_t hashJoin(double leftCard,double rightCard) { return profile.hashSetup+(leftCard*profile.hashBuild)+(rightCard*profile.hashProbe); }
    /// Costs for a hash optional
-   static cost_t hashOptional(double leftCard,double rightCard) { return 300000+(leftCard/10)+(rightCard/100); }
+   static cost_t hashOptional(double leftCard,double rightCard) { return hashJoin(leftCard,rightCard); }
    /// Costs for a filter
-   static cost_t filter(double card) { return card/(cpuSpeed/3); }
+   static cost_t filter(double card) { return card/(profile.cpuSpeed/3); }
+   /// Costs for a filter that examines the string of each tuple. Most lookups hit cached pages
+   static cost_t stringFilter(double card) { return filter(card)+(card*profile.seekCosts/100); }
+   /// Costs for evaluating a string filter once against all strings of the dictionary
+   static cost_t dictionaryFilter(double strings) { return scan(static_cast<unsigned>(strings/256))+(strings/profile.cpuSpeed); }
+   /// Costs for evaluating a prefix filter using the sorted string index, reading the given number of leaves
+   static cost_t prefixIndexFilter(double leaves) { return seekBtree()+scan(static_cast<unsigned>(leaves))+(leaves*256/profile.cpuSpeed); }
    /// Costs for a table function
    static cost_t tableFunction(double leftCard) { return leftCard*10000.0; }
+   /// Costs for replaying a materialized intermediate result
+   static cost_t materializedScan(double card) { return card/profile.cpuSpeed; }
+   /// Costs for evaluating a plan in partitions using a number of threads. The replicated part
+   /// of the plan is computed by every partition, each partition seeks into the scanned indexes
+   static cost_t exchange(cost_t costs,cost_t replicated,double card,unsigned scans,unsigned partitions,unsigned threads) { return profile.exchangeSetup+((costs-replicated)+(partitions*(replicated+scans*scan(1))))/threads+2*materializedScan(card); }
 };
 //---------------------------------------------------------------------------
 #endif
@@ -0,0 +1,85 @@
+#ifndef H_cts_plangen_JoinSampler
+#define H_cts_plangen_JoinSampler
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "cts/infra/BitSet.hpp"
+#include "cts/infra/QueryGraph.hpp"
+#include "infra/osdep/Timestamp.hpp"
+#include "infra/Config.hpp"
+#include <map>
+#include <vector>
+//---------------------------------------------------------------------------
+class Database;
+//---------------------------------------------------------------------------
+/// Estimates join cardinalities by random walks through the indexes.
+/** A walk starts at a uniformly chosen match of the most selective pattern
+  * and extends it pattern by pattern, choosing one of the d matching triples
+  * consistent with the bindings so far. The product of the fan-outs is an
+  * unbiased estimate of the join size (wander join). All sampling performed
+  * for one query shares a time budget, afterwards no estimates are produced.
+  */
+class JoinSampler
+{
+   private:
+   /// A uniform sample of the matches of a pattern
+   struct Sample {
+      /// The sampled triples, subject, predicate and object each
+      std::vector<unsigned> triples;
+      /// The number of matches
+      double cardinality;
+      /// Was the sample computed completely?
+      bool valid;
+   };
+
+   /// The database
+   Database& db;
+   /// The query
+   const QueryGraph::SubQuery& query;
+   /// The samples of the start patterns
+   std::map<unsigned,Sample> samples;
+   /// The number of walks per estimate
+   unsigned walks;
+   /// The time budget in ms
+   unsigned budget;
+   /// The begin of sampling
+   Timestamp start;
+   /// The random state
+   uint64_t seed;
+   /// Is the budget exhausted?
+   bool exhausted;
+
+   JoinSampler(const JoinSampler&);
+   void operator=(const JoinSampler&);
+
+   /// A random number in [0,limit)
+   unsigned random(unsigned limit);
+   /// Check the time budget
+   bool timeUp();
+   /// Scan the matches of a pattern consistent with the bindings. Keeps a uniform sample of up to size matches
+   bool scan(const QueryGraph::Node& node,const std::map<unsigned,unsigned>& bindings,unsigned size,std::vector<unsigned>& sample,double& count);
+   /// Pick a random match of a pattern consistent with the bindings. The fan-out comes from the aggregated indexes
+   bool pick(const QueryGraph::Node& node,const std::map<unsigned,unsigned>& bindings,std::vector<unsigned>& choice,double& fanout);
+   /// Get the sample of a start pattern
+   const Sample& getSample(unsigned node);
+
+   public:
+   /// Constructor
+   JoinSampler(Database& db,const QueryGraph::SubQuery& query,unsigned budget,unsigned walks);
+   /// Destructor
+   ~JoinSampler();
+
+   /// Estimate the cardinality of the join of some patterns. Negative if no estimate is available
+   double estimate(const BitSet& relations);
+   /// Is the budget exhausted?
+   bool isExhausted() const { return exhausted; }
+};
+//---------------------------------------------------------------------------
+#endif
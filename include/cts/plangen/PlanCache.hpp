@@ -0,0 +1,86 @@
+#ifndef H_cts_plangen_PlanCache
+#define H_cts_plangen_PlanCache
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "infra/Config.hpp"
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+//---------------------------------------------------------------------------
+class CardinalityFeedback;
+class Database;
+class QueryGraph;
+struct Plan;
+//---------------------------------------------------------------------------
+/// A cache for optimized plans, keyed by the normalized query text.
+/** A cached plan is reused for every query graph with the same structure,
+  * the constants of the new graph are copied into the cached graph the plan
+  * refers to. The cache is flushed when the statistics of the database change,
+  * and a plan is rebuilt if the cardinality of a constant pattern differs by
+  * more than the re-plan factor from the one the plan was built for or if
+  * the observed cardinalities changed.
+  * Not thread safe.
+  */
+class PlanCache
+{
+   private:
+   /// A cached plan
+   struct Entry;
+
+   /// The entries
+   std::map<std::string,Entry*> entries;
+   /// The entries, most recently used first
+   std::list<Entry*> lru;
+   /// The maximum number of entries
+   unsigned maxEntries;
+   /// The cardinality deviation that triggers re-planning (0 to disable)
+   double replanFactor;
+   /// The statistics the entries were built for
+   uint64_t statisticsVersion;
+   /// The observed cardinalities (if any)
+   const CardinalityFeedback* feedback;
+   /// Statistics
+   unsigned hits,misses,replans;
+
+   PlanCache(const PlanCache&);
+   void operator=(const PlanCache&);
+
+   /// Remove an entry
+   void drop(Entry* entry);
+
+   public:
+   /// Constructor
+   PlanCache();
+   /// Destructor
+   ~PlanCache();
+
+   /// Get a plan for a query graph that is not known to be empty. Returns the graph the plan refers to, which stays valid until the next call
+   Plan* translate(Database& db,const std::string& key,QueryGraph& query,const QueryGraph*& planQuery);
+   /// Remove all entries
+   void clear();
+   /// Plan using observed cardinalities. The feedback must outlive the cache
+   void setFeedback(const CardinalityFeedback* feedback) { this->feedback=feedback; }
+
+   /// The number of reused plans
+   unsigned getHits() const { return hits; }
+   /// The number of newly built plans
+   unsigned getMisses() const { return misses; }
+   /// The number of plans rebuilt due to cardinality or feedback changes
+   unsigned getReplans() const { return replans; }
+   /// The number of cached plans
+   unsigned getSize() const { return entries.size(); }
+
+   /// Does any constant pattern cardinality differ by more than the factor from the one the plan was built for? Never if the factor is 0
+   static bool deviates(const std::vector<unsigned>& planned,const std::vector<unsigned>& current,double factor);
+};
+//---------------------------------------------------------------------------
+#endif
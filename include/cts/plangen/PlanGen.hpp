@@ -29,22 +29,47 @@
 #include "cts/infra/BitSet.hpp"
 #include "cts/infra/QueryGraph.hpp"
 #include "rts/database/Database.hpp"
+#include <map>
+#include <vector>
+//---------------------------------------------------------------------------
+class CardinalityFeedback;
+class JoinSampler;
 //---------------------------------------------------------------------------
 /// A plan generator that construct a physical plan from a query graph
 class PlanGen
 {
+   public:
+   /// An intermediate result that was already computed. Replaces its relations in the join tree
+   struct Intermediate {
+      /// The relations contained in the result
+      BitSet relations;
+      /// The variables produced by the result
+      std::vector<unsigned> variables;
+      /// The filters already applied
+      std::vector<const QueryGraph::Filter*> filters;
+      /// The cardinality
+      double cardinality;
+      /// The ordering
+      unsigned ordering;
+   };
+
    private:
    /// A subproblem
    struct Problem {
-      /// The next problem in the DP table
+      /// The next base problem
       Problem* next;
       /// The known solutions to the problem
       Plan* plans;
       /// The relations involved in the problem
       BitSet relations;
+      /// The cardinality if known from observations or the characteristic sets, negative otherwise
+      double knownCardinality;
    };
    /// A join description
    struct JoinDescription;
+   /// The enumeration of connected subgraphs
+   class JoinEnumerator;
+   friend class JoinEnumerator;
    /// The plans
    PlanContainer plans;
    /// The problems
@@ -53,6 +78,30 @@ class PlanGen
    Database* db;
    /// The current query
    const QueryGraph* fullQuery;
+   /// The maximum number of relations for exhaustive enumeration
+   unsigned maxDPRelations;
+   /// The maximum number of join pairs for exhaustive enumeration
+   unsigned maxDPPairs;
+   /// The time spent in the last translation (in ms)
+   unsigned planningTime;
+   /// The number of join pairs considered in the last translation
+   unsigned joinPairs;
+   /// Did the last translation fall back to greedy join ordering?
+   bool greedy;
+   /// The intermediate results available to the current translation
+   const std::vector<Intermediate*>* intermediates;
+   /// The relations covered by intermediate results
+   BitSet materialized;
+   /// The observed cardinalities (if any)
+   const CardinalityFeedback* feedback;
+   /// The time budget for sampling join cardinalities (in ms, 0 to disable)
+   unsigned samplingTime;
+   /// The number of random walks per sampled estimate
+   unsigned samplingWalks;
+   /// The join sampler of the current translation (if any)
+   JoinSampler* sampler;
+   /// The number of threads available to the plans (0 for serial plans)
+   unsigned threads;
 
    PlanGen(const PlanGen&);
    void operator=(const PlanGen&);
@@ -69,6 +118,18 @@ class PlanGen
    Problem* buildScan(const QueryGraph::SubQuery& query,const QueryGraph::Node& node,unsigned id);
    /// Build the informaion about a join
    JoinDescription buildJoinInfo(const QueryGraph::SubQuery& query,const QueryGraph::Edge& edge);
+   /// Estimate the cardinality of a subject star using the characteristic sets
+   double estimateStar(const QueryGraph::SubQuery& query,const BitSet& relations);
+   /// The cardinality of a join result if observed before, a subject star or sampled. Negative if not known
+   double estimateCardinality(const QueryGraph::SubQuery& query,const BitSet& relations);
+   /// Find the join predicate connecting two subproblems in any direction
+   static bool findJoin(const std::vector<JoinDescription>& joins,const BitSet& left,const BitSet& right,double& selectivity);
+   /// Join two disjoint subproblems
+   Problem* buildJoin(const QueryGraph::SubQuery& query,const std::vector<JoinDescription>& joins,Problem* left,Problem* right,std::map<BitSet,Problem*>& lookup);
+   /// Combine subproblems greedily
+   Problem* buildGreedy(const QueryGraph::SubQuery& query,const std::vector<JoinDescription>& joins,std::vector<Problem*> current,std::map<BitSet,Problem*>& lookup);
+   /// Combine the base problems into a complete join tree
+   Problem* buildJoinTree(const QueryGraph::SubQuery& query,Problem* base,const std::vector<JoinDescription>& joins);
    /// Generate an optional part
    Problem* buildOptional(const QueryGraph::SubQuery& query,unsigned id);
    /// Generate a union part
@@ -77,6 +138,10 @@ class PlanGen
    Problem*buildGJoin(const std::vector<QueryGraph::SubQuery>& query,unsigned id);
    /// Generate a table function access
    Problem* buildTableFunction(const QueryGraph::TableFunction& function,unsigned id);
+   /// Generate the access to an intermediate result
+   Problem* buildMaterialized(const Intermediate& intermediate,unsigned index);
+   /// Evaluate the expensive partitionable parts of a plan in parallel, using up to the given number of threads
+   Plan* addExchange(Plan* plan,unsigned threads);
 
    /// Translate a query into an operator tree only used in OPTIONAL clause
    Plan* translateForOptional(const QueryGraph::SubQuery& query);
@@ -95,6 +160,18 @@ class PlanGen
 
    /// Translate a query into an operator tree
    Plan* translate(Database& db,const QueryGraph& query);
+   /// Translate a query into an operator tree, reusing already computed intermediate results
+   Plan* translate(Database& db,const QueryGraph& query,const std::vector<Intermediate*>& intermediates);
+
+   /// Use observed cardinalities instead of estimates where available. The feedback must outlive the plan generator
+   void setFeedback(const CardinalityFeedback* feedback) { this->feedback=feedback; }
+
+   /// The time spent in the last translation (in ms)
+   unsigned getPlanningTime() const { return planningTime; }
+   /// The number of join pairs considered in the last translation
+   unsigned getJoinPairs() const { return joinPairs; }
+   /// Did the last translation fall back to greedy join ordering?
+   bool usedGreedy() const { return greedy; }
 };
 //---------------------------------------------------------------------------
 #endif
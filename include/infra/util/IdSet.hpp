@@ -0,0 +1,86 @@
+#ifndef H_infra_util_IdSet
+#define H_infra_util_IdSet
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "infra/Config.hpp"
+#include <vector>
+//---------------------------------------------------------------------------
+/// A compressed set of ids.
+/** Organized like a roaring bitmap: the ids are partitioned by their upper
+  * 16 bits, each partition stores the lower bits either as sorted array (if
+  * sparse) or as bitmap (if dense). The memory is therefore proportional to
+  * the number of ids and not to their magnitude.
+  */
+class IdSet
+{
+   private:
+   /// Container limits. Arrays larger than maxArraySize entries become bitmaps of bitmapWords words
+   enum { maxArraySize = 4096, bitmapWords = 1024 };
+
+   /// A container for ids sharing the upper 16 bits
+   struct Container {
+      /// The sorted lower bits (if sparse)
+      std::vector<uint16_t> array;
+      /// The bitmap (if dense)
+      std::vector<uint64_t> bitmap;
+      /// Number of ids
+      unsigned count;
+   };
+
+   /// The upper bits of the containers, sorted
+   std::vector<unsigned> keys;
+   /// The containers
+   std::vector<Container> containers;
+   /// Total number of ids
+   unsigned count;
+
+   public:
+   /// Iterates over the ids in ascending order
+   class Iterator {
+      private:
+      /// The set
+      const IdSet* set;
+      /// The current container
+      unsigned container;
+      /// The position within the container
+      unsigned pos;
+
+      public:
+      /// Constructor
+      explicit Iterator(const IdSet& set) : set(&set),container(0),pos(0) {}
+
+      /// Get the next id
+      bool next(unsigned& id);
+   };
+
+   /// Constructor
+   IdSet();
+   /// Constructor
+   explicit IdSet(const std::vector<unsigned>& ids);
+
+   /// Replace the contents. The ids may be unsorted and contain duplicates
+   void assign(const std::vector<unsigned>& ids);
+   /// Remove all ids
+   void clear();
+
+   /// Is the id contained?
+   bool contains(unsigned id) const;
+   /// Empty?
+   bool empty() const { return !count; }
+   /// Number of ids
+   unsigned size() const { return count; }
+   /// The smallest id. Undefined if empty
+   unsigned getMin() const;
+   /// The largest id. Undefined if empty
+   unsigned getMax() const;
+};
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,231 @@
+#ifndef H_infra_util_LRUCache
+#define H_infra_util_LRUCache
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "infra/Config.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include <vector>
+//---------------------------------------------------------------------------
+/** A size bounded cache from integer keys to values. The cache is split into
+  * independently locked shards, each shard evicts its least recently used
+  * entry when full. Values are copied in and out.
+  */
+template <class T> class LRUCache
+{
+   private:
+   /// Marker for missing entries
+   enum { none = ~0u };
+   /// Number of bits used to select a shard
+   static const unsigned shardBits = 4;
+   /// Number of shards
+   static const unsigned shardCount = 1<<shardBits;
+
+   /// An entry
+   struct Entry {
+      /// The key
+      unsigned key;
+      /// The next entry in the hash chain
+      unsigned chain;
+      /// Neighbors in the LRU list
+      unsigned prev,next;
+      /// The value
+      T value;
+   };
+   /// A shard
+   struct Shard {
+      /// The lock
+      Mutex lock;
+      /// The entries
+      std::vector<Entry> entries;
+      /// The hash table
+      std::vector<unsigned> buckets;
+      /// The most and the least recently used entry
+      unsigned head,tail;
+      /// Statistics
+      uint64_t hits,misses;
+   };
+
+   /// The shards
+   Shard* shards;
+   /// Capacity of a shard
+   unsigned shardCapacity;
+
+   /// Hash a key
+   static unsigned hash(unsigned key) { return key*2654435761u; }
+   /// Unlink an entry from the LRU list
+   static void unlink(Shard& s,unsigned slot);
+   /// Make an entry the most recently used one
+   static void pushFront(Shard& s,unsigned slot);
+   /// Find an entry
+   static unsigned find(Shard& s,unsigned key,unsigned h);
+
+   LRUCache(const LRUCache&);
+   void operator=(const LRUCache&);
+
+   public:
+   /// Constructor
+   explicit LRUCache(unsigned capacity);
+   /// Destructor
+   ~LRUCache() { delete[] shards; }
+
+   /// Lookup a value
+   bool lookup(unsigned key,T& value);
+   /// Insert or update a value
+   void insert(unsigned key,const T& value);
+   /// Remove all entries
+   void clear();
+
+   /// Number of successful lookups
+   uint64_t getHits();
+   /// Number of failed lookups
+   uint64_t getMisses();
+};
+//---------------------------------------------------------------------------
+template <class T> LRUCache<T>::LRUCache(unsigned capacity)
+   : shards(new Shard[shardCount]),shardCapacity((capacity+shardCount-1)/shardCount)
+   // Constructor
+{
+   if (!shardCapacity) shardCapacity=1;
+   unsigned bucketCount=1;
+   while (bucketCount<shardCapacity) bucketCount<<=1;
+   for (unsigned index=0;index<shardCount;index++) {
+      Shard& s=shards[index];
+      s.entries.reserve(shardCapacity);
+      s.buckets.assign(bucketCount,static_cast<unsigned>(none));
+      s.head=s.tail=none;
+      s.hits=s.misses=0;
+   }
+}
+//---------------------------------------------------------------------------
+template <class T> void LRUCache<T>::unlink(Shard& s,unsigned slot)
+   // Unlink an entry from the LRU list
+{
+   Entry& e=s.entries[slot];
+   if (e.prev!=none) s.entries[e.prev].next=e.next; else s.head=e.next;
+   if (e.next!=none) s.entries[e.next].prev=e.prev; else s.tail=e.prev;
+}
+//---------------------------------------------------------------------------
+template <class T> void LRUCache<T>::pushFront(Shard& s,unsigned slot)
+   // Make an entry the most recently used one
+{
+   Entry& e=s.entries[slot];
+   e.prev=none;
+   e.next=s.head;
+   if (s.head!=none) s.entries[s.head].prev=slot; else s.tail=slot;
+   s.head=slot;
+}
+//---------------------------------------------------------------------------
+template <class T> unsigned LRUCache<T>::find(Shard& s,unsigned key,unsigned h)
+   // Find an entry
+{
+   for (unsigned slot=s.buckets[h&(s.buckets.size()-1)];slot!=none;slot=s.entries[slot].chain)
+      if (s.entries[slot].key==key)
+         return slot;
+   return none;
+}
+//---------------------------------------------------------------------------
+template <class T> bool LRUCache<T>::lookup(unsigned key,T& value)
+   // Lookup a value
+{
+   unsigned h=hash(key);
+   Shard& s=shards[h>>(32-shardBits)];
+   auto_lock lock(s.lock);
+
+   unsigned slot=find(s,key,h);
+   if (slot==none) {
+      ++s.misses;
+      return false;
+   }
+   ++s.hits;
+   if (s.head!=slot) {
+      unlink(s,slot);
+      pushFront(s,slot);
+   }
+   value=s.entries[slot].value;
+   return true;
+}
+//---------------------------------------------------------------------------
+template <class T> void LRUCache<T>::insert(unsigned key,const T& value)
+   // Insert or update a value
+{
+   unsigned h=hash(key);
+   Shard& s=shards[h>>(32-shardBits)];
+   auto_lock lock(s.lock);
+
+   // Already known?
+   unsigned slot=find(s,key,h);
+   if (slot!=none) {
+      s.entries[slot].value=value;
+      if (s.head!=slot) {
+         unlink(s,slot);
+         pushFront(s,slot);
+      }
+      return;
+   }
+
+   // Take a new entry or evict the least recently used one
+   if (s.entries.size()<shardCapacity) {
+      slot=s.entries.size();
+      s.entries.push_back(Entry());
+   } else {
+      slot=s.tail;
+      unlink(s,slot);
+      unsigned* pos=&s.buckets[hash(s.entries[slot].key)&(s.buckets.size()-1)];
+      while (*pos!=slot)
+         pos=&s.entries[*pos].chain;
+      *pos=s.entries[slot].chain;
+   }
+
+   // And insert it
+   Entry& e=s.entries[slot];
+   e.key=key;
+   e.value=value;
+   unsigned& bucket=s.buckets[h&(s.buckets.size()-1)];
+   e.chain=bucket;
+   bucket=slot;
+   pushFront(s,slot);
+}
+//---------------------------------------------------------------------------
+template <class T> void LRUCache<T>::clear()
+   // Remove all entries
+{
+   for (unsigned index=0;index<shardCount;index++) {
+      Shard& s=shards[index];
+      auto_lock lock(s.lock);
+      s.entries.clear();
+      s.buckets.assign(s.buckets.size(),static_cast<unsigned>(none));
+      s.head=s.tail=none;
+   }
+}
+//---------------------------------------------------------------------------
+template <class T> uint64_t LRUCache<T>::getHits()
+   // Number of successful lookups
+{
+   uint64_t result=0;
+   for (unsigned index=0;index<shardCount;index++) {
+      auto_lock lock(shards[index].lock);
+      result+=shards[index].hits;
+   }
+   return result;
+}
+//---------------------------------------------------------------------------
+template <class T> uint64_t LRUCache<T>::getMisses()
+   // Number of failed lookups
+{
+   uint64_t result=0;
+   for (unsigned index=0;index<shardCount;index++) {
+      auto_lock lock(shards[index].lock);
+      result+=shards[index].misses;
+   }
+   return result;
+}
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,113 @@
+#ifndef H_infra_util_Regex
+#define H_infra_util_Regex
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include <string>
+#include <vector>
+//---------------------------------------------------------------------------
+/// A compiled regular expression with the search semantics of the SPARQL regex builtin.
+/** The pattern is translated into an NFA and, if it stays reasonably small,
+  * into a DFA over byte classes. Matching is a single pass over the input.
+  * A leading literal is searched with memchr first, inputs without it are
+  * rejected without running the automaton. Compiled expressions are
+  * immutable and can be shared between threads.
+  */
+class Regex
+{
+   public:
+   /// Flags
+   enum Flag { CaseInsensitive = 1, DotAll = 2, MultiLine = 4, Extended = 8 };
+
+   private:
+   /// An NFA state
+   struct State {
+      /// Kinds
+      enum Kind { Char, Split, Jump, Begin, End, Match, LineStart };
+      /// The kind
+      Kind kind;
+      /// The character set (for Char)
+      unsigned set;
+      /// The successors
+      unsigned out1,out2;
+   };
+   class Parser;
+
+   /// The NFA states
+   std::vector<State> states;
+   /// The character sets, 256 bits each
+   std::vector<unsigned> sets;
+   /// The NFA start state
+   unsigned start;
+   /// Marker in a set of NFA states with pending end assertions at the start of a line
+   unsigned lineStartState;
+   /// The flags
+   unsigned flags;
+   /// Mapping from bytes to byte classes
+   unsigned char byteClass[256];
+   /// Number of byte classes
+   unsigned classCount;
+   /// The DFA transitions, empty if the DFA was too large
+   std::vector<unsigned> transitions;
+   /// The initial DFA state
+   unsigned initialState;
+   /// DFA states that accept at the end of the input
+   std::vector<bool> acceptAtEnd;
+   /// A literal that every match starts with
+   std::string prefix;
+   /// Does the pattern consist only of the literal?
+   bool pureLiteral;
+   /// Must the match start at the beginning of the input?
+   bool anchored;
+   /// The cache key
+   std::string cacheKey;
+
+   /// Is a byte contained in a set?
+   bool inSet(unsigned set,unsigned char c) const { return (sets[8*set+(c>>5)]>>(c&31))&1; }
+   /// Compute the epsilon closure
+   void closure(std::vector<unsigned>& result,std::vector<unsigned char>& seen,unsigned state,bool lineStart,bool lineEnd,bool& matched) const;
+   /// Remember that a set of NFA states is at the start of a line
+   void markLineStart(std::vector<unsigned>& current) const;
+   /// Advance a set of NFA states over one byte
+   void step(const std::vector<unsigned>& current,unsigned char c,std::vector<unsigned>& next,std::vector<unsigned char>& seen,bool& matched) const;
+   /// Does a set of NFA states accept at the end of the input?
+   bool acceptsAtEnd(const std::vector<unsigned>& current) const;
+   /// Build the byte classes
+   void buildByteClasses();
+   /// Build the DFA
+   bool buildDFA();
+   /// Run the automaton
+   bool run(const char* begin,const char* start,const char* stop) const;
+
+   Regex(const Regex&);
+   void operator=(const Regex&);
+
+   public:
+   /// Constructor
+   Regex();
+   /// Destructor
+   ~Regex();
+
+   /// Interpret a SPARQL flags string
+   static bool parseFlags(const std::string& text,unsigned& flags);
+   /// Compile a pattern. Returns false if the pattern is malformed
+   bool compile(const std::string& pattern,unsigned flags);
+   /// Does the pattern match somewhere in the string?
+   bool matches(const char* start,const char* stop) const;
+   /// Does the pattern match somewhere in the string?
+   bool matches(const std::string& text) const { return matches(text.data(),text.data()+text.size()); }
+
+   /// Get a compiled pattern from the shared cache. Returns 0 if the pattern is malformed
+   static const Regex* acquire(const std::string& pattern,const std::string& flags);
+   /// Release a pattern obtained from acquire
+   static void release(const Regex* regex);
+};
+//---------------------------------------------------------------------------
+#endif
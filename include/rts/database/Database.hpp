@@ -20,6 +20,7 @@ class FilePartition;
 class DatabasePartition;
 class DictionarySegment;
 class ExactStatisticsSegment;
+class PredicateSetSegment;
 //---------------------------------------------------------------------------
 /// Access to the RDF database
 class Database
@@ -67,6 +68,8 @@ class Database
    FullyAggregatedFactsSegment& getFullyAggregatedFacts(DataOrder order);
    /// Get the exact statistics
    ExactStatisticsSegment& getExactStatistics();
+   /// Get the characteristic sets. Might be null for older databases
+   PredicateSetSegment* getPredicateSets();
    /// Get the dictionary
    DictionarySegment& getDictionary();
 
@@ -14,6 +14,9 @@
 #include "rts/buffer/BufferReference.hpp"
 #include "infra/util/Type.hpp"
 //---------------------------------------------------------------------------
+class AggregatedFactsSegment;
+class FactsSegment;
+class FullyAggregatedFactsSegment;
 class Segment;
 //---------------------------------------------------------------------------
 /// Builds a new RDF database from scratch
@@ -79,6 +82,18 @@ class DatabaseBuilder
       /// Load a new data item
       virtual bool next(unsigned& v1,unsigned& v2) = 0;
    };
+   /// A reader for string/id pairs in string order
+   class StringIndexReader
+   {
+      public:
+      /// Constructor
+      StringIndexReader();
+      /// Destructor
+      virtual ~StringIndexReader();
+
+      /// Load a new entry
+      virtual bool next(unsigned& len,const char*& data,unsigned& id) = 0;
+   };
    /// A RDF triple
    struct Triple {
       /// The values as IDs
@@ -123,10 +138,26 @@ class DatabaseBuilder
    /// The file name
    const char* dbFile;
 
-   /// Load the triples aggregated into the database
-   void loadAggregatedFacts(unsigned order,FactsReader& reader);
-   /// Load the triples fully aggregated into the database
-   void loadFullyAggregatedFacts(unsigned order,FactsReader& reader);
+   /// The segments of one order
+   struct OrderSegments {
+      /// The full facts
+      FactsSegment* fullFacts;
+      /// The aggregated facts
+      AggregatedFactsSegment* aggregatedFacts;
+      /// The fully aggregated facts (even orders only)
+      FullyAggregatedFactsSegment* fullyAggregatedFacts;
+   };
+   /// Shared state when loading multiple orders concurrently
+   struct OrderJobs;
+
+   /// Create the segments of an order
+   void addOrderSegments(unsigned order,OrderSegments& segments);
+   /// Load the facts of an order into its segments
+   static void loadOrder(const OrderSegments& segments,FactsReader& reader);
+   /// Load orders until all are claimed
+   static void loadOrders(OrderJobs& jobs);
+   /// Entry point for helper threads
+   static void asyncLoadOrders(void* info);
 
    DatabaseBuilder(const DatabaseBuilder&);
    void operator=(const DatabaseBuilder&);
@@ -142,15 +173,23 @@ class DatabaseBuilder
 
    /// Loads the facts in a given order
    void loadFacts(unsigned order,FactsReader& reader);
+   /// Loads the facts in all six orders concurrently, readers[order] delivers the facts in that order. Uses up to MAXTHREADS threads
+   void loadFacts(FactsReader* readers[6]);
    /// Load the raw strings (must be in id order, ids 0,1,2,...)
    void loadStrings(StringsReader& reader);
    /// Load the strings mappings (must be in id order, ids 0,1,2,...)
    void loadStringMappings(StringInfoReader& reader);
    /// Load the hash->page mappings (must be in hash order)
    void loadStringHashes(StringInfoReader& reader);
+   /// Load the optional sorted string index (must be in string order)
+   void loadStringIndex(StringIndexReader& reader);
+   /// Record that xsd:dateTime literals are stored as Type::Date (after loading the strings). Otherwise they are expected as custom typed literals
+   void setTypedDates(bool typedDates);
 
    /// Compute the exact statistics (after loading)
    void computeExactStatistics(const char* tempFile);
+   /// Compute the characteristic sets (after loading)
+   void computePredicateSets();
 };
 //---------------------------------------------------------------------------
 #endif
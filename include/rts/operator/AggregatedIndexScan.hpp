@@ -51,6 +51,8 @@ class AggregatedIndexScan : public Operator
    Hint hint;
    /// Merge hints
    std::vector<Register*> merge1,merge2;
+   /// The admissible range of the first unbound value
+   unsigned rangeLow,rangeHigh;
 
    /// Constructor
    AggregatedIndexScan(Database& db,Database::DataOrder order,Register* value1,bool bound1,Register* value2,bool bound2,double expectedOutputCardinality);
@@ -76,6 +78,8 @@ class AggregatedIndexScan : public Operator
    void addMergeHint(Register* reg1,Register* reg2);
    /// Register parts of the tree that can be executed asynchronous
    void getAsyncInputCandidates(Scheduler& scheduler);
+   /// Restrict the first unbound value to the range [low,high). Used to partition scans
+   void restrictRange(unsigned low,unsigned high);
 
    /// Create a suitable operator
    static AggregatedIndexScan* create(Database& db,Database::DataOrder order,Register* subjectRegister,bool subjectBound,Register* predicateRegister,bool predicateBound,Register* objectRegister,bool objectBound,double expectedOutputCardinality);
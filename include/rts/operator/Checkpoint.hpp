@@ -0,0 +1,69 @@
+#ifndef H_rts_operator_Checkpoint
+#define H_rts_operator_Checkpoint
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "rts/operator/Operator.hpp"
+#include <vector>
+//---------------------------------------------------------------------------
+/// Materializes an intermediate result and replays it. This reveals the true
+/// cardinality of the intermediate result before the rest of the query runs.
+/// Can also replay a result that was materialized by another checkpoint
+class Checkpoint : public Operator
+{
+   private:
+   /// The input
+   Operator* input;
+   /// The operator tree that computed the replayed tuples (if known). Not owned, shown when printing
+   Operator* origin;
+   /// The registers
+   std::vector<Register*> regs;
+   /// The materialized tuples (values and count)
+   std::vector<unsigned> tuples;
+   /// The tuples to replay
+   const std::vector<unsigned>* source;
+   /// The current position
+   std::vector<unsigned>::const_iterator pos;
+   /// The number of tuples including duplicates
+   double cardinality;
+   /// Materialized?
+   bool materialized;
+
+   public:
+   /// Constructor
+   Checkpoint(Operator* input,const std::vector<Register*>& regs,double expectedOutputCardinality);
+   /// Constructor. Replays tuples materialized elsewhere, which must outlive the operator
+   Checkpoint(const std::vector<unsigned>& tuples,const std::vector<Register*>& regs,double expectedOutputCardinality,Operator* origin=0);
+   /// Destructor
+   ~Checkpoint();
+
+   /// Compute the input completely
+   void materialize();
+   /// The number of materialized tuples including duplicates
+   double getCardinality() const { return cardinality; }
+   /// Hand out the materialized tuples. The operator cannot be used afterwards
+   void releaseTuples(std::vector<unsigned>& target);
+   /// Hand out the input after materializing. The caller takes ownership
+   Operator* releaseInput();
+
+   /// Produce the first tuple
+   unsigned first();
+   /// Produce the next tuple
+   unsigned next();
+
+   /// Print the operator tree. Debugging only.
+   void print(PlanPrinter& out);
+   /// Add a merge join hint
+   void addMergeHint(Register* reg1,Register* reg2);
+   /// Register parts of the tree that can be executed asynchronous
+   void getAsyncInputCandidates(Scheduler& scheduler);
+};
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,97 @@
+#ifndef H_rts_operator_Exchange
+#define H_rts_operator_Exchange
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "rts/operator/Operator.hpp"
+#include "infra/osdep/Event.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include <vector>
+//---------------------------------------------------------------------------
+class Runtime;
+//---------------------------------------------------------------------------
+/// Evaluates the partitions of a subplan in parallel and concatenates their results.
+/// The partitions cover disjoint, ascending ranges of the partitioning variable,
+/// an ordering on that variable is therefore preserved
+class Exchange : public Operator
+{
+   public:
+   /// A partition of the input
+   struct Partition {
+      /// The operator tree
+      Operator* input;
+      /// The private registers of the tree (if not using the main runtime)
+      Runtime* runtime;
+      /// The output registers of the tree
+      std::vector<Register*> registers;
+   };
+
+   private:
+   /// The partitions. The first one writes into the output registers
+   std::vector<Partition> partitions;
+   /// The computed tuples of each partition (values and count)
+   std::vector<std::vector<unsigned> > results;
+   /// Partitions that are computed completely
+   std::vector<unsigned char> done;
+   /// The output registers
+   std::vector<Register*> output;
+   /// The lock
+   Mutex lock;
+   /// Notification about finished partitions and consumer progress
+   Event changed;
+   /// The next partition to compute
+   unsigned nextPartition;
+   /// The partition currently returned
+   unsigned current;
+   /// The position within the current partition
+   unsigned pos;
+   /// Is the current partition computed?
+   bool currentReady;
+   /// The number of running helper threads
+   unsigned runningThreads;
+   /// Stop computing partitions?
+   bool cancelled;
+   /// The number of threads to use at most
+   unsigned threads;
+
+   /// Compute a partition
+   void compute(unsigned partition);
+   /// Compute partitions until none is left
+   void work();
+   /// Entry point for helper threads
+   static void asyncWorker(void* info);
+   /// Wait until a partition is computed, helping if needed
+   void waitFor(unsigned partition);
+   /// Stop the helper threads
+   void stop();
+
+   public:
+   /// The number of partitions per thread. More partitions than threads balance skew in the value distribution
+   static const unsigned partitionsPerThread = 4;
+
+   /// Constructor. Takes ownership of the partitions. The helper threads are borrowed from the scheduler budget
+   Exchange(const std::vector<Partition>& partitions,const std::vector<Register*>& output,unsigned threads,double expectedOutputCardinality);
+   /// Destructor
+   ~Exchange();
+
+   /// Produce the first tuple. Computes all partitions again when called repeatedly
+   unsigned first();
+   /// Produce the next tuple
+   unsigned next();
+
+   /// Print the operator tree. Debugging only.
+   void print(PlanPrinter& out);
+   /// Add a merge join hint
+   void addMergeHint(Register* reg1,Register* reg2);
+   /// Register parts of the tree that can be executed asynchronous
+   void getAsyncInputCandidates(Scheduler& scheduler);
+};
+//---------------------------------------------------------------------------
+#endif
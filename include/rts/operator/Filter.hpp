@@ -11,6 +11,7 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 #include "rts/operator/Operator.hpp"
+#include "infra/util/IdSet.hpp"
 #include <vector>
 //---------------------------------------------------------------------------
 class Register;
@@ -23,10 +24,8 @@ class Filter : public Operator
    Operator* input;
    /// The filter register
    Register* filter;
-   /// The bounds
-   unsigned min,max;
    /// The valid values
-   std::vector<unsigned char> valid;
+   IdSet valid;
    /// Negative filter
    bool exclude;
 
@@ -11,10 +11,12 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 #include "rts/operator/Operator.hpp"
+#include "rts/operator/Scheduler.hpp"
 #include "infra/util/VarPool.hpp"
 #include <vector>
 //---------------------------------------------------------------------------
-/// A hash based aggregation
+/// A hash based aggregation. The input is pre-aggregated in a small table,
+/// spilled into radix partitions, and the partitions are merged in parallel
 class HashGroupify : public Operator
 {
    private:
@@ -33,15 +35,66 @@ class HashGroupify : public Operator
    class Rehasher;
    /// Helper
    class Chainer;
+   /// A radix partition
+   struct Partition {
+      /// The spilled tuples (hash, count, values)
+      std::vector<unsigned> tuples;
+      /// The groups
+      Group* groups;
+      /// The groups pool
+      VarPool<Group> groupsPool;
+
+      /// Constructor
+      explicit Partition(unsigned width) : groups(0),groupsPool(width*sizeof(unsigned)) {}
+   };
+   /// Aggregation task
+   class Aggregate : public Scheduler::AsyncPoint {
+      private:
+      /// The operator
+      HashGroupify& groupify;
+      /// Already done?
+      bool done;
+
+      friend class HashGroupify;
+
+      public:
+      /// Constructor
+      Aggregate(HashGroupify& groupify) : groupify(groupify),done(false) {}
+      /// Perform the task
+      void run();
+   };
+   friend class Aggregate;
+   /// Merge worker
+   class MergeWorker;
+
+   /// Number of bits used for partitioning
+   static const unsigned partitionBits = 6;
+   /// Number of partitions
+   static const unsigned partitionCount = 1<<partitionBits;
+   /// Size of the pre-aggregation table
+   static const unsigned preAggregationSize = 1024;
+   /// Spilled values required before merging in parallel
+   static const unsigned parallelThreshold = 1<<16;
 
    /// The input registers
    std::vector<Register*> values;
    /// The input
    Operator* input;
-   /// The groups
-   Group* groups,*groupsIter;
-   /// The groups pool
-   VarPool<Group> groupsPool;
+   /// The partitions
+   std::vector<Partition*> partitions;
+   /// The current partition
+   unsigned partitionsIter;
+   /// The current group
+   Group* groupsIter;
+   /// Aggregation task
+   Aggregate aggregateTask;
+
+   /// Spill a tuple into its partition
+   void spill(const unsigned* tuple);
+   /// Merge a partition
+   void merge(Partition& partition);
+   /// Aggregate the input
+   void aggregate();
 
    public:
    /// Constructor
@@ -11,6 +11,7 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 #include "rts/operator/Operator.hpp"
+#include "infra/util/IdSet.hpp"
 #include <vector>
 //---------------------------------------------------------------------------
 class Register;
@@ -25,9 +26,11 @@ class NestedLoopFilter : public Operator
    /// The filter register
    Register* filter;
    /// The valid values
-   std::vector<unsigned> values;
+   IdSet values;
    /// The current position
-   unsigned pos;
+   IdSet::Iterator pos;
+   /// All values processed?
+   bool done;
 
    public:
    /// Constructor
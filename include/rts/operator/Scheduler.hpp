@@ -71,6 +71,14 @@ class Scheduler
    void executeSingleThreaded(Operator* root);
    /// Execute a plan using, using potentially multiple threads
    void execute(Operator* root);
+
+   /// The number of threads requested via MAXTHREADS. 0 if unset or outside [2,1000], i.e., single threaded
+   static unsigned getMaxThreads();
+   /// Borrow up to the given number of helper threads. All schedulers and operators share one budget of
+   /// MAXTHREADS busy threads, the calling thread is already counted. Returns the number granted, possibly 0
+   static unsigned borrowThreads(unsigned wanted);
+   /// Give borrowed helper threads back
+   static void returnThreads(unsigned count);
 };
 //---------------------------------------------------------------------------
 #endif
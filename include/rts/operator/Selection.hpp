@@ -15,6 +15,7 @@
 #include <vector>
 #include <string>
 //---------------------------------------------------------------------------
+class Regex;
 class Register;
 class Runtime;
 //---------------------------------------------------------------------------
@@ -70,6 +71,45 @@ class Selection : public Operator
       /// Set to a string value
       void setIRI(const std::string& c);
    };
+   /// An instruction of a compiled predicate. The result of an instruction is stored in the slot with its index
+   struct Instruction {
+      /// Opcodes
+      enum Opcode { Equal, NotEqual, Bound, In, And, Or, Not, False };
+
+      /// The opcode
+      Opcode op;
+      /// The compared ids (for comparisons)
+      const unsigned* left,*right;
+      /// The input slots (for logical operations) or the range of the set (for In)
+      unsigned arg1,arg2;
+   };
+   /// A predicate compiled into a flat program that only compares ids
+   class Program {
+      private:
+      /// The instructions
+      std::vector<Instruction> code;
+      /// The sets of In
+      std::vector<const unsigned*> sets;
+      /// The result slots
+      std::vector<unsigned char> slots;
+
+      public:
+      /// Empty?
+      bool empty() const { return code.empty(); }
+      /// Number of instructions
+      unsigned size() const { return code.size(); }
+      /// Remove all instructions
+      void clear();
+      /// Add a comparison or a Bound test. Returns the result slot
+      unsigned addCompare(Instruction::Opcode op,const unsigned* left,const unsigned* right);
+      /// Add a logical operation. Returns the result slot
+      unsigned addLogical(Instruction::Opcode op,unsigned arg1,unsigned arg2);
+      /// Add a set membership test. Returns the result slot
+      unsigned addIn(const unsigned* probe,const std::vector<const unsigned*>& values);
+
+      /// Evaluate the program
+      bool run();
+   };
    /// Base for predicate evaluation
    class Predicate {
       protected:
@@ -88,6 +128,10 @@ class Selection : public Operator
       virtual void eval(Result& result) = 0;
       /// Print the predicate (debugging only)
       virtual std::string print(PlanPrinter& out) = 0;
+      /// The id the predicate evaluates to, if it is a plain id without string semantics. 0 otherwise
+      virtual const unsigned* getIdSource();
+      /// Compile the predicate into a program, the result is in the last slot. Returns false if strings would be needed
+      virtual bool compile(Program& program);
 
       /// Check the predicate
       bool check();
@@ -132,6 +176,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// Compile the predicate into a program
+      bool compile(Program& program);
    };
    /// Logical and
    class And : public BinaryPredicate {
@@ -143,6 +189,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// Compile the predicate into a program
+      bool compile(Program& program);
    };
    /// Comparison ==
    class Equal : public BinaryPredicate {
@@ -154,6 +202,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// Compile the predicate into a program
+      bool compile(Program& program);
    };
    /// Comparison !=
    class NotEqual : public BinaryPredicate {
@@ -165,6 +215,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// Compile the predicate into a program
+      bool compile(Program& program);
    };
    /// Comparison <
    class Less : public BinaryPredicate {
@@ -242,6 +294,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// Compile the predicate into a program
+      bool compile(Program& program);
    };
    /// Operator -
    class Neg : public UnaryPredicate {
@@ -256,11 +310,20 @@ class Selection : public Operator
    };
    /// A NULL value
    class Null : public Predicate {
+      private:
+      /// The id
+      unsigned id;
+
       public:
+      /// Constructor
+      Null() : id(~0u) {}
+
       /// Evaluate the predicate
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// The id the predicate evaluates to
+      const unsigned* getIdSource();
    };
    /// A false value
    class False : public Predicate {
@@ -269,6 +332,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// Compile the predicate into a program
+      bool compile(Program& program);
    };
    /// Variable access
    class Variable : public Predicate {
@@ -284,6 +349,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// The id the predicate evaluates to
+      const unsigned* getIdSource();
    };
    /// Constant
    class ConstantLiteral : public Predicate {
@@ -299,6 +366,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// The id the predicate evaluates to
+      const unsigned* getIdSource();
    };
    /// Constant
    class TemporaryConstantLiteral : public Predicate {
@@ -329,6 +398,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// The id the predicate evaluates to
+      const unsigned* getIdSource();
    };
    /// Constant
    class TemporaryConstantIRI : public Predicate {
@@ -425,6 +496,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// Compile the predicate into a program
+      bool compile(Program& program);
    };
    /// Builtin sameTerm
    class BuiltinSameTerm : public BinaryPredicate {
@@ -436,6 +509,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// Compile the predicate into a program
+      bool compile(Program& program);
    };
    /// Builtin isIRI
    class BuiltinIsIRI : public UnaryPredicate {
@@ -475,10 +550,16 @@ class Selection : public Operator
       private:
       /// Arguments
       Predicate* arg1,*arg2,*arg3;
+      /// The compiled pattern (if any)
+      const Regex* regex;
+      /// The pattern and flags it was compiled from
+      std::string regexPattern,regexFlags;
+      /// Was the pattern compiled?
+      bool compiled;
 
       public:
       /// Constructor
-      BuiltinRegEx(Predicate* arg1,Predicate* arg2,Predicate* arg3) : arg1(arg1),arg2(arg2),arg3(arg3) {}
+      BuiltinRegEx(Predicate* arg1,Predicate* arg2,Predicate* arg3) : arg1(arg1),arg2(arg2),arg3(arg3),regex(0),compiled(false) {}
       /// Destructor
       ~BuiltinRegEx();
 
@@ -490,6 +571,28 @@ class Selection : public Operator
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
    };
+   /// Builtin contains
+   class BuiltinContains : public BinaryPredicate {
+      public:
+      /// Constructor
+      BuiltinContains(Predicate* left,Predicate* right) : BinaryPredicate(left,right) {}
+
+      /// Evaluate the predicate
+      void eval(Result& result);
+      /// Print the predicate (debugging only)
+      std::string print(PlanPrinter& out);
+   };
+   /// Builtin strStarts
+   class BuiltinStrStarts : public BinaryPredicate {
+      public:
+      /// Constructor
+      BuiltinStrStarts(Predicate* left,Predicate* right) : BinaryPredicate(left,right) {}
+
+      /// Evaluate the predicate
+      void eval(Result& result);
+      /// Print the predicate (debugging only)
+      std::string print(PlanPrinter& out);
+   };
    /// Builtin in
    class BuiltinIn : public Predicate {
       private:
@@ -509,6 +612,8 @@ class Selection : public Operator
       void eval(Result& result);
       /// Print the predicate (debugging only)
       std::string print(PlanPrinter& out);
+      /// Compile the predicate into a program
+      bool compile(Program& program);
    };
 
    private:
@@ -518,6 +623,8 @@ class Selection : public Operator
    Runtime& runtime;
    /// The predicate
    Predicate* predicate;
+   /// The compiled predicate, empty if the predicate needs strings
+   Program program;
 
 
    public:
@@ -16,7 +16,7 @@
 //---------------------------------------------------------------------------
 class Database;
 //---------------------------------------------------------------------------
-/// A sort operator
+/// A sort operator. With a limit only the first tuples are kept, using a bounded heap
 class Sort : public Operator
 {
    private:
@@ -31,11 +31,18 @@ class Sort : public Operator
    struct Order {
       /// The slot
       unsigned slot;
+      /// The slot of the normalized key (if any)
+      unsigned keySlot;
       /// Descending?
       bool descending;
    };
    class Sorter;
 
+   /// Compute the normalized sort key of a value
+   static void buildKey(DictionarySegment& dict,unsigned id,unsigned* key);
+   /// Fill the normalized keys of all collected tuples
+   void buildKeys();
+
    /// The input registers
    std::vector<Register*> values;
    /// The input
@@ -48,12 +55,14 @@ class Sort : public Operator
    std::vector<Order> order;
    /// The dictionary
    DictionarySegment& dict;
+   /// Maximum number of tuples to produce (~0u if unlimited)
+   unsigned tupleLimit;
    /// Tuples iterator
    std::vector<Tuple*>::const_iterator tuplesIter;
 
    public:
    /// Constructor
-   Sort(Database& db,Operator* input,const std::vector<Register*>& values,const std::vector<std::pair<Register*,bool> >& order,double expectedOutputCardinality);
+   Sort(Database& db,Operator* input,const std::vector<Register*>& values,const std::vector<std::pair<Register*,bool> >& order,double expectedOutputCardinality,unsigned limit=~0u);
    /// Destructor
    ~Sort();
 
@@ -57,7 +57,7 @@ class TemporaryDictionary
    /// Lookup an id for a given string
    bool lookup(const std::string& text,Type::ID type,unsigned subType,unsigned& id);
    /// Lookup a string for a given id
-   bool lookupById(unsigned id,const char*& start,const char*& stop,Type::ID& type,unsigned& subType);
+   bool lookupById(unsigned id,const char*& start,const char*& stop,Type::ID& type,unsigned& subType,std::string& buffer);
 };
 //---------------------------------------------------------------------------
 #endif
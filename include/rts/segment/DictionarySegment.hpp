@@ -10,6 +10,8 @@
 // or send a letter to Creative Commons, 171 Second Street, Suite 300,
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
+#include "infra/osdep/Latch.hpp"
+#include "infra/util/LRUCache.hpp"
 #include "infra/util/Type.hpp"
 #include "rts/segment/Segment.hpp"
 #include <string>
@@ -72,10 +74,46 @@ class DictionarySegment : public Segment
       virtual bool next(unsigned& hash,unsigned& page) = 0;
    };
 
+   /// The location of a string. The strings stay in the mapped pages, or, for
+   /// prefix compressed strings, in a buffer provided by the caller
+   struct StringInfo {
+      /// The string bounds
+      const char* start,*stop;
+      /// The type
+      ::Type::ID type;
+      /// The sub-type
+      unsigned subType;
+   };
+
+   /// A source for string->id entries of the sorted string index
+   class StringIndexSource {
+      public:
+      /// Destructor
+      virtual ~StringIndexSource();
+
+      /// Get the next entry (must be in string order)
+      virtual bool next(unsigned& len,const char*& data,unsigned& id) = 0;
+   };
+   /// A predicate on strings, used to scan the dictionary
+   class StringMatcher {
+      public:
+      /// Destructor
+      virtual ~StringMatcher();
+
+      /// Does the string qualify?
+      virtual bool matches(const char* start,const char* stop,::Type::ID type,unsigned subType) = 0;
+   };
+
    class HashIndexImplementation;
    class HashIndex;
+   class StringIndex;
 
    private:
+   /// Number of strings kept in the cache
+   static const unsigned cacheSize = 1<<16;
+   /// Format flag: xsd:dateTime literals are stored as Type::Date
+   static const unsigned flagTypedDates = 1;
+
    /// The start of the raw string table
    unsigned tableStart;
    /// The next id after the existing ones
@@ -84,11 +122,55 @@ class DictionarySegment : public Segment
    std::vector<std::pair<unsigned,unsigned> > mappings;
    /// The root of the index b-tree
    unsigned indexRoot;
+   /// The root of the sorted string index b-tree (0 if none)
+   unsigned stringIndexRoot;
+   /// Number of ids covered by the sorted string index
+   unsigned stringIndexIds;
+   /// Format flags
+   unsigned flags;
+   /// The location of a string in the mapped pages. Prefix compressed strings consist of a prefix and a suffix
+   struct StringLocation {
+      /// The string bounds, or the prefix bounds if compressed
+      const char* start,*stop;
+      /// The suffix bounds if compressed, otherwise null
+      const char* suffixStart,*suffixStop;
+      /// The type
+      ::Type::ID type;
+      /// The sub-type
+      unsigned subType;
+   };
+   /// Cache for id lookups
+   LRUCache<StringLocation> cache;
+   /// An entry of the in-memory index
+   struct MemoryIndexEntry {
+      /// The hash value
+      unsigned hash;
+      /// The id (~0u if empty)
+      unsigned id;
+   };
+   /// The in-memory index hash->id (open addressing). Only used if enabled
+   std::vector<MemoryIndexEntry> memoryIndex;
+   /// Number of entries in the in-memory index
+   unsigned memoryIndexEntries;
+   /// Use the in-memory index?
+   bool useMemoryIndex;
+   /// Latch for the in-memory index. Lookups share it, building and growing the index is exclusive
+   Latch memoryIndexLatch;
 
    /// Refresh segment info stored in the partition
    void refreshInfo();
    /// Refresh the mapping table if needed
    void refreshMapping();
+   /// Find the directory entry of an id
+   bool locateId(unsigned id,unsigned& dirPage,unsigned& dirSlot);
+   /// Decode a string entry on a page of the raw string table
+   void decodeString(const char* page,unsigned ofs,StringLocation& location);
+   /// Add an entry to the in-memory index
+   void insertIntoMemoryIndex(unsigned hash,unsigned id);
+   /// Build the in-memory index from the id mapping
+   void buildMemoryIndex();
+   /// Lookup an id for a given string using the in-memory index
+   bool lookupInMemoryIndex(const std::string& text,::Type::ID type,unsigned subType,unsigned hash,unsigned& id);
    /// Lookup an id for a given string on a certain page in the raw string table
    bool lookupOnPage(unsigned pageNo,const std::string& text,::Type::ID type,unsigned subType,unsigned hash,unsigned& id);
 
@@ -98,6 +180,10 @@ class DictionarySegment : public Segment
    void loadStringMappings(IdSource& source);
    /// Write the string index (must be in hash order)
    void loadStringHashes(HashSource& source);
+   /// Write the sorted string index (must be in string order)
+   void loadStringIndex(StringIndexSource& source);
+   /// Record how xsd:dateTime literals are stored
+   void setTypedDates(bool typedDates);
 
    friend class DatabaseBuilder;
 
@@ -108,13 +194,31 @@ class DictionarySegment : public Segment
    /// Get the type
    Segment::Type getType() const;
 
+   /// Keep a memory resident hash index for string lookups. Built on the next lookup. Also enabled by the environment variable MEMORYDICTIONARY
+   void enableMemoryIndex() { useMemoryIndex=true; }
    /// Lookup an id for a given string
    bool lookup(const std::string& text,::Type::ID type,unsigned subType,unsigned& id);
-   /// Lookup a string for a given id
-   bool lookupById(unsigned id,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType);
+   /// Lookup a string for a given id. Prefix compressed strings are assembled in the buffer, the bounds are valid until it changes
+   bool lookupById(unsigned id,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType,std::string& buffer);
+   /// Lookup the strings for many ids at once, accessing each page once. Unknown ids get a null start. Prefix compressed strings are assembled in the buffer
+   bool lookupByIds(const unsigned* ids,unsigned count,StringInfo* result,std::string& buffer);
+   /// Find all ids whose string qualifies, in ascending order. Scans the whole string table once
+   void findMatching(StringMatcher& matcher,std::vector<unsigned>& ids);
+   /// Are xsd:dateTime literals stored as Type::Date? Databases loaded by older versions keep them as custom typed literals
+   bool hasTypedDates() const { return flags&flagTypedDates; }
+   /// Is there a sorted string index covering all ids?
+   bool hasStringIndex() const { return stringIndexRoot&&(stringIndexIds==nextId); }
+   /// Find all ids whose string starts with a prefix, in ascending order. Uses the sorted string index, returns false if not possible
+   bool findByPrefix(const std::string& prefix,std::vector<unsigned>& ids);
+   /// Number of leaves of the sorted string index that findByPrefix reads for a prefix. 0 if the index cannot be used
+   unsigned countPrefixLeaves(const std::string& prefix);
 
    /// Get the next id
    unsigned getNextId() const { return nextId; }
+   /// Number of id lookups answered by the cache
+   uint64_t getCacheHits() { return cache.getHits(); }
+   /// Number of id lookups not answered by the cache
+   uint64_t getCacheMisses() { return cache.getMisses(); }
 
    /// Load new literals into the dictionary
    void appendLiterals(const std::vector<Literal>& strings);
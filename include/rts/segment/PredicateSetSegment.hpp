@@ -13,7 +13,11 @@
 #include "rts/segment/Segment.hpp"
 #include <vector>
 //---------------------------------------------------------------------------
-/// Statistics about sets of predicates occuring for a subject
+/// Statistics about sets of predicates occuring for a subject.
+/** Each characteristic set stores the number of subjects having exactly these
+  * predicates and the number of triples per predicate. Rare sets are merged
+  * into their largest common subsets to bound the size.
+  */
 class PredicateSetSegment : public Segment
 {
    public:
@@ -31,6 +35,10 @@ class PredicateSetSegment : public Segment
 
    /// Refresh segment info stored in the partition
    void refreshInfo();
+   /// Compute the filter masks
+   void computeMasks();
+   /// Write the predicate sets into the partition
+   void storePredicateSets();
 
    PredicateSetSegment(const PredicateSetSegment&);
    void operator=(const PredicateSetSegment&);
@@ -49,8 +57,8 @@ class PredicateSetSegment : public Segment
    /// Compute the predicate sets (after loading)
    void computePredicateSets();
 
-   /// Estimate the cardinality of a star join
-   void getStarCardinality(const std::vector<unsigned>& predicates,unsigned& distinctSubjects,double& cardinality);
+   /// Estimate the cardinality of a star join. Returns false if no set contains all predicates
+   bool getStarCardinality(const std::vector<unsigned>& predicates,unsigned& distinctSubjects,double& cardinality) const;
 
    /// Get size statistics
    void getStatistics(unsigned& count,unsigned& entries,unsigned& size) const;
@@ -87,7 +87,7 @@ class SpaceInventorySegment : public Segment
    bool dropSegment(unsigned segmentId);
    /// Get the extend of a segment
    bool getExtent(unsigned segmentId,std::vector<ExtentEntry>& extent);
-   /// Grow a segment
+   /// Grow a segment. Serialized by the mutex, concurrent bulkloads of different segments may grow them at the same time
    bool growSegment(unsigned id,unsigned minIncrease,unsigned& start,unsigned& len);
 };
 //---------------------------------------------------------------------------
@@ -0,0 +1,172 @@
+#include "infra/util/IdSet.hpp"
+#include <algorithm>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+static unsigned lowestBit(uint64_t word)
+   // Position of the lowest set bit. The word must not be zero
+{
+#ifdef __GNUC__
+   return __builtin_ctzll(word);
+#else
+   unsigned result=0;
+   while (!(word&1)) {
+      word>>=1;
+      result++;
+   }
+   return result;
+#endif
+}
+//---------------------------------------------------------------------------
+static unsigned highestBit(uint64_t word)
+   // Position of the highest set bit. The word must not be zero
+{
+#ifdef __GNUC__
+   return 63-__builtin_clzll(word);
+#else
+   unsigned result=63;
+   while (!(word>>63)) {
+      word<<=1;
+      result--;
+   }
+   return result;
+#endif
+}
+//---------------------------------------------------------------------------
+IdSet::IdSet()
+   : count(0)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+IdSet::IdSet(const vector<unsigned>& ids)
+   : count(0)
+   // Constructor
+{
+   assign(ids);
+}
+//---------------------------------------------------------------------------
+void IdSet::clear()
+   // Remove all ids
+{
+   keys.clear();
+   containers.clear();
+   count=0;
+}
+//---------------------------------------------------------------------------
+void IdSet::assign(const vector<unsigned>& ids)
+   // Replace the contents
+{
+   clear();
+
+   // Sort the ids
+   vector<unsigned> sorted=ids;
+   sort(sorted.begin(),sorted.end());
+   sorted.resize(unique(sorted.begin(),sorted.end())-sorted.begin());
+   count=sorted.size();
+
+   // Build one container per distinct upper half
+   for (vector<unsigned>::const_iterator iter=sorted.begin(),limit=sorted.end();iter!=limit;) {
+      unsigned key=(*iter)>>16;
+      vector<unsigned>::const_iterator stop=iter;
+      while ((stop!=limit)&&(((*stop)>>16)==key))
+         ++stop;
+
+      keys.push_back(key);
+      containers.push_back(Container());
+      Container& c=containers.back();
+      c.count=stop-iter;
+      if (c.count<=maxArraySize) {
+         c.array.reserve(c.count);
+         for (;iter!=stop;++iter)
+            c.array.push_back((*iter)&0xFFFF);
+      } else {
+         c.bitmap.assign(bitmapWords,0);
+         for (;iter!=stop;++iter) {
+            unsigned low=(*iter)&0xFFFF;
+            c.bitmap[low>>6]|=static_cast<uint64_t>(1)<<(low&63);
+         }
+      }
+   }
+}
+//---------------------------------------------------------------------------
+bool IdSet::contains(unsigned id) const
+   // Is the id contained?
+{
+   // Find the container
+   unsigned key=id>>16;
+   vector<unsigned>::const_iterator pos=lower_bound(keys.begin(),keys.end(),key);
+   if ((pos==keys.end())||((*pos)!=key))
+      return false;
+   const Container& c=containers[pos-keys.begin()];
+
+   // Check the lower half
+   unsigned low=id&0xFFFF;
+   if (!c.bitmap.empty())
+      return (c.bitmap[low>>6]>>(low&63))&1;
+   return binary_search(c.array.begin(),c.array.end(),static_cast<uint16_t>(low));
+}
+//---------------------------------------------------------------------------
+unsigned IdSet::getMin() const
+   // The smallest id
+{
+   const Container& c=containers.front();
+   if (!c.bitmap.empty()) {
+      for (unsigned index=0;;index++)
+         if (c.bitmap[index])
+            return (keys.front()<<16)|(index<<6)|lowestBit(c.bitmap[index]);
+   }
+   return (keys.front()<<16)|c.array.front();
+}
+//---------------------------------------------------------------------------
+unsigned IdSet::getMax() const
+   // The largest id
+{
+   const Container& c=containers.back();
+   if (!c.bitmap.empty()) {
+      for (unsigned index=bitmapWords;;index--)
+         if (c.bitmap[index-1])
+            return (keys.back()<<16)|((index-1)<<6)|highestBit(c.bitmap[index-1]);
+   }
+   return (keys.back()<<16)|c.array.back();
+}
+//---------------------------------------------------------------------------
+bool IdSet::Iterator::next(unsigned& id)
+   // Get the next id
+{
+   while (container<set->containers.size()) {
+      const Container& c=set->containers[container];
+      unsigned key=set->keys[container]<<16;
+      if (c.bitmap.empty()) {
+         if (pos<c.array.size()) {
+            id=key|c.array[pos++];
+            return true;
+         }
+      } else {
+         // Find the next set bit at or after pos
+         while (pos<(bitmapWords<<6)) {
+            uint64_t word=c.bitmap[pos>>6]>>(pos&63);
+            if (word) {
+               pos+=lowestBit(word);
+               id=key|pos;
+               ++pos;
+               return true;
+            }
+            pos=(pos|63)+1;
+         }
+      }
+      ++container;
+      pos=0;
+   }
+   return false;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,1083 @@
+#include "infra/util/Regex.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include <algorithm>
+#include <map>
+#include <cstring>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Maximum number of NFA states
+static const unsigned maxNFAStates = 20000;
+/// Maximum number of DFA transitions
+static const unsigned maxDFATransitions = 1<<16;
+/// Maximum repetition count
+static const unsigned maxRepeat = 1000;
+/// Maximum number of non-ASCII characters enumerated for a range
+static const unsigned maxRangeChars = 1024;
+/// Number of cached patterns
+static const unsigned cacheSize = 64;
+/// Special DFA states
+enum { deadState = 0, matchedState = 1 };
+//---------------------------------------------------------------------------
+/// A set of bytes
+struct ByteSet {
+   /// The bits
+   unsigned bits[8];
+
+   /// Constructor
+   ByteSet() { memset(bits,0,sizeof(bits)); }
+   /// Add a byte
+   void add(unsigned c) { bits[c>>5]|=1u<<(c&31); }
+   /// Add a range
+   void add(unsigned from,unsigned to) { for (unsigned c=from;c<=to;c++) add(c); }
+   /// Contains a byte?
+   bool contains(unsigned c) const { return (bits[c>>5]>>(c&31))&1; }
+   /// Empty?
+   bool empty() const { for (unsigned index=0;index<8;index++) if (bits[index]) return false; return true; }
+   /// Number of bytes
+   unsigned count() const { unsigned result=0; for (unsigned c=0;c<256;c++) if (contains(c)) result++; return result; }
+};
+//---------------------------------------------------------------------------
+/// Encode a code point as UTF-8
+static string encodeUTF8(unsigned c)
+{
+   string result;
+   if (c<0x80) {
+      result+=static_cast<char>(c);
+   } else if (c<0x800) {
+      result+=static_cast<char>(0xC0|(c>>6));
+      result+=static_cast<char>(0x80|(c&0x3F));
+   } else if (c<0x10000) {
+      result+=static_cast<char>(0xE0|(c>>12));
+      result+=static_cast<char>(0x80|((c>>6)&0x3F));
+      result+=static_cast<char>(0x80|(c&0x3F));
+   } else {
+      result+=static_cast<char>(0xF0|(c>>18));
+      result+=static_cast<char>(0x80|((c>>12)&0x3F));
+      result+=static_cast<char>(0x80|((c>>6)&0x3F));
+      result+=static_cast<char>(0x80|(c&0x3F));
+   }
+   return result;
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+/// Translates a pattern into an NFA
+class Regex::Parser
+{
+   private:
+   /// A node of the syntax tree
+   struct Node {
+      /// Kinds
+      enum Kind { Empty, Chars, Concat, Alt, Repeat, Begin, End };
+      /// The kind
+      Kind kind;
+      /// The qualifying single byte characters (for Chars)
+      ByteSet set;
+      /// The qualifying multi-byte characters (for Chars)
+      vector<string> sequences;
+      /// Does every multi-byte character qualify? (for Chars)
+      bool anyMultiByte;
+      /// The children
+      vector<unsigned> children;
+      /// The repetition bounds, max is ~0u if unbounded
+      unsigned min,max;
+
+      /// Constructor
+      explicit Node(Kind kind) : kind(kind),anyMultiByte(false),min(0),max(0) {}
+   };
+   /// An NFA fragment. The exit is a jump state whose target is still open
+   struct Fragment {
+      /// The entry and the exit
+      unsigned start,exit;
+   };
+
+   /// The regex
+   Regex& regex;
+   /// The pattern
+   string pattern;
+   /// The position
+   unsigned pos;
+   /// The syntax tree
+   vector<Node> nodes;
+   /// Known character sets
+   map<vector<unsigned>,unsigned> knownSets;
+
+   /// Case insensitive?
+   bool caseInsensitive() const { return regex.flags&CaseInsensitive; }
+   /// Read a (possibly multi-byte) character
+   unsigned readChar();
+   /// Add the other case of letters
+   void foldCase(ByteSet& set);
+   /// Parse an escape sequence, producing either a character or a set
+   bool parseEscape(unsigned& c,Node& node,bool& isSet);
+   /// Add a character range to a node
+   void addRange(Node& node,unsigned from,unsigned to);
+   /// Parse a character class
+   bool parseClass(unsigned& result);
+   /// Parse an atom
+   bool parseAtom(unsigned& result);
+   /// Parse a repetition
+   bool parseRepeat(unsigned& result);
+   /// Parse a sequence
+   bool parseConcat(unsigned& result);
+   /// Parse an alternative
+   bool parseAlt(unsigned& result);
+
+   /// Create a new state
+   unsigned newState(State::Kind kind,unsigned set,unsigned out1,unsigned out2);
+   /// Register a character set
+   unsigned addSet(const ByteSet& set);
+   /// Patch the exit of a fragment
+   void patch(const Fragment& f,unsigned target) { regex.states[f.exit].out1=target; }
+   /// An empty fragment
+   Fragment emptyFragment();
+   /// A fragment for a single byte set
+   Fragment setFragment(const ByteSet& set);
+   /// Concatenate
+   Fragment concat(const Fragment& a,const Fragment& b);
+   /// Alternative
+   Fragment alt(const Fragment& a,const Fragment& b);
+   /// Compile a node
+   bool compile(unsigned node,Fragment& result);
+   /// Compute the literal prefix
+   void computePrefix(unsigned root);
+
+   public:
+   /// Constructor
+   Parser(Regex& regex,const string& pattern);
+
+   /// Translate the pattern
+   bool translate();
+};
+//---------------------------------------------------------------------------
+Regex::Parser::Parser(Regex& regex,const string& pattern)
+   : regex(regex),pos(0)
+   // Constructor
+{
+   if (regex.flags&Extended) {
+      // Remove whitespace outside character classes
+      bool inClass=false;
+      for (unsigned index=0;index<pattern.size();index++) {
+         char c=pattern[index];
+         if ((!inClass)&&((c==' ')||(c=='\t')||(c=='\n')||(c=='\r')))
+            continue;
+         this->pattern+=c;
+         if ((c=='\\')&&(index+1<pattern.size())) {
+            this->pattern+=pattern[++index];
+         } else if (c=='[') {
+            inClass=true;
+         } else if (c==']') {
+            inClass=false;
+         }
+      }
+   } else {
+      this->pattern=pattern;
+   }
+}
+//---------------------------------------------------------------------------
+unsigned Regex::Parser::readChar()
+   // Read a (possibly multi-byte) character
+{
+   unsigned c=static_cast<unsigned char>(pattern[pos++]);
+   unsigned extra=0;
+   if ((c&0xE0)==0xC0) { c&=0x1F; extra=1; } else
+   if ((c&0xF0)==0xE0) { c&=0x0F; extra=2; } else
+   if ((c&0xF8)==0xF0) { c&=0x07; extra=3; }
+   for (;extra&&(pos<pattern.size())&&((pattern[pos]&0xC0)==0x80);extra--)
+      c=(c<<6)|(pattern[pos++]&0x3F);
+   return c;
+}
+//---------------------------------------------------------------------------
+void Regex::Parser::foldCase(ByteSet& set)
+   // Add the other case of letters
+{
+   for (unsigned c='a';c<='z';c++)
+      if (set.contains(c)||set.contains(c-'a'+'A')) {
+         set.add(c);
+         set.add(c-'a'+'A');
+      }
+}
+//---------------------------------------------------------------------------
+bool Regex::Parser::parseEscape(unsigned& c,Node& node,bool& isSet)
+   // Parse an escape sequence
+{
+   if (pos>=pattern.size())
+      return false;
+   char e=pattern[pos++];
+   isSet=true;
+   switch (e) {
+      case 'd': node.set.add('0','9'); return true;
+      case 'D': node.set.add(0,'0'-1); node.set.add('9'+1,0x7F); node.anyMultiByte=true; return true;
+      case 's': node.set.add(' '); node.set.add('\t'); node.set.add('\n'); node.set.add('\r'); return true;
+      case 'S': node.set.add(0,'\t'-1); node.set.add('\n'+1,'\r'-1); node.set.add('\r'+1,' '-1); node.set.add(' '+1,0x7F); node.anyMultiByte=true; return true;
+      case 'w': node.set.add('a','z'); node.set.add('A','Z'); node.set.add('0','9'); node.set.add('_'); node.anyMultiByte=true; return true;
+      case 'W': node.set.add(0,'0'-1); node.set.add('9'+1,'A'-1); node.set.add('Z'+1,'_'-1); node.set.add('_'+1,'a'-1); node.set.add('z'+1,0x7F); return true;
+      case 'n': isSet=false; c='\n'; return true;
+      case 'r': isSet=false; c='\r'; return true;
+      case 't': isSet=false; c='\t'; return true;
+   }
+   if (strchr("\\|.-^?*+{}()[]$/",e)&&e) {
+      isSet=false;
+      c=static_cast<unsigned char>(e);
+      return true;
+   }
+   return false;
+}
+//---------------------------------------------------------------------------
+void Regex::Parser::addRange(Node& node,unsigned from,unsigned to)
+   // Add a character range to a node
+{
+   for (;(from<=to)&&(from<0x80);from++)
+      node.set.add(from);
+   if (from>to)
+      return;
+   if ((to-from)>=maxRangeChars) {
+      // Too many characters, approximate by accepting all multi-byte characters
+      node.anyMultiByte=true;
+      return;
+   }
+   for (;from<=to;from++)
+      node.sequences.push_back(encodeUTF8(from));
+}
+//---------------------------------------------------------------------------
+bool Regex::Parser::parseClass(unsigned& result)
+   // Parse a character class
+{
+   Node node(Node::Chars);
+   bool negated=false;
+   if ((pos<pattern.size())&&(pattern[pos]=='^')) {
+      negated=true;
+      ++pos;
+   }
+   bool first=true;
+   while (true) {
+      if (pos>=pattern.size())
+         return false;
+      if ((pattern[pos]==']')&&(!first))
+         break;
+      first=false;
+
+      // Read a character or a set
+      unsigned from;
+      if (pattern[pos]=='\\') {
+         ++pos;
+         bool isSet;
+         if (!parseEscape(from,node,isSet))
+            return false;
+         if (isSet) continue;
+      } else {
+         from=readChar();
+      }
+
+      // A range?
+      unsigned to=from;
+      if ((pos+1<pattern.size())&&(pattern[pos]=='-')&&(pattern[pos+1]!=']')) {
+         ++pos;
+         if (pattern[pos]=='\\') {
+            ++pos;
+            bool isSet;
+            Node dummy(Node::Chars);
+            if ((!parseEscape(to,dummy,isSet))||isSet)
+               return false;
+         } else {
+            to=readChar();
+         }
+         if (to<from)
+            return false;
+      }
+      addRange(node,from,to);
+   }
+   ++pos;
+
+   if (caseInsensitive())
+      foldCase(node.set);
+   if (negated) {
+      // Non-ASCII characters in a negated class are not excluded, an approximation
+      for (unsigned index=0;index<4;index++)
+         node.set.bits[index]=~node.set.bits[index];
+      node.sequences.clear();
+      node.anyMultiByte=true;
+   }
+   result=nodes.size();
+   nodes.push_back(node);
+   return true;
+}
+//---------------------------------------------------------------------------
+bool Regex::Parser::parseAtom(unsigned& result)
+   // Parse an atom
+{
+   char c=pattern[pos];
+   if (c=='(') {
+      ++pos;
+      if ((pos+1<pattern.size())&&(pattern[pos]=='?')&&(pattern[pos+1]==':'))
+         pos+=2;
+      if (!parseAlt(result))
+         return false;
+      if ((pos>=pattern.size())||(pattern[pos]!=')'))
+         return false;
+      ++pos;
+      return true;
+   }
+   if (c=='[') {
+      ++pos;
+      return parseClass(result);
+   }
+   if ((c=='^')||(c=='$')) {
+      ++pos;
+      result=nodes.size();
+      nodes.push_back(Node((c=='^')?Node::Begin:Node::End));
+      return true;
+   }
+   if ((c=='*')||(c=='+')||(c=='?')||(c=='{')||(c==')')||(c=='|'))
+      return false;
+
+   Node node(Node::Chars);
+   if (c=='.') {
+      ++pos;
+      node.set.add(0,0x7F);
+      if (!(regex.flags&DotAll)) {
+         node.set.bits[0]&=~((1u<<'\n')|(1u<<'\r'));
+      }
+      node.anyMultiByte=true;
+   } else {
+      unsigned ch;
+      bool isSet=false;
+      if (c=='\\') {
+         ++pos;
+         if (!parseEscape(ch,node,isSet))
+            return false;
+      } else {
+         ch=readChar();
+      }
+      if (!isSet) {
+         if (ch<0x80) {
+            node.set.add(ch);
+            if (caseInsensitive()) foldCase(node.set);
+         } else {
+            node.sequences.push_back(encodeUTF8(ch));
+         }
+      }
+   }
+   result=nodes.size();
+   nodes.push_back(node);
+   return true;
+}
+//---------------------------------------------------------------------------
+bool Regex::Parser::parseRepeat(unsigned& result)
+   // Parse a repetition
+{
+   if (!parseAtom(result))
+      return false;
+   while (pos<pattern.size()) {
+      unsigned min,max;
+      char c=pattern[pos];
+      if (c=='*') {
+         min=0; max=~0u; ++pos;
+      } else if (c=='+') {
+         min=1; max=~0u; ++pos;
+      } else if (c=='?') {
+         min=0; max=1; ++pos;
+      } else if (c=='{') {
+         ++pos;
+         min=0;
+         unsigned digits=0;
+         for (;(pos<pattern.size())&&(pattern[pos]>='0')&&(pattern[pos]<='9');++pos,++digits) {
+            min=10*min+(pattern[pos]-'0');
+            if (min>maxRepeat) return false;
+         }
+         if (!digits) return false;
+         max=min;
+         if ((pos<pattern.size())&&(pattern[pos]==',')) {
+            ++pos;
+            if ((pos<pattern.size())&&(pattern[pos]=='}')) {
+               max=~0u;
+            } else {
+               max=0; digits=0;
+               for (;(pos<pattern.size())&&(pattern[pos]>='0')&&(pattern[pos]<='9');++pos,++digits) {
+                  max=10*max+(pattern[pos]-'0');
+                  if (max>maxRepeat) return false;
+               }
+               if ((!digits)||(max<min)) return false;
+            }
+         }
+         if ((pos>=pattern.size())||(pattern[pos]!='}'))
+            return false;
+         ++pos;
+      } else break;
+
+      // Reluctant quantifiers do not change whether there is a match
+      if ((pos<pattern.size())&&(pattern[pos]=='?'))
+         ++pos;
+
+      Node node(Node::Repeat);
+      node.children.push_back(result);
+      node.min=min;
+      node.max=max;
+      result=nodes.size();
+      nodes.push_back(node);
+   }
+   return true;
+}
+//---------------------------------------------------------------------------
+bool Regex::Parser::parseConcat(unsigned& result)
+   // Parse a sequence
+{
+   Node node(Node::Concat);
+   while ((pos<pattern.size())&&(pattern[pos]!='|')&&(pattern[pos]!=')')) {
+      unsigned part;
+      if (!parseRepeat(part))
+         return false;
+      if (nodes[part].kind==Node::Concat)
+         node.children.insert(node.children.end(),nodes[part].children.begin(),nodes[part].children.end()); else
+         node.children.push_back(part);
+   }
+   if (node.children.size()==1) {
+      result=node.children[0];
+      return true;
+   }
+   if (node.children.empty())
+      node.kind=Node::Empty;
+   result=nodes.size();
+   nodes.push_back(node);
+   return true;
+}
+//---------------------------------------------------------------------------
+bool Regex::Parser::parseAlt(unsigned& result)
+   // Parse an alternative
+{
+   if (!parseConcat(result))
+      return false;
+   if ((pos>=pattern.size())||(pattern[pos]!='|'))
+      return true;
+
+   Node node(Node::Alt);
+   node.children.push_back(result);
+   while ((pos<pattern.size())&&(pattern[pos]=='|')) {
+      ++pos;
+      unsigned part;
+      if (!parseConcat(part))
+         return false;
+      node.children.push_back(part);
+   }
+   result=nodes.size();
+   nodes.push_back(node);
+   return true;
+}
+//---------------------------------------------------------------------------
+unsigned Regex::Parser::newState(State::Kind kind,unsigned set,unsigned out1,unsigned out2)
+   // Create a new state
+{
+   State s;
+   s.kind=kind;
+   s.set=set;
+   s.out1=out1;
+   s.out2=out2;
+   regex.states.push_back(s);
+   return regex.states.size()-1;
+}
+//---------------------------------------------------------------------------
+unsigned Regex::Parser::addSet(const ByteSet& set)
+   // Register a character set
+{
+   vector<unsigned> key(set.bits,set.bits+8);
+   map<vector<unsigned>,unsigned>::const_iterator iter=knownSets.find(key);
+   if (iter!=knownSets.end())
+      return (*iter).second;
+   unsigned id=regex.sets.size()/8;
+   regex.sets.insert(regex.sets.end(),key.begin(),key.end());
+   knownSets[key]=id;
+   return id;
+}
+//---------------------------------------------------------------------------
+Regex::Parser::Fragment Regex::Parser::emptyFragment()
+   // An empty fragment
+{
+   Fragment f;
+   f.start=f.exit=newState(State::Jump,0,~0u,~0u);
+   return f;
+}
+//---------------------------------------------------------------------------
+Regex::Parser::Fragment Regex::Parser::setFragment(const ByteSet& set)
+   // A fragment for a single byte set
+{
+   Fragment f;
+   unsigned id=addSet(set);
+   f.exit=newState(State::Jump,0,~0u,~0u);
+   f.start=newState(State::Char,id,f.exit,~0u);
+   return f;
+}
+//---------------------------------------------------------------------------
+Regex::Parser::Fragment Regex::Parser::concat(const Fragment& a,const Fragment& b)
+   // Concatenate
+{
+   patch(a,b.start);
+   Fragment f;
+   f.start=a.start;
+   f.exit=b.exit;
+   return f;
+}
+//---------------------------------------------------------------------------
+Regex::Parser::Fragment Regex::Parser::alt(const Fragment& a,const Fragment& b)
+   // Alternative
+{
+   Fragment f;
+   f.exit=newState(State::Jump,0,~0u,~0u);
+   f.start=newState(State::Split,0,a.start,b.start);
+   patch(a,f.exit);
+   patch(b,f.exit);
+   return f;
+}
+//---------------------------------------------------------------------------
+bool Regex::Parser::compile(unsigned node,Fragment& result)
+   // Compile a node
+{
+   if (regex.states.size()>maxNFAStates)
+      return false;
+
+   const Node& n=nodes[node];
+   switch (n.kind) {
+      case Node::Empty:
+         result=emptyFragment();
+         return true;
+      case Node::Begin: case Node::End: {
+         result.exit=newState(State::Jump,0,~0u,~0u);
+         result.start=newState((n.kind==Node::Begin)?State::Begin:State::End,0,result.exit,~0u);
+         return true;
+      }
+      case Node::Chars: {
+         bool have=false;
+         if (!n.set.empty()) {
+            result=setFragment(n.set);
+            have=true;
+         }
+         for (vector<string>::const_iterator iter=n.sequences.begin(),limit=n.sequences.end();iter!=limit;++iter) {
+            Fragment seq=emptyFragment();
+            for (string::const_iterator iter2=(*iter).begin(),limit2=(*iter).end();iter2!=limit2;++iter2) {
+               ByteSet b; b.add(static_cast<unsigned char>(*iter2));
+               seq=concat(seq,setFragment(b));
+            }
+            result=have?alt(result,seq):seq;
+            have=true;
+         }
+         if (n.anyMultiByte) {
+            // All well-formed UTF-8 sequences of two to four bytes
+            ByteSet cont; cont.add(0x80,0xBF);
+            static const unsigned leads[3][2]={{0xC2,0xDF},{0xE0,0xEF},{0xF0,0xF4}};
+            for (unsigned len=0;len<3;len++) {
+               ByteSet lead; lead.add(leads[len][0],leads[len][1]);
+               Fragment seq=setFragment(lead);
+               for (unsigned index=0;index<=len;index++)
+                  seq=concat(seq,setFragment(cont));
+               result=have?alt(result,seq):seq;
+               have=true;
+            }
+         }
+         if (!have) {
+            // Nothing qualifies, use a state that never matches
+            result=setFragment(ByteSet());
+         }
+         return true;
+      }
+      case Node::Concat: {
+         Fragment f=emptyFragment();
+         for (unsigned index=0;index<n.children.size();index++) {
+            Fragment part;
+            if (!compile(nodes[node].children[index],part))
+               return false;
+            f=concat(f,part);
+         }
+         result=f;
+         return true;
+      }
+      case Node::Alt: {
+         Fragment f;
+         for (unsigned index=0;index<n.children.size();index++) {
+            Fragment part;
+            if (!compile(nodes[node].children[index],part))
+               return false;
+            f=index?alt(f,part):part;
+         }
+         result=f;
+         return true;
+      }
+      case Node::Repeat: {
+         unsigned child=n.children[0],min=n.min,max=n.max;
+         Fragment f=emptyFragment();
+         for (unsigned index=0;index<min;index++) {
+            Fragment part;
+            if (!compile(child,part))
+               return false;
+            f=concat(f,part);
+         }
+         if (max==~0u) {
+            Fragment part;
+            if (!compile(child,part))
+               return false;
+            Fragment loop;
+            loop.exit=newState(State::Jump,0,~0u,~0u);
+            loop.start=newState(State::Split,0,part.start,loop.exit);
+            patch(part,loop.start);
+            f=concat(f,loop);
+         } else {
+            for (unsigned index=min;index<max;index++) {
+               Fragment part;
+               if (!compile(child,part))
+                  return false;
+               Fragment opt;
+               opt.exit=newState(State::Jump,0,~0u,~0u);
+               opt.start=newState(State::Split,0,part.start,opt.exit);
+               patch(part,opt.exit);
+               f=concat(f,opt);
+            }
+         }
+         result=f;
+         return true;
+      }
+   }
+   return false;
+}
+//---------------------------------------------------------------------------
+void Regex::Parser::computePrefix(unsigned root)
+   // Compute the literal prefix
+{
+   vector<unsigned> parts;
+   if (nodes[root].kind==Node::Concat)
+      parts=nodes[root].children; else
+      parts.push_back(root);
+
+   unsigned index=0;
+   if ((index<parts.size())&&(nodes[parts[index]].kind==Node::Begin)&&(!(regex.flags&MultiLine))) {
+      regex.anchored=true;
+      ++index;
+   }
+   for (;index<parts.size();++index) {
+      const Node& n=nodes[parts[index]];
+      if ((n.kind!=Node::Chars)||(n.anyMultiByte))
+         break;
+      if (n.sequences.empty()&&(n.set.count()==1)) {
+         for (unsigned c=0;c<256;c++)
+            if (n.set.contains(c))
+               regex.prefix+=static_cast<char>(c);
+      } else if ((n.sequences.size()==1)&&n.set.empty()) {
+         regex.prefix+=n.sequences[0];
+      } else break;
+   }
+   regex.pureLiteral=(index==parts.size())&&(nodes[root].kind!=Node::Empty);
+}
+//---------------------------------------------------------------------------
+bool Regex::Parser::translate()
+   // Translate the pattern
+{
+   unsigned root;
+   if ((!parseAlt(root))||(pos!=pattern.size()))
+      return false;
+
+   Fragment f;
+   if (!compile(root,f))
+      return false;
+   unsigned match=newState(State::Match,0,~0u,~0u);
+   patch(f,match);
+   regex.start=f.start;
+   regex.lineStartState=newState(State::LineStart,0,~0u,~0u);
+   if (regex.states.size()>maxNFAStates)
+      return false;
+
+   computePrefix(root);
+   return true;
+}
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The shared pattern cache
+class RegexCache
+{
+   public:
+   /// An entry
+   struct Entry {
+      /// The pattern
+      Regex* regex;
+      /// Number of users
+      unsigned users;
+      /// Time of last use
+      unsigned long long lastUse;
+   };
+
+   /// The lock
+   Mutex lock;
+   /// The entries
+   map<string,Entry> entries;
+   /// The clock
+   unsigned long long clock;
+
+   /// Constructor
+   RegexCache() : clock(0) {}
+   /// Destructor
+   ~RegexCache();
+};
+//---------------------------------------------------------------------------
+RegexCache::~RegexCache()
+   // Destructor
+{
+   for (map<string,Entry>::iterator iter=entries.begin(),limit=entries.end();iter!=limit;++iter)
+      delete (*iter).second.regex;
+}
+//---------------------------------------------------------------------------
+static RegexCache cache;
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+Regex::Regex()
+   : start(0),lineStartState(0),flags(0),classCount(0),initialState(0),pureLiteral(false),anchored(false)
+   // Constructor
+{
+   memset(byteClass,0,sizeof(byteClass));
+}
+//---------------------------------------------------------------------------
+Regex::~Regex()
+   // Destructor
+{
+}
+//---------------------------------------------------------------------------
+bool Regex::parseFlags(const string& text,unsigned& flags)
+   // Interpret a SPARQL flags string
+{
+   flags=0;
+   for (string::const_iterator iter=text.begin(),limit=text.end();iter!=limit;++iter)
+      switch (*iter) {
+         case 'i': flags|=CaseInsensitive; break;
+         case 's': flags|=DotAll; break;
+         case 'm': flags|=MultiLine; break;
+         case 'x': flags|=Extended; break;
+         default: return false;
+      }
+   return true;
+}
+//---------------------------------------------------------------------------
+void Regex::closure(vector<unsigned>& result,vector<unsigned char>& seen,unsigned state,bool lineStart,bool lineEnd,bool& matched) const
+   // Compute the epsilon closure. End assertions that do not hold yet are kept
+{
+   vector<unsigned> stack;
+   stack.push_back(state);
+   while (!stack.empty()) {
+      unsigned s=stack.back();
+      stack.pop_back();
+      if (seen[s]) continue;
+      seen[s]=1;
+      const State& st=states[s];
+      switch (st.kind) {
+         case State::Char: result.push_back(s); break;
+         case State::Split: stack.push_back(st.out2); stack.push_back(st.out1); break;
+         case State::Jump: stack.push_back(st.out1); break;
+         case State::Begin: if (lineStart) stack.push_back(st.out1); break;
+         case State::End: if (lineEnd) stack.push_back(st.out1); else result.push_back(s); break;
+         case State::Match: matched=true; break;
+         case State::LineStart: break;
+      }
+   }
+}
+//---------------------------------------------------------------------------
+void Regex::markLineStart(vector<unsigned>& current) const
+   // Remember that a set of NFA states is at the start of a line. Only needed if end assertions are pending, as they might be followed by begin assertions
+{
+   for (vector<unsigned>::const_iterator iter=current.begin(),limit=current.end();iter!=limit;++iter)
+      if (states[*iter].kind==State::End) {
+         current.push_back(lineStartState);
+         return;
+      }
+}
+//---------------------------------------------------------------------------
+void Regex::step(const vector<unsigned>& current,unsigned char c,vector<unsigned>& next,vector<unsigned char>& seen,bool& matched) const
+   // Advance a set of NFA states over one byte
+{
+   next.clear();
+
+   // In multi-line mode pending end assertions hold before a line break
+   vector<unsigned> expanded;
+   const vector<unsigned>* active=&current;
+   if ((flags&MultiLine)&&(c=='\n')) {
+      bool lineStart=find(current.begin(),current.end(),lineStartState)!=current.end();
+      seen.assign(states.size(),0);
+      expanded=current;
+      for (vector<unsigned>::const_iterator iter=current.begin(),limit=current.end();iter!=limit;++iter)
+         if (states[*iter].kind==State::End)
+            closure(expanded,seen,states[*iter].out1,lineStart,true,matched);
+      if (matched) return;
+      active=&expanded;
+   }
+
+   // Consume the byte and restart the search behind it
+   bool lineStart=(flags&MultiLine)&&(c=='\n');
+   seen.assign(states.size(),0);
+   for (vector<unsigned>::const_iterator iter=active->begin(),limit=active->end();iter!=limit;++iter) {
+      const State& s=states[*iter];
+      if ((s.kind==State::Char)&&inSet(s.set,c))
+         closure(next,seen,s.out1,lineStart,false,matched);
+   }
+   closure(next,seen,start,lineStart,false,matched);
+   if (lineStart)
+      markLineStart(next);
+   sort(next.begin(),next.end());
+}
+//---------------------------------------------------------------------------
+bool Regex::acceptsAtEnd(const vector<unsigned>& current) const
+   // Does a set of NFA states accept at the end of the input?
+{
+   vector<unsigned char> seen(states.size(),0);
+   vector<unsigned> dummy;
+   bool lineStart=find(current.begin(),current.end(),lineStartState)!=current.end(),matched=false;
+   for (vector<unsigned>::const_iterator iter=current.begin(),limit=current.end();iter!=limit;++iter)
+      if (states[*iter].kind==State::End)
+         closure(dummy,seen,states[*iter].out1,lineStart,true,matched);
+   return matched;
+}
+//---------------------------------------------------------------------------
+void Regex::buildByteClasses()
+   // Build the byte classes
+{
+   // Refine the partition by every character set
+   vector<unsigned> classes(256,0);
+   unsigned setCount=sets.size()/8;
+   for (unsigned set=0;set<=setCount;set++) {
+      map<pair<unsigned,bool>,unsigned> refined;
+      for (unsigned c=0;c<256;c++) {
+         bool in=(set<setCount)?inSet(set,c):((flags&MultiLine)&&(c=='\n'));
+         pair<unsigned,bool> key(classes[c],in);
+         map<pair<unsigned,bool>,unsigned>::const_iterator iter=refined.find(key);
+         if (iter==refined.end()) {
+            unsigned id=refined.size();
+            refined[key]=id;
+            classes[c]=id;
+         } else classes[c]=(*iter).second;
+      }
+   }
+   classCount=0;
+   for (unsigned c=0;c<256;c++) {
+      byteClass[c]=classes[c];
+      if (classes[c]>=classCount) classCount=classes[c]+1;
+   }
+}
+//---------------------------------------------------------------------------
+bool Regex::buildDFA()
+   // Build the DFA
+{
+   // A representative byte for each class
+   vector<unsigned char> representative(classCount);
+   for (unsigned c=256;c>0;c--)
+      representative[byteClass[c-1]]=c-1;
+
+   // The special states and the initial state
+   vector<vector<unsigned> > dfaStates(2);
+   map<vector<unsigned>,unsigned> known;
+   vector<unsigned char> seen(states.size(),0);
+   vector<unsigned> initial;
+   bool matched=false;
+   closure(initial,seen,start,true,false,matched);
+   if (matched) {
+      initialState=matchedState;
+   } else {
+      markLineStart(initial);
+      sort(initial.begin(),initial.end());
+      initialState=dfaStates.size();
+      known[initial]=initialState;
+      dfaStates.push_back(initial);
+   }
+   transitions.assign(2*classCount,deadState);
+   for (unsigned index=0;index<classCount;index++)
+      transitions[matchedState*classCount+index]=matchedState;
+   acceptAtEnd.assign(2,false);
+   acceptAtEnd[matchedState]=true;
+
+   // Explore all reachable states
+   vector<unsigned> next;
+   for (unsigned state=2;state<dfaStates.size();state++) {
+      acceptAtEnd.push_back(acceptsAtEnd(dfaStates[state]));
+      for (unsigned cl=0;cl<classCount;cl++) {
+         matched=false;
+         step(dfaStates[state],representative[cl],next,seen,matched);
+         unsigned target;
+         if (matched) {
+            target=matchedState;
+         } else if (next.empty()&&(!(flags&MultiLine))) {
+            // Without line breaks as anchors the search can never succeed
+            target=deadState;
+         } else {
+            map<vector<unsigned>,unsigned>::const_iterator iter=known.find(next);
+            if (iter==known.end()) {
+               if ((dfaStates.size()+1)*classCount>maxDFATransitions) {
+                  transitions.clear();
+                  acceptAtEnd.clear();
+                  return false;
+               }
+               target=dfaStates.size();
+               known[next]=target;
+               dfaStates.push_back(next);
+            } else target=(*iter).second;
+         }
+         transitions.push_back(target);
+      }
+   }
+   return true;
+}
+//---------------------------------------------------------------------------
+bool Regex::compile(const string& pattern,unsigned flags)
+   // Compile a pattern
+{
+   states.clear();
+   sets.clear();
+   transitions.clear();
+   acceptAtEnd.clear();
+   prefix.clear();
+   pureLiteral=anchored=false;
+   this->flags=flags;
+
+   Parser parser(*this,pattern);
+   if (!parser.translate())
+      return false;
+
+   // A pure literal is handled by the prefix search alone
+   if (pureLiteral)
+      return true;
+   buildByteClasses();
+   buildDFA();
+   return true;
+}
+//---------------------------------------------------------------------------
+bool Regex::run(const char* begin,const char* start,const char* stop) const
+   // Run the automaton
+{
+   // Use the DFA if available
+   if (!transitions.empty()) {
+      unsigned state=initialState;
+      const unsigned* t=&transitions[0];
+      for (const char* iter=start;iter!=stop;++iter) {
+         state=t[state*classCount+byteClass[static_cast<unsigned char>(*iter)]];
+         if (state<2)
+            return state==matchedState;
+      }
+      return acceptAtEnd[state];
+   }
+
+   // Simulate the NFA
+   vector<unsigned> current,next;
+   vector<unsigned char> seen(states.size(),0);
+   bool matched=false;
+   bool lineStart=(start==begin)||((flags&MultiLine)&&(start[-1]=='\n'));
+   closure(current,seen,this->start,lineStart,false,matched);
+   if (lineStart)
+      markLineStart(current);
+   for (const char* iter=start;(iter!=stop)&&(!matched);++iter) {
+      step(current,*iter,next,seen,matched);
+      if (next.empty()&&(!(flags&MultiLine)))
+         return matched;
+      swap(current,next);
+   }
+   return matched||acceptsAtEnd(current);
+}
+//---------------------------------------------------------------------------
+bool Regex::matches(const char* start,const char* stop) const
+   // Does the pattern match somewhere in the string?
+{
+   unsigned len=stop-start;
+   if (anchored) {
+      if ((len<prefix.size())||(memcmp(start,prefix.data(),prefix.size())!=0))
+         return false;
+      if (pureLiteral)
+         return true;
+      return run(start,start,stop);
+   }
+   if (!prefix.empty()) {
+      // Every match starts with the prefix, find its first occurrence
+      const char* iter=start;
+      while (true) {
+         iter=static_cast<const char*>(memchr(iter,prefix[0],stop-iter));
+         if ((!iter)||(static_cast<unsigned>(stop-iter)<prefix.size()))
+            return false;
+         if (memcmp(iter,prefix.data(),prefix.size())==0)
+            break;
+         ++iter;
+      }
+      if (pureLiteral)
+         return true;
+      return run(start,iter,stop);
+   }
+   return run(start,start,stop);
+}
+//---------------------------------------------------------------------------
+const Regex* Regex::acquire(const string& pattern,const string& flagsText)
+   // Get a compiled pattern from the shared cache
+{
+   unsigned flags;
+   if (!parseFlags(flagsText,flags))
+      return 0;
+   string key=static_cast<char>('A'+flags)+pattern;
+
+   // Known?
+   {
+      auto_lock lock(cache.lock);
+      map<string,RegexCache::Entry>::iterator iter=cache.entries.find(key);
+      if (iter!=cache.entries.end()) {
+         (*iter).second.users++;
+         (*iter).second.lastUse=++cache.clock;
+         return (*iter).second.regex;
+      }
+   }
+
+   // Compile it without holding the lock
+   Regex* regex=new Regex();
+   if (!regex->compile(pattern,flags)) {
+      delete regex;
+      return 0;
+   }
+   regex->cacheKey=key;
+
+   auto_lock lock(cache.lock);
+   map<string,RegexCache::Entry>::iterator iter=cache.entries.find(key);
+   if (iter!=cache.entries.end()) {
+      // Somebody else was faster
+      delete regex;
+      (*iter).second.users++;
+      (*iter).second.lastUse=++cache.clock;
+      return (*iter).second.regex;
+   }
+   RegexCache::Entry& entry=cache.entries[key];
+   entry.regex=regex;
+   entry.users=1;
+   entry.lastUse=++cache.clock;
+
+   // Evict the least recently used unused pattern if the cache is full
+   if (cache.entries.size()>cacheSize) {
+      map<string,RegexCache::Entry>::iterator victim=cache.entries.end();
+      for (map<string,RegexCache::Entry>::iterator iter=cache.entries.begin(),limit=cache.entries.end();iter!=limit;++iter)
+         if ((!(*iter).second.users)&&((victim==cache.entries.end())||((*iter).second.lastUse<(*victim).second.lastUse)))
+            victim=iter;
+      if (victim!=cache.entries.end()) {
+         delete (*victim).second.regex;
+         cache.entries.erase(victim);
+      }
+   }
+   return regex;
+}
+//---------------------------------------------------------------------------
+void Regex::release(const Regex* regex)
+   // Release a pattern obtained from acquire
+{
+   if (!regex)
+      return;
+   auto_lock lock(cache.lock);
+   map<string,RegexCache::Entry>::iterator iter=cache.entries.find(regex->cacheKey);
+   if ((iter!=cache.entries.end())&&((*iter).second.regex==regex)&&((*iter).second.users))
+      (*iter).second.users--;
+}
+//---------------------------------------------------------------------------
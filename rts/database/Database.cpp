@@ -7,6 +7,7 @@
 #include "rts/segment/ExactStatisticsSegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
 #include "rts/segment/FullyAggregatedFactsSegment.hpp"
+#include "rts/segment/PredicateSetSegment.hpp"
 #include <iostream>
 #include <cassert>
 //---------------------------------------------------------------------------
@@ -167,6 +168,12 @@ ExactStatisticsSegment& Database::getExactStatistics()
    return *(partition->lookupSegment<ExactStatisticsSegment>(DatabasePartition::Tag_ExactStatistics));
 }
 //---------------------------------------------------------------------------
+PredicateSetSegment* Database::getPredicateSets()
+   // Get the characteristic sets
+{
+   return partition->lookupSegment<PredicateSetSegment>(DatabasePartition::Tag_PredicateSet);
+}
+//---------------------------------------------------------------------------
 DictionarySegment& Database::getDictionary()
    // Get the dictionary
 {
@@ -1,13 +1,18 @@
 #include "rts/database/DatabaseBuilder.hpp"
+#include "infra/osdep/Event.hpp"
 #include "infra/osdep/MemoryMappedFile.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include "infra/osdep/Thread.hpp"
 #include "infra/util/Hash.hpp"
 #include "rts/buffer/BufferReference.hpp"
 #include "rts/database/DatabasePartition.hpp"
+#include "rts/operator/Scheduler.hpp"
 #include "rts/segment/AggregatedFactsSegment.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/ExactStatisticsSegment.hpp"
 #include "rts/segment/FactsSegment.hpp"
 #include "rts/segment/FullyAggregatedFactsSegment.hpp"
+#include "rts/segment/PredicateSetSegment.hpp"
 #include "rts/segment/Segment.hpp"
 #include <fstream>
 #include <iostream>
@@ -72,6 +77,16 @@ DatabaseBuilder::StringInfoReader::~StringInfoReader()
 {
 }
 //---------------------------------------------------------------------------
+DatabaseBuilder::StringIndexReader::StringIndexReader()
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+DatabaseBuilder::StringIndexReader::~StringIndexReader()
+   // Destructor
+{
+}
+//---------------------------------------------------------------------------
 DatabaseBuilder::PageChainer::PageChainer(unsigned ofs)
    : ofs(ofs),firstPage(0),pages(0)
    // Constructor
@@ -267,35 +282,42 @@ bool FullyAggregatedFactsSegmentSource::next(unsigned& value1,unsigned& count)
 //---------------------------------------------------------------------------
 }
 //---------------------------------------------------------------------------
-void DatabaseBuilder::loadFacts(unsigned order,FactsReader& reader)
-   // Loads the facts in a given order
+void DatabaseBuilder::addOrderSegments(unsigned order,OrderSegments& segments)
+   // Create the segments of an order
+{
+   segments.fullFacts=new FactsSegment(out.getFirstPartition());
+   out.getFirstPartition().addSegment(segments.fullFacts,DatabasePartition::Tag_SPO+order);
+   segments.aggregatedFacts=new AggregatedFactsSegment(out.getFirstPartition());
+   out.getFirstPartition().addSegment(segments.aggregatedFacts,DatabasePartition::Tag_SP+order);
+   segments.fullyAggregatedFacts=0;
+   if ((order&1)==0) {
+      segments.fullyAggregatedFacts=new FullyAggregatedFactsSegment(out.getFirstPartition());
+      out.getFirstPartition().addSegment(segments.fullyAggregatedFacts,DatabasePartition::Tag_S+(order/2));
+   }
+}
+//---------------------------------------------------------------------------
+void DatabaseBuilder::loadOrder(const OrderSegments& segments,FactsReader& reader)
+   // Load the facts of an order into its segments
 {
    // Load the full facts first
-   FactsSegment* fullFacts=new FactsSegment(out.getFirstPartition());
-   out.getFirstPartition().addSegment(fullFacts,DatabasePartition::Tag_SPO+order);
    reader.reset();
    {
       FactsSegmentSource source(reader);
-      fullFacts->loadFullFacts(source);
+      segments.fullFacts->loadFullFacts(source);
    }
 
    // Load the aggregated facts
-   AggregatedFactsSegment* aggregatedFacts=new AggregatedFactsSegment(out.getFirstPartition());
-   out.getFirstPartition().addSegment(aggregatedFacts,DatabasePartition::Tag_SP+order);
    reader.reset();
    {
       AggregatedFactsSegmentSource source(reader);
-      aggregatedFacts->loadAggregatedFacts(source);
+      segments.aggregatedFacts->loadAggregatedFacts(source);
    }
 
    // Load the fully aggregated facts
-   FullyAggregatedFactsSegment* fullyAggregatedFacts=0;
-   if ((order&1)==0) {
-      fullyAggregatedFacts=new FullyAggregatedFactsSegment(out.getFirstPartition());
-      out.getFirstPartition().addSegment(fullyAggregatedFacts,DatabasePartition::Tag_S+(order/2));
+   if (segments.fullyAggregatedFacts) {
       reader.reset();
       FullyAggregatedFactsSegmentSource source(reader);
-      fullyAggregatedFacts->loadFullyAggregatedFacts(source);
+      segments.fullyAggregatedFacts->loadFullyAggregatedFacts(source);
    }
 
    // Compute the tuple statistics
@@ -327,10 +349,93 @@ void DatabaseBuilder::loadFacts(unsigned order,FactsReader& reader)
          }
       }
    }
-   fullFacts->loadCounts(groups1,groups2,cardinality);
-   aggregatedFacts->loadCounts(groups1,groups2);
-   if (fullyAggregatedFacts)
-      fullyAggregatedFacts->loadCounts(groups1);
+   segments.fullFacts->loadCounts(groups1,groups2,cardinality);
+   segments.aggregatedFacts->loadCounts(groups1,groups2);
+   if (segments.fullyAggregatedFacts)
+      segments.fullyAggregatedFacts->loadCounts(groups1);
+}
+//---------------------------------------------------------------------------
+void DatabaseBuilder::loadFacts(unsigned order,FactsReader& reader)
+   // Loads the facts in a given order
+{
+   OrderSegments segments;
+   addOrderSegments(order,segments);
+   loadOrder(segments,reader);
+}
+//---------------------------------------------------------------------------
+/// Shared state when loading multiple orders concurrently
+struct DatabaseBuilder::OrderJobs {
+   /// The segments
+   OrderSegments segments[6];
+   /// The readers
+   FactsReader** readers;
+   /// The next unclaimed order
+   unsigned nextOrder;
+   /// The number of running helper threads
+   unsigned runningThreads;
+   /// Lock
+   Mutex lock;
+   /// Notification
+   Event changed;
+};
+//---------------------------------------------------------------------------
+void DatabaseBuilder::loadOrders(OrderJobs& jobs)
+   // Load orders until all are claimed
+{
+   while (true) {
+      jobs.lock.lock();
+      unsigned order=jobs.nextOrder;
+      if (order<6) jobs.nextOrder++;
+      jobs.lock.unlock();
+      if (order>=6)
+         break;
+      loadOrder(jobs.segments[order],*jobs.readers[order]);
+   }
+}
+//---------------------------------------------------------------------------
+void DatabaseBuilder::asyncLoadOrders(void* info)
+   // Entry point for helper threads
+{
+   OrderJobs& jobs=*static_cast<OrderJobs*>(info);
+   loadOrders(jobs);
+
+   jobs.lock.lock();
+   jobs.runningThreads--;
+   jobs.changed.notifyAll(jobs.lock);
+   jobs.lock.unlock();
+}
+//---------------------------------------------------------------------------
+void DatabaseBuilder::loadFacts(FactsReader* readers[6])
+   // Loads the facts in all six orders concurrently
+{
+   // Create all segments upfront. The segment table of the partition must not
+   // change while the bulkloads run, and this keeps the segment ids stable
+   OrderJobs jobs;
+   for (unsigned order=0;order<6;order++)
+      addOrderSegments(order,jobs.segments[order]);
+   jobs.readers=readers;
+   jobs.nextOrder=0;
+   jobs.runningThreads=0;
+
+   // Each order is loaded by one thread. Page allocations are serialized by the space inventory
+   unsigned threads=Scheduler::getMaxThreads();
+   if (!threads) threads=1;
+   if (threads>6) threads=6;
+
+   jobs.lock.lock();
+   for (unsigned index=1;index<threads;index++) {
+      jobs.runningThreads++;
+      if (!Thread::start(asyncLoadOrders,&jobs))
+         jobs.runningThreads--;
+   }
+   jobs.lock.unlock();
+
+   // Participate, then wait for the helpers
+   loadOrders(jobs);
+   jobs.lock.lock();
+   while (jobs.runningThreads)
+      jobs.changed.wait(jobs.lock);
+   jobs.lock.unlock();
 }
 //---------------------------------------------------------------------------
 namespace {
@@ -441,6 +546,40 @@ void DatabaseBuilder::loadStringHashes(StringInfoReader& reader)
    seg->loadStringHashes(source);
 }
 //---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// Reader for string -> id entries
+class StringIndexInfoReader : public DictionarySegment::StringIndexSource
+{
+   private:
+   /// The source
+   DatabaseBuilder::StringIndexReader& reader;
+
+   public:
+   /// Constructor
+   StringIndexInfoReader(DatabaseBuilder::StringIndexReader& reader) : reader(reader) {}
+
+   /// Get the next entry
+   bool next(unsigned& len,const char*& data,unsigned& id) { return reader.next(len,data,id); }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+void DatabaseBuilder::loadStringIndex(StringIndexReader& reader)
+   // Load the sorted string index
+{
+   DictionarySegment* seg=out.getFirstPartition().lookupSegment<DictionarySegment>(DatabasePartition::Tag_Dictionary);
+   StringIndexInfoReader source(reader);
+   seg->loadStringIndex(source);
+}
+//---------------------------------------------------------------------------
+void DatabaseBuilder::setTypedDates(bool typedDates)
+   // Record that xsd:dateTime literals are stored as Type::Date
+{
+   DictionarySegment* seg=out.getFirstPartition().lookupSegment<DictionarySegment>(DatabasePartition::Tag_Dictionary);
+   seg->setTypedDates(typedDates);
+}
+//---------------------------------------------------------------------------
 static void buildCountMap(Database& db,const char* fileName)
    // Build a map with aggregated counts
 {
@@ -502,3 +641,12 @@ void DatabaseBuilder::computeExactStatistics(const char* tmpFile)
    remove(tmpFile);
 }
 //---------------------------------------------------------------------------
+void DatabaseBuilder::computePredicateSets()
+   // Compute the characteristic sets (after loading)
+{
+   PredicateSetSegment* seg=new PredicateSetSegment(out.getFirstPartition());
+   out.getFirstPartition().addSegment(seg,DatabasePartition::Tag_PredicateSet);
+   seg->computePredicateSets();
+   seg->storePredicateSets();
+}
+//---------------------------------------------------------------------------
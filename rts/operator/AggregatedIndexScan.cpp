@@ -132,7 +132,7 @@ void AggregatedIndexScan::Hint::next(unsigned& value1,unsigned& value2)
 //---------------------------------------------------------------------------
 AggregatedIndexScan::AggregatedIndexScan(Database& db,Database::DataOrder order,Register* value1,bool bound1,Register* value2,bool bound2,double expectedOutputCardinality)
    : Operator(expectedOutputCardinality),value1(value1),value2(value2),bound1(bound1),bound2(bound2),facts(db.getAggregatedFacts(order)),order(order),
-     scan(disableSkipping?0:&hint),hint(*this)
+     scan(disableSkipping?0:&hint),hint(*this),rangeLow(0),rangeHigh(~0u)
    // Constructor
 {
 }
@@ -142,6 +142,13 @@ AggregatedIndexScan::~AggregatedIndexScan()
 {
 }
 //---------------------------------------------------------------------------
+void AggregatedIndexScan::restrictRange(unsigned low,unsigned high)
+   // Restrict the first unbound value to the range [low,high)
+{
+   rangeLow=low;
+   rangeHigh=high;
+}
+//---------------------------------------------------------------------------
 void AggregatedIndexScan::print(PlanPrinter& out)
    // Print the operator tree. Debugging only.
 {
@@ -247,7 +254,9 @@ unsigned AggregatedIndexScan::Scan::first()
 {
    observedOutputCardinality=0;
 
-   if (!scan.first(facts))
+   if (!(rangeLow?scan.first(facts,rangeLow,0):scan.first(facts)))
+      return false;
+   if (scan.getValue1()>=rangeHigh)
       return false;
    value1->value=scan.getValue1();
    value2->value=scan.getValue2();
@@ -262,6 +271,8 @@ unsigned AggregatedIndexScan::Scan::next()
 {
    if (!scan.next())
       return false;
+   if (scan.getValue1()>=rangeHigh)
+      return false;
    value1->value=scan.getValue1();
    value2->value=scan.getValue2();
 
@@ -276,7 +287,9 @@ unsigned AggregatedIndexScan::ScanFilter2::first()
    observedOutputCardinality=0;
    filter=value2->value;
 
-   if (!scan.first(facts))
+   if (!(rangeLow?scan.first(facts,rangeLow,0):scan.first(facts)))
+      return false;
+   if (scan.getValue1()>=rangeHigh)
       return false;
    if (scan.getValue2()!=filter)
       return next();
@@ -293,6 +306,8 @@ unsigned AggregatedIndexScan::ScanFilter2::next()
    while (true) {
       if (!scan.next())
          return false;
+      if (scan.getValue1()>=rangeHigh)
+         return false;
       if (scan.getValue2()!=filter)
          continue;
       value1->value=scan.getValue1();
@@ -308,9 +323,9 @@ unsigned AggregatedIndexScan::ScanPrefix1::first()
 {
    observedOutputCardinality=0;
    stop1=value1->value;
-   if (!scan.first(facts,stop1,0))
+   if (!scan.first(facts,stop1,rangeLow))
       return false;
-   if (scan.getValue1()>stop1)
+   if ((scan.getValue1()>stop1)||(scan.getValue2()>=rangeHigh))
       return false;
    value2->value=scan.getValue2();
 
@@ -324,7 +339,7 @@ unsigned AggregatedIndexScan::ScanPrefix1::next()
 {
    if (!scan.next())
       return false;
-   if (scan.getValue1()>stop1)
+   if ((scan.getValue1()>stop1)||(scan.getValue2()>=rangeHigh))
       return false;
    value2->value=scan.getValue2();
 
@@ -0,0 +1,118 @@
+#include "rts/operator/Checkpoint.hpp"
+#include "rts/operator/PlanPrinter.hpp"
+#include "rts/runtime/Runtime.hpp"
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+Checkpoint::Checkpoint(Operator* input,const vector<Register*>& regs,double expectedOutputCardinality)
+   : Operator(expectedOutputCardinality),input(input),origin(0),regs(regs),source(&tuples),cardinality(0),materialized(false)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+Checkpoint::Checkpoint(const vector<unsigned>& tuples,const vector<Register*>& regs,double expectedOutputCardinality,Operator* origin)
+   : Operator(expectedOutputCardinality),input(0),origin(origin),regs(regs),source(&tuples),cardinality(expectedOutputCardinality),materialized(true)
+   // Constructor
+{
+}
+//---------------------------------------------------------------------------
+Checkpoint::~Checkpoint()
+   // Destructor
+{
+   delete input;
+}
+//---------------------------------------------------------------------------
+void Checkpoint::materialize()
+   // Compute the input completely
+{
+   if (materialized)
+      return;
+   materialized=true;
+
+   unsigned width=regs.size();
+   for (unsigned count=input->first();count;count=input->next()) {
+      for (unsigned index=0;index<width;index++)
+         tuples.push_back(regs[index]->value);
+      tuples.push_back(count);
+      cardinality+=count;
+   }
+
+   // Nothing was produced yet as far as the consumers are concerned. Otherwise merge hints
+   // would skip to the last materialized value
+   for (vector<Register*>::const_iterator iter=regs.begin(),limit=regs.end();iter!=limit;++iter)
+      (*iter)->value=~0u;
+}
+//---------------------------------------------------------------------------
+void Checkpoint::releaseTuples(vector<unsigned>& target)
+   // Hand out the materialized tuples
+{
+   target.swap(tuples);
+   tuples.clear();
+}
+//---------------------------------------------------------------------------
+Operator* Checkpoint::releaseInput()
+   // Hand out the input after materializing
+{
+   materialize();
+   Operator* result=input;
+   input=0;
+   return result;
+}
+//---------------------------------------------------------------------------
+unsigned Checkpoint::first()
+   // Produce the first tuple
+{
+   materialize();
+   observedOutputCardinality=0;
+   pos=source->begin();
+   return next();
+}
+//---------------------------------------------------------------------------
+unsigned Checkpoint::next()
+   // Produce the next tuple
+{
+   if (pos==source->end())
+      return false;
+
+   for (vector<Register*>::const_iterator iter=regs.begin(),limit=regs.end();iter!=limit;++iter,++pos)
+      (*iter)->value=*pos;
+   unsigned count=*pos;
+   ++pos;
+
+   observedOutputCardinality+=count;
+   return count;
+}
+//---------------------------------------------------------------------------
+void Checkpoint::print(PlanPrinter& out)
+   // Print the operator tree. Debugging only.
+{
+   out.beginOperator("Checkpoint",expectedOutputCardinality,observedOutputCardinality);
+   out.addMaterializationAnnotation(regs);
+   if (input)
+      input->print(out); else if (origin)
+      origin->print(out);
+   out.endOperator();
+}
+//---------------------------------------------------------------------------
+void Checkpoint::addMergeHint(Register* /*reg1*/,Register* /*reg2*/)
+   // Add a merge join hint
+{
+   // Do not propagate as we break the pipeline
+}
+//---------------------------------------------------------------------------
+void Checkpoint::getAsyncInputCandidates(Scheduler& scheduler)
+   // Register parts of the tree that can be executed asynchronous
+{
+   if (input&&(!materialized))
+      input->getAsyncInputCandidates(scheduler);
+}
+//---------------------------------------------------------------------------
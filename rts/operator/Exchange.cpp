@@ -0,0 +1,210 @@
+#include "rts/operator/Exchange.hpp"
+#include "rts/operator/PlanPrinter.hpp"
+#include "rts/operator/Scheduler.hpp"
+#include "rts/runtime/Runtime.hpp"
+#include "infra/osdep/Thread.hpp"
+#include <algorithm>
+#include <sstream>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+Exchange::Exchange(const vector<Partition>& partitions,const vector<Register*>& output,unsigned threads,double expectedOutputCardinality)
+   : Operator(expectedOutputCardinality),partitions(partitions),output(output),nextPartition(0),current(0),pos(0),currentReady(false),runningThreads(0),cancelled(false),threads(threads?threads:1)
+   // Constructor
+{
+   results.resize(partitions.size());
+   done.resize(partitions.size());
+}
+//---------------------------------------------------------------------------
+Exchange::~Exchange()
+   // Destructor
+{
+   stop();
+   for (vector<Partition>::const_iterator iter=partitions.begin(),limit=partitions.end();iter!=limit;++iter) {
+      delete (*iter).input;
+      delete (*iter).runtime;
+   }
+}
+//---------------------------------------------------------------------------
+void Exchange::compute(unsigned partition)
+   // Compute a partition
+{
+   Operator* input=partitions[partition].input;
+   const vector<Register*>& regs=partitions[partition].registers;
+   vector<unsigned>& tuples=results[partition];
+
+   unsigned width=regs.size();
+   for (unsigned count=input->first();count;count=input->next()) {
+      for (unsigned index=0;index<width;index++)
+         tuples.push_back(regs[index]->value);
+      tuples.push_back(count);
+   }
+}
+//---------------------------------------------------------------------------
+void Exchange::work()
+   // Compute partitions until none is left
+{
+   // Stay at most a few partitions ahead of the consumer to bound the memory
+   unsigned window=2*threads;
+   lock.lock();
+   while (true) {
+      while ((!cancelled)&&(nextPartition<partitions.size())&&(nextPartition>=current+window))
+         changed.wait(lock);
+      if (cancelled||(nextPartition>=partitions.size()))
+         break;
+      unsigned partition=nextPartition++;
+      lock.unlock();
+
+      compute(partition);
+
+      lock.lock();
+      done[partition]=true;
+      changed.notifyAll(lock);
+   }
+   lock.unlock();
+}
+//---------------------------------------------------------------------------
+void Exchange::asyncWorker(void* info)
+   // Entry point for helper threads
+{
+   Exchange& exchange=*static_cast<Exchange*>(info);
+   exchange.work();
+   Scheduler::returnThreads(1);
+
+   exchange.lock.lock();
+   exchange.runningThreads--;
+   exchange.changed.notifyAll(exchange.lock);
+   exchange.lock.unlock();
+}
+//---------------------------------------------------------------------------
+void Exchange::waitFor(unsigned partition)
+   // Wait until a partition is computed, helping if needed
+{
+   lock.lock();
+   while (!done[partition]) {
+      // Not started yet? Then compute the next partition ourself
+      if (nextPartition<=partition) {
+         unsigned next=nextPartition++;
+         lock.unlock();
+         compute(next);
+         lock.lock();
+         done[next]=true;
+         changed.notifyAll(lock);
+         continue;
+      }
+      changed.wait(lock);
+   }
+   lock.unlock();
+}
+//---------------------------------------------------------------------------
+void Exchange::stop()
+   // Stop the helper threads
+{
+   lock.lock();
+   cancelled=true;
+   changed.notifyAll(lock);
+   while (runningThreads)
+      changed.wait(lock);
+   lock.unlock();
+}
+//---------------------------------------------------------------------------
+unsigned Exchange::first()
+   // Produce the first tuple
+{
+   observedOutputCardinality=0;
+
+   // Forget a previous run
+   stop();
+   for (unsigned index=0;index<partitions.size();index++) {
+      done[index]=false;
+      vector<unsigned>().swap(results[index]);
+   }
+   nextPartition=0;
+   current=0;
+   pos=0;
+   currentReady=false;
+   cancelled=false;
+
+   // Start the helpers, the current thread computes partitions when waiting
+   unsigned helpers=Scheduler::borrowThreads(min<unsigned>(threads,partitions.size())-1);
+   lock.lock();
+   for (unsigned index=0;index<helpers;index++) {
+      runningThreads++;
+      if (!Thread::start(asyncWorker,this)) {
+         runningThreads--;
+         Scheduler::returnThreads(1);
+      }
+   }
+   lock.unlock();
+
+   return next();
+}
+//---------------------------------------------------------------------------
+unsigned Exchange::next()
+   // Produce the next tuple
+{
+   unsigned width=output.size();
+   while (current<partitions.size()) {
+      if (!currentReady) {
+         waitFor(current);
+         currentReady=true;
+      }
+
+      // Replay the current partition
+      const vector<unsigned>& tuples=results[current];
+      if (pos<tuples.size()) {
+         for (unsigned index=0;index<width;index++)
+            output[index]->value=tuples[pos++];
+         unsigned count=tuples[pos++];
+         observedOutputCardinality+=count;
+         return count;
+      }
+
+      // Continue with the next partition
+      vector<unsigned>().swap(results[current]);
+      lock.lock();
+      current++;
+      changed.notifyAll(lock);
+      lock.unlock();
+      pos=0;
+      currentReady=false;
+   }
+
+   // Give the helper threads back
+   stop();
+   return false;
+}
+//---------------------------------------------------------------------------
+void Exchange::print(PlanPrinter& out)
+   // Print the operator tree. Debugging only.
+{
+   out.beginOperator("Exchange",expectedOutputCardinality,observedOutputCardinality);
+   stringstream partitionInfo;
+   partitionInfo << partitions.size() << " partitions, showing the first";
+   out.addArgumentAnnotation(partitionInfo.str());
+   out.addMaterializationAnnotation(output);
+   partitions.front().input->print(out);
+   out.endOperator();
+}
+//---------------------------------------------------------------------------
+void Exchange::addMergeHint(Register* /*reg1*/,Register* /*reg2*/)
+   // Add a merge join hint
+{
+   // Do not propagate as the partitions are computed independently
+}
+//---------------------------------------------------------------------------
+void Exchange::getAsyncInputCandidates(Scheduler& /*scheduler*/)
+   // Register parts of the tree that can be executed asynchronous
+{
+   // The partitions are computed by our own threads
+}
+//---------------------------------------------------------------------------
@@ -12,24 +12,9 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 Filter::Filter(Operator* input,Register* filter,const std::vector<unsigned>& values,bool exclude,double expectedOutputCardinality)
-   : Operator(expectedOutputCardinality),input(input),filter(filter),exclude(exclude)
+   : Operator(expectedOutputCardinality),input(input),filter(filter),valid(values),exclude(exclude)
    // Constructor
 {
-   if (values.empty()) {
-      min=1;
-      max=0;
-   } else {
-      min=max=values[0];
-      for (std::vector<unsigned>::const_iterator iter=values.begin(),limit=values.end();iter!=limit;++iter) {
-         if ((*iter)<min)
-            min=*iter;
-         if ((*iter)>max)
-            max=*iter;
-      }
-      valid.resize(max-min+1);
-      for (std::vector<unsigned>::const_iterator iter=values.begin(),limit=values.end();iter!=limit;++iter)
-         valid[(*iter)-min]=true;
-   }
 }
 //---------------------------------------------------------------------------
 Filter::~Filter()
@@ -46,9 +31,9 @@ unsigned Filter::first()
    // Do we know the domain?
    if ((!exclude)&&(filter->domain)) {
       ObservedDomainDescription domain;
-      for (unsigned index=min;index<=max;index++)
-         if (valid[index-min])
-            domain.add(index);
+      IdSet::Iterator iter(valid);
+      for (unsigned id;iter.next(id);)
+         domain.add(id);
       filter->domain->restrictTo(domain);
    }
 
@@ -58,52 +43,27 @@ unsigned Filter::first()
       return false;
 
    // Check if valid
-   unsigned value=filter->value;
-   if (exclude) {
-      if ((value>=min)&&(value<=max)&&(valid[value-min]))
-         return next();
+   if (valid.contains(filter->value)!=exclude) {
       observedOutputCardinality+=count;
       return count;
-   } else {
-      if ((value>=min)&&(value<=max)&&(valid[value-min])) {
-         observedOutputCardinality+=count;
-         return count;
-      }
-      return next();
    }
+   return next();
 }
 //---------------------------------------------------------------------------
 unsigned Filter::next()
    // Produce the next tuple
 {
-   if (exclude) {
-      while (true) {
-         // Done?
-         unsigned count;
-         if ((count=input->next())==0)
-            return false;
+   while (true) {
+      // Done?
+      unsigned count;
+      if ((count=input->next())==0)
+         return false;
 
-         // Check if valid
-         unsigned value=filter->value;
-         if ((value>=min)&&(value<=max)&&(valid[value-min]))
-            continue;
+      // Check if valid
+      if (valid.contains(filter->value)!=exclude) {
          observedOutputCardinality+=count;
          return count;
       }
-   } else {
-      while (true) {
-         // Done?
-         unsigned count;
-         if ((count=input->next())==0)
-            return false;
-
-         // Check if valid
-         unsigned value=filter->value;
-         if ((value>=min)&&(value<=max)&&(valid[value-min])) {
-            observedOutputCardinality+=count;
-            return count;
-         }
-      }
    }
 }
 //---------------------------------------------------------------------------
@@ -115,8 +75,9 @@ void Filter::print(PlanPrinter& out)
    std::string pred=out.formatRegister(filter);
    if (exclude) pred+=" not";
    pred+=" in {";
-   unsigned id=min; bool first=true;
-   for (std::vector<unsigned char>::const_iterator iter=valid.begin(),limit=valid.end();iter!=limit;++iter,++id) {
+   IdSet::Iterator iter(valid);
+   bool first=true;
+   for (unsigned id;iter.next(id);) {
       if (first) first=false; else pred+=" ";
       pred+=out.formatValue(id);
    }
@@ -1,6 +1,9 @@
 #include "rts/operator/HashGroupify.hpp"
 #include "rts/operator/PlanPrinter.hpp"
 #include "rts/runtime/Runtime.hpp"
+#include "infra/osdep/Event.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include "infra/osdep/Thread.hpp"
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -52,8 +55,94 @@ class HashGroupify::Chainer {
    }
 };
 //---------------------------------------------------------------------------
+/// Merge worker. Threads grab partitions until all are merged
+class HashGroupify::MergeWorker {
+   private:
+   /// The operator
+   HashGroupify& groupify;
+   /// The lock
+   Mutex lock;
+   /// Notification
+   Event finished;
+   /// The next partition to merge
+   unsigned nextPartition;
+   /// The number of running threads
+   unsigned runningThreads;
+
+   /// Merge partitions until none is left
+   void work();
+   /// Entry point for worker threads
+   static void asyncWorker(void* info);
+
+   public:
+   /// Constructor
+   MergeWorker(HashGroupify& groupify) : groupify(groupify),nextPartition(0),runningThreads(0) {}
+
+   /// Merge all partitions using the given number of borrowed helper threads
+   void run(unsigned helpers);
+};
+//---------------------------------------------------------------------------
+void HashGroupify::MergeWorker::work()
+   // Merge partitions until none is left
+{
+   while (true) {
+      lock.lock();
+      if (nextPartition>=groupify.partitions.size()) {
+         lock.unlock();
+         break;
+      }
+      Partition& partition=*(groupify.partitions[nextPartition++]);
+      lock.unlock();
+
+      groupify.merge(partition);
+   }
+}
+//---------------------------------------------------------------------------
+void HashGroupify::MergeWorker::asyncWorker(void* info)
+   // Entry point for worker threads
+{
+   MergeWorker& worker=*static_cast<MergeWorker*>(info);
+   worker.work();
+   Scheduler::returnThreads(1);
+
+   worker.lock.lock();
+   worker.runningThreads--;
+   worker.finished.notifyAll(worker.lock);
+   worker.lock.unlock();
+}
+//---------------------------------------------------------------------------
+void HashGroupify::MergeWorker::run(unsigned helpers)
+   // Merge all partitions using the given number of borrowed helper threads
+{
+   // Start the helpers, the current thread works, too
+   lock.lock();
+   for (unsigned index=0;index<helpers;index++) {
+      runningThreads++;
+      if (!Thread::start(asyncWorker,this)) {
+         runningThreads--;
+         Scheduler::returnThreads(1);
+      }
+   }
+   lock.unlock();
+   work();
+
+   // Wait for the helpers
+   lock.lock();
+   while (runningThreads)
+      finished.wait(lock);
+   lock.unlock();
+}
+//---------------------------------------------------------------------------
+void HashGroupify::Aggregate::run()
+   // Aggregate the input
+{
+   if (done) return;
+   groupify.aggregate();
+   done=true;
+}
+//---------------------------------------------------------------------------
 HashGroupify::HashGroupify(Operator* input,const std::vector<Register*>& values,double expectedOutputCardinality)
-   : Operator(expectedOutputCardinality),values(values),input(input),groups(0),groupsPool(values.size()*sizeof(unsigned))
+   : Operator(expectedOutputCardinality),values(values),input(input),partitionsIter(0),groupsIter(0),aggregateTask(*this)
    // Constructor
 {
 }
@@ -61,48 +150,55 @@ HashGroupify::HashGroupify(Operator* input,const std::vector<Register*>& values,
 HashGroupify::~HashGroupify()
    // Destructor
 {
+   for (std::vector<Partition*>::const_iterator iter=partitions.begin(),limit=partitions.end();iter!=limit;++iter)
+      delete *iter;
    delete input;
 }
 //---------------------------------------------------------------------------
-unsigned HashGroupify::first()
-   // Produce the first tuple
+void HashGroupify::spill(const unsigned* tuple)
+   // Spill a tuple into its partition
+{
+   // The low bits of the hash are used by the hash tables, use mixed high bits here
+   unsigned slot=(tuple[0]*2654435761u)>>(8*sizeof(unsigned)-partitionBits);
+   std::vector<unsigned>& target=partitions[slot]->tuples;
+   target.insert(target.end(),tuple,tuple+values.size()+2);
+}
+//---------------------------------------------------------------------------
+void HashGroupify::merge(Partition& partition)
+   // Merge a partition
 {
-   observedOutputCardinality=0;
-
-   // Aggregate the input
    std::vector<Group*> hashTable;
    unsigned hashTableSize=64,load=0,maxLoad=static_cast<unsigned>(0.8*hashTableSize);
    hashTable.resize(hashTableSize);
-   groupsPool.freeAll();
+   partition.groupsPool.freeAll();
 
-   for (unsigned count=input->first();count;count=input->next()) {
-      // Hash the aggregation values
-      unsigned hash=0;
-      for (std::vector<Register*>::const_iterator iter=values.begin(),limit=values.end();iter!=limit;++iter)
-         hash=((hash<<15)|(hash>>(8*sizeof(unsigned)-15)))^((*iter)->value);
+   unsigned width=values.size()+2;
+   for (std::vector<unsigned>::const_iterator iter=partition.tuples.begin(),limit=partition.tuples.end();iter!=limit;iter+=width) {
+      const unsigned* tuple=&(*iter);
+      unsigned hash=tuple[0];
 
       // Scan the hash table for existing values
       Group*& slot=hashTable[hash&(hashTableSize-1)];
       bool match=false;
       for (Group* iter=slot;iter;iter=iter->next) {
-         match=true;
-         for (unsigned index=0,limit=values.size();index<limit;index++)
-            if (iter->values[index]!=values[index]->value)
-               { match=false; break; }
+         match=(iter->hash==hash);
+         for (unsigned index=0,limit=values.size();match&&(index<limit);index++)
+            if (iter->values[index]!=tuple[index+2])
+               match=false;
          if (match) {
-            iter->count+=count;
+            iter->count+=tuple[1];
             break;
          }
       }
       if (match) continue;
 
       // Create a new group
-      Group* g=groupsPool.alloc();
+      Group* g=partition.groupsPool.alloc();
       g->next=slot;
       g->hash=hash;
-      g->count=count;
+      g->count=tuple[1];
       for (unsigned index=0,limit=values.size();index<limit;index++)
-         g->values[index]=values[index]->value;
+         g->values[index]=tuple[index+2];
       slot=g;
 
       // Rehash if necessary
@@ -112,16 +208,85 @@ unsigned HashGroupify::first()
          maxLoad=static_cast<unsigned>(0.8*hashTableSize);
          hashTable.resize(hashTableSize);
          Rehasher rehasher(hashTable);
-         groupsPool.enumAll(rehasher);
+         partition.groupsPool.enumAll(rehasher);
       }
    }
+   std::vector<unsigned>().swap(partition.tuples);
 
    // Form a chain out of the groups
    Chainer chainer;
-   groupsPool.enumAll(chainer);
+   partition.groupsPool.enumAll(chainer);
+   partition.groups=chainer.getHead();
+}
+//---------------------------------------------------------------------------
+void HashGroupify::aggregate()
+   // Aggregate the input
+{
+   // Prepare the partitions
+   for (std::vector<Partition*>::const_iterator iter=partitions.begin(),limit=partitions.end();iter!=limit;++iter)
+      delete *iter;
+   partitions.clear();
+   for (unsigned index=0;index<partitionCount;index++)
+      partitions.push_back(new Partition(values.size()));
 
-   groups=chainer.getHead();
-   groupsIter=groups;
+   // Pre-aggregate the input in a small table. Entries are hash, count, values, a zero count marks a free entry
+   unsigned width=values.size()+2;
+   std::vector<unsigned> table(preAggregationSize*width);
+   for (unsigned count=input->first();count;count=input->next()) {
+      // Hash the aggregation values
+      unsigned hash=0;
+      for (std::vector<Register*>::const_iterator iter=values.begin(),limit=values.end();iter!=limit;++iter)
+         hash=((hash<<15)|(hash>>(8*sizeof(unsigned)-15)))^((*iter)->value);
+
+      // Already present?
+      unsigned* slot=&table[(hash&(preAggregationSize-1))*width];
+      if (slot[1]) {
+         bool match=(slot[0]==hash);
+         for (unsigned index=0,limit=values.size();match&&(index<limit);index++)
+            if (slot[index+2]!=values[index]->value)
+               match=false;
+         if (match) {
+            slot[1]+=count;
+            continue;
+         }
+         // No, evict the old entry
+         spill(slot);
+      }
+      slot[0]=hash;
+      slot[1]=count;
+      for (unsigned index=0,limit=values.size();index<limit;index++)
+         slot[index+2]=values[index]->value;
+   }
+   for (unsigned index=0;index<preAggregationSize;index++)
+      if (table[index*width+1])
+         spill(&table[index*width]);
+
+   // Merge the partitions, in parallel if worthwhile. We usually run on a scheduler
+   // worker already, the helpers are borrowed from the idle part of the thread budget
+   unsigned spilled=0;
+   for (std::vector<Partition*>::const_iterator iter=partitions.begin(),limit=partitions.end();iter!=limit;++iter)
+      spilled+=(*iter)->tuples.size()/width;
+   unsigned helpers=(spilled>=parallelThreshold)?Scheduler::borrowThreads(partitions.size()-1):0;
+   if (helpers) {
+      MergeWorker worker(*this);
+      worker.run(helpers);
+   } else {
+      for (std::vector<Partition*>::const_iterator iter=partitions.begin(),limit=partitions.end();iter!=limit;++iter)
+         merge(**iter);
+   }
+}
+//---------------------------------------------------------------------------
+unsigned HashGroupify::first()
+   // Produce the first tuple
+{
+   observedOutputCardinality=0;
+
+   // Aggregate the input if not already done. Repeated calls aggregate again
+   aggregateTask.run();
+   aggregateTask.done=false;
+
+   partitionsIter=0;
+   groupsIter=partitions.empty()?0:partitions[0]->groups;
 
    return next();
 }
@@ -129,9 +294,12 @@ unsigned HashGroupify::first()
 unsigned HashGroupify::next()
    // Produce the next tuple
 {
-   // End of input?
-   if (!groupsIter)
-      return 0;
+   // End of the current partition?
+   while (!groupsIter) {
+      if ((++partitionsIter)>=partitions.size())
+         return 0;
+      groupsIter=partitions[partitionsIter]->groups;
+   }
 
    // Produce the next group
    for (unsigned index=0,limit=values.size();index<limit;index++)
@@ -161,6 +329,8 @@ void HashGroupify::addMergeHint(Register* /*reg1*/,Register* /*reg2*/)
 void HashGroupify::getAsyncInputCandidates(Scheduler& scheduler)
    // Register parts of the tree that can be executed asynchronous
 {
+   unsigned p=scheduler.getRegisteredPoints();
    input->getAsyncInputCandidates(scheduler);
+   scheduler.registerAsyncPoint(aggregateTask,0,input->getExpectedOutputCardinality(),p);
 }
 //---------------------------------------------------------------------------
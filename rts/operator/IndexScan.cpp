@@ -223,7 +223,7 @@ void IndexScan::Hint::next(unsigned& value1,unsigned& value2,unsigned& value3)
 //---------------------------------------------------------------------------
 IndexScan::IndexScan(Database& db,Database::DataOrder order,Register* value1,bool bound1,Register* value2,bool bound2,Register* value3,bool bound3,double expectedOutputCardinality)
    : Operator(expectedOutputCardinality),value1(value1),value2(value2),value3(value3),bound1(bound1),bound2(bound2),bound3(bound3),facts(db.getFacts(order)),order(order),
-     scan(disableSkipping?0:&hint),hint(*this)
+     scan(disableSkipping?0:&hint),hint(*this),rangeLow(0),rangeHigh(~0u)
    // Constructor
 {
 }
@@ -233,6 +233,13 @@ IndexScan::~IndexScan()
 {
 }
 //---------------------------------------------------------------------------
+void IndexScan::restrictRange(unsigned low,unsigned high)
+   // Restrict the first unbound value to the range [low,high)
+{
+   rangeLow=low;
+   rangeHigh=high;
+}
+//---------------------------------------------------------------------------
 void IndexScan::print(PlanPrinter& out)
    // Print the operator tree. Debugging only.
 {
@@ -343,7 +350,9 @@ unsigned IndexScan::Scan::first()
    // Produce the first tuple
 {
    observedOutputCardinality=0;
-   if (!scan.first(facts))
+   if (!(rangeLow?scan.first(facts,rangeLow,0,0):scan.first(facts)))
+      return false;
+   if (scan.getValue1()>=rangeHigh)
       return false;
    value1->value=scan.getValue1();
    value2->value=scan.getValue2();
@@ -357,6 +366,8 @@ unsigned IndexScan::Scan::next()
 {
    if (!scan.next())
       return false;
+   if (scan.getValue1()>=rangeHigh)
+      return false;
    value1->value=scan.getValue1();
    value2->value=scan.getValue2();
    value3->value=scan.getValue3();
@@ -369,7 +380,9 @@ unsigned IndexScan::ScanFilter2::first()
 {
    observedOutputCardinality=0;
    filter2=value2->value;
-   if (!scan.first(facts))
+   if (!(rangeLow?scan.first(facts,rangeLow,0,0):scan.first(facts)))
+      return false;
+   if (scan.getValue1()>=rangeHigh)
       return false;
    if (scan.getValue2()!=filter2)
       return next();
@@ -385,6 +398,8 @@ unsigned IndexScan::ScanFilter2::next()
    while (true) {
       if (!scan.next())
          return false;
+      if (scan.getValue1()>=rangeHigh)
+         return false;
       if (scan.getValue2()!=filter2)
          continue;
       value1->value=scan.getValue1();
@@ -399,7 +414,9 @@ unsigned IndexScan::ScanFilter3::first()
 {
    observedOutputCardinality=0;
    filter3=value3->value;
-   if (!scan.first(facts))
+   if (!(rangeLow?scan.first(facts,rangeLow,0,0):scan.first(facts)))
+      return false;
+   if (scan.getValue1()>=rangeHigh)
       return false;
    if (scan.getValue3()!=filter3)
       return next();
@@ -415,6 +432,8 @@ unsigned IndexScan::ScanFilter3::next()
    while (true) {
       if (!scan.next())
          return false;
+      if (scan.getValue1()>=rangeHigh)
+         return false;
       if (scan.getValue3()!=filter3)
          continue;
       value1->value=scan.getValue1();
@@ -430,7 +449,9 @@ unsigned IndexScan::ScanFilter23::first()
    observedOutputCardinality=0;
    filter2=value2->value;
    filter3=value3->value;
-   if (!scan.first(facts))
+   if (!(rangeLow?scan.first(facts,rangeLow,0,0):scan.first(facts)))
+      return false;
+   if (scan.getValue1()>=rangeHigh)
       return false;
    if ((scan.getValue2()!=filter2)||(scan.getValue3()!=filter3))
       return next();
@@ -445,6 +466,8 @@ unsigned IndexScan::ScanFilter23::next()
    while (true) {
       if (!scan.next())
          return false;
+      if (scan.getValue1()>=rangeHigh)
+         return false;
       if ((scan.getValue2()!=filter2)||(scan.getValue3()!=filter3))
          continue;
       value1->value=scan.getValue1();
@@ -458,9 +481,9 @@ unsigned IndexScan::ScanPrefix1::first()
 {
    observedOutputCardinality=0;
    stop1=value1->value;
-   if (!scan.first(facts,stop1,0,0))
+   if (!scan.first(facts,stop1,rangeLow,0))
       return false;
-   if (scan.getValue1()>stop1)
+   if ((scan.getValue1()>stop1)||(scan.getValue2()>=rangeHigh))
       return false;
    value2->value=scan.getValue2();
    value3->value=scan.getValue3();
@@ -473,7 +496,7 @@ unsigned IndexScan::ScanPrefix1::next()
 {
    if (!scan.next())
       return false;
-   if (scan.getValue1()>stop1)
+   if ((scan.getValue1()>stop1)||(scan.getValue2()>=rangeHigh))
       return false;
    value2->value=scan.getValue2();
    value3->value=scan.getValue3();
@@ -487,9 +510,9 @@ unsigned IndexScan::ScanPrefix1Filter3::first()
    observedOutputCardinality=0;
    stop1=value1->value;
    filter3=value3->value;
-   if (!scan.first(facts,stop1,0,0))
+   if (!scan.first(facts,stop1,rangeLow,0))
       return false;
-   if (scan.getValue1()>stop1)
+   if ((scan.getValue1()>stop1)||(scan.getValue2()>=rangeHigh))
       return false;
    if (scan.getValue3()!=filter3)
       return next();
@@ -504,7 +527,7 @@ unsigned IndexScan::ScanPrefix1Filter3::next()
    while (true) {
       if (!scan.next())
          return false;
-      if (scan.getValue1()>stop1)
+      if ((scan.getValue1()>stop1)||(scan.getValue2()>=rangeHigh))
          return false;
       if (scan.getValue3()!=filter3)
          continue;
@@ -520,9 +543,9 @@ unsigned IndexScan::ScanPrefix12::first()
    observedOutputCardinality=0;
    stop1=value1->value;
    stop2=value2->value;
-   if (!scan.first(facts,stop1,stop2,0))
+   if (!scan.first(facts,stop1,stop2,rangeLow))
       return false;
-   if ((scan.getValue1()>stop1)||((scan.getValue1()==stop1)&&(scan.getValue2()>stop2)))
+   if ((scan.getValue1()>stop1)||((scan.getValue1()==stop1)&&(scan.getValue2()>stop2))||(scan.getValue3()>=rangeHigh))
       return false;
    value3->value=scan.getValue3();
    observedOutputCardinality++;
@@ -534,7 +557,7 @@ unsigned IndexScan::ScanPrefix12::next()
 {
    if (!scan.next())
       return false;
-   if ((scan.getValue1()>stop1)||((scan.getValue1()==stop1)&&(scan.getValue2()>stop2)))
+   if ((scan.getValue1()>stop1)||((scan.getValue1()==stop1)&&(scan.getValue2()>stop2))||(scan.getValue3()>=rangeHigh))
       return false;
    value3->value=scan.getValue3();
    observedOutputCardinality++;
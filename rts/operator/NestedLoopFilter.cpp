@@ -1,7 +1,6 @@
 #include "rts/operator/NestedLoopFilter.hpp"
 #include "rts/operator/PlanPrinter.hpp"
 #include "rts/runtime/Runtime.hpp"
-#include <algorithm>
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -13,10 +12,9 @@
 // San Francisco, California, 94105, USA.
 //---------------------------------------------------------------------------
 NestedLoopFilter::NestedLoopFilter(Operator* input,Register* filter,const std::vector<unsigned>& values,double expectedOutputCardinality)
-   : Operator(expectedOutputCardinality),input(input),filter(filter),values(values)
+   : Operator(expectedOutputCardinality),input(input),filter(filter),values(values),pos(this->values),done(true)
    // Constructor
 {
-   std::sort(this->values.begin(),this->values.end());
 }
 //---------------------------------------------------------------------------
 NestedLoopFilter::~NestedLoopFilter()
@@ -28,14 +26,17 @@ unsigned NestedLoopFilter::first()
    // Produce the first tuple
 {
    observedOutputCardinality=0;
-   for (pos=0;pos<values.size();++pos) {
-      filter->value=values[pos];
+   pos=IdSet::Iterator(values);
+   done=false;
+   for (unsigned value;pos.next(value);) {
+      filter->value=value;
       unsigned count;
       if ((count=input->first())!=0) {
          observedOutputCardinality+=count;
          return count;
       }
    }
+   done=true;
    return false;
 }
 //---------------------------------------------------------------------------
@@ -43,7 +44,7 @@ unsigned NestedLoopFilter::next()
    // Produce the next tuple
 {
    // Done?
-   if (pos>=values.size())
+   if (done)
       return false;
 
    // More tuples?
@@ -54,13 +55,14 @@ unsigned NestedLoopFilter::next()
    }
 
    // No, go to the next value
-   for (++pos;pos<values.size();++pos) {
-      filter->value=values[pos];
+   for (unsigned value;pos.next(value);) {
+      filter->value=value;
       if ((count=input->first())!=0) {
          observedOutputCardinality+=count;
          return count;
       }
    }
+   done=true;
    return false;
 }
 //---------------------------------------------------------------------------
@@ -71,10 +73,11 @@ void NestedLoopFilter::print(PlanPrinter& out)
 
    std::string pred=out.formatRegister(filter);
    pred+=" in {";
+   IdSet::Iterator iter(values);
    bool first=true;
-   for (std::vector<unsigned>::const_iterator iter=values.begin(),limit=values.end();iter!=limit;++iter) {
-      if (first) first=true; else pred+=" ";
-      pred+=out.formatValue(*iter);
+   for (unsigned value;iter.next(value);) {
+      if (first) first=false; else pred+=" ";
+      pred+=out.formatValue(value);
    }
    pred+="}";
    out.addGenericAnnotation(pred);
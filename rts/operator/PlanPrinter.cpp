@@ -123,8 +123,8 @@ string DebugPlanPrinter::formatValue(unsigned value)
 {
    stringstream result;
    if (~value) {
-      const char* start,*stop; Type::ID type; unsigned subType;
-      if (runtime.getDatabase().getDictionary().lookupById(value,start,stop,type,subType)) {
+      const char* start,*stop; Type::ID type; unsigned subType; string buffer;
+      if (runtime.getDatabase().getDictionary().lookupById(value,start,stop,type,subType,buffer)) {
          result << '\"';
          for (const char* iter=start;iter!=stop;++iter)
            result << *iter;
@@ -5,6 +5,7 @@
 #include "rts/runtime/Runtime.hpp"
 #include "rts/runtime/TemporaryDictionary.hpp"
 #include "rts/segment/DictionarySegment.hpp"
+#include <deque>
 #include <iostream>
 #include <map>
 #include <set>
@@ -99,6 +100,32 @@ static void printResult(map<unsigned,CacheEntry>& stringCache,vector<unsigned>::
    }
 }
 //---------------------------------------------------------------------------
+/// Number of result values that are collected and resolved together
+static const unsigned chunkSize = 1<<16;
+//---------------------------------------------------------------------------
+static void lookupStrings(map<unsigned,CacheEntry>& stringCache,const vector<unsigned>& ids,DictionarySegment& dictionary,TemporaryDictionary* tempDict,DifferentialIndex* diffIndex,deque<string>& buffers)
+   // Lookup the strings for a number of ids. Strings that are not stored contiguously are assembled in new buffers
+{
+   if (tempDict||diffIndex) {
+      for (vector<unsigned>::const_iterator iter=ids.begin(),limit=ids.end();iter!=limit;++iter) {
+         CacheEntry& c=stringCache[*iter];
+         buffers.push_back(string());
+         if (tempDict)
+            tempDict->lookupById(*iter,c.start,c.stop,c.type,c.subType,buffers.back()); else
+            diffIndex->lookupById(*iter,c.start,c.stop,c.type,c.subType,buffers.back());
+      }
+   } else if (!ids.empty()) {
+      // Resolve all at once, the dictionary sorts the accesses by page
+      vector<DictionarySegment::StringInfo> infos(ids.size());
+      buffers.push_back(string());
+      dictionary.lookupByIds(&ids[0],ids.size(),&infos[0],buffers.back());
+      for (unsigned index=0,limit=ids.size();index<limit;index++) {
+         CacheEntry& c=stringCache[ids[index]];
+         c.start=infos[index].start; c.stop=infos[index].stop; c.type=infos[index].type; c.subType=infos[index].subType;
+      }
+   }
+}
+//---------------------------------------------------------------------------
 };
 //---------------------------------------------------------------------------
 unsigned ResultsPrinter::first()
@@ -109,74 +136,74 @@ unsigned ResultsPrinter::first()
    // Empty input?
    unsigned count;
    if ((count=input->first())==0) {
+      // A lone count still produces its result
+      if ((!silent)&&output.empty()&&(duplicateHandling==CountDuplicates))
+         cout << " 0" << endl; else
       if ((!silent)&&(outputMode!=Embedded))
          cout << "<empty result>" << endl;
       return 1;
    }
 
-   // Collect the values
-   vector<unsigned> results;
+   // Process the input in chunks, the strings of a chunk are resolved together
+   vector<unsigned> results,ids;
    map<unsigned,CacheEntry> stringCache;
+   deque<string> buffers;
    unsigned minCount=(duplicateHandling==ShowDuplicates)?2:1;
-   unsigned entryCount=0;
-   do {
-      if (count<minCount) continue;
-      results.push_back(count);
-      for (vector<Register*>::const_iterator iter=output.begin(),limit=output.end();iter!=limit;++iter) {
-         unsigned id=(*iter)->value;
-         results.push_back(id);
-         if (~id) stringCache[id];
-      }
-      if ((++entryCount)>=this->limit) break;
-   } while ((count=input->next())!=0);
-
-   // Lookup the strings
-   set<unsigned> subTypes;
+   unsigned entryCount=0,columns=output.size();
    TemporaryDictionary* tempDict=runtime.hasTemporaryDictionary()?(&runtime.getTemporaryDictionary()):0;
    DifferentialIndex* diffIndex=runtime.hasDifferentialIndex()?(&runtime.getDifferentialIndex()):0;
-   for (map<unsigned,CacheEntry>::iterator iter=stringCache.begin(),limit=stringCache.end();iter!=limit;++iter) {
-      CacheEntry& c=(*iter).second;
-      if (tempDict)
-         tempDict->lookupById((*iter).first,c.start,c.stop,c.type,c.subType); else
-      if (diffIndex)
-         diffIndex->lookupById((*iter).first,c.start,c.stop,c.type,c.subType); else
-         dictionary.lookupById((*iter).first,c.start,c.stop,c.type,c.subType);
-      if (Type::hasSubType(c.type))
-         subTypes.insert(c.subType);
-   }
-   for (set<unsigned>::const_iterator iter=subTypes.begin(),limit=subTypes.end();iter!=limit;++iter) {
-      CacheEntry& c=stringCache[*iter];
-      if (tempDict)
-         tempDict->lookupById(*iter,c.start,c.stop,c.type,c.subType); else
-      if (diffIndex)
-         diffIndex->lookupById(*iter,c.start,c.stop,c.type,c.subType); else
-         dictionary.lookupById(*iter,c.start,c.stop,c.type,c.subType);
-   }
+   while (count) {
+      // Collect the values
+      results.clear();
+      stringCache.clear();
+      buffers.clear();
+      do {
+         if (count<minCount) continue;
+         results.push_back(count);
+         for (vector<Register*>::const_iterator iter=output.begin(),limit=output.end();iter!=limit;++iter) {
+            unsigned id=(*iter)->value;
+            results.push_back(id);
+            if (~id) stringCache[id];
+         }
+         if ((++entryCount)>=this->limit) { count=0; break; }
+      } while (((count=input->next())!=0)&&(results.size()<chunkSize));
 
-   // Skip printing the results?
-   if (silent)
-      return 1;
+      // Lookup the strings
+      ids.clear();
+      for (map<unsigned,CacheEntry>::const_iterator iter=stringCache.begin(),limit=stringCache.end();iter!=limit;++iter)
+         ids.push_back((*iter).first);
+      lookupStrings(stringCache,ids,dictionary,tempDict,diffIndex,buffers);
+      set<unsigned> subTypes;
+      for (map<unsigned,CacheEntry>::const_iterator iter=stringCache.begin(),limit=stringCache.end();iter!=limit;++iter)
+         if (Type::hasSubType((*iter).second.type))
+            subTypes.insert((*iter).second.subType);
+      ids.assign(subTypes.begin(),subTypes.end());
+      lookupStrings(stringCache,ids,dictionary,tempDict,diffIndex,buffers);
 
-   // Expand duplicates?
-   unsigned columns=output.size();
-   if (duplicateHandling==ExpandDuplicates) {
-      for (vector<unsigned>::const_iterator iter=results.begin(),limit=results.end();iter!=limit;) {
-         unsigned count=*iter; ++iter;
-         for (unsigned index=0;index<count;index++) {
+      // Skip printing the results?
+      if (silent)
+         continue;
+
+      // Expand duplicates?
+      if (duplicateHandling==ExpandDuplicates) {
+         for (vector<unsigned>::const_iterator iter=results.begin(),limit=results.end();iter!=limit;) {
+            unsigned count=*iter; ++iter;
+            for (unsigned index=0;index<count;index++) {
+               printResult(stringCache,iter,iter+columns,(outputMode==Embedded));
+               cout << endl;
+            }
+            iter+=columns;
+         }
+      } else {
+         // No, reduced, count, or duplicates
+         for (vector<unsigned>::const_iterator iter=results.begin(),limit=results.end();iter!=limit;) {
+            unsigned count=*iter; ++iter;
             printResult(stringCache,iter,iter+columns,(outputMode==Embedded));
+            if (duplicateHandling!=ReduceDuplicates)
+               cout << " " << count;
             cout << endl;
+            iter+=columns;
          }
-         iter+=columns;
-      }
-   } else {
-      // No, reduced, count, or duplicates
-      for (vector<unsigned>::const_iterator iter=results.begin(),limit=results.end();iter!=limit;) {
-         unsigned count=*iter; ++iter;
-         printResult(stringCache,iter,iter+columns,(outputMode==Embedded));
-         if (duplicateHandling!=ReduceDuplicates)
-            cout << " " << count;
-         cout << endl;
-         iter+=columns;
       }
    }
 
@@ -5,6 +5,11 @@
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
+/// Protects the thread budget
+static Mutex budgetLock;
+/// The number of busy threads beyond the threads running queries. Negative while a scheduler lends the thread waiting for its workers
+static int lentThreads = 0;
+//---------------------------------------------------------------------------
 Scheduler::AsyncPoint::~AsyncPoint()
    // Destructor
 {
@@ -16,16 +21,49 @@ Scheduler::RegisteredPoint::RegisteredPoint(AsyncPoint& point,unsigned schedulin
 {
 }
 //---------------------------------------------------------------------------
-Scheduler::Scheduler()
-   : activeWorkers(0),workerThreads(0),workersDie(false)
-   // Constructor
+unsigned Scheduler::getMaxThreads()
+   // The number of threads requested via MAXTHREADS
 {
-   // How many threads should we use?
-   threads=0;
+   unsigned threads=0;
    if (getenv("MAXTHREADS"))
       threads=atoi(getenv("MAXTHREADS"));
    if ((threads<2)||(threads>1000))
       threads=0;
+   return threads;
+}
+//---------------------------------------------------------------------------
+unsigned Scheduler::borrowThreads(unsigned wanted)
+   // Borrow up to the given number of helper threads
+{
+   int available=static_cast<int>(getMaxThreads())-1;
+   auto_lock lock(budgetLock);
+   if (lentThreads>=available)
+      return 0;
+   unsigned granted=min(wanted,static_cast<unsigned>(available-lentThreads));
+   lentThreads+=granted;
+   return granted;
+}
+//---------------------------------------------------------------------------
+void Scheduler::returnThreads(unsigned count)
+   // Give borrowed helper threads back
+{
+   auto_lock lock(budgetLock);
+   lentThreads-=count;
+}
+//---------------------------------------------------------------------------
+static void takeThread()
+   // Take a thread from the budget even if it is exhausted
+{
+   auto_lock lock(budgetLock);
+   lentThreads++;
+}
+//---------------------------------------------------------------------------
+Scheduler::Scheduler()
+   : activeWorkers(0),workerThreads(0),workersDie(false)
+   // Constructor
+{
+   // How many threads should we use?
+   threads=getMaxThreads();
 
    // Start worker threads
    if (threads) {
@@ -91,10 +129,11 @@ void Scheduler::performWork()
       workQueue.erase(workQueue.begin());
       workerSignal.notifyAll(workerLock);
 
-      // Run the job
+      // Run the job, using the thread taken from the budget when scheduling it
       activeWorkers++;
       workerLock.unlock();
       job->point.run();
+      returnThreads(1);
       workerLock.lock();
       activeWorkers--;
 
@@ -132,7 +171,10 @@ void Scheduler::execute(Operator* root)
    registeredPoints.clear();
    root->getAsyncInputCandidates(*this);
 
-   // Execute all asynchronous execution points
+   // Execute all asynchronous execution points. The current thread only waits meanwhile,
+   // the workers can use its share of the thread budget
+   returnThreads(1);
+   workerLock.lock();
    while (!registeredPoints.empty()) {
       // Is the worker queue full?
       if ((workQueue.size()+activeWorkers)>=threads) {
@@ -162,6 +204,14 @@ void Scheduler::execute(Operator* root)
          // No, cyclic dependency!
          throw;
       }
+      // Take a thread from the budget. If the running jobs and their helpers use it up, wait for them
+      if (!borrowThreads(1)) {
+         if (activeWorkers||workQueue.size()) {
+            workerSignal.wait(workerLock);
+            continue;
+         }
+         takeThread();
+      }
       // Add the task
       workQueue.push_back(best);
       swap(*bestPos,registeredPoints.back());
@@ -173,6 +223,7 @@ void Scheduler::execute(Operator* root)
    while (activeWorkers)
       workerSignal.wait(workerLock);
    workerLock.unlock();
+   takeThread();
 
    // Now run the main parts if any
    if (root->first()) {
@@ -1,4 +1,5 @@
 #include "rts/operator/Selection.hpp"
+#include "infra/util/Regex.hpp"
 #include "rts/operator/PlanPrinter.hpp"
 #include "rts/database/Database.hpp"
 #include "rts/runtime/Runtime.hpp"
@@ -57,8 +58,8 @@ void Selection::Result::ensureString(Selection* selection)
 {  
    if (!(flags&stringAvailable)) {
       if (flags&idAvailable) {
-         const char* start,*stop;
-         if ((~id)&&(selection->runtime.getDatabase().getDictionary().lookupById(id,start,stop,type,subType))) {
+         const char* start,*stop; string buffer;
+         if ((~id)&&(selection->runtime.getDatabase().getDictionary().lookupById(id,start,stop,type,subType,buffer))) {
             value=string(start,stop);
             flags|=typeAvailable;
          } else {
@@ -80,8 +81,8 @@ void Selection::Result::ensureType(Selection* selection)
 {
    if (!(flags&typeAvailable)) {
       if (flags&idAvailable) {
-         const char* start,*stop;
-         if ((~id)&&(selection->runtime.getDatabase().getDictionary().lookupById(id,start,stop,type,subType))) {
+         const char* start,*stop; string buffer;
+         if ((~id)&&(selection->runtime.getDatabase().getDictionary().lookupById(id,start,stop,type,subType,buffer))) {
             value=string(start,stop);
             flags|=stringAvailable;
          } else {
@@ -102,9 +103,9 @@ void Selection::Result::ensureSubType(Selection* selection)
    ensureType(selection);
    if (!(flags&subTypeAvailable)) {
       if ((type==Type::CustomLanguage)||(type==Type::CustomType)) {
-         const char* start,*stop;
+         const char* start,*stop; string buffer;
          Type::ID t; unsigned st;
-         if (selection->runtime.getDatabase().getDictionary().lookupById(subType,start,stop,t,st)) {
+         if (selection->runtime.getDatabase().getDictionary().lookupById(subType,start,stop,t,st,buffer)) {
             subTypeValue=string(start,stop);
          } else {
             subTypeValue.clear();
@@ -157,6 +158,84 @@ void Selection::Result::setIRI(const std::string& v)
    value=v;
 }
 //---------------------------------------------------------------------------
+void Selection::Program::clear()
+   // Remove all instructions
+{
+   code.clear();
+   sets.clear();
+   slots.clear();
+}
+//---------------------------------------------------------------------------
+unsigned Selection::Program::addCompare(Instruction::Opcode op,const unsigned* left,const unsigned* right)
+   // Add a comparison or a Bound test
+{
+   Instruction i;
+   i.op=op;
+   i.left=left;
+   i.right=right;
+   i.arg1=i.arg2=0;
+   code.push_back(i);
+   slots.push_back(0);
+   return code.size()-1;
+}
+//---------------------------------------------------------------------------
+unsigned Selection::Program::addLogical(Instruction::Opcode op,unsigned arg1,unsigned arg2)
+   // Add a logical operation
+{
+   Instruction i;
+   i.op=op;
+   i.left=i.right=0;
+   i.arg1=arg1;
+   i.arg2=arg2;
+   code.push_back(i);
+   slots.push_back(0);
+   return code.size()-1;
+}
+//---------------------------------------------------------------------------
+unsigned Selection::Program::addIn(const unsigned* probe,const vector<const unsigned*>& values)
+   // Add a set membership test
+{
+   Instruction i;
+   i.op=Instruction::In;
+   i.left=probe;
+   i.right=0;
+   i.arg1=sets.size();
+   sets.insert(sets.end(),values.begin(),values.end());
+   i.arg2=sets.size();
+   code.push_back(i);
+   slots.push_back(0);
+   return code.size()-1;
+}
+//---------------------------------------------------------------------------
+bool Selection::Program::run()
+   // Evaluate the program
+{
+   unsigned char* s=&slots[0];
+   for (unsigned index=0,limit=code.size();index<limit;index++) {
+      const Instruction& i=code[index];
+      switch (i.op) {
+         case Instruction::Equal: s[index]=(*i.left==*i.right); break;
+         case Instruction::NotEqual: s[index]=(*i.left!=*i.right); break;
+         case Instruction::Bound: s[index]=(~(*i.left))!=0; break;
+         case Instruction::In: {
+            unsigned probe=*i.left;
+            s[index]=false;
+            for (unsigned index2=i.arg1;index2<i.arg2;index2++)
+               if (*sets[index2]==probe) {
+                  s[index]=true;
+                  break;
+               }
+            break;
+         }
+         case Instruction::And: s[index]=s[i.arg1]&&s[i.arg2]; break;
+         case Instruction::Or: s[index]=s[i.arg1]||s[i.arg2]; break;
+         case Instruction::Not: s[index]=!s[i.arg1]; break;
+         case Instruction::False: s[index]=false; break;
+      }
+   }
+   return s[code.size()-1];
+}
+//---------------------------------------------------------------------------
 Selection::Predicate::Predicate()
    : selection(0)
    // Constructor
@@ -174,6 +253,18 @@ void Selection::Predicate::setSelection(Selection* s)
    selection=s;
 }
 //---------------------------------------------------------------------------
+const unsigned* Selection::Predicate::getIdSource()
+   // The id the predicate evaluates to, if it is a plain id without string semantics
+{
+   return 0;
+}
+//---------------------------------------------------------------------------
+bool Selection::Predicate::compile(Program& /*program*/)
+   // Compile the predicate into a program
+{
+   return false;
+}
+//---------------------------------------------------------------------------
 bool Selection::Predicate::check()
    // Check the predicate
 {  
@@ -223,6 +314,20 @@ string Selection::Or::print(PlanPrinter& out)
    return "("+left->print(out)+")||("+right->print(out)+")";
 }
 //---------------------------------------------------------------------------
+bool Selection::Or::compile(Program& program)
+   // Compile the predicate into a program
+{
+   unsigned arg1,arg2;
+   if (!left->compile(program))
+      return false;
+   arg1=program.size()-1;
+   if (!right->compile(program))
+      return false;
+   arg2=program.size()-1;
+   program.addLogical(Instruction::Or,arg1,arg2);
+   return true;
+}
+//---------------------------------------------------------------------------
 void Selection::And::eval(Result& result)
    // Evaluate the predicate
 {
@@ -234,6 +339,20 @@ string Selection::And::print(PlanPrinter& out)
 {
    return "("+left->print(out)+")&&("+right->print(out)+")";
 }
+//---------------------------------------------------------------------------
+bool Selection::And::compile(Program& program)
+   // Compile the predicate into a program
+{
+   unsigned arg1,arg2;
+   if (!left->compile(program))
+      return false;
+   arg1=program.size()-1;
+   if (!right->compile(program))
+      return false;
+   arg2=program.size()-1;
+   program.addLogical(Instruction::And,arg1,arg2);
+   return true;
+}
 
 //---------------------------------------------------------------------------
 // Name: eval
@@ -280,6 +399,17 @@ string Selection::Equal::print(PlanPrinter& out)
 {
    return "("+left->print(out)+")==("+right->print(out)+")";
 }
+//---------------------------------------------------------------------------
+bool Selection::Equal::compile(Program& program)
+   // Compile the predicate into a program
+{
+   // Only plain ids can be compared without looking at the strings
+   const unsigned* l=left->getIdSource(),*r=right->getIdSource();
+   if ((!l)||(!r))
+      return false;
+   program.addCompare(Instruction::Equal,l,r);
+   return true;
+}
 
 //---------------------------------------------------------------------------
 // Name: eval
@@ -325,6 +455,17 @@ string Selection::NotEqual::print(PlanPrinter& out)
 {
    return "("+left->print(out)+")!=("+right->print(out)+")";
 }
+//---------------------------------------------------------------------------
+bool Selection::NotEqual::compile(Program& program)
+   // Compile the predicate into a program
+{
+   // Only plain ids can be compared without looking at the strings
+   const unsigned* l=left->getIdSource(),*r=right->getIdSource();
+   if ((!l)||(!r))
+      return false;
+   program.addCompare(Instruction::NotEqual,l,r);
+   return true;
+}
 
 //---------------------------------------------------------------------------
 // Name: eval
@@ -519,6 +660,15 @@ string Selection::Not::print(PlanPrinter& out)
    return "!"+input->print(out);
 }
 //---------------------------------------------------------------------------
+bool Selection::Not::compile(Program& program)
+   // Compile the predicate into a program
+{
+   if (!input->compile(program))
+      return false;
+   program.addLogical(Instruction::Not,program.size()-1,0);
+   return true;
+}
+//---------------------------------------------------------------------------
 void Selection::Neg::eval(Result& result)
    // Evaluate the predicate
 {
@@ -549,6 +699,12 @@ string Selection::Null::print(PlanPrinter& /*out*/)
    return "NULL";
 }
 //---------------------------------------------------------------------------
+const unsigned* Selection::Null::getIdSource()
+   // The id the predicate evaluates to
+{
+   return &id;
+}
+//---------------------------------------------------------------------------
 void Selection::False::eval(Result& result)
    // Evaluate the predicate
 {
@@ -561,6 +717,13 @@ string Selection::False::print(PlanPrinter& /*out*/)
    return "false";
 }
 //---------------------------------------------------------------------------
+bool Selection::False::compile(Program& program)
+   // Compile the predicate into a program
+{
+   program.addLogical(Instruction::False,0,0);
+   return true;
+}
+//---------------------------------------------------------------------------
 void Selection::Variable::eval(Result& result)
    // Evaluate the predicate
 { 
@@ -573,6 +736,12 @@ string Selection::Variable::print(PlanPrinter& out)
    return out.formatRegister(reg);
 }
 //---------------------------------------------------------------------------
+const unsigned* Selection::Variable::getIdSource()
+   // The id the predicate evaluates to
+{
+   return &(reg->value);
+}
+//---------------------------------------------------------------------------
 void Selection::ConstantLiteral::eval(Result& result)
    // Evaluate the predicate
 {
@@ -585,6 +754,12 @@ string Selection::ConstantLiteral::print(PlanPrinter& out)
    return out.formatValue(id);
 }
 //---------------------------------------------------------------------------
+const unsigned* Selection::ConstantLiteral::getIdSource()
+   // The id the predicate evaluates to
+{
+   return &id;
+}
+//---------------------------------------------------------------------------
 void Selection::TemporaryConstantLiteral::eval(Result& result)
    // Evaluate the predicate
 {
@@ -609,6 +784,12 @@ string Selection::ConstantIRI::print(PlanPrinter& out)
    return out.formatValue(id);
 }
 //---------------------------------------------------------------------------
+const unsigned* Selection::ConstantIRI::getIdSource()
+   // The id the predicate evaluates to
+{
+   return &id;
+}
+//---------------------------------------------------------------------------
 void Selection::TemporaryConstantIRI::eval(Result& result)
    // Evaluate the predicate
 {
@@ -751,15 +932,17 @@ string Selection::BuiltinDatatype::print(PlanPrinter& out)
 //---------------------------------------------------------------------------
 void Selection::BuiltinBound::eval(Result& result)
    // Evaluate the predicate
-{ 
-  Result i;
-  input->eval(result);
-  result.ensureString(selection);
-  
-  if(!result.value.compare("NULL"))
-    result.setBoolean(false);
-  else
-    result.setBoolean(true);
+{
+   input->eval(result);
+
+   // Ids can be checked directly
+   if (result.hasId()) {
+      result.setBoolean(~result.id);
+      return;
+   }
+
+   result.ensureString(selection);
+   result.setBoolean(result.value.compare("NULL")!=0);
 }
 //---------------------------------------------------------------------------
 string Selection::BuiltinBound::print(PlanPrinter& out)
@@ -768,6 +951,16 @@ string Selection::BuiltinBound::print(PlanPrinter& out)
    return "bound("+input->print(out)+")";
 }
 //---------------------------------------------------------------------------
+bool Selection::BuiltinBound::compile(Program& program)
+   // Compile the predicate into a program
+{
+   const unsigned* i=input->getIdSource();
+   if (!i)
+      return false;
+   program.addCompare(Instruction::Bound,i,0);
+   return true;
+}
+//---------------------------------------------------------------------------
 void Selection::BuiltinSameTerm::eval(Result& result)
    // Evaluate the predicate
 {
@@ -799,6 +992,17 @@ string Selection::BuiltinSameTerm::print(PlanPrinter& out)
    return "sameTerm("+left->print(out)+","+right->print(out)+")";
 }
 //---------------------------------------------------------------------------
+bool Selection::BuiltinSameTerm::compile(Program& program)
+   // Compile the predicate into a program
+{
+   // Only plain ids can be compared without looking at the strings
+   const unsigned* l=left->getIdSource(),*r=right->getIdSource();
+   if ((!l)||(!r))
+      return false;
+   program.addCompare(Instruction::Equal,l,r);
+   return true;
+}
+//---------------------------------------------------------------------------
 void Selection::BuiltinIsIRI::eval(Result& result)
    // Evaluate the predicate
 {
@@ -853,6 +1057,7 @@ string Selection::BuiltinIsLiteral::print(PlanPrinter& out)
 Selection::BuiltinRegEx::~BuiltinRegEx()
    // Destructor
 {
+   Regex::release(regex);
    delete arg1;
    delete arg2;
    delete arg3;
@@ -866,28 +1071,31 @@ void Selection::BuiltinRegEx::setSelection(Selection* s)
    arg2->setSelection(s);
    if (arg3) arg3->setSelection(s);
 }
-
-//---------------------------------------------------------------------------
-// Name: eval
-// Modified by: Giuseppe De Simone and Hancel Gonzalez
-// Advisor: Maria Esther Vidal
-// Description: Evaluate the regex function with dates. This is not consider
-//              all forms of regular expression, only pattern search.
 //---------------------------------------------------------------------------
 void Selection::BuiltinRegEx::eval(Result& result)
    // Evaluate the predicate
 {
-   Result text,pattern;
+   Result text,pattern,flags;
    arg1->eval(text);
    arg2->eval(pattern);
    text.ensureString(selection);
    pattern.ensureString(selection);
-   int found = text.value.find(pattern.value);
-   if (found != -1) {
-     result.setBoolean(true);
-     return;
+   if (arg3) {
+      arg3->eval(flags);
+      flags.ensureString(selection);
    }
-   result.setBoolean(false);
+
+   // Compile the pattern unless it is unchanged, usually this happens only once
+   if ((!compiled)||(pattern.value!=regexPattern)||(flags.value!=regexFlags)) {
+      Regex::release(regex);
+      regex=Regex::acquire(pattern.value,flags.value);
+      regexPattern=pattern.value;
+      regexFlags=flags.value;
+      compiled=true;
+   }
+
+   // Malformed patterns never match
+   result.setBoolean(regex&&regex->matches(text.value));
 }
 //---------------------------------------------------------------------------
 string Selection::BuiltinRegEx::print(PlanPrinter& out)
@@ -902,6 +1110,40 @@ string Selection::BuiltinRegEx::print(PlanPrinter& out)
    return result;
 }
 //---------------------------------------------------------------------------
+void Selection::BuiltinContains::eval(Result& result)
+   // Evaluate the predicate
+{
+   Result text,pattern;
+   left->eval(text);
+   right->eval(pattern);
+   text.ensureString(selection);
+   pattern.ensureString(selection);
+   result.setBoolean(text.value.find(pattern.value)!=string::npos);
+}
+//---------------------------------------------------------------------------
+string Selection::BuiltinContains::print(PlanPrinter& out)
+   // Print the predicate (debugging only)
+{
+   return "contains("+left->print(out)+","+right->print(out)+")";
+}
+//---------------------------------------------------------------------------
+void Selection::BuiltinStrStarts::eval(Result& result)
+   // Evaluate the predicate
+{
+   Result text,pattern;
+   left->eval(text);
+   right->eval(pattern);
+   text.ensureString(selection);
+   pattern.ensureString(selection);
+   result.setBoolean(text.value.compare(0,pattern.value.size(),pattern.value)==0);
+}
+//---------------------------------------------------------------------------
+string Selection::BuiltinStrStarts::print(PlanPrinter& out)
+   // Print the predicate (debugging only)
+{
+   return "strStarts("+left->print(out)+","+right->print(out)+")";
+}
+//---------------------------------------------------------------------------
 void Selection::BuiltinIn::setSelection(Selection* s)
    // Set the selection
 {
@@ -948,10 +1190,30 @@ string Selection::BuiltinIn::print(PlanPrinter& out)
    return result;
 }
 //---------------------------------------------------------------------------
+bool Selection::BuiltinIn::compile(Program& program)
+   // Compile the predicate into a program
+{
+   const unsigned* p=probe->getIdSource();
+   if (!p)
+      return false;
+   vector<const unsigned*> values;
+   for (vector<Predicate*>::iterator iter=args.begin(),limit=args.end();iter!=limit;++iter) {
+      const unsigned* v=(*iter)->getIdSource();
+      if (!v)
+         return false;
+      values.push_back(v);
+   }
+   program.addIn(p,values);
+   return true;
+}
+//---------------------------------------------------------------------------
 Selection::Selection(Operator* input,Runtime& runtime,Predicate* predicate,double expectedOutputCardinality)
    : Operator(expectedOutputCardinality),input(input),runtime(runtime),predicate(predicate)
    // Constructor
 {
+   // Predicates that only compare ids are evaluated as a flat program
+   if (!predicate->compile(program))
+      program.clear();
 }
 //---------------------------------------------------------------------------
 Selection::~Selection()
@@ -972,7 +1234,7 @@ unsigned Selection::first()
    if (!count) return 0;
 
    // Match?
-   if (predicate->check()) {
+   if (program.empty()?predicate->check():program.run()) {
       observedOutputCardinality+=count;
       return count;
    }
@@ -990,7 +1252,7 @@ unsigned Selection::next()
       if (!count) return 0;
 
       // Match?
-      if (predicate->check()) {
+      if (program.empty()?predicate->check():program.run()) {
          observedOutputCardinality+=count;
          return count;
       }
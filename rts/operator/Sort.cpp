@@ -5,6 +5,9 @@
 #include "rts/runtime/Runtime.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include <algorithm>
+#include <map>
+#include <sstream>
+#include <cstring>
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -17,6 +20,21 @@
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// A cached normalized key
+struct CachedKey {
+   /// The key
+   unsigned key[2];
+   /// The number of heap tuples using it
+   unsigned uses;
+
+   /// Constructor
+   CachedKey() : uses(0) {}
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
 /// Comparator
 class Sort::Sorter
 {
@@ -53,6 +71,21 @@ bool Sort::Sorter::operator()(const Tuple* a,const Tuple* b)
          // Equal?
          if (v1==v2) continue;
 
+         // Compare the normalized keys first, they usually decide
+         unsigned keySlot=(*iter).keySlot;
+         const unsigned* k1,*k2;
+         if ((*iter).descending) {
+            k1=b->values+keySlot;
+            k2=a->values+keySlot;
+         } else {
+            k1=a->values+keySlot;
+            k2=b->values+keySlot;
+         }
+         if (k1[0]<k2[0]) return true;
+         if (k1[0]>k2[0]) return false;
+         if (k1[1]<k2[1]) return true;
+         if (k1[1]>k2[1]) return false;
+
          // Null values
          if (!~v1) return true;
          if (!~v2) return false;
@@ -60,8 +93,9 @@ bool Sort::Sorter::operator()(const Tuple* a,const Tuple* b)
          // Load the strings
          const char* start1,*stop1,*start2,*stop2;
          Type::ID type1,type2; unsigned subType1,subType2;
-         if (!dict.lookupById(v1,start1,stop1,type1,subType1)) continue;
-         if (!dict.lookupById(v2,start2,stop2,type2,subType2)) continue;
+         string buffer1,buffer2;
+         if (!dict.lookupById(v1,start1,stop1,type1,subType1,buffer1)) continue;
+         if (!dict.lookupById(v2,start2,stop2,type2,subType2,buffer2)) continue;
 
          // Compare
          if (type1<type2) return true;
@@ -93,13 +127,63 @@ bool Sort::Sorter::operator()(const Tuple* a,const Tuple* b)
    return false;
 }
 //---------------------------------------------------------------------------
-Sort::Sort(Database& db,Operator* input,const vector<Register*>& values,const vector<pair<Register*,bool> >& registerOrder,double expectedOutputCardinality)
-   : Operator(expectedOutputCardinality),values(values),input(input),tuplesPool(values.size()*sizeof(unsigned)),dict(db.getDictionary())
+void Sort::buildKey(DictionarySegment& dict,unsigned id,unsigned* key)
+   // Compute the normalized sort key of a value
+{
+   // The key consists of the type and the first bytes of the string, packed
+   // big endian into two words. Comparing keys gives the same order as the
+   // comparison in Sorter unless the keys are equal.
+   unsigned char bytes[8];
+   memset(bytes,0,sizeof(bytes));
+   const char* start,*stop; Type::ID type; unsigned subType; string buffer;
+   if ((~id)&&(dict.lookupById(id,start,stop,type,subType,buffer))) {
+      bytes[0]=static_cast<unsigned char>(type)+1;
+      unsigned pos=1;
+      if (Type::hasSubType(type)) {
+         bytes[1]=subType>>24; bytes[2]=subType>>16; bytes[3]=subType>>8; bytes[4]=subType;
+         pos=5;
+      }
+      for (;(pos<8)&&(start<stop);++pos,++start)
+         bytes[pos]=*start;
+   }
+   key[0]=(bytes[0]<<24)|(bytes[1]<<16)|(bytes[2]<<8)|bytes[3];
+   key[1]=(bytes[4]<<24)|(bytes[5]<<16)|(bytes[6]<<8)|bytes[7];
+}
+//---------------------------------------------------------------------------
+void Sort::buildKeys()
+   // Fill the normalized keys of all collected tuples
+{
+   // Collect all distinct values
+   vector<unsigned> ids;
+   for (vector<Tuple*>::const_iterator iter=tuples.begin(),limit=tuples.end();iter!=limit;++iter)
+      for (vector<Order>::const_iterator iter2=order.begin(),limit2=order.end();iter2!=limit2;++iter2)
+         if (~(*iter2).slot)
+            ids.push_back((*iter)->values[(*iter2).slot]);
+   sort(ids.begin(),ids.end());
+   ids.resize(unique(ids.begin(),ids.end())-ids.begin());
+
+   // Resolve each value once, in id order
+   vector<unsigned> keys(2*ids.size());
+   for (unsigned index=0,limit=ids.size();index<limit;index++)
+      buildKey(dict,ids[index],&keys[2*index]);
+
+   // And store the keys in the tuples
+   for (vector<Tuple*>::const_iterator iter=tuples.begin(),limit=tuples.end();iter!=limit;++iter)
+      for (vector<Order>::const_iterator iter2=order.begin(),limit2=order.end();iter2!=limit2;++iter2)
+         if (~(*iter2).slot) {
+            unsigned pos=lower_bound(ids.begin(),ids.end(),(*iter)->values[(*iter2).slot])-ids.begin();
+            (*iter)->values[(*iter2).keySlot]=keys[2*pos];
+            (*iter)->values[(*iter2).keySlot+1]=keys[2*pos+1];
+         }
+}
+//---------------------------------------------------------------------------
+Sort::Sort(Database& db,Operator* input,const vector<Register*>& values,const vector<pair<Register*,bool> >& registerOrder,double expectedOutputCardinality,unsigned limit)
+   : Operator(expectedOutputCardinality),values(values),input(input),tuplesPool((values.size()+2*registerOrder.size())*sizeof(unsigned)),dict(db.getDictionary()),tupleLimit(limit)
    // Constructor
 {
    for (vector<pair<Register*,bool> >::const_iterator iter=registerOrder.begin(),limit=registerOrder.end();iter!=limit;++iter) {
       if (!(*iter).first) {
-         Order o; o.slot=~0u; o.descending=(*iter).second;
+         Order o; o.slot=~0u; o.keySlot=~0u; o.descending=(*iter).second;
          order.push_back(o);
       } else {
          unsigned slot=~0u;
@@ -109,7 +193,7 @@ Sort::Sort(Database& db,Operator* input,const vector<Register*>& values,const ve
                break;
             }
          if (~slot) {
-            Order o; o.slot=slot; o.descending=(*iter).second;
+            Order o; o.slot=slot; o.keySlot=values.size()+2*order.size(); o.descending=(*iter).second;
             order.push_back(o);
          }
       }
@@ -130,17 +214,74 @@ unsigned Sort::first()
    // Collect the input
    tuples.clear();
    tuplesPool.freeAll();
-   for (unsigned count=input->first();count;count=input->next()) {
-      Tuple* t=tuplesPool.alloc();
-      t->count=count;
-      for (unsigned index=0,limit=values.size();index<limit;index++)
-         t->values[index]=values[index]->value;
-      tuples.push_back(t);
-   }
-
-   // Sort it
    Sorter sorter(dict,order);
-   sort(tuples.begin(),tuples.end(),sorter);
+   if (~tupleLimit) {
+      // Keep only the best tuples. The heap top is the worst tuple seen so far.
+      // Keys are cached only for the values of tuples in the heap, counting their uses
+      map<unsigned,CachedKey> keyCache;
+      Tuple* t=0;
+      for (unsigned count=input->first();count;count=input->next()) {
+         if (!t) t=tuplesPool.alloc();
+         t->count=count;
+         for (unsigned index=0,limit=values.size();index<limit;index++)
+            t->values[index]=values[index]->value;
+         for (vector<Order>::const_iterator iter=order.begin(),limit=order.end();iter!=limit;++iter)
+            if (~(*iter).slot) {
+               unsigned id=t->values[(*iter).slot];
+               map<unsigned,CachedKey>::const_iterator pos=keyCache.find(id);
+               if (pos==keyCache.end()) {
+                  buildKey(dict,id,t->values+(*iter).keySlot);
+               } else {
+                  t->values[(*iter).keySlot]=(*pos).second.key[0];
+                  t->values[(*iter).keySlot+1]=(*pos).second.key[1];
+               }
+            }
+
+         // Does the tuple enter the heap?
+         const Tuple* added=t,*evicted=0;
+         if (tuples.size()<tupleLimit) {
+            tuples.push_back(t);
+            push_heap(tuples.begin(),tuples.end(),sorter);
+            t=0;
+         } else if ((!tuples.empty())&&(sorter(t,tuples.front()))) {
+            // Replace the worst tuple, its memory is reused for the next input
+            pop_heap(tuples.begin(),tuples.end(),sorter);
+            swap(t,tuples.back());
+            push_heap(tuples.begin(),tuples.end(),sorter);
+            evicted=t;
+         } else continue;
+
+         // Update the cache
+         for (vector<Order>::const_iterator iter=order.begin(),limit=order.end();iter!=limit;++iter)
+            if (~(*iter).slot) {
+               CachedKey& c=keyCache[added->values[(*iter).slot]];
+               if (!(c.uses++)) {
+                  c.key[0]=added->values[(*iter).keySlot];
+                  c.key[1]=added->values[(*iter).keySlot+1];
+               }
+               if (evicted) {
+                  map<unsigned,CachedKey>::iterator pos=keyCache.find(evicted->values[(*iter).slot]);
+                  if (!(--(*pos).second.uses))
+                     keyCache.erase(pos);
+               }
+            }
+      }
+
+      // Sort the survivors
+      sort_heap(tuples.begin(),tuples.end(),sorter);
+   } else {
+      for (unsigned count=input->first();count;count=input->next()) {
+         Tuple* t=tuplesPool.alloc();
+         t->count=count;
+         for (unsigned index=0,limit=values.size();index<limit;index++)
+            t->values[index]=values[index]->value;
+         tuples.push_back(t);
+      }
+
+      // Sort it, using normalized keys to avoid most dictionary lookups
+      buildKeys();
+      sort(tuples.begin(),tuples.end(),sorter);
+   }
 
    // Return the first one
    tuplesIter=tuples.begin();
@@ -168,7 +309,7 @@ unsigned Sort::next()
 void Sort::print(PlanPrinter& out)
    // Print the operator tree. Debugging only.
 {
-   out.beginOperator("Sort",expectedOutputCardinality,observedOutputCardinality);
+   out.beginOperator((~tupleLimit)?"TopK":"Sort",expectedOutputCardinality,observedOutputCardinality);
    string o="[";
    for (unsigned index=0,limit=order.size();index<limit;index++) {
       if (index) o+=" ";
@@ -179,6 +320,11 @@ void Sort::print(PlanPrinter& out)
          o+=" desc";
    }
    o+="]";
+   if (~tupleLimit) {
+      stringstream l;
+      l << " limit " << tupleLimit;
+      o+=l.str();
+   }
    out.addGenericAnnotation(o);
    out.addMaterializationAnnotation(values);
    input->print(out);
@@ -62,12 +62,12 @@ void TableFunction::requestTable()
          if (!~v) {
             cout << "NULL";
          } else {
-            const char* start,*stop; Type::ID type; unsigned subType;
+            const char* start,*stop; Type::ID type; unsigned subType; string buffer;
             bool ok;
             if (runtime.hasTemporaryDictionary()) {
-               ok=runtime.getTemporaryDictionary().lookupById(v,start,stop,type,subType);
+               ok=runtime.getTemporaryDictionary().lookupById(v,start,stop,type,subType,buffer);
             } else {
-               ok=runtime.getDatabase().getDictionary().lookupById(v,start,stop,type,subType);
+               ok=runtime.getDatabase().getDictionary().lookupById(v,start,stop,type,subType,buffer);
             }
             if (!ok) {
                cout << "NULL";
@@ -85,9 +85,9 @@ void TableFunction::requestTable()
                      case Type::Literal: break;
                      case Type::CustomLanguage:
                         if (runtime.hasTemporaryDictionary()) {
-                           ok=runtime.getTemporaryDictionary().lookupById(subType,start,stop,type,subType);
+                           ok=runtime.getTemporaryDictionary().lookupById(subType,start,stop,type,subType,buffer);
                         } else {
-                           ok=runtime.getDatabase().getDictionary().lookupById(subType,start,stop,type,subType);
+                           ok=runtime.getDatabase().getDictionary().lookupById(subType,start,stop,type,subType,buffer);
                         }
                         if (ok) {
                            cout << "@";
@@ -96,9 +96,9 @@ void TableFunction::requestTable()
                         break;
                      case Type::CustomType:
                         if (runtime.hasTemporaryDictionary()) {
-                           ok=runtime.getTemporaryDictionary().lookupById(subType,start,stop,type,subType);
+                           ok=runtime.getTemporaryDictionary().lookupById(subType,start,stop,type,subType,buffer);
                         } else {
-                           ok=runtime.getDatabase().getDictionary().lookupById(subType,start,stop,type,subType);
+                           ok=runtime.getDatabase().getDictionary().lookupById(subType,start,stop,type,subType,buffer);
                         }
                         if (ok) {
                            cout << "^^<";
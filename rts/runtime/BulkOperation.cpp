@@ -33,6 +33,16 @@ unsigned BulkOperation::mapString(const DifferentialIndex::Literal& value)
    if (string2id.count(value))
       return string2id[value];
 
+   // Dates are stored as the database expects them. Older databases keep xsd:dateTime as custom type
+   bool typedDates=differentialIndex.getDatabase().getDictionary().hasTypedDates();
+   if ((value.type==Type::Date)&&(!typedDates)) {
+      DifferentialIndex::Literal l;
+      l.value=value.value;
+      l.type=Type::CustomType;
+      l.subType="http://www.w3.org/2001/XMLSchema#dateTime";
+      return mapString(l);
+   }
+
    // Resolve the sub-type if any
    unsigned subType=0;
    if (Type::hasSubType(value.type)) {
@@ -48,6 +58,8 @@ unsigned BulkOperation::mapString(const DifferentialIndex::Literal& value)
             realType=Type::Double;
          } else if (value.subType=="http://www.w3.org/2001/XMLSchema#boolean") {
             realType=Type::Boolean;
+         } else if ((value.subType=="http://www.w3.org/2001/XMLSchema#dateTime")&&typedDates) {
+            realType=Type::Date;
          }
          if (realType!=value.type) {
             DifferentialIndex::Literal l;
@@ -56,7 +56,7 @@ bool TemporaryDictionary::lookup(const std::string& text,Type::ID type,unsigned
    return true;
 }
 //---------------------------------------------------------------------------
-bool TemporaryDictionary::lookupById(unsigned id,const char*& start,const char*& stop,Type::ID& type,unsigned& subType)
+bool TemporaryDictionary::lookupById(unsigned id,const char*& start,const char*& stop,Type::ID& type,unsigned& subType,std::string& buffer)
    // Lookup a string for a given id
 {
    if (id>=idBase) {
@@ -69,9 +69,9 @@ bool TemporaryDictionary::lookupById(unsigned id,const char*& start,const char*&
       subType=l.subType;
       return true;
    } else if (diffIndex) {
-      return diffIndex->lookupById(id,start,stop,type,subType);
+      return diffIndex->lookupById(id,start,stop,type,subType,buffer);
    } else {
-      return dict.lookupById(id,start,stop,type,subType);
+      return dict.lookupById(id,start,stop,type,subType,buffer);
    }
 }
 //---------------------------------------------------------------------------
@@ -3,6 +3,7 @@
 #include "rts/segment/BTree.hpp"
 #include "infra/util/Hash.hpp"
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <vector>
@@ -23,6 +24,9 @@ static const unsigned slotTableStart = 0;
 static const unsigned slotNextId = 1;
 static const unsigned slotMappingStart = 2;
 static const unsigned slotIndexRoot = 3;
+static const unsigned slotStringIndexRoot = 4;
+static const unsigned slotStringIndexIds = 5;
+static const unsigned slotFlags = 6;
 //---------------------------------------------------------------------------
 const unsigned entriesOnFirstMappingPage = (BufferReference::pageSize-16)/8;
 const unsigned entriesPerMappingPage = (BufferReference::pageSize-8)/8;
@@ -187,6 +191,267 @@ class DictionarySegment::HashIndex : public BTree<HashIndexImplementation>
    using BTree<HashIndexImplementation>::leafHeaderSize;
 };
 //---------------------------------------------------------------------------
+/// Sorted index string->id, built once by a bulkload. Strings are truncated
+/// to a maximum length and front coded within a leaf page. Inner pages store
+/// the shortest prefixes that separate their children
+class DictionarySegment::StringIndex
+{
+   public:
+   /// Maximum length of an indexed string
+   static const unsigned maxIndexedLen = 1024;
+
+   // Layout of a leaf page: LSN[8] next[4] leafNo[4] count[4] entries[?]
+   // Each entry is stored as id, common prefix len, suffix len, suffix
+
+   /// Size of the header for a leaf page
+   static const unsigned leafHeaderSize = 16;
+   /// Offset of the next pointer
+   static const unsigned leafHeaderNextPos = 8;
+   /// Offset of the leaf number
+   static const unsigned leafHeaderNoPos = 12;
+
+   // Layout of an inner page: LSN[8] marker[4] next[4] count[4] entries[?]
+   // Each entry is stored as child[4], separator len[2], separator. All
+   // strings of a child are <= its separator, all strings of the following
+   // children are >= it. The last entry has no separator (len 0xFFFF)
+
+   /// Size of the header for an inner page
+   static const unsigned innerHeaderSize = 20;
+   /// Offset of the next pointer
+   static const unsigned innerHeaderNextPos = 12;
+   /// Length marker of a missing separator
+   static const unsigned noSeparator = 0xFFFF;
+
+   /// A leaf entry
+   struct LeafEntry {
+      /// The key value
+      std::string str;
+      /// The payload
+      unsigned id;
+   };
+
+   private:
+   /// A child of an inner page
+   struct Child {
+      /// The separator to the next child
+      std::string separator;
+      /// The page
+      unsigned page;
+      /// Is there a next child?
+      bool hasSeparator;
+   };
+
+   /// The segment
+   DictionarySegment& segment;
+
+   /// Is a page an inner page?
+   static bool isInnerPage(const unsigned char* page) { return Segment::readUint32Aligned(page+8)==0xFFFFFFFF; }
+   /// Pack leaf entries
+   static unsigned packLeafEntries(unsigned char* writer,unsigned char* limit,vector<LeafEntry>::const_iterator entriesStart,vector<LeafEntry>::const_iterator entriesLimit);
+   /// Create a new level of inner nodes
+   void packInner(const vector<Child>& children,vector<Child>& parents);
+   /// Navigate to the first leaf that can contain strings >= key. A null key navigates to the last leaf
+   void findLeaf(BufferReference& leaf,const std::string* key);
+
+   public:
+   /// Constructor
+   explicit StringIndex(DictionarySegment& segment) : segment(segment) {}
+
+   /// Unpack leaf entries
+   static void unpackLeafEntries(vector<LeafEntry>& entries,const unsigned char* page);
+   /// Get the number of a leaf
+   static unsigned getLeafNo(const unsigned char* page) { return Segment::readUint32Aligned(page+leafHeaderNoPos); }
+
+   /// Perform the bulkload
+   void performBulkload(StringIndexSource& source);
+   /// Navigate to the first leaf that can contain strings >= key
+   void findLeaf(BufferReference& leaf,const std::string& key) { findLeaf(leaf,&key); }
+   /// Navigate to the last leaf
+   void findLastLeaf(BufferReference& leaf) { findLeaf(leaf,0); }
+};
+//---------------------------------------------------------------------------
+unsigned DictionarySegment::StringIndex::packLeafEntries(unsigned char* writer,unsigned char* writerLimit,vector<DictionarySegment::StringIndex::LeafEntry>::const_iterator entriesStart,vector<DictionarySegment::StringIndex::LeafEntry>::const_iterator entriesLimit)
+   // Store the string/id pairs. Each entry is stored as id, common prefix len, suffix len, suffix
+{
+   // Too small?
+   if ((writerLimit-writer)<4)
+      return 0;
+   unsigned char* countPos=writer;
+   writer+=4;
+
+   // Store the entries
+   unsigned len=0;
+   const std::string* last=0;
+   for (;entriesStart!=entriesLimit;++entriesStart,++len) {
+      const std::string& str=(*entriesStart).str;
+      unsigned common=0;
+      if (last)
+         while ((common<str.size())&&(common<last->size())&&(str[common]==(*last)[common]))
+            ++common;
+      unsigned suffixLen=str.size()-common;
+      if ((writerLimit-writer)<static_cast<long>(8+suffixLen))
+         break;
+      Segment::writeUint32(writer,(*entriesStart).id); writer+=4;
+      writer[0]=common>>8; writer[1]=common&0xFF; writer[2]=suffixLen>>8; writer[3]=suffixLen&0xFF; writer+=4;
+      memcpy(writer,str.data()+common,suffixLen); writer+=suffixLen;
+      last=&str;
+   }
+
+   // Write the count and pad the remaining space
+   Segment::writeUint32Aligned(countPos,len);
+   memset(writer,0,writerLimit-writer);
+   return len;
+}
+//---------------------------------------------------------------------------
+void DictionarySegment::StringIndex::unpackLeafEntries(vector<DictionarySegment::StringIndex::LeafEntry>& entries,const unsigned char* page)
+   // Read the string/id pairs
+{
+   // Read the len
+   const unsigned char* reader=page+leafHeaderSize;
+   unsigned len=Segment::readUint32Aligned(reader); reader+=4;
+
+   // Read the entries
+   entries.resize(len);
+   for (unsigned index=0;index<len;index++) {
+      entries[index].id=Segment::readUint32(reader); reader+=4;
+      unsigned common=(reader[0]<<8)|reader[1],suffixLen=(reader[2]<<8)|reader[3]; reader+=4;
+      if (index)
+         entries[index].str.assign(entries[index-1].str,0,common); else
+         entries[index].str.clear();
+      entries[index].str.append(reinterpret_cast<const char*>(reader),suffixLen); reader+=suffixLen;
+   }
+}
+//---------------------------------------------------------------------------
+void DictionarySegment::StringIndex::packInner(const vector<Child>& children,vector<Child>& parents)
+   // Create a new level of inner nodes
+{
+   parents.clear();
+
+   DatabaseBuilder::PageChainer chainer(innerHeaderNextPos);
+   unsigned char buffer[BufferReference::pageSize];
+   unsigned bufferPos=innerHeaderSize,bufferCount=0;
+
+   for (vector<Child>::const_iterator iter=children.begin(),limit=children.end();;++iter) {
+      // Do we have to start a new page?
+      if ((iter==limit)||((bufferPos+6+(*iter).separator.size())>BufferReference::pageSize)) {
+         memset(buffer,0,8);
+         Segment::writeUint32Aligned(buffer+8,0xFFFFFFFF);
+         Segment::writeUint32Aligned(buffer+12,0);
+         Segment::writeUint32Aligned(buffer+16,bufferCount);
+         memset(buffer+bufferPos,0,BufferReference::pageSize-bufferPos);
+         chainer.store(&segment,buffer);
+         Child parent;
+         parent.separator=(*(iter-1)).separator;
+         parent.page=chainer.getPageNo();
+         parent.hasSeparator=(*(iter-1)).hasSeparator;
+         parents.push_back(parent);
+         bufferPos=innerHeaderSize; bufferCount=0;
+         if (iter==limit)
+            break;
+      }
+      // Write the entry
+      unsigned len=(*iter).hasSeparator?(*iter).separator.size():noSeparator;
+      Segment::writeUint32(buffer+bufferPos,(*iter).page);
+      buffer[bufferPos+4]=len>>8; buffer[bufferPos+5]=len&0xFF;
+      bufferPos+=6;
+      memcpy(buffer+bufferPos,(*iter).separator.data(),(*iter).separator.size());
+      bufferPos+=(*iter).separator.size();
+      bufferCount++;
+   }
+   chainer.finish();
+}
+//---------------------------------------------------------------------------
+void DictionarySegment::StringIndex::performBulkload(StringIndexSource& source)
+   // Perform the bulkload
+{
+   // Write the leaf pages. The separator between two leaves is the shortest prefix of the first string of the right leaf that is greater than the last string of the left leaf
+   vector<Child> children;
+   {
+      DatabaseBuilder::PageChainer chainer(leafHeaderNextPos);
+      unsigned char buffer[BufferReference::pageSize];
+      vector<LeafEntry> entries;
+      string lastStr;
+      bool inputDone=false;
+      do {
+         // Collect some input
+         while ((entries.size()<BufferReference::pageSize)&&(!inputDone)) {
+            LeafEntry entry;
+            unsigned len; const char* data;
+            if (!source.next(len,data,entry.id)) {
+               inputDone=true;
+               break;
+            }
+            entry.str.assign(data,(len<maxIndexedLen)?len:static_cast<unsigned>(maxIndexedLen));
+            entries.push_back(entry);
+         }
+
+         // Separate from the previous leaf
+         if (!children.empty()) {
+            const string& next=entries.front().str;
+            unsigned common=0;
+            while ((common<lastStr.size())&&(common<next.size())&&(lastStr[common]==next[common]))
+               ++common;
+            children.back().separator.assign(next,0,min<size_t>(common+1,next.size()));
+            children.back().hasSeparator=true;
+         }
+
+         // Store as much as possible
+         unsigned stored=packLeafEntries(buffer+leafHeaderSize,buffer+sizeof(buffer),entries.begin(),entries.end());
+         assert(stored||entries.empty());
+         Segment::writeUint32Aligned(buffer+leafHeaderNoPos,children.size());
+         chainer.store(&segment,buffer);
+         Child child;
+         child.page=chainer.getPageNo();
+         child.hasSeparator=false;
+         children.push_back(child);
+         if (stored)
+            lastStr=entries[stored-1].str;
+         entries.erase(entries.begin(),entries.begin()+stored);
+      } while (!entries.empty()||!inputDone);
+      chainer.finish();
+   }
+
+   // Write the inner nodes
+   while (children.size()>1) {
+      vector<Child> parents;
+      packInner(children,parents);
+      swap(children,parents);
+   }
+
+   // Remember the index root
+   segment.stringIndexRoot=children.back().page;
+   segment.setSegmentData(slotStringIndexRoot,segment.stringIndexRoot);
+}
+//---------------------------------------------------------------------------
+void DictionarySegment::StringIndex::findLeaf(BufferReference& ref,const std::string* key)
+   // Navigate to the first leaf that can contain strings >= key
+{
+   ref=segment.readShared(segment.stringIndexRoot);
+   while (true) {
+      const unsigned char* page=static_cast<const unsigned char*>(ref.getPage());
+      if (!isInnerPage(page))
+         return;
+
+      // Take the first child whose separator is not less than the key, or the last child
+      const unsigned char* reader=page+innerHeaderSize;
+      unsigned child=0;
+      for (unsigned index=0,count=Segment::readUint32Aligned(page+16);index<count;index++) {
+         child=Segment::readUint32(reader);
+         unsigned len=(reader[4]<<8)|reader[5];
+         reader+=6;
+         if (len==noSeparator)
+            break;
+         if (key) {
+            int cmp=memcmp(reader,key->data(),min<size_t>(len,key->size()));
+            if ((cmp>0)||((cmp==0)&&(len>=key->size())))
+               break;
+         }
+         reader+=len;
+      }
+      ref=segment.readShared(child);
+   }
+}
+//---------------------------------------------------------------------------
 namespace {
 //---------------------------------------------------------------------------
 LOGACTION3(DictionarySegment,UpdateMapping,uint32_t,slot,LogData,oldValue,LogData,newValue)
@@ -211,8 +476,18 @@ DictionarySegment::HashSource::~HashSource()
 {
 }
 //---------------------------------------------------------------------------
+DictionarySegment::StringIndexSource::~StringIndexSource()
+   // Destructor
+{
+}
+//---------------------------------------------------------------------------
+DictionarySegment::StringMatcher::~StringMatcher()
+   // Destructor
+{
+}
+//---------------------------------------------------------------------------
 DictionarySegment::DictionarySegment(DatabasePartition& partition)
-   : Segment(partition),tableStart(0),nextId(0),indexRoot(0)
+   : Segment(partition),tableStart(0),nextId(0),indexRoot(0),stringIndexRoot(0),stringIndexIds(0),flags(0),cache(cacheSize),memoryIndexEntries(0),useMemoryIndex(getenv("MEMORYDICTIONARY")!=0)
    // Constructor
 {
 }
@@ -232,6 +507,9 @@ void DictionarySegment::refreshInfo()
    nextId=getSegmentData(slotNextId);
    mappings.push_back(pair<unsigned,unsigned>(getSegmentData(slotMappingStart),0));
    indexRoot=getSegmentData(slotIndexRoot);
+   stringIndexRoot=getSegmentData(slotStringIndexRoot);
+   stringIndexIds=getSegmentData(slotStringIndexIds);
+   flags=getSegmentData(slotFlags);
 }
 //---------------------------------------------------------------------------
 void DictionarySegment::refreshMapping()
@@ -252,8 +530,14 @@ void DictionarySegment::refreshMapping()
    }
 }
 //---------------------------------------------------------------------------
+// Entry layout on the raw string pages: id, hash, len|type<<24, [subType],
+// string. A prefix compressed entry has the top bit of the type set and
+// continues with the page and (ofs<<16)|len of its prefix, which is stored
+// in an earlier entry. len is then the length of the suffix only.
+static const unsigned prefixCompressed = 0x80000000;
 static inline unsigned getLiteralLen(unsigned header) { return header&0x00FFFFFF; }
-static inline unsigned getLiteralType(unsigned header) { return header>>24; }
+static inline unsigned getLiteralType(unsigned header) { return (header>>24)&0x7F; }
+static inline bool isPrefixCompressed(unsigned header) { return header&prefixCompressed; }
 //---------------------------------------------------------------------------
 bool DictionarySegment::lookupOnPage(unsigned pageNo,const string& text,::Type::ID type,unsigned subType,unsigned hash,unsigned& id)
    // Lookup an id for a given string on a certain page in the raw string table
@@ -267,33 +551,133 @@ bool DictionarySegment::lookupOnPage(unsigned pageNo,const string& text,::Type::
          break;
       unsigned header=readUint32(page+pos+8);
       unsigned len=getLiteralLen(header),currentType=getLiteralType(header);
-      if ((currentType==static_cast<unsigned>(type))&&(readUint32(page+pos+4)==hash)&&(len==text.length())) {
-         // Examine the sub-type if any
-         unsigned ofs=pos+12;
-         bool match=true;
-         if (::Type::hasSubType(static_cast< ::Type::ID>(currentType))) {
-            unsigned currentSubType=readUint32(page+ofs);
-            if (subType!=currentSubType)
-               match=false;
-            ofs+=4;
-         }
+      unsigned ofs=pos+12,prefixPage=0,prefixOfsLen=0;
+      bool match=true;
+      if (::Type::hasSubType(static_cast< ::Type::ID>(currentType))) {
+         if (readUint32(page+ofs)!=subType)
+            match=false;
+         ofs+=4;
+      }
+      if (isPrefixCompressed(header)) {
+         prefixPage=readUint32(page+ofs);
+         prefixOfsLen=readUint32(page+ofs+4);
+         ofs+=8;
+      }
+      unsigned prefixLen=prefixOfsLen&0xFFFF;
+      if ((currentType==static_cast<unsigned>(type))&&(readUint32(page+pos+4)==hash)&&(prefixLen+len==text.length())&&match) {
          // Check if the string is really identical
-         if (match&&(memcmp(page+ofs,text.c_str(),len)==0)) {
+         match=(memcmp(page+ofs,text.c_str()+prefixLen,len)==0);
+         if (match&&prefixLen) {
+            BufferReference prefixRef(readShared(prefixPage));
+            match=(memcmp(static_cast<const unsigned char*>(prefixRef.getPage())+(prefixOfsLen>>16),text.c_str(),prefixLen)==0);
+         }
+         if (match) {
             id=readUint32(page+pos);
             return true;
          }
       }
-      pos+=12+len+(::Type::hasSubType(static_cast< ::Type::ID>(currentType))?4:0);
+      pos=ofs+len;
    }
    return false;
 }
 //---------------------------------------------------------------------------
+void DictionarySegment::insertIntoMemoryIndex(unsigned hash,unsigned id)
+   // Add an entry to the in-memory index
+{
+   // Grow if needed, keeping the table at most half full
+   if (2*(memoryIndexEntries+1)>memoryIndex.size()) {
+      vector<MemoryIndexEntry> oldIndex;
+      oldIndex.swap(memoryIndex);
+      MemoryIndexEntry empty; empty.hash=0; empty.id=~0u;
+      memoryIndex.assign(oldIndex.empty()?1024:(2*oldIndex.size()),empty);
+      memoryIndexEntries=0;
+      for (vector<MemoryIndexEntry>::const_iterator iter=oldIndex.begin(),limit=oldIndex.end();iter!=limit;++iter)
+         if (~(*iter).id)
+            insertIntoMemoryIndex((*iter).hash,(*iter).id);
+   }
+
+   // Linear probing
+   unsigned mask=memoryIndex.size()-1;
+   unsigned slot=hash&mask;
+   while (~memoryIndex[slot].id)
+      slot=(slot+1)&mask;
+   memoryIndex[slot].hash=hash;
+   memoryIndex[slot].id=id;
+   ++memoryIndexEntries;
+}
+//---------------------------------------------------------------------------
+void DictionarySegment::buildMemoryIndex()
+   // Build the in-memory index from the id mapping
+{
+   refreshMapping();
+
+   // Walk the mapping pages in id order, the string pages are mostly in the same order
+   BufferReference stringRef;
+   unsigned currentPage=~0u,id=0;
+   for (vector<pair<unsigned,unsigned> >::const_iterator iter=mappings.begin(),limit=mappings.end();(iter!=limit)&&(id<nextId);++iter) {
+      for (unsigned index=0;(index<(*iter).second)&&(id<nextId);index++) {
+         BufferReference dirRef(readShared((*iter).first+index));
+         const unsigned char* dirPage=static_cast<const unsigned char*>(dirRef.getPage());
+         unsigned slot=index?0:1,slotLimit=index?entriesPerMappingPage:(entriesOnFirstMappingPage+1);
+         for (;(slot<slotLimit)&&(id<nextId);++slot,++id) {
+            unsigned pageNo=readUint32(dirPage+8+8*slot),ofs=readUint32(dirPage+8+8*slot+4)>>16;
+            if (pageNo!=currentPage)
+               stringRef=readShared(currentPage=pageNo);
+            insertIntoMemoryIndex(readUint32(static_cast<const unsigned char*>(stringRef.getPage())+ofs+4),id);
+         }
+      }
+   }
+}
+//---------------------------------------------------------------------------
+bool DictionarySegment::lookupInMemoryIndex(const string& text,::Type::ID type,unsigned subType,unsigned hash,unsigned& id)
+   // Lookup an id for a given string using the in-memory index
+{
+   memoryIndexLatch.lockShared();
+
+   // Build the index on first use
+   if (memoryIndex.empty()) {
+      memoryIndexLatch.unlock();
+      memoryIndexLatch.lockExclusive();
+      if (memoryIndex.empty())
+         buildMemoryIndex();
+      memoryIndexLatch.unlock();
+      memoryIndexLatch.lockShared();
+   }
+
+   // Check all candidates with the same hash value
+   bool found=false;
+   if (!memoryIndex.empty()) {
+      string buffer;
+      unsigned mask=memoryIndex.size()-1;
+      for (unsigned slot=hash&mask;~memoryIndex[slot].id;slot=(slot+1)&mask) {
+         if (memoryIndex[slot].hash!=hash)
+            continue;
+         const char* start,*stop; ::Type::ID currentType; unsigned currentSubType;
+         if (!lookupById(memoryIndex[slot].id,start,stop,currentType,currentSubType,buffer))
+            continue;
+         if ((currentType==type)&&((!::Type::hasSubType(type))||(currentSubType==subType))&&
+             (static_cast<unsigned>(stop-start)==text.length())&&(memcmp(start,text.c_str(),text.length())==0)) {
+            id=memoryIndex[slot].id;
+            found=true;
+            break;
+         }
+      }
+   }
+   memoryIndexLatch.unlock();
+
+   return found;
+}
+//---------------------------------------------------------------------------
 bool DictionarySegment::lookup(const string& text,::Type::ID type,unsigned subType,unsigned& id)
    // Lookup an id for a given string
 {
    // Determine the hash value
    unsigned hash=Hash::hash(text,(type<<24)^subType);
 
+   // Use the in-memory index if requested
+   if (useMemoryIndex)
+      return lookupInMemoryIndex(text,type,subType,hash,id);
+
    // Find the leaf page
    BufferReference ref;
    if (!HashIndex(*this).findLeaf(ref,HashIndex::InnerKey(hash)))
@@ -335,8 +719,8 @@ bool DictionarySegment::lookup(const string& text,::Type::ID type,unsigned subTy
    return false;
 }
 //---------------------------------------------------------------------------
-bool DictionarySegment::lookupById(unsigned id,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType)
-   // Lookup a string for a given id
+bool DictionarySegment::locateId(unsigned id,unsigned& dirPage,unsigned& dirSlot)
+   // Find the directory entry of an id
 {
    // Fill the mappings if needed
    refreshMapping();
@@ -356,7 +740,6 @@ bool DictionarySegment::lookupById(unsigned id,const char*& start,const char*& s
    }
 
    // Compute position in directory
-   unsigned dirPage,dirSlot;
    if (relId<entriesOnFirstMappingPage) {
       dirPage=mappingStart;
       dirSlot=relId+1;
@@ -364,54 +747,286 @@ bool DictionarySegment::lookupById(unsigned id,const char*& start,const char*& s
       dirPage=mappingStart+1+((relId-entriesOnFirstMappingPage)/entriesPerMappingPage);
       dirSlot=(relId-entriesOnFirstMappingPage)%entriesPerMappingPage;
    }
-
-   // Lookup the direct mapping entry
-   BufferReference ref(readShared(dirPage));
-   unsigned pageNo=readUint32(static_cast<const unsigned char*>(ref.getPage())+8+8*dirSlot);
-   unsigned ofsLen=readUint32(static_cast<const unsigned char*>(ref.getPage())+8+8*dirSlot+4);
-   unsigned ofs=ofsLen>>16,len=(ofsLen&0xFFFF);
-
-   // Now search the entry on the page itself
-   ref=readShared(pageNo);
-   const char* page=static_cast<const char*>(ref.getPage());
-
+   return true;
+}
+//---------------------------------------------------------------------------
+void DictionarySegment::decodeString(const char* page,unsigned ofs,StringLocation& location)
+   // Decode a string entry on a page of the raw string table
+{
    // Read the type info
    unsigned typeLen=readUint32(reinterpret_cast<const unsigned char*>(page+ofs+8));
-   type=static_cast< ::Type::ID>(typeLen>>24);
-   len=(typeLen&0x00FFFFFF);
+   location.type=static_cast< ::Type::ID>(getLiteralType(typeLen));
+   unsigned len=getLiteralLen(typeLen);
 
    // Has a sub type?
-   if (::Type::hasSubType(type)) {
+   if (::Type::hasSubType(location.type)) {
       ofs+=4;
-      subType=readUint32(reinterpret_cast<const unsigned char*>(page+ofs+8));
+      location.subType=readUint32(reinterpret_cast<const unsigned char*>(page+ofs+8));
    } else {
-      subType=0;
+      location.subType=0;
+   }
+
+   // Prefix compressed? Then the prefix is stored in an earlier entry
+   if (isPrefixCompressed(typeLen)) {
+      unsigned prefixPage=readUint32(reinterpret_cast<const unsigned char*>(page+ofs+12));
+      unsigned prefixOfsLen=readUint32(reinterpret_cast<const unsigned char*>(page+ofs+16));
+      BufferReference ref(readShared(prefixPage));
+      location.start=static_cast<const char*>(ref.getPage())+(prefixOfsLen>>16);
+      location.stop=location.start+(prefixOfsLen&0xFFFF);
+      location.suffixStart=page+ofs+20;
+      location.suffixStop=location.suffixStart+len;
+      return;
    }
 
    // And return the string bounds
-   start=page+ofs+12; stop=start+len;
+   location.start=page+ofs+12; location.stop=location.start+len;
+   location.suffixStart=location.suffixStop=0;
+}
+//---------------------------------------------------------------------------
+bool DictionarySegment::lookupById(unsigned id,const char*& start,const char*& stop,::Type::ID& type,unsigned& subType,string& buffer)
+   // Lookup a string for a given id
+{
+   // Recently used?
+   StringLocation location;
+   if (!cache.lookup(id,location)) {
+      // Find the directory entry
+      unsigned dirPage,dirSlot;
+      if (!locateId(id,dirPage,dirSlot))
+         return false;
+
+      // Lookup the direct mapping entry
+      BufferReference ref(readShared(dirPage));
+      unsigned pageNo=readUint32(static_cast<const unsigned char*>(ref.getPage())+8+8*dirSlot);
+      unsigned ofsLen=readUint32(static_cast<const unsigned char*>(ref.getPage())+8+8*dirSlot+4);
+
+      // Now decode the entry on the page itself
+      ref=readShared(pageNo);
+      decodeString(static_cast<const char*>(ref.getPage()),ofsLen>>16,location);
+      cache.insert(id,location);
+   }
 
+   // Assemble prefix compressed strings in the buffer
+   if (location.suffixStart) {
+      buffer.assign(location.start,location.stop);
+      buffer.append(location.suffixStart,location.suffixStop);
+      start=buffer.data(); stop=start+buffer.size();
+   } else {
+      start=location.start; stop=location.stop;
+   }
+   type=location.type; subType=location.subType;
    return true;
 }
 //---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// A pending id lookup
+struct PendingLookup {
+   /// The id
+   unsigned id;
+   /// The directory position
+   unsigned dirPage,dirSlot;
+   /// The string position
+   unsigned pageNo,ofs;
+
+   /// Order by string position
+   bool operator<(const PendingLookup& o) const { return (pageNo<o.pageNo)||((pageNo==o.pageNo)&&(ofs<o.ofs)); }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+bool DictionarySegment::lookupByIds(const unsigned* ids,unsigned count,StringInfo* result,string& buffer)
+   // Lookup the strings for many ids at once, accessing each page once
+{
+   // Eliminate duplicates
+   vector<unsigned> distinct(ids,ids+count);
+   sort(distinct.begin(),distinct.end());
+   distinct.resize(unique(distinct.begin(),distinct.end())-distinct.begin());
+
+   // Check the cache first, and locate the directory entries of the rest.
+   // Ids are in ascending order, thus directory pages are, too
+   vector<StringLocation> locations(distinct.size());
+   vector<PendingLookup> pending;
+   bool found=true;
+   for (unsigned index=0,limit=distinct.size();index<limit;index++) {
+      StringLocation& location=locations[index];
+      if (cache.lookup(distinct[index],location))
+         continue;
+      PendingLookup p;
+      p.id=distinct[index];
+      if ((~p.id)&&(locateId(p.id,p.dirPage,p.dirSlot))) {
+         pending.push_back(p);
+      } else {
+         location.start=location.stop=location.suffixStart=location.suffixStop=0; location.type=::Type::URI; location.subType=0;
+         found=false;
+      }
+   }
+
+   // Read the directory entries, fixing each directory page once
+   {
+      BufferReference ref;
+      unsigned current=~0u;
+      for (vector<PendingLookup>::iterator iter=pending.begin(),limit=pending.end();iter!=limit;++iter) {
+         if ((*iter).dirPage!=current)
+            ref=readShared(current=(*iter).dirPage);
+         const unsigned char* page=static_cast<const unsigned char*>(ref.getPage());
+         (*iter).pageNo=readUint32(page+8+8*(*iter).dirSlot);
+         (*iter).ofs=readUint32(page+8+8*(*iter).dirSlot+4)>>16;
+      }
+   }
+
+   // Decode the strings in page order, fixing each string page once
+   sort(pending.begin(),pending.end());
+   {
+      BufferReference ref;
+      unsigned current=~0u;
+      for (vector<PendingLookup>::const_iterator iter=pending.begin(),limit=pending.end();iter!=limit;++iter) {
+         if ((*iter).pageNo!=current)
+            ref=readShared(current=(*iter).pageNo);
+         StringLocation& location=locations[lower_bound(distinct.begin(),distinct.end(),(*iter).id)-distinct.begin()];
+         decodeString(static_cast<const char*>(ref.getPage()),(*iter).ofs,location);
+         cache.insert((*iter).id,location);
+      }
+   }
+
+   // Assemble the prefix compressed strings in the buffer
+   vector<unsigned> offsets(distinct.size());
+   buffer.clear();
+   for (unsigned index=0,limit=distinct.size();index<limit;index++) {
+      const StringLocation& location=locations[index];
+      if (location.suffixStart) {
+         offsets[index]=buffer.size();
+         buffer.append(location.start,location.stop);
+         buffer.append(location.suffixStart,location.suffixStop);
+      }
+   }
+   vector<StringInfo> infos(distinct.size());
+   for (unsigned index=0,limit=distinct.size();index<limit;index++) {
+      const StringLocation& location=locations[index];
+      StringInfo& info=infos[index];
+      if (location.suffixStart) {
+         info.start=buffer.data()+offsets[index];
+         info.stop=info.start+(location.stop-location.start)+(location.suffixStop-location.suffixStart);
+      } else {
+         info.start=location.start; info.stop=location.stop;
+      }
+      info.type=location.type; info.subType=location.subType;
+   }
+
+   // Produce the result in input order
+   for (unsigned index=0;index<count;index++)
+      result[index]=infos[lower_bound(distinct.begin(),distinct.end(),ids[index])-distinct.begin()];
+
+   return found;
+}
+//---------------------------------------------------------------------------
+void DictionarySegment::findMatching(StringMatcher& matcher,vector<unsigned>& ids)
+   // Find all ids whose string qualifies, in ascending order
+{
+   refreshMapping();
+
+   // Walk the mapping pages in id order, the string pages are mostly in the same order.
+   // Prefix compressed strings are expanded into a local buffer only
+   BufferReference stringRef,prefixRef;
+   unsigned currentPage=~0u,currentPrefixPage=~0u,id=0;
+   string buffer;
+   for (vector<pair<unsigned,unsigned> >::const_iterator iter=mappings.begin(),limit=mappings.end();(iter!=limit)&&(id<nextId);++iter) {
+      for (unsigned index=0;(index<(*iter).second)&&(id<nextId);index++) {
+         BufferReference dirRef(readShared((*iter).first+index));
+         const unsigned char* dirPage=static_cast<const unsigned char*>(dirRef.getPage());
+         unsigned slot=index?0:1,slotLimit=index?entriesPerMappingPage:(entriesOnFirstMappingPage+1);
+         for (;(slot<slotLimit)&&(id<nextId);++slot,++id) {
+            unsigned pageNo=readUint32(dirPage+8+8*slot),ofs=readUint32(dirPage+8+8*slot+4)>>16;
+            if (pageNo!=currentPage)
+               stringRef=readShared(currentPage=pageNo);
+            const unsigned char* page=static_cast<const unsigned char*>(stringRef.getPage());
+
+            // Decode the entry
+            unsigned header=readUint32(page+ofs+8),len=getLiteralLen(header),subType=0;
+            ::Type::ID type=static_cast< ::Type::ID>(getLiteralType(header));
+            ofs+=12;
+            if (::Type::hasSubType(type)) {
+               subType=readUint32(page+ofs);
+               ofs+=4;
+            }
+            const char* start=reinterpret_cast<const char*>(page+ofs),*stop=start+len;
+            if (isPrefixCompressed(header)) {
+               unsigned prefixPage=readUint32(page+ofs),prefixOfsLen=readUint32(page+ofs+4);
+               if (prefixPage!=currentPrefixPage)
+                  prefixRef=readShared(currentPrefixPage=prefixPage);
+               buffer.assign(static_cast<const char*>(prefixRef.getPage())+(prefixOfsLen>>16),prefixOfsLen&0xFFFF);
+               buffer.append(start+8,len);
+               start=buffer.data(); stop=start+buffer.size();
+            }
+
+            // And check it
+            if (matcher.matches(start,stop,type,subType))
+               ids.push_back(id);
+         }
+      }
+   }
+}
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// A namespace stored uncompressed in the raw string table
+struct KnownPrefix {
+   /// The namespace
+   string prefix;
+   /// Its position
+   unsigned page,ofs;
+};
+//---------------------------------------------------------------------------
+static unsigned namespaceLen(const char* data,unsigned len)
+   // Length of the namespace part of an URI (up to the last '/' or '#')
+{
+   for (unsigned index=len;index>0;--index)
+      if ((data[index-1]=='/')||(data[index-1]=='#'))
+         return index;
+   return 0;
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
 void DictionarySegment::loadStrings(StringSource& reader)
    // Load the raw strings (must be in id order)
 {
    static const unsigned pageSize = BufferReference::pageSize;
+   // Shorter namespaces are not worth the prefix reference
+   static const unsigned minPrefixLen = 12;
+   // Number of namespaces remembered for prefix compression
+   static const unsigned knownPrefixSlots = 1<<16;
 
    // Prepare the buffer
    const unsigned headerSize = 16; // LSN+next+count
    DatabaseBuilder::PageChainer chainer(8);
    unsigned char* buffer=0;
    unsigned bufferPos=headerSize,bufferCount=0;
+   vector<KnownPrefix> knownPrefixes(knownPrefixSlots);
 
    // Read the strings
    unsigned len; const char* data;
    ::Type::ID type; unsigned subType;
    unsigned id=0;
    while (reader.next(len,data,type,subType)) {
+      // Share the namespace of URIs with an earlier entry if possible
+      KnownPrefix* known=0;
+      unsigned prefixLen=0;
+      if (type==::Type::URI) {
+         unsigned nsLen=namespaceLen(data,len);
+         if ((nsLen>=minPrefixLen)&&(headerSize+12+nsLen<=pageSize)) {
+            known=&knownPrefixes[Hash::hash(data,nsLen)&(knownPrefixSlots-1)];
+            if ((known->prefix.size()==nsLen)&&(memcmp(known->prefix.data(),data,nsLen)==0))
+               prefixLen=nsLen;
+         }
+      }
+      unsigned entryLen=12+(len-prefixLen)+(::Type::hasSubType(type)?4:0)+(prefixLen?8:0);
+      if (headerSize+entryLen>pageSize) {
+         known=0; prefixLen=0;
+         entryLen=12+len+(::Type::hasSubType(type)?4:0);
+      }
+
       // Is the page full?
-      if ((bufferPos+12+len+(::Type::hasSubType(type)?4:0)>pageSize)&&(bufferCount)) {
+      if ((bufferPos+entryLen>pageSize)&&(bufferCount)) {
          for (unsigned index=bufferPos;index<pageSize;index++)
             buffer[index]=0;
          writeUint32(buffer+12,bufferCount);
@@ -419,7 +1034,7 @@ void DictionarySegment::loadStrings(StringSource& reader)
          bufferPos=headerSize; bufferCount=0;
       }
       // Check the len, handle an overlong string
-      if (bufferPos+12+len+(::Type::hasSubType(type)?4:0)>pageSize) {
+      if (bufferPos+entryLen>pageSize) {
          // Write the first page
          unsigned hash=Hash::hash(data,len,(type<<24)^subType);
          writeUint32(buffer+12,1);
@@ -471,12 +1086,20 @@ void DictionarySegment::loadStrings(StringSource& reader)
       unsigned ofs=bufferPos;
       writeUint32(buffer+bufferPos,id); bufferPos+=4;
       writeUint32(buffer+bufferPos,hash); bufferPos+=4;
-      writeUint32(buffer+bufferPos,len|(type<<24)); bufferPos+=4;
+      writeUint32(buffer+bufferPos,(len-prefixLen)|(type<<24)|(prefixLen?prefixCompressed:0)); bufferPos+=4;
       if (::Type::hasSubType(type)) {
          writeUint32(buffer+bufferPos,subType);
          bufferPos+=4;
       }
-      for (unsigned index=0;index<len;index++)
+      if (prefixLen) {
+         writeUint32(buffer+bufferPos,known->page); bufferPos+=4;
+         writeUint32(buffer+bufferPos,(known->ofs<<16)|prefixLen); bufferPos+=4;
+      } else if (known) {
+         known->prefix.assign(data,namespaceLen(data,len));
+         known->page=chainer.getPageNo();
+         known->ofs=bufferPos;
+      }
+      for (unsigned index=prefixLen;index<len;index++)
          buffer[bufferPos++]=data[index];
       ++bufferCount;
 
@@ -550,6 +1173,85 @@ void DictionarySegment::loadStringHashes(HashSource& reader)
    HashIndex(*this).performBulkload(source);
 }
 //---------------------------------------------------------------------------
+void DictionarySegment::loadStringIndex(StringIndexSource& source)
+   // Write the sorted string index
+{
+   StringIndex(*this).performBulkload(source);
+   stringIndexIds=nextId;
+   setSegmentData(slotStringIndexIds,stringIndexIds);
+}
+//---------------------------------------------------------------------------
+void DictionarySegment::setTypedDates(bool typedDates)
+   // Record how xsd:dateTime literals are stored
+{
+   if (typedDates)
+      flags|=flagTypedDates; else
+      flags&=~flagTypedDates;
+   setSegmentData(slotFlags,flags);
+}
+//---------------------------------------------------------------------------
+bool DictionarySegment::findByPrefix(const string& prefix,vector<unsigned>& ids)
+   // Find all ids whose string starts with a prefix, in ascending order
+{
+   if ((!hasStringIndex())||(prefix.size()>StringIndex::maxIndexedLen))
+      return false;
+
+   // Find the first leaf that can contain the prefix
+   StringIndex index(*this);
+   BufferReference ref;
+   index.findLeaf(ref,prefix);
+
+   // Scan until the strings are past the prefix
+   vector<StringIndex::LeafEntry> entries;
+   while (true) {
+      const unsigned char* page=static_cast<const unsigned char*>(ref.getPage());
+      StringIndex::unpackLeafEntries(entries,page);
+      for (vector<StringIndex::LeafEntry>::const_iterator iter=entries.begin(),limit=entries.end();iter!=limit;++iter) {
+         const string& str=(*iter).str;
+         int cmp=memcmp(str.data(),prefix.data(),min(str.size(),prefix.size()));
+         if ((cmp<0)||((cmp==0)&&(str.size()<prefix.size())))
+            continue;
+         if (cmp>0) {
+            sort(ids.begin(),ids.end());
+            return true;
+         }
+         ids.push_back((*iter).id);
+      }
+      unsigned next=readUint32Aligned(page+StringIndex::leafHeaderNextPos);
+      if (!next) break;
+      ref=readShared(next);
+   }
+   sort(ids.begin(),ids.end());
+   return true;
+}
+//---------------------------------------------------------------------------
+unsigned DictionarySegment::countPrefixLeaves(const string& prefix)
+   // Number of leaves of the sorted string index that findByPrefix reads for a prefix
+{
+   if ((!hasStringIndex())||(prefix.size()>StringIndex::maxIndexedLen))
+      return 0;
+
+   // The first leaf that can contain the prefix
+   StringIndex index(*this);
+   BufferReference ref;
+   index.findLeaf(ref,prefix);
+   unsigned first=StringIndex::getLeafNo(static_cast<const unsigned char*>(ref.getPage()));
+
+   // The first leaf that can contain strings past the prefix
+   string upper=prefix;
+   while ((!upper.empty())&&(static_cast<unsigned char>(upper[upper.size()-1])==0xFF))
+      upper.resize(upper.size()-1);
+   if (upper.empty()) {
+      index.findLastLeaf(ref);
+   } else {
+      upper[upper.size()-1]++;
+      index.findLeaf(ref,upper);
+   }
+   unsigned last=StringIndex::getLeafNo(static_cast<const unsigned char*>(ref.getPage()));
+
+   return last-first+1;
+}
+//---------------------------------------------------------------------------
 namespace {
 //---------------------------------------------------------------------------
 struct EntryInfo {
@@ -595,6 +1297,9 @@ void DictionarySegment::appendLiterals(const std::vector<Literal>& literals)
 {
    static const unsigned pageSize = BufferReference::pageSize;
 
+   // Pages might move, forget cached locations
+   cache.clear();
+
    // Prepare the buffer
    const unsigned headerSize = 16; // LSN+next+count
    DatabaseBuilder::PageChainer chainer(8);
@@ -752,11 +1457,11 @@ void DictionarySegment::appendLiterals(const std::vector<Literal>& literals)
             memset(newEntries,0,sizeof(newEntries));
          if (slot==1) {
             Segment::writeUint32Aligned(newEntries,0);
-            Segment::writeUint32Aligned(newEntries,len);
+            Segment::writeUint32Aligned(newEntries+4,len);
          }
          for (unsigned index2=0;index2<chunk;++index2) {
-            Segment::writeUint32Aligned(newEntries+(8*index2),info[index+index2].page);
-            Segment::writeUint32Aligned(newEntries+(8*index2)+4,info[index+index2].ofsLen);
+            Segment::writeUint32Aligned(newEntries+(8*(slot+index2)),info[index+index2].page);
+            Segment::writeUint32Aligned(newEntries+(8*(slot+index2))+4,info[index+index2].ofsLen);
          }
          UpdateMapping(0,LogData(static_cast<const unsigned char*>(ref.getPage())+8,BufferReference::pageSize-8),LogData(newEntries,BufferReference::pageSize-8)).apply(ref);
          index+=chunk;
@@ -774,6 +1479,13 @@ void DictionarySegment::appendLiterals(const std::vector<Literal>& literals)
       mappings.push_back(pair<unsigned,unsigned>(start,len));
    }
 
+   // Maintain the in-memory index if it was already built
+   memoryIndexLatch.lockExclusive();
+   if (!memoryIndex.empty())
+      for (unsigned index=0,limit=info.size();index<limit;index++)
+         insertIntoMemoryIndex(info[index].hash,oldNextId+index);
+   memoryIndexLatch.unlock();
+
    // Load hash->pos mapping
    sort(info.begin(),info.end(),SortByHash());
    EntryInfoReader reader(info.begin(),info.end());
@@ -1,4 +1,5 @@
 #include "rts/segment/PredicateSetSegment.hpp"
+#include "rts/buffer/BufferReference.hpp"
 #include "rts/database/DatabasePartition.hpp"
 #include "rts/segment/AggregatedFactsSegment.hpp"
 #include <algorithm>
@@ -6,6 +7,7 @@
 #include <set>
 #include <iostream>
 #include <fstream>
+#include <cstring>
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -18,6 +20,11 @@
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
+// Info slots
+static const unsigned slotFirstPage = 0;
+static const unsigned slotSetCount = 1;
+static const unsigned slotMaxPredicate = 2;
+//---------------------------------------------------------------------------
 /// A predicate set
 struct PredicateSetSegment::PredSet
 {
@@ -122,7 +129,7 @@ struct PredicateSetSegment::Data
 };
 //---------------------------------------------------------------------------
 PredicateSetSegment::PredicateSetSegment(DatabasePartition& partition)
-   : Segment(partition),data(new Data())
+   : Segment(partition),data(new Data()),maxPredicate(0)
    // Constructor
 {
 }
@@ -143,6 +150,33 @@ void PredicateSetSegment::refreshInfo()
    // Refresh segment info stored in the partition
 {
    Segment::refreshInfo();
+
+   // Read the serialized sets. Each page starts with the next page and the number of values
+   vector<unsigned> values;
+   for (unsigned pageNo=getSegmentData(slotFirstPage);pageNo;) {
+      BufferReference page(readShared(pageNo));
+      const unsigned char* reader=static_cast<const unsigned char*>(page.getPage());
+      pageNo=readUint32(reader);
+      unsigned count=readUint32(reader+4);
+      reader+=8;
+      for (unsigned index=0;index<count;index++,reader+=4)
+         values.push_back(readUint32(reader));
+   }
+
+   // And reconstruct the sets
+   data->predSets.clear();
+   data->predSets.resize(getSegmentData(slotSetCount));
+   vector<unsigned>::const_iterator reader=values.begin();
+   for (vector<PredSet>::iterator iter=data->predSets.begin(),limit=data->predSets.end();iter!=limit;++iter) {
+      (*iter).subjects=*(reader++);
+      (*iter).predicates.resize(*(reader++));
+      for (vector<PredSet::Entry>::iterator iter2=(*iter).predicates.begin(),limit2=(*iter).predicates.end();iter2!=limit2;++iter2) {
+         (*iter2).predicate=*(reader++);
+         (*iter2).count=*(reader++);
+      }
+   }
+   maxPredicate=getSegmentData(slotMaxPredicate);
+   computeMasks();
 }
 //---------------------------------------------------------------------------
 #if 1
@@ -288,43 +322,99 @@ void PredicateSetSegment::computePredicateSets()
    for (vector<PredSet>::const_iterator iter=data->predSets.begin(),limit=data->predSets.end();iter!=limit;++iter)
       if ((!(*iter).predicates.empty())&&((*iter).predicates.back().predicate>maxPredicate))
          maxPredicate=(*iter).predicates.back().predicate;
+   computeMasks();
+}
+//---------------------------------------------------------------------------
+void PredicateSetSegment::computeMasks()
+   // Compute the filter masks
+{
+   if (!maxPredicate)
+      return;
    for (vector<PredSet>::iterator iter=data->predSets.begin(),limit=data->predSets.end();iter!=limit;++iter) {
       unsigned long long mask1=0,mask2=0;
       for (vector<PredSet::Entry>::const_iterator iter2=(*iter).predicates.begin(),limit2=(*iter).predicates.end();iter2!=limit2;++iter2) {
          static const unsigned bitsPerMask=sizeof(unsigned long long)*8;
          unsigned p=(*iter2).predicate;
-         mask1=mask1|(1ul<<(p%bitsPerMask));
+         mask1=mask1|(1ull<<(p%bitsPerMask));
          unsigned slot=(p*bitsPerMask)/maxPredicate;
          if (slot>=bitsPerMask)
             slot=bitsPerMask-1;
-         mask2=mask2|(1ul<<slot);
+         mask2=mask2|(1ull<<slot);
       }
       (*iter).mask1=mask1;
       (*iter).mask2=mask2;
    }
 }
 //---------------------------------------------------------------------------
-void PredicateSetSegment::getStarCardinality(const vector<unsigned>& predicates,unsigned& distinctSubjects,double& cardinality)
+void PredicateSetSegment::storePredicateSets()
+   // Write the predicate sets into the partition
+{
+   // Serialize the sets
+   vector<unsigned> values;
+   for (vector<PredSet>::const_iterator iter=data->predSets.begin(),limit=data->predSets.end();iter!=limit;++iter) {
+      values.push_back((*iter).subjects);
+      values.push_back((*iter).predicates.size());
+      for (vector<PredSet::Entry>::const_iterator iter2=(*iter).predicates.begin(),limit2=(*iter).predicates.end();iter2!=limit2;++iter2) {
+         values.push_back((*iter2).predicate);
+         values.push_back((*iter2).count);
+      }
+   }
+
+   // Write them into a chain of pages
+   static const unsigned valuesPerPage=(BufferReference::pageSize-8)/4;
+   unsigned firstPage=0;
+   if (!values.empty()) {
+      BufferReferenceModified page,nextPage;
+      allocPage(page);
+      firstPage=page.getPageNo();
+      for (unsigned pos=0;;) {
+         unsigned char* writer=static_cast<unsigned char*>(page.getPage());
+         unsigned count=min(valuesPerPage,static_cast<unsigned>(values.size())-pos);
+         memset(writer,0,BufferReference::pageSize);
+         writeUint32(writer+4,count);
+         for (unsigned index=0;index<count;index++)
+            writeUint32(writer+8+4*index,values[pos+index]);
+         pos+=count;
+         if (pos==values.size()) {
+            page.unfixWithoutRecovery();
+            break;
+         }
+         allocPage(nextPage);
+         writeUint32(writer,nextPage.getPageNo());
+         page.unfixWithoutRecovery();
+         page.swap(nextPage);
+      }
+   }
+
+   setSegmentData(slotFirstPage,firstPage);
+   setSegmentData(slotSetCount,data->predSets.size());
+   setSegmentData(slotMaxPredicate,maxPredicate);
+}
+//---------------------------------------------------------------------------
+bool PredicateSetSegment::getStarCardinality(const vector<unsigned>& predicates,unsigned& distinctSubjects,double& cardinality) const
    // Estimate the cardinality of a star join
 {
+   distinctSubjects=0;
+   cardinality=0;
+   if (!maxPredicate)
+      return false;
+
    // Produce the predicate counts
    map<unsigned,unsigned> counts;
    unsigned long long mask1=0,mask2=0;
    for (vector<unsigned>::const_iterator iter=predicates.begin(),limit=predicates.end();iter!=limit;++iter) {
       static const unsigned bitsPerMask=sizeof(unsigned long long)*8;
       unsigned p=(*iter);
-      mask1=mask1|(1ul<<(p%bitsPerMask));
+      mask1=mask1|(1ull<<(p%bitsPerMask));
       unsigned slot=(p*bitsPerMask)/maxPredicate;
       if (slot>=bitsPerMask)
          slot=bitsPerMask-1;
-      mask2=mask2|(1ul<<slot);
+      mask2=mask2|(1ull<<slot);
 
       counts[p]++;
    }
 
    // Find all supersets
-   distinctSubjects=0;
-   cardinality=0;
    for (vector<PredSet>::const_iterator iter=data->predSets.begin(),limit=data->predSets.end();iter!=limit;++iter) {
       if ((((*iter).mask1&mask1)!=mask1)||(((*iter).mask2&mask2)!=mask2))
          continue;
@@ -382,7 +472,9 @@ void PredicateSetSegment::getStarCardinality(const vector<unsigned>& predicates,
          if ((!distinctSubjects)||((*iter).subjects<distinctSubjects))
             distinctSubjects=(*iter).subjects;
       cardinality=distinctSubjects;
+      return false;
    }
+   return true;
 }
 //---------------------------------------------------------------------------
 void PredicateSetSegment::getStatistics(unsigned& count,unsigned& entries,unsigned& size) const
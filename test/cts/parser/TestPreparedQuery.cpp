@@ -0,0 +1,118 @@
+#include "cts/parser/PreparedQuery.hpp"
+#include "cts/parser/SPARQLParser.hpp"
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+static bool accepts(const PreparedQuery& query,const string& value)
+   // Is a value accepted for the placeholder %v?
+{
+   PreparedQuery::Bindings bindings;
+   bindings["v"]=value;
+   try {
+      query.instantiate(bindings);
+   } catch (const SPARQLParser::ParserException&) {
+      return false;
+   }
+   return true;
+}
+//---------------------------------------------------------------------------
+TEST(PreparedQuery,Substitution)
+   // Test placeholder collection and substitution
+{
+   PreparedQuery query("select ?x where { ?x <http://p> %o . ?x <http://q> %s . ?x <http://r> %o }");
+   ASSERT_EQ(2u,query.getParameters().size());
+   EXPECT_EQ("o",query.getParameters()[0]);
+   EXPECT_EQ("s",query.getParameters()[1]);
+
+   PreparedQuery::Bindings bindings;
+   bindings["o"]="\"a b\"@en";
+   bindings["s"]="<http://x>";
+   EXPECT_EQ("select ?x where { ?x <http://p>  \"a b\"@en  . ?x <http://q>  <http://x>  . ?x <http://r>  \"a b\"@en  }",query.instantiate(bindings));
+
+   // Every placeholder needs a value
+   bindings.erase("s");
+   EXPECT_THROW(query.instantiate(bindings),SPARQLParser::ParserException);
+
+   // Bindings as given by the embedded interface
+   bindings.clear();
+   PreparedQuery::parseBindings("%o=\"a b\"^^<http://t> %s=-5",bindings);
+   ASSERT_EQ(2u,bindings.size());
+   EXPECT_EQ("\"a b\"^^<http://t>",bindings["o"]);
+   EXPECT_EQ("-5",bindings["s"]);
+   EXPECT_THROW(PreparedQuery::parseBindings("%o <http://x>",bindings),SPARQLParser::ParserException);
+   EXPECT_THROW(PreparedQuery::parseBindings("%o=",bindings),SPARQLParser::ParserException);
+}
+//---------------------------------------------------------------------------
+TEST(PreparedQuery,Values)
+   // Test that only single constants are accepted
+{
+   PreparedQuery query("select ?x where { ?x <http://p> %v }");
+
+   // Valid constants
+   EXPECT_TRUE(accepts(query,"<http://x>"));
+   EXPECT_TRUE(accepts(query,"ex:name"));
+   EXPECT_TRUE(accepts(query,":name"));
+   EXPECT_TRUE(accepts(query,"42"));
+   EXPECT_TRUE(accepts(query,"-42"));
+   EXPECT_TRUE(accepts(query,"+42"));
+   EXPECT_TRUE(accepts(query,"\"x\""));
+   EXPECT_TRUE(accepts(query,"\"x\"@en"));
+   EXPECT_TRUE(accepts(query,"\"x\"^^<http://t>"));
+   EXPECT_TRUE(accepts(query," <http://x> "));
+
+   // Anything else
+   EXPECT_FALSE(accepts(query,""));
+   EXPECT_FALSE(accepts(query,"?y"));
+   EXPECT_FALSE(accepts(query,"<http://x> <http://y>"));
+   EXPECT_FALSE(accepts(query,"<http://x> . ?x ?p ?o"));
+   EXPECT_FALSE(accepts(query,"<http://x> } union { ?x ?p ?o"));
+   EXPECT_FALSE(accepts(query,"\"x\" \"y\""));
+   EXPECT_FALSE(accepts(query,"\"x\"@"));
+   EXPECT_FALSE(accepts(query,"\"x\"^^ex:type"));
+   EXPECT_FALSE(accepts(query,"@en"));
+   EXPECT_FALSE(accepts(query,"^^<http://t>"));
+   EXPECT_FALSE(accepts(query,"ex:"));
+   EXPECT_FALSE(accepts(query,"ex"));
+   EXPECT_FALSE(accepts(query,"ex:a:b"));
+   EXPECT_FALSE(accepts(query,"-"));
+   EXPECT_FALSE(accepts(query,"1 2"));
+   EXPECT_FALSE(accepts(query,"- <http://x>"));
+   EXPECT_FALSE(accepts(query,"%v"));
+}
+//---------------------------------------------------------------------------
+TEST(PreparedQuery,Key)
+   // Test that the key identifies the template, not its text or values
+{
+   PreparedQuery a("select ?x where { ?x <http://p> %v }");
+   PreparedQuery b("select ?x   where {\n  ?x <http://p> %v\n}");
+   PreparedQuery c("select ?x where { ?x <http://p> %w }");
+   PreparedQuery d("select ?x where { ?x <http://q> %v }");
+   EXPECT_EQ(a.getKey(),b.getKey());
+   EXPECT_NE(a.getKey(),c.getKey());
+   EXPECT_NE(a.getKey(),d.getKey());
+   EXPECT_EQ(a.getKey(),PreparedQuery::normalize("select ?x where { ?x <http://p> %v }"));
+
+   // Instantiations differ from the template and from each other
+   PreparedQuery::Bindings b1,b2;
+   b1["v"]="<http://x>";
+   b2["v"]="<http://y>";
+   string q1=PreparedQuery::normalize(a.instantiate(b1)),q2=PreparedQuery::normalize(a.instantiate(b2));
+   EXPECT_EQ("select ?x where { ?x <http://p> <http://x> }",q1);
+   EXPECT_NE(q1,q2);
+   EXPECT_NE(a.getKey(),q1);
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
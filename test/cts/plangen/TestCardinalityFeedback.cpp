@@ -0,0 +1,145 @@
+#include "cts/plangen/CardinalityFeedback.hpp"
+#include "rts/database/Database.hpp"
+#include "rts/database/DatabaseBuilder.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+class TestCardinalityFeedback : public testing::Test {
+   protected:
+   /// Destructor
+   ~TestCardinalityFeedback();
+};
+//---------------------------------------------------------------------------
+static const char tempFileName[]="feedbacktest.tmp";
+static const char feedbackFileName[]="feedbacktest.feedback";
+//---------------------------------------------------------------------------
+TestCardinalityFeedback::~TestCardinalityFeedback()
+   // Destructor
+{
+   remove(tempFileName);
+   remove(feedbackFileName);
+}
+//---------------------------------------------------------------------------
+/// Facts for the builder, the same triples (i,i,i) in every order
+class TestFactsReader : public DatabaseBuilder::FactsReader
+{
+   public:
+   /// The number of triples
+   unsigned count;
+   /// The position
+   unsigned pos;
+
+   /// Constructor
+   TestFactsReader(unsigned count) : count(count),pos(0) {}
+
+   /// Load a new fact
+   bool next(unsigned& v1,unsigned& v2,unsigned& v3) { if (pos>=count) return false; v1=v2=v3=pos++; return true; }
+   /// Reset the reader
+   void reset() { pos=0; }
+};
+//---------------------------------------------------------------------------
+static void buildDatabase(unsigned count)
+   // Build a database with the given number of triples
+{
+   DatabaseBuilder builder(tempFileName);
+   for (unsigned order=0;order<6;order++) {
+      TestFactsReader reader(count);
+      builder.loadFacts(order,reader);
+   }
+   builder.close();
+}
+//---------------------------------------------------------------------------
+static bool exists(const char* fileName)
+   // Does a file exist?
+{
+   ifstream in(fileName);
+   return in.is_open();
+}
+//---------------------------------------------------------------------------
+TEST_F(TestCardinalityFeedback,RoundTrip)
+   // Test recording, lookup, and storing and loading the observations
+{
+   remove(tempFileName);
+   remove(feedbackFileName);
+   buildDatabase(100);
+   Database db;
+   ASSERT_TRUE(db.open(tempFileName));
+
+   CardinalityFeedback feedback;
+   EXPECT_FALSE(feedback.load(db,feedbackFileName));
+   EXPECT_EQ(0u,feedback.getSize());
+
+   // Record and look up
+   double card;
+   EXPECT_FALSE(feedback.lookup("1 ?0 ?1 . ?1 2 ?2",card));
+   unsigned version=feedback.getVersion();
+   feedback.record("1 ?0 ?1 . ?1 2 ?2",10,1234567);
+   EXPECT_NE(version,feedback.getVersion());
+   ASSERT_TRUE(feedback.lookup("1 ?0 ?1 . ?1 2 ?2",card));
+   EXPECT_EQ(1234567,card);
+
+   // Small changes keep the version, large ones do not
+   version=feedback.getVersion();
+   feedback.record("1 ?0 ?1 . ?1 2 ?2",10,1500000);
+   EXPECT_EQ(version,feedback.getVersion());
+   feedback.record("1 ?0 ?1 . ?1 2 ?2",10,5000000);
+   EXPECT_NE(version,feedback.getVersion());
+
+   // Batches are only written when complete
+   feedback.clear();
+   ASSERT_TRUE(feedback.storeChanges(feedbackFileName,1));
+   EXPECT_TRUE(exists(feedbackFileName));
+   remove(feedbackFileName);
+   feedback.record("1 ?0 ?1 . ?1 2 ?2",10,1234567);
+   ASSERT_TRUE(feedback.storeChanges(feedbackFileName,2));
+   EXPECT_FALSE(exists(feedbackFileName));
+   feedback.record("?0 3 ?1 . ?1 ?2 ?0",20,0.5);
+   ASSERT_TRUE(feedback.storeChanges(feedbackFileName,2));
+
+   // Load the observations again
+   {
+      CardinalityFeedback loaded;
+      ASSERT_TRUE(loaded.load(db,feedbackFileName));
+      EXPECT_EQ(2u,loaded.getSize());
+      ASSERT_TRUE(loaded.lookup("1 ?0 ?1 . ?1 2 ?2",card));
+      EXPECT_EQ(1234567,card);
+      ASSERT_TRUE(loaded.lookup("?0 3 ?1 . ?1 ?2 ?0",card));
+      EXPECT_EQ(0.5,card);
+      EXPECT_FALSE(loaded.lookup("?0 3 ?1",card));
+
+      // Nothing changed, nothing to write
+      remove(feedbackFileName);
+      ASSERT_TRUE(loaded.storeChanges(feedbackFileName,1));
+      EXPECT_FALSE(exists(feedbackFileName));
+      ASSERT_TRUE(feedback.store(feedbackFileName));
+   }
+   db.close();
+
+   // Observations of another database are dropped
+   remove(tempFileName);
+   buildDatabase(200);
+   ASSERT_TRUE(db.open(tempFileName));
+   {
+      CardinalityFeedback loaded;
+      EXPECT_TRUE(loaded.load(db,feedbackFileName));
+      EXPECT_EQ(0u,loaded.getSize());
+   }
+   db.close();
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,54 @@
+#include "cts/plangen/Costs.hpp"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+static const char tempFileName[]="coststest.tmp";
+//---------------------------------------------------------------------------
+static bool loadProfile(const char* content,Costs::Profile& profile)
+   // Load a profile with the given content
+{
+   {
+      ofstream out(tempFileName);
+      out << content;
+   }
+   bool result=profile.load(tempFileName);
+   remove(tempFileName);
+   return result;
+}
+//---------------------------------------------------------------------------
+TEST(Costs,LoadProfile)
+   // Test reading a cost profile
+{
+   Costs::Profile profile,defaults;
+   ASSERT_TRUE(profile.store(tempFileName));
+   EXPECT_TRUE(profile.load(tempFileName));
+   remove(tempFileName);
+
+   EXPECT_TRUE(loadProfile("# comment\nseek 50\nhashBuild 0.5\n",profile));
+   EXPECT_EQ(50,profile.seekCosts);
+   EXPECT_EQ(0.5,profile.hashBuild);
+   EXPECT_EQ(defaults.scanCosts,profile.scanCosts);
+
+   // Unknown keys and unusable values are rejected
+   EXPECT_FALSE(loadProfile("seeks 50\n",profile));
+   EXPECT_FALSE(loadProfile("scan 0\n",profile));
+   EXPECT_FALSE(loadProfile("hashProbe -1\n",profile));
+   EXPECT_FALSE(loadProfile("cpuSpeed fast\n",profile));
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
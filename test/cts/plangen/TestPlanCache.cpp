@@ -0,0 +1,62 @@
+#include "cts/plangen/PlanCache.hpp"
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+TEST(PlanCache,Replan)
+   // Test when a cached plan is rebuilt for other constants
+{
+   vector<unsigned> planned,current;
+   planned.push_back(100); planned.push_back(0);
+   current=planned;
+   EXPECT_FALSE(PlanCache::deviates(planned,current,10));
+
+   // Within the factor in both directions
+   current[0]=1000;
+   EXPECT_FALSE(PlanCache::deviates(planned,current,10));
+   current[0]=10;
+   EXPECT_FALSE(PlanCache::deviates(planned,current,10));
+
+   // Beyond it
+   current[0]=1001;
+   EXPECT_TRUE(PlanCache::deviates(planned,current,10));
+   current[0]=9;
+   EXPECT_TRUE(PlanCache::deviates(planned,current,10));
+
+   // Empty patterns count as one tuple
+   current[0]=100;
+   current[1]=10;
+   EXPECT_FALSE(PlanCache::deviates(planned,current,10));
+   current[1]=11;
+   EXPECT_TRUE(PlanCache::deviates(planned,current,10));
+
+   // A factor of 0 disables re-planning
+   current[0]=1000000;
+   EXPECT_FALSE(PlanCache::deviates(planned,current,0));
+}
+//---------------------------------------------------------------------------
+TEST(PlanCache,Empty)
+   // Test a new cache
+{
+   PlanCache cache;
+   EXPECT_EQ(0u,cache.getSize());
+   EXPECT_EQ(0u,cache.getHits());
+   EXPECT_EQ(0u,cache.getMisses());
+   EXPECT_EQ(0u,cache.getReplans());
+   cache.clear();
+   EXPECT_EQ(0u,cache.getSize());
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,57 @@
+#include "infra/util/IdSet.hpp"
+#include <gtest/gtest.h>
+#include <set>
+#include <cstdlib>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+TEST(IdSet,BasicFunctionality)
+   // Test membership, bounds, and iteration for sparse and dense ranges
+{
+   std::vector<unsigned> ids;
+   std::set<unsigned> reference;
+   srand(42);
+   for (unsigned index=0;index<15000;index++) {
+      // A dense range, a sparse range, and a few large ids
+      unsigned id;
+      switch (index%3) {
+         case 0: id=70000+index; break;
+         case 1: id=rand()%1000000; break;
+         default: id=4000000000u+(rand()%100); break;
+      }
+      ids.push_back(id);
+      reference.insert(id);
+   }
+   IdSet set(ids);
+
+   EXPECT_EQ(reference.size(),set.size());
+   EXPECT_EQ(*reference.begin(),set.getMin());
+   EXPECT_EQ(*reference.rbegin(),set.getMax());
+   for (unsigned id=60000;id<90000;id++)
+      EXPECT_EQ(reference.count(id)!=0,set.contains(id));
+   EXPECT_FALSE(set.contains(~0u));
+
+   IdSet::Iterator iter(set);
+   std::set<unsigned>::const_iterator expected=reference.begin();
+   for (unsigned id;iter.next(id);++expected) {
+      ASSERT_TRUE(expected!=reference.end());
+      EXPECT_EQ(*expected,id);
+   }
+   EXPECT_TRUE(expected==reference.end());
+
+   set.clear();
+   EXPECT_TRUE(set.empty());
+   EXPECT_FALSE(set.contains(70000));
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
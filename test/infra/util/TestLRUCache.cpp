@@ -0,0 +1,61 @@
+#include "infra/util/LRUCache.hpp"
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+TEST(LRUCache,BasicFunctionality)
+   // Test lookup, update, and statistics
+{
+   LRUCache<unsigned> cache(1000);
+   unsigned value=0;
+   EXPECT_FALSE(cache.lookup(1,value));
+   cache.insert(1,10);
+   ASSERT_TRUE(cache.lookup(1,value));
+   EXPECT_EQ(10u,value);
+   cache.insert(1,11);
+   ASSERT_TRUE(cache.lookup(1,value));
+   EXPECT_EQ(11u,value);
+   EXPECT_EQ(2u,cache.getHits());
+   EXPECT_EQ(1u,cache.getMisses());
+
+   cache.clear();
+   EXPECT_FALSE(cache.lookup(1,value));
+}
+//---------------------------------------------------------------------------
+TEST(LRUCache,Eviction)
+   // Test that the size is bounded and recently used entries survive
+{
+   LRUCache<unsigned> cache(64);
+   unsigned value;
+
+   // Keep key 0 hot while inserting many other keys
+   cache.insert(0,0);
+   for (unsigned index=1;index<10000;index++) {
+      ASSERT_TRUE(cache.lookup(0,value));
+      cache.insert(index,index);
+   }
+   EXPECT_TRUE(cache.lookup(0,value));
+   EXPECT_TRUE(cache.lookup(9999,value));
+   EXPECT_EQ(9999u,value);
+
+   // Old entries must be gone
+   unsigned found=0;
+   for (unsigned index=1;index<10000;index++)
+      if (cache.lookup(index,value)) {
+         EXPECT_EQ(index,value);
+         ++found;
+      }
+   EXPECT_LE(found,64u);
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
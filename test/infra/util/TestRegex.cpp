@@ -0,0 +1,101 @@
+#include "infra/util/Regex.hpp"
+#include <gtest/gtest.h>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+static bool match(const char* pattern,const std::string& text,unsigned flags=0)
+   // Compile and match
+{
+   Regex regex;
+   if (!regex.compile(pattern,flags))
+      return false;
+   return regex.matches(text);
+}
+//---------------------------------------------------------------------------
+TEST(Regex,Syntax)
+   // Test the supported constructs
+{
+   EXPECT_TRUE(match("abc","xxabcxx"));
+   EXPECT_FALSE(match("abc","xxabxcx"));
+   EXPECT_TRUE(match("a.c","abc"));
+   EXPECT_TRUE(match("a.c","a\xc3\xa4""c"));
+   EXPECT_FALSE(match("a.c","a\nc"));
+   EXPECT_TRUE(match("a.c","a\nc",Regex::DotAll));
+   EXPECT_TRUE(match("^ab*c$","abbbc"));
+   EXPECT_FALSE(match("^ab*c$","xabbbc"));
+   EXPECT_FALSE(match("^ab+c$","ac"));
+   EXPECT_TRUE(match("colou?r","color"));
+   EXPECT_TRUE(match("(foo|bar)baz","xbarbaz"));
+   EXPECT_FALSE(match("(foo|bar)baz","xbazbar"));
+   EXPECT_TRUE(match("^[a-c]{2,3}$","cab"));
+   EXPECT_FALSE(match("^[a-c]{2,3}$","cabc"));
+   EXPECT_TRUE(match("^[^0-9]+$","abc"));
+   EXPECT_FALSE(match("^[^0-9]+$","ab1"));
+   EXPECT_TRUE(match("\\d+\\.\\d+","pi is 3.14"));
+   EXPECT_FALSE(match("\\d+\\.\\d+","pi is 3,14"));
+   EXPECT_TRUE(match("ABC","xabcx",Regex::CaseInsensitive));
+   EXPECT_FALSE(match("ABC","xabcx"));
+   EXPECT_TRUE(match("^b","a\nb",Regex::MultiLine));
+   EXPECT_FALSE(match("^b","a\nb"));
+   EXPECT_TRUE(match("a$","a\nb",Regex::MultiLine));
+   EXPECT_TRUE(match("a b c","abc",Regex::Extended));
+   EXPECT_TRUE(match("","anything"));
+   EXPECT_TRUE(match("x*",""));
+
+   Regex regex;
+   EXPECT_FALSE(regex.compile("(abc",0));
+   EXPECT_FALSE(regex.compile("a{2",0));
+   EXPECT_FALSE(regex.compile("*a",0));
+}
+//---------------------------------------------------------------------------
+TEST(Regex,Anchors)
+   // Test zero-width anchor sequences, an empty position can be start and end of a line at once
+{
+   EXPECT_TRUE(match("$^",""));
+   EXPECT_TRUE(match("^$",""));
+   EXPECT_TRUE(match("$^^$",""));
+   EXPECT_TRUE(match("a|$^",""));
+   EXPECT_TRUE(match("(a$|$)^",""));
+   EXPECT_FALSE(match("$^","a"));
+   EXPECT_FALSE(match("x$^","x"));
+   EXPECT_FALSE(match("$^x","x"));
+   EXPECT_TRUE(match("$^","a\n\nb",Regex::MultiLine));
+   EXPECT_TRUE(match("$^","a\n",Regex::MultiLine));
+   EXPECT_TRUE(match("\n$^\n","a\n\nb",Regex::MultiLine));
+   EXPECT_FALSE(match("$^","a\nb",Regex::MultiLine));
+   EXPECT_FALSE(match("a$^","a\n\nb",Regex::MultiLine));
+   EXPECT_FALSE(match("$^","a\n\nb"));
+}
+//---------------------------------------------------------------------------
+TEST(Regex,LargeAutomaton)
+   // Test patterns whose DFA would be too large
+{
+   EXPECT_TRUE(match("(a|b)*a(a|b){16}c","xbab"+std::string(15,'b')+"c"));
+   EXPECT_FALSE(match("(a|b)*a(a|b){16}c","xbbbbbbbbbbbbbbbbbbbc"));
+}
+//---------------------------------------------------------------------------
+TEST(Regex,Cache)
+   // Test that compiled patterns are shared
+{
+   const Regex* r1=Regex::acquire("ab+c","i");
+   const Regex* r2=Regex::acquire("ab+c","i");
+   ASSERT_TRUE(r1!=0);
+   EXPECT_EQ(r1,r2);
+   EXPECT_TRUE(r1->matches(std::string("xABBCx")));
+   EXPECT_TRUE(Regex::acquire("ab+c","q")==0);
+   EXPECT_TRUE(Regex::acquire("ab(c","")==0);
+   Regex::release(r1);
+   Regex::release(r2);
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
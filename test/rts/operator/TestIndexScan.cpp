@@ -0,0 +1,237 @@
+#include "rts/operator/Exchange.hpp"
+#include "rts/operator/IndexScan.hpp"
+#include "rts/operator/Scheduler.hpp"
+#include "rts/database/Database.hpp"
+#include "rts/database/DatabaseBuilder.hpp"
+#include "rts/runtime/Runtime.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+class TestIndexScan : public testing::Test {
+   protected:
+   /// Destructor
+   ~TestIndexScan();
+};
+//---------------------------------------------------------------------------
+static const char tempFileName[]="indexscantest.tmp";
+/// The largest id used in the test data
+static const unsigned maxId=1500;
+/// The positions of subject, predicate and object within the sort key of each order
+static const unsigned orderSlots[6][3]={{0,1,2},{0,2,1},{2,1,0},{2,0,1},{1,0,2},{1,2,0}};
+//---------------------------------------------------------------------------
+TestIndexScan::~TestIndexScan()
+   // Destructor
+{
+   remove(tempFileName);
+}
+//---------------------------------------------------------------------------
+/// A triple
+struct Triple {
+   /// The values (subject,predicate,object)
+   unsigned value[3];
+
+   /// Comparison
+   bool operator==(const Triple& t) const { return (value[0]==t.value[0])&&(value[1]==t.value[1])&&(value[2]==t.value[2]); }
+};
+//---------------------------------------------------------------------------
+/// Order triples by the sort key of an order
+class OrderTriples {
+   private:
+   /// The slots
+   const unsigned* slots;
+
+   public:
+   /// Constructor
+   OrderTriples(unsigned order) : slots(orderSlots[order]) {}
+
+   /// Compare
+   bool operator()(const Triple& a,const Triple& b) const {
+      for (unsigned index=0;index<3;index++)
+         if (a.value[slots[index]]!=b.value[slots[index]])
+            return a.value[slots[index]]<b.value[slots[index]];
+      return false;
+   }
+};
+//---------------------------------------------------------------------------
+/// Facts for the builder
+class TestFactsReader : public DatabaseBuilder::FactsReader
+{
+   public:
+   /// The triples in the order of the index
+   vector<Triple> triples;
+   /// The slots of the order
+   const unsigned* slots;
+   /// The position
+   unsigned pos;
+
+   /// Constructor
+   TestFactsReader(unsigned order) : slots(orderSlots[order]),pos(0) {}
+
+   /// Load a new fact, the values are in the order of the index
+   bool next(unsigned& v1,unsigned& v2,unsigned& v3) { if (pos>=triples.size()) return false; v1=triples[pos].value[slots[0]]; v2=triples[pos].value[slots[1]]; v3=triples[pos].value[slots[2]]; ++pos; return true; }
+   /// Reset the reader
+   void reset() { pos=0; }
+};
+//---------------------------------------------------------------------------
+static vector<Triple> buildFacts()
+   // Build a database with skewed facts, returns the facts
+{
+   vector<Triple> triples;
+   for (unsigned index=0;index<20000;index++) {
+      Triple t;
+      t.value[0]=((index*index)/7919)%maxId;
+      t.value[1]=index%7;
+      t.value[2]=(index*104729u)%maxId;
+      triples.push_back(t);
+   }
+   sort(triples.begin(),triples.end(),OrderTriples(0));
+   triples.erase(unique(triples.begin(),triples.end()),triples.end());
+
+   DatabaseBuilder builder(tempFileName);
+   for (unsigned order=0;order<6;order++) {
+      TestFactsReader reader(order);
+      reader.triples=triples;
+      sort(reader.triples.begin(),reader.triples.end(),OrderTriples(order));
+      builder.loadFacts(order,reader);
+   }
+   builder.close();
+   return triples;
+}
+//---------------------------------------------------------------------------
+static void collect(Operator* op,Register* regs,vector<Triple>& result)
+   // Collect the output of an operator
+{
+   for (unsigned count=op->first();count;count=op->next()) {
+      Triple t;
+      for (unsigned index=0;index<3;index++)
+         t.value[index]=regs[index].value;
+      for (unsigned index=0;index<count;index++)
+         result.push_back(t);
+   }
+}
+//---------------------------------------------------------------------------
+static IndexScan* createScan(Database& db,unsigned order,Runtime& runtime,unsigned bound,const Triple& constants)
+   // Create a scan, bound is a bit mask of the bound values in the order of the index
+{
+   Register* regs[3];
+   bool isBound[3];
+   for (unsigned index=0;index<3;index++) {
+      regs[index]=runtime.getRegister(index);
+      isBound[index]=false;
+   }
+   for (unsigned index=0;index<3;index++)
+      if (bound&(4>>index)) {
+         unsigned slot=orderSlots[order][index];
+         isBound[slot]=true;
+         regs[slot]->value=constants.value[slot];
+      }
+   return IndexScan::create(db,static_cast<Database::DataOrder>(order),regs[0],isBound[0],regs[1],isBound[1],regs[2],isBound[2],0);
+}
+//---------------------------------------------------------------------------
+TEST_F(TestIndexScan,RestrictRange)
+   // The partitions of a range restricted scan add up to the serial scan
+{
+   remove(tempFileName);
+   vector<Triple> triples=buildFacts();
+   Database db;
+   ASSERT_TRUE(db.open(tempFileName));
+
+   // All scan variants that have an unbound value, in all orders
+   static const unsigned patterns[]={0,1,2,3,4,5,6};
+   const unsigned partitionCount=5;
+   for (unsigned order=0;order<6;order++) {
+      for (unsigned index=0;index<(sizeof(patterns)/sizeof(patterns[0]));index++) {
+         unsigned bound=patterns[index];
+         const Triple& constants=triples[(triples.size()*(index+1))/9];
+
+         Runtime runtime(db);
+         runtime.allocateRegisters(3);
+         vector<Triple> serial;
+         IndexScan* scan=createScan(db,order,runtime,bound,constants);
+         collect(scan,runtime.getRegister(0),serial);
+         delete scan;
+         EXPECT_FALSE(serial.empty()) << order << " " << bound;
+
+         vector<Triple> partitioned;
+         for (unsigned partition=0;partition<partitionCount;partition++) {
+            scan=createScan(db,order,runtime,bound,constants);
+            unsigned high=(partition+1<partitionCount)?((maxId*(partition+1))/partitionCount):~0u;
+            scan->restrictRange((maxId*partition)/partitionCount,high);
+            collect(scan,runtime.getRegister(0),partitioned);
+            delete scan;
+         }
+         EXPECT_TRUE(serial==partitioned) << order << " " << bound << ": " << serial.size() << " vs. " << partitioned.size();
+      }
+   }
+
+   db.close();
+   remove(tempFileName);
+}
+//---------------------------------------------------------------------------
+TEST_F(TestIndexScan,Exchange)
+   // An exchange over range partitions produces the serial scan, also when restarted
+{
+   remove(tempFileName);
+   vector<Triple> triples=buildFacts();
+   Database db;
+   ASSERT_TRUE(db.open(tempFileName));
+   setenv("MAXTHREADS","4",1);
+
+   {
+      const unsigned threads=3,partitionCount=Exchange::partitionsPerThread*threads;
+      vector<Exchange::Partition> partitions;
+      Triple constants=triples.front();
+      for (unsigned partition=0;partition<partitionCount;partition++) {
+         Exchange::Partition p;
+         p.runtime=new Runtime(db);
+         p.runtime->allocateRegisters(3);
+         IndexScan* scan=createScan(db,Database::Order_Object_Predicate_Subject,*p.runtime,0,constants);
+         unsigned high=(partition+1<partitionCount)?((maxId*(partition+1))/partitionCount):~0u;
+         scan->restrictRange((maxId*partition)/partitionCount,high);
+         p.input=scan;
+         for (unsigned index=0;index<3;index++)
+            p.registers.push_back(p.runtime->getRegister(index));
+         partitions.push_back(p);
+      }
+      Exchange exchange(partitions,partitions.front().registers,threads,0);
+      Register* output=partitions.front().runtime->getRegister(0);
+
+      sort(triples.begin(),triples.end(),OrderTriples(Database::Order_Object_Predicate_Subject));
+      for (unsigned run=0;run<2;run++) {
+         vector<Triple> result;
+         collect(&exchange,output,result);
+         EXPECT_TRUE(triples==result) << run << ": " << triples.size() << " vs. " << result.size();
+
+         // The helper threads are given back
+         EXPECT_EQ(3u,Scheduler::borrowThreads(3));
+         Scheduler::returnThreads(3);
+      }
+
+      // Restart before the end
+      EXPECT_EQ(1u,exchange.first());
+      vector<Triple> result;
+      collect(&exchange,output,result);
+      EXPECT_TRUE(triples==result);
+   }
+   unsetenv("MAXTHREADS");
+   db.close();
+   remove(tempFileName);
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
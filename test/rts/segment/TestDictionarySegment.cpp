@@ -0,0 +1,277 @@
+#include "rts/segment/DictionarySegment.hpp"
+#include "rts/database/Database.hpp"
+#include "rts/database/DatabaseBuilder.hpp"
+#include "infra/osdep/Event.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include "infra/osdep/Thread.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+class TestDictionarySegment : public testing::Test {
+   protected:
+   /// Destructor
+   ~TestDictionarySegment();
+};
+//---------------------------------------------------------------------------
+static const char tempFileName[]="dictionarytest.tmp";
+//---------------------------------------------------------------------------
+TestDictionarySegment::~TestDictionarySegment()
+   // Destructor
+{
+   remove(tempFileName);
+}
+//---------------------------------------------------------------------------
+static string literal(unsigned index)
+   // The string of a test literal
+{
+   ostringstream s; s << "literal" << index;
+   return s.str();
+}
+//---------------------------------------------------------------------------
+/// Strings for the builder
+class TestStringsReader : public DatabaseBuilder::StringsReader
+{
+   public:
+   /// The strings
+   vector<string> strings;
+   /// The remembered infos (hash,page,ofs)
+   vector<pair<unsigned,pair<unsigned,unsigned> > > infos;
+
+   /// Load a new string
+   bool next(unsigned& len,const char*& data,Type::ID& type,unsigned& subType);
+   /// Remember a string position and hash
+   void rememberInfo(unsigned page,unsigned ofs,unsigned hash) { infos.push_back(pair<unsigned,pair<unsigned,unsigned> >(hash,pair<unsigned,unsigned>(page,ofs))); }
+};
+//---------------------------------------------------------------------------
+bool TestStringsReader::next(unsigned& len,const char*& data,Type::ID& type,unsigned& subType)
+   // Load a new string
+{
+   if (infos.size()>=strings.size())
+      return false;
+   const string& s=strings[infos.size()];
+   len=s.size(); data=s.c_str(); type=Type::Literal; subType=0;
+   return true;
+}
+//---------------------------------------------------------------------------
+/// Pairs for the builder
+class TestInfoReader : public DatabaseBuilder::StringInfoReader
+{
+   public:
+   /// The pairs
+   vector<pair<unsigned,unsigned> > pairs;
+   /// The position
+   unsigned pos;
+
+   /// Constructor
+   TestInfoReader() : pos(0) {}
+
+   /// Load a new data item
+   bool next(unsigned& v1,unsigned& v2) { if (pos>=pairs.size()) return false; v1=pairs[pos].first; v2=pairs[pos].second; ++pos; return true; }
+};
+//---------------------------------------------------------------------------
+/// Sorted strings for the builder
+class TestStringIndexReader : public DatabaseBuilder::StringIndexReader
+{
+   public:
+   /// The string/id pairs
+   vector<pair<string,unsigned> > entries;
+   /// The position
+   unsigned pos;
+
+   /// Constructor
+   TestStringIndexReader() : pos(0) {}
+
+   /// Load a new entry
+   bool next(unsigned& len,const char*& data,unsigned& id) { if (pos>=entries.size()) return false; len=entries[pos].first.size(); data=entries[pos].first.data(); id=entries[pos].second; ++pos; return true; }
+};
+//---------------------------------------------------------------------------
+static void buildDictionary(const vector<string>& literals,bool stringIndex)
+   // Build a database with the given literals
+{
+   DatabaseBuilder builder(tempFileName);
+   TestStringsReader strings;
+   strings.strings=literals;
+   builder.loadStrings(strings);
+
+   TestInfoReader mappings;
+   for (unsigned index=0;index<literals.size();index++)
+      mappings.pairs.push_back(strings.infos[index].second);
+   builder.loadStringMappings(mappings);
+
+   sort(strings.infos.begin(),strings.infos.end());
+   TestInfoReader hashes;
+   for (unsigned index=0;index<literals.size();index++)
+      hashes.pairs.push_back(pair<unsigned,unsigned>(strings.infos[index].first,strings.infos[index].second.first));
+   builder.loadStringHashes(hashes);
+
+   if (stringIndex) {
+      TestStringIndexReader index;
+      for (unsigned id=0;id<literals.size();id++)
+         index.entries.push_back(pair<string,unsigned>(literals[id],id));
+      sort(index.entries.begin(),index.entries.end());
+      builder.loadStringIndex(index);
+   }
+   builder.close();
+}
+//---------------------------------------------------------------------------
+/// Lookups running in parallel
+struct ParallelLookups {
+   /// The dictionary
+   DictionarySegment* dict;
+   /// The number of literals
+   unsigned count;
+   /// Number of wrong answers
+   unsigned errors;
+   /// Number of running threads
+   unsigned running;
+   /// Lock
+   Mutex lock;
+   /// Notification when a thread is done
+   Event done;
+};
+//---------------------------------------------------------------------------
+static void lookupAll(void* data)
+   // Lookup all literals
+{
+   ParallelLookups& job=*static_cast<ParallelLookups*>(data);
+   unsigned errors=0;
+   for (unsigned index=0;index<job.count;index++) {
+      unsigned id;
+      if ((!job.dict->lookup(literal(index),Type::Literal,0,id))||(id!=index))
+         ++errors;
+   }
+
+   auto_lock lock(job.lock);
+   job.errors+=errors;
+   --job.running;
+   job.done.notifyAll(job.lock);
+}
+//---------------------------------------------------------------------------
+TEST_F(TestDictionarySegment,MemoryIndex)
+   // Test lookups with the in-memory index, in parallel and after growing the dictionary
+{
+   // Remove the file if it exists
+   remove(tempFileName);
+
+   // Create a new database with a dictionary
+   vector<string> literals;
+   for (unsigned index=0;index<1000;index++)
+      literals.push_back(literal(index));
+   buildDictionary(literals,false);
+   Database db;
+   ASSERT_TRUE(db.open(tempFileName));
+   DictionarySegment* dict=&db.getDictionary();
+   dict->enableMemoryIndex();
+
+   // Lookup from several threads, the first lookups build the index
+   ParallelLookups job;
+   job.dict=dict; job.count=1000; job.errors=0; job.running=0;
+   for (unsigned index=0;index<4;index++) {
+      auto_lock lock(job.lock);
+      ++job.running;
+      if (!Thread::start(lookupAll,&job))
+         --job.running;
+   }
+   {
+      auto_lock lock(job.lock);
+      while (job.running)
+         job.done.wait(job.lock);
+   }
+   EXPECT_EQ(0u,job.errors);
+
+   // Grow the dictionary, the index has to follow
+   vector<DictionarySegment::Literal> newLiterals;
+   for (unsigned index=1000;index<5000;index++) {
+      DictionarySegment::Literal l;
+      l.str=literal(index); l.type=Type::Literal; l.subType=0;
+      newLiterals.push_back(l);
+   }
+   dict->appendLiterals(newLiterals);
+   job.count=5000; job.running=1;
+   lookupAll(&job);
+   EXPECT_EQ(0u,job.errors);
+
+   // Unknown strings
+   unsigned id;
+   EXPECT_FALSE(dict->lookup("literal5000",Type::Literal,0,id));
+   EXPECT_FALSE(dict->lookup("literal1",Type::CustomLanguage,1,id));
+
+   // Cleanup
+   db.close();
+   remove(tempFileName);
+}
+//---------------------------------------------------------------------------
+static vector<unsigned> matchPrefix(const vector<string>& literals,const string& prefix)
+   // Find all literals with a given prefix
+{
+   vector<unsigned> result;
+   for (unsigned index=0;index<literals.size();index++)
+      if (literals[index].compare(0,prefix.size(),prefix)==0)
+         result.push_back(index);
+   return result;
+}
+//---------------------------------------------------------------------------
+TEST_F(TestDictionarySegment,StringIndex)
+   // Test prefix searches with the sorted string index
+{
+   // Remove the file if it exists
+   remove(tempFileName);
+
+   // Strings with long common prefixes and some duplicates, enough for several inner levels
+   vector<string> literals;
+   for (unsigned index=0;index<60000;index++) {
+      ostringstream s; s << "/" << (index/4);
+      literals.push_back(string(600,'a'+(index%4))+s.str());
+   }
+   literals.push_back(""); literals.push_back("");
+   literals.push_back(literals[100]);
+   buildDictionary(literals,true);
+   Database db;
+   ASSERT_TRUE(db.open(tempFileName));
+   DictionarySegment& dict=db.getDictionary();
+   ASSERT_TRUE(dict.hasStringIndex());
+
+   // Compare prefix searches with a scan
+   const char* suffixes[]={"","/","/1","/123","/14999","/15000","/9"};
+   for (unsigned group=0;group<5;group++)
+      for (unsigned index=0;index<(sizeof(suffixes)/sizeof(suffixes[0]));index++) {
+         string prefix=string(600,'a'+group)+suffixes[index];
+         vector<unsigned> ids;
+         ASSERT_TRUE(dict.findByPrefix(prefix,ids));
+         EXPECT_TRUE(ids==matchPrefix(literals,prefix)) << prefix.substr(599);
+      }
+   vector<unsigned> ids;
+   ASSERT_TRUE(dict.findByPrefix("",ids));
+   EXPECT_EQ(literals.size(),ids.size());
+   ids.clear();
+   ASSERT_TRUE(dict.findByPrefix(string(601,'a'),ids));
+   EXPECT_TRUE(ids.empty());
+
+   // The separators are exact, a narrow prefix touches only few leaves
+   unsigned allLeaves=dict.countPrefixLeaves("");
+   EXPECT_GT(allLeaves,20u);
+   EXPECT_LE(dict.countPrefixLeaves(string(600,'b')+"/123"),2u);
+   EXPECT_LE(dict.countPrefixLeaves(string(600,'c')),(allLeaves/4)+2);
+
+   // Cleanup
+   db.close();
+   remove(tempFileName);
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
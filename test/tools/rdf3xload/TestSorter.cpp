@@ -0,0 +1,132 @@
+#include "../../../tools/rdf3xload/Sorter.hpp"
+#include "../../../tools/rdf3xload/TempFile.hpp"
+#include "infra/osdep/MemoryMappedFile.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+static const char tempBaseName[]="sortertest";
+/// The key columns of the sort orders
+static const unsigned orderColumns[6][3]={{0,1,2},{0,2,1},{1,0,2},{1,2,0},{2,0,1},{2,1,0}};
+//---------------------------------------------------------------------------
+/// A triple
+struct Triple {
+   /// The values
+   uint64_t value[3];
+
+   /// Comparison
+   bool operator==(const Triple& t) const { return (value[0]==t.value[0])&&(value[1]==t.value[1])&&(value[2]==t.value[2]); }
+};
+//---------------------------------------------------------------------------
+/// Order triples by the key columns of an order
+class OrderTriples {
+   private:
+   /// The columns
+   const unsigned* columns;
+
+   public:
+   /// Constructor
+   OrderTriples(unsigned order) : columns(orderColumns[order]) {}
+
+   /// Compare
+   bool operator()(const Triple& a,const Triple& b) const {
+      for (unsigned index=0;index<3;index++)
+         if (a.value[columns[index]]!=b.value[columns[index]])
+            return a.value[columns[index]]<b.value[columns[index]];
+      return false;
+   }
+};
+//---------------------------------------------------------------------------
+static vector<Triple> buildTriples(unsigned count)
+   // Build skewed triples with duplicates and ids of varying length
+{
+   vector<Triple> triples;
+   for (unsigned index=0;index<count;index++) {
+      Triple t;
+      t.value[0]=((static_cast<uint64_t>(index)*index)/7919)%1500;
+      t.value[1]=index%7;
+      t.value[2]=(static_cast<uint64_t>(index%(count/2+1))*104729u)<<(index%40);
+      triples.push_back(t);
+   }
+   return triples;
+}
+//---------------------------------------------------------------------------
+static vector<Triple> sortTriples(const vector<Triple>& triples,unsigned order,bool eliminateDuplicates)
+   // Sort triples with the sorter
+{
+   TempFile in(tempBaseName),out(tempBaseName);
+   for (vector<Triple>::const_iterator iter=triples.begin(),limit=triples.end();iter!=limit;++iter) {
+      in.writeId((*iter).value[0]);
+      in.writeId((*iter).value[1]);
+      in.writeId((*iter).value[2]);
+   }
+   Sorter::sortTriples(in,out,static_cast<Sorter::Order>(order),eliminateDuplicates);
+
+   vector<Triple> result;
+   MemoryMappedFile mappedOut;
+   if (!mappedOut.open(out.getFile().c_str()))
+      return result;
+   for (const char* reader=mappedOut.getBegin(),*limit=mappedOut.getEnd();reader<limit;) {
+      Triple t;
+      reader=TempFile::readId(TempFile::readId(TempFile::readId(reader,t.value[0]),t.value[1]),t.value[2]);
+      result.push_back(t);
+   }
+   return result;
+}
+//---------------------------------------------------------------------------
+static void checkOrders(const vector<Triple>& triples)
+   // Compare the sorter with std::sort in all orders
+{
+   for (unsigned order=0;order<6;order++) {
+      vector<Triple> expected=triples;
+      stable_sort(expected.begin(),expected.end(),OrderTriples(order));
+      EXPECT_TRUE(sortTriples(triples,order,false)==expected) << order;
+
+      expected.erase(unique(expected.begin(),expected.end()),expected.end());
+      EXPECT_TRUE(sortTriples(triples,order,true)==expected) << order;
+   }
+}
+//---------------------------------------------------------------------------
+TEST(Sorter,Empty)
+   // Sort an empty input
+{
+   vector<Triple> triples;
+   for (unsigned order=0;order<6;order++) {
+      EXPECT_TRUE(sortTriples(triples,order,false).empty());
+      EXPECT_TRUE(sortTriples(triples,order,true).empty());
+   }
+}
+//---------------------------------------------------------------------------
+TEST(Sorter,InMemory)
+   // Sort triples that fit into memory, with multiple runs sorted in parallel
+{
+   setenv("MAXTHREADS","4",1);
+   checkOrders(buildTriples(100));
+   checkOrders(buildTriples(100000));
+   unsetenv("MAXTHREADS");
+}
+//---------------------------------------------------------------------------
+TEST(Sorter,Spilled)
+   // Sort triples that are spilled to disk in many runs
+{
+   setenv("SORTMEMORY","0.01",1);
+   checkOrders(buildTriples(5000));
+   unsetenv("SORTMEMORY");
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
@@ -416,6 +416,7 @@ bool buildDatabaseStatistics(DatabaseBuilder& builder,const char* targetName)
    tmpName+=".tmp";
    builder.computeExactStatistics(tmpName.c_str());
    remove(tmpName.c_str());
+   builder.computePredicateSets();
 
    return true;
 }
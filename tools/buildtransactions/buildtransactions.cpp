@@ -22,8 +22,8 @@ static void dumpEntry(DictionarySegment& dict,unsigned id)
    cout << id << ' ';
 
    const char* start,*stop;
-   Type::ID type; unsigned subType;
-   if (dict.lookupById(id,start,stop,type,subType)) {
+   Type::ID type; unsigned subType; string buffer;
+   if (dict.lookupById(id,start,stop,type,subType,buffer)) {
       for (;start!=stop;++start)
          cout << *start;
    }
@@ -65,7 +65,9 @@ static void evalQuery(Database& db,const string& query,bool silent)
          return;
       }
       if (queryGraph.knownEmpty()) {
-         cout << "<empty result>" << endl;
+         if ((queryGraph.getDuplicateHandling()==QueryGraph::CountDuplicates)&&(queryGraph.projectionBegin()==queryGraph.projectionEnd()))
+            cout << " 0" << endl; else
+            cout << "<empty result>" << endl;
          return;
       }
    }
@@ -77,6 +79,7 @@ static void evalQuery(Database& db,const string& query,bool silent)
       cout << "plan generation failed" << endl;
       return;
    }
+   cout << "Planning time: " << plangen.getPlanningTime() << " ms" << (plangen.usedGreedy()?" (greedy)":"") << endl;
    if (getenv("SHOWCOSTS"))
       plan->print(0);
    if (getenv("DISABLESKIPPING"))
@@ -39,8 +39,8 @@ static bool contains(const vector<unsigned>& allNodes,unsigned id)
 static string lookupId(Database& db,unsigned id)
    // Lookup a string id
 {
-   const char* start=0,*stop=0; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,stop,type,subType);
+   const char* start=0,*stop=0; Type::ID type; unsigned subType; string buffer;
+   db.getDictionary().lookupById(id,start,stop,type,subType,buffer);
    return string(start,stop);
 }
 //---------------------------------------------------------------------------
@@ -258,16 +258,16 @@ static vector<unsigned> buildChain(unsigned from,const vector<unsigned>& fromIds
 static string lookupURL(Database& db,unsigned id)
    // Lookup a URL
 {
-   const char* start=0,*end=start; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,end,type,subType);
+   const char* start=0,*end=start; Type::ID type; unsigned subType; string buffer;
+   db.getDictionary().lookupById(id,start,end,type,subType,buffer);
    return "<"+string(start,end)+">";
 }
 //---------------------------------------------------------------------------
 static string lookupLiteral(Database& db,unsigned id)
    // Lookup a literal value
 {
-   const char* start=0,*end=start; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,end,type,subType);
+   const char* start=0,*end=start; Type::ID type; unsigned subType; string buffer;
+   db.getDictionary().lookupById(id,start,end,type,subType,buffer);
 
    if (type==Type::URI)
       return "<"+string(start,end)+">"; else
@@ -24,8 +24,8 @@ using namespace std;
 static void lookupById(Database& db,unsigned id)
    // Lookup a string id
 {
-   const char* start=0,*stop=0; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,stop,type,subType);
+   const char* start=0,*stop=0; Type::ID type; unsigned subType; string buffer;
+   db.getDictionary().lookupById(id,start,stop,type,subType,buffer);
    cerr<<"name: "<< string(start,stop)<<", type: " <<type<<", subType: "<<subType<<endl;
 }
 //---------------------------------------------------------------------------
@@ -164,8 +164,8 @@ static void expandConstants(Database& db,const vector<string>& terms,vector<vect
          if (!~v) {
             break;
          } else {
-            const char* start,*stop; Type::ID type; unsigned subType;
-            if (!db.getDictionary().lookupById(v,start,stop,type,subType))
+            const char* start,*stop; Type::ID type; unsigned subType; string buffer;
+            if (!db.getDictionary().lookupById(v,start,stop,type,subType,buffer))
                break;
             switch (type) {
                case Type::URI: values.push_back("<"+escapeURI(start,stop)+">"); break;
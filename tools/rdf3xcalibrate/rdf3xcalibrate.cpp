@@ -0,0 +1,275 @@
+#include "cts/plangen/Costs.hpp"
+#include "infra/osdep/Timestamp.hpp"
+#include "rts/database/Database.hpp"
+#include "rts/operator/Checkpoint.hpp"
+#include "rts/operator/Exchange.hpp"
+#include "rts/operator/HashJoin.hpp"
+#include "rts/operator/MergeJoin.hpp"
+#include "rts/operator/Scheduler.hpp"
+#include "rts/runtime/Runtime.hpp"
+#include "rts/segment/DictionarySegment.hpp"
+#include "rts/segment/FactsSegment.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// The minimum duration of warm measurements in ms
+static const unsigned minDuration = 200;
+/// The number of random lookups
+static const unsigned lookups = 1000;
+/// The number of tuples per join input
+static const unsigned joinSize = 1<<20;
+//---------------------------------------------------------------------------
+static bool dropCache(const char* fileName)
+   // Remove a file from the OS cache
+{
+#if defined(__linux__)&&defined(POSIX_FADV_DONTNEED)
+   int fd=open(fileName,O_RDONLY);
+   if (fd<0)
+      return false;
+   bool result=!posix_fadvise(fd,0,0,POSIX_FADV_DONTNEED);
+   close(fd);
+   return result;
+#else
+   return false;
+#endif
+}
+//---------------------------------------------------------------------------
+static double toCosts(unsigned ms)
+   // Convert ms into cost units (1/10ms). Used for measurements that are too short otherwise
+{
+   return 10.0*(ms?ms:1);
+}
+//---------------------------------------------------------------------------
+static void measured(double& cost,double value)
+   // Store a measured cost, keeps the default if the measurement was too small to be usable
+{
+   if (value>0)
+      cost=value;
+}
+//---------------------------------------------------------------------------
+static unsigned scanFacts(Database& db)
+   // Scan a complete facts table
+{
+   unsigned count=0;
+   FactsSegment::Scan scan;
+   if (scan.first(db.getFacts(Database::Order_Subject_Predicate_Object)))
+      do { count++; } while (scan.next());
+   return count;
+}
+//---------------------------------------------------------------------------
+static void lookupFacts(Database& db,unsigned count,unsigned seed)
+   // Perform random lookups
+{
+   unsigned ids=db.getDictionary().getNextId();
+   if (!ids) ids=1;
+   srand(seed);
+   for (unsigned index=0;index<count;index++) {
+      FactsSegment::Scan scan;
+      scan.first(db.getFacts(Database::Order_Subject_Predicate_Object),static_cast<unsigned>(rand())%ids,0,0);
+   }
+}
+//---------------------------------------------------------------------------
+static void buildInput(vector<unsigned>& tuples,unsigned size,unsigned step)
+   // Build a sorted join input, value and count per tuple
+{
+   tuples.clear();
+   for (unsigned index=0;index<size;index++) {
+      tuples.push_back(index*step);
+      tuples.push_back(1);
+   }
+}
+//---------------------------------------------------------------------------
+static unsigned runJoin(Runtime& runtime,bool hash,const vector<unsigned>& left,const vector<unsigned>& right)
+   // Run a join between two inputs, returns the time in ms
+{
+   vector<Register*> leftRegs,rightRegs,tail;
+   leftRegs.push_back(runtime.getRegister(0));
+   rightRegs.push_back(runtime.getRegister(1));
+   Operator* leftInput=new Checkpoint(left,leftRegs,left.size()/2);
+   Operator* rightInput=new Checkpoint(right,rightRegs,right.size()/2);
+   Operator* join;
+   if (hash)
+      join=new HashJoin(leftInput,leftRegs[0],tail,rightInput,rightRegs[0],tail,0,0,1); else
+      join=new MergeJoin(leftInput,leftRegs[0],tail,rightInput,rightRegs[0],tail,1);
+
+   Timestamp start;
+   if (join->first())
+      while (join->next()) ;
+   unsigned result=Timestamp()-start;
+   delete join;
+   return result;
+}
+//---------------------------------------------------------------------------
+static unsigned runExchange(Database& db,const vector<unsigned>& input,unsigned threads)
+   // Compute an input in partitions, returns the time in ms
+{
+   unsigned partitionCount=Exchange::partitionsPerThread*threads;
+   vector<Exchange::Partition> partitions;
+   for (unsigned index=0;index<partitionCount;index++) {
+      Exchange::Partition partition;
+      partition.runtime=new Runtime(db);
+      partition.runtime->allocateRegisters(1);
+      partition.registers.push_back(partition.runtime->getRegister(0));
+      partition.input=new Checkpoint(input,partition.registers,input.size()/2);
+      partitions.push_back(partition);
+   }
+   Operator* exchange=new Exchange(partitions,partitions.front().registers,threads,partitionCount*input.size()/2);
+
+   Timestamp start;
+   if (exchange->first())
+      while (exchange->next()) ;
+   delete exchange;
+   return Timestamp()-start;
+}
+//---------------------------------------------------------------------------
+int main(int argc,char* argv[])
+{
+   // Check the arguments
+   bool warm=false;
+   if ((argc>1)&&(!strcmp(argv[1],"--warm"))) {
+      warm=true;
+      --argc; ++argv;
+   }
+   if (argc!=3) {
+      cerr << "usage: " << argv[0] << " [--warm] <database> <profile>" << endl
+           << "measures the cost constants of the plan generator on this machine. Use the profile by setting COSTPROFILE" << endl;
+      return 1;
+   }
+   const char* dbFile=argv[1];
+
+   // Cold accesses
+   bool cold=dropCache(dbFile);
+   if (!cold)
+      cerr << "warning: unable to drop " << dbFile << " from the OS cache, cold measurements will be too low" << endl;
+   Database db;
+   if (!db.open(dbFile,true)) {
+      cerr << "unable to open database " << dbFile << endl;
+      return 1;
+   }
+   unsigned pages=db.getFacts(Database::Order_Subject_Predicate_Object).getPages();
+   if (!pages) pages=1;
+   double coldSeek,coldScan;
+   {
+      Timestamp start;
+      lookupFacts(db,lookups,1);
+      coldSeek=toCosts(Timestamp()-start)/lookups/3;
+   }
+   db.close();
+   dropCache(dbFile);
+   if (!db.open(dbFile,true)) {
+      cerr << "unable to open database " << dbFile << endl;
+      return 1;
+   }
+   {
+      Timestamp start;
+      scanFacts(db);
+      coldScan=toCosts(Timestamp()-start)/pages;
+   }
+
+   // Warm accesses
+   double warmSeek,warmScan;
+   {
+      unsigned runs=0,duration;
+      Timestamp start;
+      do {
+         lookupFacts(db,lookups,1);
+         runs++;
+      } while ((duration=Timestamp()-start)<minDuration);
+      warmSeek=toCosts(duration)/(static_cast<double>(runs)*lookups)/3;
+   }
+   {
+      unsigned runs=0,duration;
+      Timestamp start;
+      do {
+         scanFacts(db);
+         runs++;
+      } while ((duration=Timestamp()-start)<minDuration);
+      warmScan=toCosts(duration)/(static_cast<double>(runs)*pages);
+   }
+
+   // Join costs per tuple, the best of three runs
+   Runtime runtime(db);
+   runtime.allocateRegisters(2);
+   vector<unsigned> large1,large2,small1,small2;
+   buildInput(large1,joinSize,2);
+   buildInput(large2,joinSize,3);
+   buildInput(small1,1000,2);
+   buildInput(small2,1000,3);
+   unsigned merge=~0u,build=~0u,probe=~0u;
+   for (unsigned run=0;run<3;run++) {
+      merge=min(merge,runJoin(runtime,false,large1,large2));
+      build=min(build,runJoin(runtime,true,large1,small2));
+      probe=min(probe,runJoin(runtime,true,small1,large2));
+   }
+   double setup;
+   {
+      unsigned runs=0,duration;
+      Timestamp start;
+      do {
+         runJoin(runtime,true,small1,small2);
+         runs++;
+      } while ((duration=Timestamp()-start)<minDuration);
+      setup=toCosts(duration)/runs;
+   }
+
+   // Fixed costs of a parallel evaluation, using the threads given by MAXTHREADS
+   double exchangeSetup;
+   {
+      unsigned threads=Scheduler::getMaxThreads();
+      if (!threads) threads=1;
+      vector<unsigned> empty;
+      unsigned runs=0,duration;
+      Timestamp start;
+      do {
+         runExchange(db,empty,threads);
+         runs++;
+      } while ((duration=Timestamp()-start)<minDuration);
+      exchangeSetup=toCosts(duration)/runs;
+   }
+
+   // Build the profile
+   Costs::Profile profile;
+   measured(profile.seekCosts,warm?warmSeek:coldSeek);
+   measured(profile.scanCosts,warm?warmScan:coldScan);
+   measured(profile.cpuSpeed,(2.0*joinSize)/toCosts(merge));
+   measured(profile.hashSetup,setup);
+   measured(profile.hashBuild,(toCosts(build)-setup)/joinSize);
+   measured(profile.hashProbe,(toCosts(probe)-setup)/joinSize);
+   measured(profile.exchangeSetup,exchangeSetup);
+   if (!profile.store(argv[2])) {
+      cerr << "unable to write " << argv[2] << endl;
+      return 1;
+   }
+
+   // Report the measurements, in 1/10ms like the cost model
+   Costs::Profile defaults;
+   cout << "                   default     measured" << endl
+        << "seek (cold)        " << defaults.seekCosts << "\t" << coldSeek << endl
+        << "seek (warm)        " << defaults.seekCosts << "\t" << warmSeek << endl
+        << "scan/page (cold)   " << defaults.scanCosts << "\t" << coldScan << endl
+        << "scan/page (warm)   " << defaults.scanCosts << "\t" << warmScan << endl
+        << "merge tuples/unit  " << defaults.cpuSpeed << "\t" << profile.cpuSpeed << endl
+        << "hash setup         " << defaults.hashSetup << "\t" << profile.hashSetup << endl
+        << "hash build/tuple   " << defaults.hashBuild << "\t" << profile.hashBuild << endl
+        << "hash probe/tuple   " << defaults.hashProbe << "\t" << profile.hashProbe << endl
+        << "exchange setup     " << defaults.exchangeSetup << "\t" << profile.exchangeSetup << endl
+        << "wrote " << (warm?"warm":"cold") << " profile to " << argv[2] << endl;
+}
+//---------------------------------------------------------------------------
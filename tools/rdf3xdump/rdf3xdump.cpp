@@ -54,8 +54,8 @@ static void writeLiteral(const char* start,const char* stop)
 static void dumpSubject(DictionarySegment& dic,unsigned id)
    // Write a subject entry
 {
-   const char* start,*stop; Type::ID type; unsigned subType;
-   if (!dic.lookupById(id,start,stop,type,subType)) {
+   const char* start,*stop; Type::ID type; unsigned subType; string buffer;
+   if (!dic.lookupById(id,start,stop,type,subType,buffer)) {
       cerr << "consistency error: encountered unknown id " << id << endl;
       throw;
    }
@@ -67,8 +67,8 @@ static void dumpSubject(DictionarySegment& dic,unsigned id)
 static void dumpPredicate(DictionarySegment& dic,unsigned id)
    // Write a predicate entry
 {
-   const char* start,*stop; Type::ID type; unsigned subType;
-   if (!dic.lookupById(id,start,stop,type,subType)) {
+   const char* start,*stop; Type::ID type; unsigned subType; string buffer;
+   if (!dic.lookupById(id,start,stop,type,subType,buffer)) {
       cerr << "consistency error: encountered unknown id " << id << endl;
       throw;
    }
@@ -80,8 +80,8 @@ static void dumpPredicate(DictionarySegment& dic,unsigned id)
 static void dumpObject(DictionarySegment& dic,unsigned id)
    // Write an object entry
 {
-   const char* start,*stop; Type::ID type; unsigned subType;
-   if (!dic.lookupById(id,start,stop,type,subType)) {
+   const char* start,*stop; Type::ID type; unsigned subType; string buffer;
+   if (!dic.lookupById(id,start,stop,type,subType,buffer)) {
       cerr << "consistency error: encountered unknown id " << id << endl;
       throw;
    }
@@ -89,8 +89,8 @@ static void dumpObject(DictionarySegment& dic,unsigned id)
       case Type::URI: writeURI(start,stop); break;
       case Type::Literal: writeLiteral(start,stop); break;
       case Type::CustomLanguage: {
-         const char* start2,*stop2; Type::ID type2; unsigned subType2;
-         if (!dic.lookupById(subType,start2,stop2,type2,subType2)) {
+         const char* start2,*stop2; Type::ID type2; unsigned subType2; string buffer2;
+         if (!dic.lookupById(subType,start2,stop2,type2,subType2,buffer2)) {
             cerr << "consistency error: encountered unknown language " << subType << endl;
             throw;
          }
@@ -100,8 +100,8 @@ static void dumpObject(DictionarySegment& dic,unsigned id)
             cout << (*iter);
          } break;
       case Type::CustomType: {
-         const char* start2,*stop2; Type::ID type2; unsigned subType2;
-         if (!dic.lookupById(subType,start2,stop2,type2,subType2)) {
+         const char* start2,*stop2; Type::ID type2; unsigned subType2; string buffer2;
+         if (!dic.lookupById(subType,start2,stop2,type2,subType2,buffer2)) {
             cerr << "consistency error: encountered unknown type " << subType << endl;
             throw;
          }
@@ -161,9 +161,9 @@ int main(int argc,char* argv[])
       }
       // Dump the strings
       {
-         const char* start,*stop; Type::ID type; unsigned subType;
+         const char* start,*stop; Type::ID type; unsigned subType; string buffer;
          DictionarySegment& dic=db.getDictionary();
-         for (unsigned id=0;(id<=maxId)&&dic.lookupById(id,start,stop,type,subType);++id) {
+         for (unsigned id=0;(id<=maxId)&&dic.lookupById(id,start,stop,type,subType,buffer);++id) {
             cerr << id << " " << type << " " << subType << " ";
 	    for (const char* iter=start;iter!=stop;++iter) {
 	       char c=*iter;
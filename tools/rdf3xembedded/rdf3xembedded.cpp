@@ -1,8 +1,11 @@
 #include "cts/codegen/CodeGen.hpp"
 #include "cts/infra/QueryGraph.hpp"
+#include "cts/parser/PreparedQuery.hpp"
 #include "cts/parser/SPARQLLexer.hpp"
 #include "cts/parser/SPARQLParser.hpp"
 #include "cts/parser/TurtleParser.hpp"
+#include "cts/plangen/CardinalityFeedback.hpp"
+#include "cts/plangen/PlanCache.hpp"
 #include "cts/plangen/PlanGen.hpp"
 #include "cts/semana/SemanticAnalysis.hpp"
 #include "infra/osdep/Timestamp.hpp"
@@ -19,6 +22,7 @@
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
+#include <map>
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -39,8 +43,15 @@ bool smallAddressSpace()
 //---------------------------------------------------------------------------
 namespace {
 //---------------------------------------------------------------------------
+/// The observed cardinalities (if enabled)
+static CardinalityFeedback* feedback = 0;
+/// The file storing the observed cardinalities
+static const char* feedbackFile = 0;
+/// The number of changed estimates that are written together
+static const unsigned feedbackBatch = 16;
+//---------------------------------------------------------------------------
 /// Query types
-enum QueryType { RegularQuery, ExplainQuery, InsertQuery, RollbackQuery, UnknownQueryType };
+enum QueryType { RegularQuery, ExplainQuery, InsertQuery, RollbackQuery, PrepareQuery, ExecuteQuery, UnknownQueryType };
 //---------------------------------------------------------------------------
 static QueryType classifyQuery(const string& s)
    // Classify a query
@@ -56,6 +67,10 @@ static QueryType classifyQuery(const string& s)
       return InsertQuery;
    if (lexer.isKeyword("rollback"))
       return RollbackQuery;
+   if (lexer.isKeyword("prepare"))
+      return PrepareQuery;
+   if (lexer.isKeyword("execute"))
+      return ExecuteQuery;
    return UnknownQueryType;
 }
 //---------------------------------------------------------------------------
@@ -80,7 +95,7 @@ static void writeHeader(const QueryGraph& graph,const SPARQLParser& parser)
    cout << endl;
 }
 //---------------------------------------------------------------------------
-static void runQuery(DifferentialIndex& diffIndex,const string& query)
+static void runQuery(DifferentialIndex& diffIndex,PlanCache& planCache,const string& query,const string& key)
    // Evaluate a query
 {
    QueryGraph queryGraph;
@@ -105,14 +120,17 @@ static void runQuery(DifferentialIndex& diffIndex,const string& query)
    if (queryGraph.knownEmpty()) {
       cout << "ok" << endl;
       writeHeader(queryGraph,parser);
+      // A lone count still produces its result
+      if ((queryGraph.getDuplicateHandling()==QueryGraph::CountDuplicates)&&(queryGraph.projectionBegin()==queryGraph.projectionEnd()))
+         cout << " 0" << endl;
       cout << "\\." << endl;
       cout.flush();
       return;
    }
 
-   // Run the optimizer
-   PlanGen plangen;
-   Plan* plan=plangen.translate(diffIndex.getDatabase(),queryGraph);
+   // Run the optimizer, reusing the plan of an earlier query with the same key if possible
+   const QueryGraph* planGraph;
+   Plan* plan=planCache.translate(diffIndex.getDatabase(),key,queryGraph,planGraph);
    if (!plan) {
       cout << "internal error plan generation failed" << endl;
       return;
@@ -121,18 +139,24 @@ static void runQuery(DifferentialIndex& diffIndex,const string& query)
    // Build a physical plan
    TemporaryDictionary tempDict(diffIndex);
    Runtime runtime(diffIndex.getDatabase(),&diffIndex,&tempDict);
-   Operator* operatorTree=CodeGen().translate(runtime,queryGraph,plan,false);
+   Operator* operatorTree=CodeGen().translate(runtime,*planGraph,plan,false);
    dynamic_cast<ResultsPrinter*>(operatorTree)->setOutputMode(ResultsPrinter::Embedded);
 
    // Execute it
    cout << "ok" << endl;
-   writeHeader(queryGraph,parser);
+   writeHeader(*planGraph,parser);
    if (operatorTree->first()) {
       while (operatorTree->next()) ;
    }
    cout << "\\." << endl;
    cout.flush();
 
+   // Remember the observed cardinalities
+   if (feedback) {
+      feedback->observe(runtime,*planGraph,operatorTree);
+      feedback->storeChanges(feedbackFile,feedbackBatch);
+   }
+
    delete operatorTree;
 }
 //---------------------------------------------------------------------------
@@ -295,8 +319,8 @@ string ExplainPrinter::formatValue(unsigned value)
 {
    stringstream result;
    if (~value) {
-      const char* start,*stop; Type::ID type; unsigned subType;
-      if (runtime.getDatabase().getDictionary().lookupById(value,start,stop,type,subType)) {
+      const char* start,*stop; Type::ID type; unsigned subType; string buffer;
+      if (runtime.getDatabase().getDictionary().lookupById(value,start,stop,type,subType,buffer)) {
          result << '\"';
          for (const char* iter=start;iter!=stop;++iter)
            result << *iter;
@@ -419,6 +443,59 @@ static void insertQuery(DifferentialIndex& diffIndex,const string& query)
    cout << "ok" << endl << endl << "\\." << endl;
 }
 //---------------------------------------------------------------------------
+static bool splitCommand(const string& command,string& name,string& rest)
+   // Split a command of the form 'keyword name rest'
+{
+   istringstream in(command);
+   string keyword;
+   if (!(in >> keyword >> name))
+      return false;
+   getline(in,rest,'\0');
+   return true;
+}
+//---------------------------------------------------------------------------
+static void prepareQuery(map<string,PreparedQuery>& prepared,const string& command)
+   // Register a query template
+{
+   string name,text;
+   if (!splitCommand(command,name,text)) {
+      cout << "name expected" << endl;
+      return;
+   }
+   try {
+      prepared[name]=PreparedQuery(text);
+   } catch (const SPARQLParser::ParserException& e) {
+      cout << "parse error: " << e.message << endl;
+      return;
+   }
+   cout << "ok" << endl << endl << "\\." << endl;
+}
+//---------------------------------------------------------------------------
+static void executeQuery(DifferentialIndex& diffIndex,PlanCache& planCache,const map<string,PreparedQuery>& prepared,const string& command)
+   // Evaluate a query template with bound placeholders
+{
+   string name,bindingText;
+   if (!splitCommand(command,name,bindingText)) {
+      cout << "name expected" << endl;
+      return;
+   }
+   map<string,PreparedQuery>::const_iterator pos=prepared.find(name);
+   if (pos==prepared.end()) {
+      cout << "unknown prepared query " << name << endl;
+      return;
+   }
+   string query;
+   try {
+      PreparedQuery::Bindings bindings;
+      PreparedQuery::parseBindings(bindingText,bindings);
+      query=(*pos).second.instantiate(bindings);
+   } catch (const SPARQLParser::ParserException& e) {
+      cout << "parse error: " << e.message << endl;
+      return;
+   }
+   runQuery(diffIndex,planCache,query,(*pos).second.getKey());
+}
+//---------------------------------------------------------------------------
 }
 //---------------------------------------------------------------------------
 int main(int argc,char* argv[])
@@ -438,20 +515,32 @@ int main(int argc,char* argv[])
       return 1;
    }
    DifferentialIndex diffIndex(db);
+   PlanCache planCache;
+   CardinalityFeedback observations;
+   if (getenv("FEEDBACK")&&(*getenv("FEEDBACK"))) {
+      feedbackFile=getenv("FEEDBACK");
+      observations.load(db,feedbackFile);
+      feedback=&observations;
+      planCache.setFeedback(feedback);
+   }
+   map<string,PreparedQuery> prepared;
    cout << "RDF-3X protocol 1" << endl;
 
    // And process queries
    while (true) {
       string query;
+      bool eof=false;
       while (true) {
          char c;
-         if (!(cin.get(c))) return 0;
+         if (!(cin.get(c))) { eof=true; break; }
          if (c=='\n') break;
          if (c=='\\') {
-            if (!(cin.get(c))) return 0;
+            if (!(cin.get(c))) { eof=true; break; }
          }
          query+=c;
       }
+      if (eof)
+         break;
       switch (classifyQuery(query)) {
          case ExplainQuery:
             explainQuery(diffIndex,query);
@@ -463,12 +552,23 @@ int main(int argc,char* argv[])
             diffIndex.clear();
             cout << "ok" << endl << endl << "\\." << endl;
             break;
+         case PrepareQuery:
+            prepareQuery(prepared,query);
+            break;
+         case ExecuteQuery:
+            executeQuery(diffIndex,planCache,prepared,query);
+            break;
          case RegularQuery:
          default:
-            runQuery(diffIndex,query);
+            runQuery(diffIndex,planCache,query,PreparedQuery::normalize(query));
             break;
       }
       cout.flush();
    }
+
+   // Write the remaining observations
+   if (feedback)
+      feedback->storeChanges(feedbackFile,1);
+   return 0;
 }
 //---------------------------------------------------------------------------
@@ -0,0 +1,382 @@
+#include "ParallelParser.hpp"
+#include "infra/osdep/Thread.hpp"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+/// The prefix of blank nodes generated within a chunk. Cannot occur in labeled blank nodes
+static const char blankMarker[] = "_:\n";
+/// The length of the marker
+static const unsigned blankMarkerLen = sizeof(blankMarker)-1;
+//---------------------------------------------------------------------------
+/// A stream buffer reading from the text of a chunk
+class ChunkBuffer : public streambuf {
+   public:
+   /// Constructor
+   explicit ChunkBuffer(string& text) { char* begin=&text[0]; setg(begin,begin,begin+text.size()); }
+};
+//---------------------------------------------------------------------------
+static bool issep(char c) { return (c==' ')||(c=='\t')||(c=='\n')||(c=='\r')||(c=='[')||(c==']')||(c=='(')||(c==')')||(c==',')||(c==';')||(c==':')||(c=='.'); }
+//---------------------------------------------------------------------------
+static void renumberBlank(string& value,unsigned offset)
+   // Convert a blank node generated within a chunk into a global blank node
+{
+   if ((value.size()<=blankMarkerLen)||(value.compare(0,blankMarkerLen,blankMarker)!=0))
+      return;
+   stringstream buffer;
+   buffer << "_:_" << (offset+atoi(value.c_str()+blankMarkerLen));
+   value=buffer.str();
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+ParallelParser::ParallelParser(istream& in,unsigned threads,unsigned chunkSize)
+   : in(in),chunkSize(chunkSize),threads(threads),scanPos(0),cutPos(0),state(Normal),depth(0),statementStart(true),afterTerminator(false),directiveStart(~0u),directiveLines(0),line(1),eof(false),pos(0),nextError(0),blankOffset(0),runningThreads(0),cancelled(false)
+   // Constructor
+{
+   // Start the helpers, the current thread parses chunks when waiting
+   lock.lock();
+   for (unsigned index=1;index<threads;index++) {
+      runningThreads++;
+      if (!Thread::start(asyncWorker,this))
+         runningThreads--;
+   }
+   lock.unlock();
+}
+//---------------------------------------------------------------------------
+ParallelParser::~ParallelParser()
+   // Destructor
+{
+   lock.lock();
+   cancelled=true;
+   changed.notifyAll(lock);
+   while (runningThreads)
+      changed.wait(lock);
+   lock.unlock();
+
+   for (deque<Chunk*>::const_iterator iter=chunks.begin(),limit=chunks.end();iter!=limit;++iter)
+      delete *iter;
+}
+//---------------------------------------------------------------------------
+void ParallelParser::addDirective(const string& directive)
+   // Remember a directive
+{
+   // Malformed directives are reported when parsing the chunk itself, do not replay them
+   {
+      istringstream in(directive);
+      TurtleParser parser(in);
+      string subject,predicate,object,objectSubType;
+      Type::ID objectType;
+      try {
+         if (parser.parse(subject,predicate,object,objectType,objectSubType))
+            return;
+      } catch (const TurtleParser::Exception&) {
+         return;
+      }
+   }
+
+   pendingDirectives.push_back(pair<unsigned,string>(directiveStart,directive));
+}
+//---------------------------------------------------------------------------
+void ParallelParser::scan()
+   // Scan the pending input for statement boundaries
+{
+   // Keep some lookahead unless the input is exhausted
+   const char* text=pending.c_str();
+   unsigned size=pending.size(),limit=size;
+   if (!eof) limit=(size>3)?(size-3):0;
+
+   for (;scanPos<limit;scanPos++) {
+      char c=text[scanPos];
+      switch (state) {
+         case Word:
+            if (!issep(c)) continue;
+            state=Normal;
+            break;
+         case Comment:
+            if ((c=='\n')||(c=='\r')) {
+               state=Normal;
+               break;
+            }
+            continue;
+         case String:
+            if (c=='\\') scanPos++; else
+            if (c=='\"') state=Normal;
+            continue;
+         case LongString:
+            if (c=='\\') scanPos++; else
+            if ((c=='\"')&&(scanPos+2<size)&&(text[scanPos+1]=='\"')&&(text[scanPos+2]=='\"')) {
+               scanPos+=2;
+               state=Normal;
+            }
+            continue;
+         case URI:
+            if (c=='\\') scanPos++; else
+            if (c=='>') state=Normal;
+            continue;
+         case Normal: break;
+      }
+
+      // Whitespace and comments
+      if ((c==' ')||(c=='\t')||(c=='\r'))
+         continue;
+      if (c=='\n') {
+         // A statement ending at the end of a line is a valid cut point
+         if (afterTerminator) {
+            cutPos=scanPos+1;
+            afterTerminator=false;
+         }
+         continue;
+      }
+      if (c=='#') {
+         state=Comment;
+         continue;
+      }
+
+      // A new statement?
+      afterTerminator=false;
+      if (statementStart) {
+         statementStart=false;
+         if (c=='@')
+            directiveStart=scanPos;
+      }
+
+      // Tokens
+      switch (c) {
+         case '\"':
+            if ((scanPos+2<size)&&(text[scanPos+1]=='\"')&&(text[scanPos+2]=='\"')) {
+               scanPos+=2;
+               state=LongString;
+            } else state=String;
+            break;
+         case '<': state=URI; break;
+         case '[': case '(': depth++; break;
+         case ']': case ')': if (depth) depth--; break;
+         case '.':
+            // The start of a number?
+            if ((text[scanPos+1]>='0')&&(text[scanPos+1]<='9')) {
+               state=Word;
+               break;
+            }
+            // No, the end of a statement
+            if (!depth) {
+               if (directiveStart!=~0u) {
+                  addDirective(pending.substr(directiveStart,scanPos+1-directiveStart));
+                  directiveStart=~0u;
+               }
+               statementStart=true;
+               afterTerminator=true;
+            }
+            break;
+         default:
+            if (((c>='A')&&(c<='Z'))||((c>='a')&&(c<='z'))||((c>='0')&&(c<='9'))||(c=='_')||(c=='+')||(c=='-'))
+               state=Word;
+            break;
+      }
+   }
+}
+//---------------------------------------------------------------------------
+bool ParallelParser::readChunk()
+   // Read the next chunk. Returns false at the end of the input
+{
+   // Read until we can cut a chunk of sufficient size
+   while ((!eof)&&((pending.size()<chunkSize)||(!cutPos))) {
+      unsigned ofs=pending.size();
+      pending.resize(ofs+chunkSize);
+      in.read(&pending[ofs],chunkSize);
+      pending.resize(ofs+in.gcount());
+      if (!in)
+         eof=true;
+      scan();
+   }
+   unsigned end=eof?pending.size():cutPos;
+   if (!end)
+      return false;
+
+   // Construct the chunk, replaying all directives seen before
+   Chunk* chunk=new Chunk();
+   chunk->text.reserve(directives.size()+end);
+   chunk->text=directives;
+   chunk->text.append(pending,0,end);
+   chunk->firstLine=(line>directiveLines)?(line-directiveLines):1;
+   chunk->blankNodes=0;
+   chunk->claimed=false;
+   chunk->done=false;
+
+   // Advance the line counter
+   for (string::const_iterator iter=pending.begin(),limit=pending.begin()+end;iter!=limit;++iter)
+      if ((*iter)=='\n')
+         line++;
+
+   // Collect the directives of the chunk for the following chunks
+   vector<pair<unsigned,string> > remaining;
+   for (vector<pair<unsigned,string> >::const_iterator iter=pendingDirectives.begin(),limit=pendingDirectives.end();iter!=limit;++iter) {
+      if ((*iter).first<end) {
+         directives+=(*iter).second;
+         directives+="\n";
+      } else {
+         remaining.push_back(pair<unsigned,string>((*iter).first-end,(*iter).second));
+      }
+   }
+   pendingDirectives.swap(remaining);
+   directiveLines=0;
+   for (string::const_iterator iter=directives.begin(),limit=directives.end();iter!=limit;++iter)
+      if ((*iter)=='\n')
+         directiveLines++;
+
+   // Drop the consumed input
+   pending.erase(0,end);
+   scanPos-=end;
+   cutPos=0;
+   if (directiveStart!=~0u)
+      directiveStart-=end;
+
+   // And publish the chunk
+   lock.lock();
+   chunks.push_back(chunk);
+   changed.notifyAll(lock);
+   lock.unlock();
+
+   return true;
+}
+//---------------------------------------------------------------------------
+void ParallelParser::parseChunk(Chunk& chunk)
+   // Parse a chunk
+{
+   ChunkBuffer buffer(chunk.text);
+   istream in(&buffer);
+   TurtleParser parser(in,chunk.firstLine,blankMarker);
+
+   while (true) {
+      chunk.triples.resize(chunk.triples.size()+1);
+      Triple& t=chunk.triples.back();
+      try {
+         if (!parser.parse(t.subject,t.predicate,t.object,t.objectType,t.objectSubType)) {
+            chunk.triples.pop_back();
+            break;
+         }
+      } catch (const TurtleParser::Exception& e) {
+         chunk.triples.pop_back();
+         chunk.errors.push_back(pair<unsigned,string>(chunk.triples.size(),e.message));
+         // recover as the serial loader does
+         while (in&&(in.get()!='\n')) ;
+         continue;
+      }
+   }
+   chunk.blankNodes=parser.getBlankNodeCount();
+
+   string().swap(chunk.text);
+}
+//---------------------------------------------------------------------------
+void ParallelParser::work()
+   // Parse chunks until shut down
+{
+   lock.lock();
+   while (!cancelled) {
+      // Find a chunk that is not parsed yet
+      Chunk* chunk=0;
+      for (deque<Chunk*>::const_iterator iter=chunks.begin(),limit=chunks.end();iter!=limit;++iter)
+         if (!(*iter)->claimed) {
+            chunk=*iter;
+            break;
+         }
+      if (!chunk) {
+         changed.wait(lock);
+         continue;
+      }
+
+      chunk->claimed=true;
+      lock.unlock();
+
+      parseChunk(*chunk);
+
+      lock.lock();
+      chunk->done=true;
+      changed.notifyAll(lock);
+   }
+   lock.unlock();
+}
+//---------------------------------------------------------------------------
+void ParallelParser::asyncWorker(void* info)
+   // Entry point for helper threads
+{
+   ParallelParser& parser=*static_cast<ParallelParser*>(info);
+   parser.work();
+
+   parser.lock.lock();
+   parser.runningThreads--;
+   parser.changed.notifyAll(parser.lock);
+   parser.lock.unlock();
+}
+//---------------------------------------------------------------------------
+bool ParallelParser::parse(string& subject,string& predicate,string& object,Type::ID& objectType,string& objectSubType)
+   // Read the next triple
+{
+   while (true) {
+      // Produce triples from the current chunk
+      if (!chunks.empty()) {
+         Chunk& chunk=*chunks.front();
+         if ((nextError<chunk.errors.size())&&(chunk.errors[nextError].first==pos)) {
+            nextError++;
+            throw TurtleParser::Exception(chunk.errors[nextError-1].second);
+         }
+         if (pos<chunk.triples.size()) {
+            Triple& t=chunk.triples[pos++];
+            subject.swap(t.subject);
+            predicate.swap(t.predicate);
+            object.swap(t.object);
+            objectType=t.objectType;
+            objectSubType.swap(t.objectSubType);
+            renumberBlank(subject,blankOffset);
+            if (objectType==Type::URI)
+               renumberBlank(object,blankOffset);
+            return true;
+         }
+
+         // Continue with the next chunk
+         blankOffset+=chunk.blankNodes;
+         lock.lock();
+         chunks.pop_front();
+         lock.unlock();
+         delete &chunk;
+         pos=0;
+         nextError=0;
+      }
+
+      // Stay a few chunks ahead to keep the helpers busy
+      while ((chunks.size()<2*threads)&&readChunk()) ;
+      if (chunks.empty())
+         return false;
+
+      // Wait for the current chunk, parse it ourself if nobody else does
+      Chunk* chunk=chunks.front();
+      lock.lock();
+      while (!chunk->done) {
+         if (!chunk->claimed) {
+            chunk->claimed=true;
+            lock.unlock();
+            parseChunk(*chunk);
+            lock.lock();
+            chunk->done=true;
+            changed.notifyAll(lock);
+            continue;
+         }
+         changed.wait(lock);
+      }
+      lock.unlock();
+   }
+}
+//---------------------------------------------------------------------------
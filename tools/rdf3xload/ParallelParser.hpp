@@ -0,0 +1,133 @@
+#ifndef H_tools_rdf3xload_ParallelParser
+#define H_tools_rdf3xload_ParallelParser
+//---------------------------------------------------------------------------
+// RDF-3X
+// (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
+//
+// This work is licensed under the Creative Commons
+// Attribution-Noncommercial-Share Alike 3.0 Unported License. To view a copy
+// of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+// or send a letter to Creative Commons, 171 Second Street, Suite 300,
+// San Francisco, California, 94105, USA.
+//---------------------------------------------------------------------------
+#include "cts/parser/TurtleParser.hpp"
+#include "infra/osdep/Event.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include <deque>
+#include <iosfwd>
+#include <string>
+#include <vector>
+//---------------------------------------------------------------------------
+/// A turtle parser that parses chunks of the input in multiple threads.
+/** The input is cut into chunks at statement boundaries that are followed
+  * by a line break. Directives are replayed at the beginning of each chunk,
+  * generated blank nodes are renumbered when the triples are consumed. The
+  * triples are produced in input order and are identical to the ones
+  * produced by the TurtleParser.
+  */
+class ParallelParser
+{
+   public:
+   /// A parsed triple
+   struct Triple {
+      /// The values
+      std::string subject,predicate,object,objectSubType;
+      /// The object type
+      Type::ID objectType;
+   };
+   /// A chunk of input
+   struct Chunk {
+      /// The text, including the replayed directives
+      std::string text;
+      /// The line number at the beginning of the text
+      unsigned firstLine;
+      /// The parsed triples
+      std::deque<Triple> triples;
+      /// The parse errors and the number of triples before them
+      std::vector<std::pair<unsigned,std::string> > errors;
+      /// The number of generated blank nodes
+      unsigned blankNodes;
+      /// Parsing started?
+      bool claimed;
+      /// Parsing done?
+      bool done;
+   };
+   /// Scanner states
+   enum ScanState { Normal, Word, Comment, String, LongString, URI };
+
+   private:
+   /// The input
+   std::istream& in;
+   /// The chunk size
+   unsigned chunkSize;
+   /// The number of threads
+   unsigned threads;
+   /// Input not yet assigned to a chunk
+   std::string pending;
+   /// The scanner position in pending
+   unsigned scanPos;
+   /// The last cut position in pending
+   unsigned cutPos;
+   /// The scanner state
+   ScanState state;
+   /// The bracket depth
+   unsigned depth;
+   /// At the beginning of a statement?
+   bool statementStart;
+   /// Behind a statement terminator?
+   bool afterTerminator;
+   /// The begin of the current directive in pending (if any)
+   unsigned directiveStart;
+   /// Directives that have been scanned but not assigned to a chunk yet
+   std::vector<std::pair<unsigned,std::string> > pendingDirectives;
+   /// The directives before the current chunk
+   std::string directives;
+   /// The number of lines in the directives
+   unsigned directiveLines;
+   /// The line number at the beginning of pending
+   unsigned line;
+   /// Input exhausted?
+   bool eof;
+
+   /// The chunks that have not been consumed yet
+   std::deque<Chunk*> chunks;
+   /// The position in the front chunk
+   unsigned pos;
+   /// The next error in the front chunk
+   unsigned nextError;
+   /// The blank nodes generated by previous chunks
+   unsigned blankOffset;
+
+   /// Lock
+   Mutex lock;
+   /// Notification
+   Event changed;
+   /// The number of running helper threads
+   unsigned runningThreads;
+   /// Shutting down?
+   bool cancelled;
+
+   /// Scan the pending input for statement boundaries
+   void scan();
+   /// Remember a directive
+   void addDirective(const std::string& directive);
+   /// Read the next chunk. Returns false at the end of the input
+   bool readChunk();
+   /// Parse a chunk
+   static void parseChunk(Chunk& chunk);
+   /// Parse chunks until shut down
+   void work();
+   /// Entry point for helper threads
+   static void asyncWorker(void* info);
+
+   public:
+   /// Constructor
+   ParallelParser(std::istream& in,unsigned threads,unsigned chunkSize=4*1024*1024);
+   /// Destructor
+   ~ParallelParser();
+
+   /// Read the next triple. Throws a TurtleParser::Exception for malformed triples
+   bool parse(std::string& subject,std::string& predicate,std::string& object,Type::ID& objectType,std::string& objectSubType);
+};
+//---------------------------------------------------------------------------
+#endif
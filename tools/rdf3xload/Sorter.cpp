@@ -1,9 +1,15 @@
 #include "Sorter.hpp"
 #include "TempFile.hpp"
+#include "infra/osdep/Event.hpp"
 #include "infra/osdep/MemoryMappedFile.hpp"
+#include "infra/osdep/Mutex.hpp"
+#include "infra/osdep/Thread.hpp"
+#include "rts/operator/Scheduler.hpp"
 #include <vector>
+#include <string>
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 //---------------------------------------------------------------------------
 // RDF-3X
@@ -17,8 +23,29 @@
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
-/// Maximum amount of usable memory. XXX detect at runtime!
-static const unsigned memoryLimit = sizeof(void*)*(1<<27);
+/// Maximum amount of memory used for runs by default
+static const uint64_t memoryLimit = sizeof(void*)*(1<<27);
+//---------------------------------------------------------------------------
+static uint64_t memoryBudget()
+   // The amount of memory usable for in-memory runs
+{
+   if (getenv("SORTMEMORY")) {
+      double megabytes=atof(getenv("SORTMEMORY"));
+      if (megabytes>0)
+         return static_cast<uint64_t>(megabytes*1024*1024);
+   }
+   uint64_t available=Thread::guessPhysicalAvailable();
+   if ((available>0)&&(available<memoryLimit))
+      return available;
+   return memoryLimit;
+}
+//---------------------------------------------------------------------------
+static unsigned sortThreads()
+   // The number of threads used for sorting runs
+{
+   unsigned threads=Scheduler::getMaxThreads();
+   return threads?threads:1;
+}
 //---------------------------------------------------------------------------
 namespace {
 //---------------------------------------------------------------------------
@@ -31,6 +58,8 @@ struct Range {
 
    /// Some content?
    bool equals(const Range& o) { return ((to-from)==(o.to-o.from))&&(memcmp(from,o.from,to-from)==0); }
+   /// Empty?
+   bool done() const { return from==to; }
 };
 //---------------------------------------------------------------------------
 /// Sort wrapper that colls the comparison function
@@ -49,6 +78,306 @@ struct CompareSorter
    bool operator()(const Range& a,const Range& b) const { return compare(a.from,b.from)<0; }
 };
 //---------------------------------------------------------------------------
+/// A tree of losers for merging sorted runs
+/** The inner nodes remember the loser of the match between their subtrees,
+  * the overall winner is kept in the root. Advancing the winner therefore
+  * needs only one comparison per level.
+  */
+template <class T,class Less> class LoserTree
+{
+   private:
+   /// The runs
+   std::vector<T>& runs;
+   /// The comparison
+   Less less;
+   /// The number of leaves
+   unsigned size;
+   /// The winner and the losers of the inner nodes
+   std::vector<unsigned> tree;
+
+   /// Does run a win against run b? Missing and exhausted runs always lose
+   bool beats(unsigned a,unsigned b) const {
+      if ((a>=runs.size())||runs[a].done()) return false;
+      if ((b>=runs.size())||runs[b].done()) return true;
+      if (less(runs[a],runs[b])) return true;
+      if (less(runs[b],runs[a])) return false;
+      return a<b;
+   }
+
+   public:
+   /// Constructor
+   LoserTree(std::vector<T>& runs,Less less);
+
+   /// All runs exhausted?
+   bool empty() const { return (tree[0]>=runs.size())||runs[tree[0]].done(); }
+   /// The run with the smallest head
+   T& top() { return runs[tree[0]]; }
+   /// Restore the tree after the top run has been advanced
+   void update();
+};
+//---------------------------------------------------------------------------
+template <class T,class Less> LoserTree<T,Less>::LoserTree(std::vector<T>& runs,Less less)
+   : runs(runs),less(less),size(1)
+   // Constructor
+{
+   while (size<runs.size())
+      size<<=1;
+
+   // Play all matches bottom up
+   std::vector<unsigned> winners(2*size);
+   for (unsigned index=0;index<size;index++)
+      winners[size+index]=index;
+   tree.resize(size);
+   for (unsigned node=size-1;node>0;node--) {
+      unsigned a=winners[2*node],b=winners[2*node+1];
+      if (beats(a,b)) {
+         winners[node]=a;
+         tree[node]=b;
+      } else {
+         winners[node]=b;
+         tree[node]=a;
+      }
+   }
+   tree[0]=winners[1];
+}
+//---------------------------------------------------------------------------
+template <class T,class Less> void LoserTree<T,Less>::update()
+   // Restore the tree after the top run has been advanced
+{
+   unsigned winner=tree[0];
+   for (unsigned node=(size+winner)>>1;node>0;node>>=1)
+      if (beats(tree[node],winner))
+         std::swap(tree[node],winner);
+   tree[0]=winner;
+}
+//---------------------------------------------------------------------------
+/// A triple, the ids are ordered by the sort key
+struct Triple {
+   /// The ids
+   uint64_t key[3];
+};
+//---------------------------------------------------------------------------
+static inline bool lessTriples(const Triple& a,const Triple& b)
+   // Compare two triples
+{
+   if (a.key[0]!=b.key[0]) return a.key[0]<b.key[0];
+   if (a.key[1]!=b.key[1]) return a.key[1]<b.key[1];
+   return a.key[2]<b.key[2];
+}
+//---------------------------------------------------------------------------
+static inline bool equalTriples(const Triple& a,const Triple& b)
+   // Compare two triples
+{
+   return (a.key[0]==b.key[0])&&(a.key[1]==b.key[1])&&(a.key[2]==b.key[2]);
+}
+//---------------------------------------------------------------------------
+static void radixSort(Triple* data,Triple* scratch,unsigned count)
+   // Sort triples with a least significant digit first radix sort
+{
+   // Build the histograms of all digits in one pass. Digit 0 is the lowest byte of the last key
+   static const unsigned digits = 24;
+   std::vector<unsigned> histogram(digits*256,0);
+   for (const Triple* iter=data,*limit=data+count;iter!=limit;++iter)
+      for (unsigned digit=0;digit<digits;digit++)
+         histogram[(digit<<8)+((iter->key[2-(digit>>3)]>>((digit&7)<<3))&0xFF)]++;
+
+   // Distribute by all digits that are not constant
+   Triple* from=data,*to=scratch;
+   for (unsigned digit=0;digit<digits;digit++) {
+      unsigned* counts=&histogram[digit<<8];
+      bool constant=false;
+      for (unsigned index=0;index<256;index++)
+         if (counts[index]==count) {
+            constant=true;
+            break;
+         }
+      if (constant)
+         continue;
+
+      unsigned sum=0;
+      for (unsigned index=0;index<256;index++) {
+         unsigned c=counts[index];
+         counts[index]=sum;
+         sum+=c;
+      }
+      unsigned column=2-(digit>>3),shift=(digit&7)<<3;
+      for (const Triple* iter=from,*limit=from+count;iter!=limit;++iter)
+         to[counts[(iter->key[column]>>shift)&0xFF]++]=*iter;
+      std::swap(from,to);
+   }
+   if (from!=data)
+      memcpy(data,from,count*sizeof(Triple));
+}
+//---------------------------------------------------------------------------
+static void writeId(std::string& out,uint64_t id)
+   // Write an id with variable length
+{
+   while (id>=128) {
+      out+=static_cast<char>(id|128);
+      id>>=7;
+   }
+   out+=static_cast<char>(id);
+}
+//---------------------------------------------------------------------------
+static void compressRun(const Triple* from,const Triple* to,std::string& out,bool eliminateDuplicates)
+   // Write a sorted run. The ids are stored as deltas to the predecessor if the prefix is equal
+{
+   out.reserve(4*(to-from));
+   Triple last;
+   last.key[0]=last.key[1]=last.key[2]=0;
+   for (const Triple* iter=from;iter!=to;++iter) {
+      if (eliminateDuplicates&&(iter!=from)&&equalTriples(*iter,last))
+         continue;
+      if (iter->key[0]!=last.key[0]) {
+         writeId(out,iter->key[0]-last.key[0]);
+         writeId(out,iter->key[1]);
+         writeId(out,iter->key[2]);
+      } else if (iter->key[1]!=last.key[1]) {
+         writeId(out,0);
+         writeId(out,iter->key[1]-last.key[1]);
+         writeId(out,iter->key[2]);
+      } else {
+         writeId(out,0);
+         writeId(out,0);
+         writeId(out,iter->key[2]-last.key[2]);
+      }
+      last=*iter;
+   }
+}
+//---------------------------------------------------------------------------
+/// A compressed run of triples
+struct TripleRun {
+   /// The remaining data
+   const char* iter,*limit;
+   /// The current triple
+   Triple head;
+   /// Exhausted?
+   bool exhausted;
+
+   /// Constructor
+   TripleRun(const char* iter,const char* limit) : iter(iter),limit(limit),exhausted(false) { head.key[0]=head.key[1]=head.key[2]=0; next(); }
+
+   /// Exhausted?
+   bool done() const { return exhausted; }
+   /// Decode the next triple
+   void next();
+};
+//---------------------------------------------------------------------------
+void TripleRun::next()
+   // Decode the next triple
+{
+   if (iter==limit) {
+      exhausted=true;
+      return;
+   }
+   uint64_t delta;
+   iter=TempFile::readId(iter,delta);
+   if (delta) {
+      head.key[0]+=delta;
+      iter=TempFile::readId(TempFile::readId(iter,head.key[1]),head.key[2]);
+      return;
+   }
+   iter=TempFile::readId(iter,delta);
+   if (delta) {
+      head.key[1]+=delta;
+      iter=TempFile::readId(iter,head.key[2]);
+      return;
+   }
+   iter=TempFile::readId(iter,delta);
+   head.key[2]+=delta;
+}
+//---------------------------------------------------------------------------
+/// Compare the heads of two runs
+struct TripleRunLess
+{
+   /// Compare
+   bool operator()(const TripleRun& a,const TripleRun& b) const { return lessTriples(a.head,b.head); }
+};
+//---------------------------------------------------------------------------
+/// Sorts the slices of a batch in parallel, each slice becomes a run
+class RunBuilder
+{
+   private:
+   /// The triples
+   Triple* data;
+   /// The scratch area
+   Triple* scratch;
+   /// The slice bounds
+   const std::vector<unsigned>& bounds;
+   /// The runs
+   std::vector<std::string>& runs;
+   /// Eliminate duplicates?
+   bool eliminateDuplicates;
+   /// Lock
+   Mutex lock;
+   /// Notification
+   Event finished;
+   /// The next slice
+   unsigned nextSlice;
+   /// The number of running helper threads
+   unsigned runningThreads;
+
+   /// Sort slices until none is left
+   void work();
+   /// Entry point for helper threads
+   static void asyncWorker(void* info);
+
+   public:
+   /// Constructor
+   RunBuilder(Triple* data,Triple* scratch,const std::vector<unsigned>& bounds,std::vector<std::string>& runs,bool eliminateDuplicates) : data(data),scratch(scratch),bounds(bounds),runs(runs),eliminateDuplicates(eliminateDuplicates),nextSlice(0),runningThreads(0) {}
+
+   /// Build all runs
+   void build(unsigned threads);
+};
+//---------------------------------------------------------------------------
+void RunBuilder::work()
+   // Sort slices until none is left
+{
+   lock.lock();
+   while (nextSlice+1<bounds.size()) {
+      unsigned slice=nextSlice++;
+      lock.unlock();
+
+      unsigned from=bounds[slice],to=bounds[slice+1];
+      radixSort(data+from,scratch+from,to-from);
+      compressRun(data+from,data+to,runs[slice],eliminateDuplicates);
+
+      lock.lock();
+   }
+   lock.unlock();
+}
+//---------------------------------------------------------------------------
+void RunBuilder::asyncWorker(void* info)
+   // Entry point for helper threads
+{
+   RunBuilder& builder=*static_cast<RunBuilder*>(info);
+   builder.work();
+
+   builder.lock.lock();
+   builder.runningThreads--;
+   builder.finished.notifyAll(builder.lock);
+   builder.lock.unlock();
+}
+//---------------------------------------------------------------------------
+void RunBuilder::build(unsigned threads)
+   // Build all runs
+{
+   lock.lock();
+   for (unsigned index=1;(index<threads)&&(index+1<bounds.size());index++) {
+      runningThreads++;
+      if (!Thread::start(asyncWorker,this))
+         runningThreads--;
+   }
+   lock.unlock();
+
+   work();
+
+   lock.lock();
+   while (runningThreads)
+      finished.wait(lock);
+   lock.unlock();
+}
+//---------------------------------------------------------------------------
 static char* spool(char* ofs,TempFile& out,const vector<Range>& items,bool eliminateDuplicates)
    // Spool items to disk
 {
@@ -75,13 +404,14 @@ void Sorter::sort(TempFile& in,TempFile& out,const char* (*skip)(const char*),in
    const char* reader=mappedIn.getBegin(),*limit=mappedIn.getEnd();
 
    // Produce runs
+   uint64_t budget=memoryBudget();
    vector<Range> runs;
    TempFile intermediate(out.getBaseFile());
    char* ofs=0;
    while (reader<limit) {
       // Collect items
       vector<Range> items;
-      const char* maxReader=reader+memoryLimit;
+      const char* maxReader=reader+budget;
       while (reader<limit) {
          const char* start=reader;
          reader=skip(reader);
@@ -119,55 +449,122 @@ void Sorter::sort(TempFile& in,TempFile& out,const char* (*skip)(const char*),in
          (*iter).to=tempIn.getBegin()+((*iter).to-static_cast<char*>(0));
       }
 
-      // Sort the run heads
-      std::sort(runs.begin(),runs.end(),CompareSorter(compare));
-
       // And merge them
+      LoserTree<Range,CompareSorter> merger(runs,CompareSorter(compare));
       Range last(0,0);
-      while (!runs.empty()) {
+      while (!merger.empty()) {
          // Write the first entry if no duplicate
-         Range head(runs.front().from,skip(runs.front().from));
+         Range& run=merger.top();
+         Range head(run.from,skip(run.from));
          if ((!eliminateDuplicates)||(!last.equals(head)))
             out.write(head.to-head.from,head.from);
          last=head;
 
-         // Update the first entry. First entry done?
-         if ((runs.front().from=head.to)==runs.front().to) {
-            runs[0]=runs[runs.size()-1];
-            runs.pop_back();
-         }
+         // Advance the run
+         run.from=head.to;
+         merger.update();
+      }
+   }
 
-         // Check the heap condition
-         unsigned pos=0,size=runs.size();
-         while (pos<size) {
-            unsigned left=2*pos+1,right=left+1;
-            if (left>=size) break;
-            if (right<size) {
-               if (compare(runs[pos].from,runs[left].from)>0) {
-                  if (compare(runs[pos].from,runs[right].from)>0) {
-                     if (compare(runs[left].from,runs[right].from)<0) {
-                        std::swap(runs[pos],runs[left]);
-                        pos=left;
-                     } else {
-                        std::swap(runs[pos],runs[right]);
-                        pos=right;
-                     }
-                  } else {
-                     std::swap(runs[pos],runs[left]);
-                     pos=left;
-                  }
-               } else if (compare(runs[pos].from,runs[right].from)>0) {
-                  std::swap(runs[pos],runs[right]);
-                  pos=right;
-               } else break;
-            } else {
-               if (compare(runs[pos].from,runs[left].from)>0) {
-                  std::swap(runs[pos],runs[left]);
-                  pos=left;
-               } else break;
-            }
-         }
+   out.close();
+}
+//---------------------------------------------------------------------------
+void Sorter::sortTriples(TempFile& in,TempFile& out,Order order,bool eliminateDuplicates)
+   // Sort a file of id triples
+{
+   // The key columns of the orders
+   static const unsigned columns[6][3]={{0,1,2},{0,2,1},{1,0,2},{1,2,0},{2,0,1},{2,1,0}};
+   const unsigned* key=columns[order];
+
+   // Open the input
+   in.close();
+   MemoryMappedFile mappedIn;
+   assert(mappedIn.open(in.getFile().c_str()));
+   const char* reader=mappedIn.getBegin(),*limit=mappedIn.getEnd();
+
+   // A batch needs space for the triples and the radix sort scratch area
+   unsigned threads=sortThreads();
+   uint64_t batchLimit=memoryBudget()/(2*sizeof(Triple));
+   if (batchLimit<1) batchLimit=1;
+   if (batchLimit>(1u<<30)) batchLimit=1u<<30;
+
+   // Produce runs
+   vector<Triple> batch,scratch;
+   vector<string> memoryRuns;
+   vector<pair<uint64_t,uint64_t> > spilledRuns;
+   TempFile intermediate(out.getBaseFile());
+   uint64_t ofs=0;
+   while (reader<limit) {
+      // Collect triples
+      batch.clear();
+      while ((reader<limit)&&(batch.size()<batchLimit)) {
+         uint64_t values[3];
+         reader=TempFile::readId(TempFile::readId(TempFile::readId(reader,values[0]),values[1]),values[2]);
+         Triple t;
+         t.key[0]=values[key[0]];
+         t.key[1]=values[key[1]];
+         t.key[2]=values[key[2]];
+         batch.push_back(t);
+      }
+      scratch.resize(batch.size());
+
+      // Sort slices of the batch in parallel. Small batches are not split
+      unsigned slices=(batch.size()<65536)?1:threads;
+      vector<unsigned> bounds;
+      for (unsigned index=0;index<=slices;index++)
+         bounds.push_back((static_cast<uint64_t>(batch.size())*index)/slices);
+      vector<string> runs(slices);
+      RunBuilder(&batch[0],&scratch[0],bounds,runs,eliminateDuplicates).build(threads);
+
+      // Did everything fit?
+      if ((reader==limit)&&(spilledRuns.empty())) {
+         memoryRuns.swap(runs);
+         break;
+      }
+
+      // No, spool to intermediate file
+      for (vector<string>::iterator iter=runs.begin(),limit=runs.end();iter!=limit;++iter) {
+         intermediate.write((*iter).size(),(*iter).data());
+         spilledRuns.push_back(pair<uint64_t,uint64_t>(ofs,ofs+(*iter).size()));
+         ofs+=(*iter).size();
+         string().swap(*iter);
+      }
+   }
+   vector<Triple>().swap(batch);
+   vector<Triple>().swap(scratch);
+   intermediate.close();
+   mappedIn.close();
+
+   // Prepare the merge
+   vector<TripleRun> runs;
+   MemoryMappedFile tempIn;
+   if (!spilledRuns.empty()) {
+      assert(tempIn.open(intermediate.getFile().c_str()));
+      for (vector<pair<uint64_t,uint64_t> >::const_iterator iter=spilledRuns.begin(),limit=spilledRuns.end();iter!=limit;++iter)
+         runs.push_back(TripleRun(tempIn.getBegin()+(*iter).first,tempIn.getBegin()+(*iter).second));
+   } else {
+      for (vector<string>::const_iterator iter=memoryRuns.begin(),limit=memoryRuns.end();iter!=limit;++iter)
+         runs.push_back(TripleRun((*iter).data(),(*iter).data()+(*iter).size()));
+   }
+
+   // And merge them, restoring the original column order
+   unsigned columnOf[3];
+   for (unsigned index=0;index<3;index++)
+      columnOf[key[index]]=index;
+   LoserTree<TripleRun,TripleRunLess> merger(runs,TripleRunLess());
+   Triple last;
+   bool first=true;
+   while (!merger.empty()) {
+      TripleRun& run=merger.top();
+      if ((!eliminateDuplicates)||first||(!equalTriples(run.head,last))) {
+         out.writeId(run.head.key[columnOf[0]]);
+         out.writeId(run.head.key[columnOf[1]]);
+         out.writeId(run.head.key[columnOf[2]]);
+         last=run.head;
+         first=false;
       }
+      run.next();
+      merger.update();
    }
 
    out.close();
@@ -13,10 +13,19 @@
 class TempFile;
 //---------------------------------------------------------------------------
 /// Sort a temporary file
+/** The memory budget for in-memory runs defaults to a guess of the available
+  * memory and can be set with the SORTMEMORY environment variable (in MB).
+  * Triples are sorted with MAXTHREADS threads.
+  */
 class Sorter {
    public:
+   /// Sort orders for triples, by the column positions forming the key
+   enum Order { Order123, Order132, Order213, Order231, Order312, Order321 };
+
    /// Sort a file
    static void sort(TempFile& in,TempFile& out,const char* (*skip)(const char*),int (*compare)(const char*,const char*),bool eliminateDuplicates=false);
+   /// Sort a file of id triples
+   static void sortTriples(TempFile& in,TempFile& out,Order order,bool eliminateDuplicates=false);
 };
 //---------------------------------------------------------------------------
 #endif
@@ -1,9 +1,11 @@
+#include "ParallelParser.hpp"
 #include "Sorter.hpp"
 #include "StringLookup.hpp"
 #include "TempFile.hpp"
 #include "cts/parser/TurtleParser.hpp"
 #include "infra/osdep/MemoryMappedFile.hpp"
 #include "rts/database/DatabaseBuilder.hpp"
+#include "rts/operator/Scheduler.hpp"
 #include <iostream>
 #include <cassert>
 #include <cstring>
@@ -27,12 +29,21 @@ bool smallAddressSpace()
    return sizeof(void*)<8;
 }
 //---------------------------------------------------------------------------
-static bool parse(istream& in,const char* name,StringLookup& lookup,TempFile& facts,TempFile& strings,map<unsigned,unsigned>& subTypes)
-   // Parse the input and store it into temporary files
+static void recover(TurtleParser& /*parser*/,istream& in)
+   // Skip the rest of the line after a parse error
+{
+   while (in&&(in.get()!='\n')) ;
+}
+//---------------------------------------------------------------------------
+static void recover(ParallelParser& /*parser*/,istream& /*in*/)
+   // Skip the rest of the line after a parse error
+{
+   // Already done by the parser
+}
+//---------------------------------------------------------------------------
+template <class Parser> static bool parseTriples(Parser& parser,istream& in,StringLookup& lookup,TempFile& facts,TempFile& strings,map<unsigned,unsigned>& subTypes)
+   // Read the triples and store them into temporary files
 {
-   cerr << "Parsing " << name << "..." << endl;
-
-   TurtleParser parser(in);
    map<string,unsigned> languages,types;
 
    // Read the triples
@@ -46,7 +57,7 @@ static bool parse(istream& in,const char* name,StringLookup& lookup,TempFile& fa
          } catch (const TurtleParser::Exception& e) {
             cerr << e.message << endl;
             // recover...
-            while (in.get()!='\n') ;
+            recover(parser,in);
             continue;
          }
          // Construct IDs
@@ -82,12 +93,34 @@ static bool parse(istream& in,const char* name,StringLookup& lookup,TempFile& fa
    return true;
 }
 //---------------------------------------------------------------------------
+static bool parse(istream& in,const char* name,StringLookup& lookup,TempFile& facts,TempFile& strings,map<unsigned,unsigned>& subTypes)
+   // Parse the input and store it into temporary files
+{
+   cerr << "Parsing " << name << "..." << endl;
+
+   // Parse chunks of the input in parallel if requested. The ids are still assigned in input order
+   unsigned threads=Scheduler::getMaxThreads();
+   if (threads) {
+      ParallelParser parser(in,threads);
+      return parseTriples(parser,in,lookup,facts,strings,subTypes);
+   } else {
+      TurtleParser parser(in);
+      return parseTriples(parser,in,lookup,facts,strings,subTypes);
+   }
+}
+//---------------------------------------------------------------------------
 static const char* skipStringIdId(const char* reader)
    // Skip a materialized string/id pair
 {
    return TempFile::skipId(TempFile::skipId(TempFile::skipString(reader)));
 }
 //---------------------------------------------------------------------------
+static const char* skipStringId(const char* reader)
+   // Skip a materialized string/id pair
+{
+   return TempFile::skipId(TempFile::skipString(reader));
+}
+//---------------------------------------------------------------------------
 static const char* skipIdStringId(const char* reader)
    // Skip a materialized id/string/id triple
 {
@@ -151,6 +184,29 @@ static int compareStringIdId(const char* left,const char* right)
    return cmpIds(leftId,rightId);
 }
 //---------------------------------------------------------------------------
+static int compareStringId(const char* left,const char* right)
+   // Sort by string, and within same strings by id
+{
+   // Read the string length
+   uint64_t leftLen,rightLen;
+   left=TempFile::readId(left,leftLen);
+   right=TempFile::readId(right,rightLen);
+
+   // Compare the strings
+   int cmp=memcmp(left,right,min(leftLen,rightLen));
+   if (cmp) return cmp;
+   if (leftLen<rightLen) return -1;
+   if (leftLen>rightLen) return 1;
+   left+=leftLen;
+   right+=rightLen;
+
+   // Compare the ids
+   uint64_t leftId,rightId;
+   TempFile::readId(left,leftId);
+   TempFile::readId(right,rightId);
+   return cmpIds(leftId,rightId);
+}
+//---------------------------------------------------------------------------
 static int compareId(const char* left,const char* right)
    // Sort by id
 {
@@ -273,84 +329,6 @@ static void buildDictionary(TempFile& rawStrings,TempFile& stringTable,TempFile&
    }
 }
 //---------------------------------------------------------------------------
-static inline int cmpValue(uint64_t l,uint64_t r) { return (l<r)?-1:((l>r)?1:0); }
-//---------------------------------------------------------------------------
-static inline int cmpTriples(uint64_t l1,uint64_t l2,uint64_t l3,uint64_t r1,uint64_t r2,uint64_t r3)
-   // Compar two triples
-{
-   int c=cmpValue(l1,r1);
-   if (c) return c;
-   c=cmpValue(l2,r2);
-   if (c) return c;
-   return cmpValue(l3,r3);
-}
-//---------------------------------------------------------------------------
-static inline void loadTriple(const char* data,uint64_t& v1,uint64_t& v2,uint64_t& v3)
-   // Load a triple
-{
-   TempFile::readId(TempFile::readId(TempFile::readId(data,v1),v2),v3);
-}
-//---------------------------------------------------------------------------
-static int compare123(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l1,l2,l3,r1,r2,r3);
-}
-//---------------------------------------------------------------------------
-static int compare132(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l1,l3,l2,r1,r3,r2);
-}
-//---------------------------------------------------------------------------
-static int compare213(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l2,l1,l3,r2,r1,r3);
-}
-//---------------------------------------------------------------------------
-static int compare231(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l2,l3,l1,r2,r3,r1);
-}
-//---------------------------------------------------------------------------
-static int compare312(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l3,l1,l2,r3,r1,r2);
-}
-//---------------------------------------------------------------------------
-static int compare321(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l3,l2,l1,r3,r2,r1);
-}
-//---------------------------------------------------------------------------
 static void resolveIds(TempFile& rawFacts,TempFile& stringIds,TempFile& facts)
    // Resolve the triple ids
 {
@@ -361,7 +339,7 @@ static void resolveIds(TempFile& rawFacts,TempFile& stringIds,TempFile& facts)
 
    // Sort by subject
    TempFile sortedBySubject(rawFacts.getBaseFile());
-   Sorter::sort(rawFacts,sortedBySubject,skipIdIdId,compareValue);
+   Sorter::sortTriples(rawFacts,sortedBySubject,Sorter::Order123);
    rawFacts.discard();
 
    // Resolve the subject
@@ -387,7 +365,7 @@ static void resolveIds(TempFile& rawFacts,TempFile& stringIds,TempFile& facts)
 
    // Sort by predicate
    TempFile sortedByPredicate(rawFacts.getBaseFile());
-   Sorter::sort(subjectResolved,sortedByPredicate,skipIdIdId,compareValue);
+   Sorter::sortTriples(subjectResolved,sortedByPredicate,Sorter::Order123);
    subjectResolved.discard();
 
    // Resolve the predicate
@@ -413,7 +391,7 @@ static void resolveIds(TempFile& rawFacts,TempFile& stringIds,TempFile& facts)
 
    // Sort by object
    TempFile sortedByObject(rawFacts.getBaseFile());
-   Sorter::sort(predicateResolved,sortedByObject,skipIdIdId,compareValue);
+   Sorter::sortTriples(predicateResolved,sortedByObject,Sorter::Order123);
    predicateResolved.discard();
 
    // Resolve the object
@@ -438,7 +416,7 @@ static void resolveIds(TempFile& rawFacts,TempFile& stringIds,TempFile& facts)
    sortedByObject.discard();
 
    // Final sort by subject, predicate, object, eliminaing duplicates
-   Sorter::sort(objectResolved,facts,skipIdIdId,compare123,true);
+   Sorter::sortTriples(objectResolved,facts,Sorter::Order123,true);
 }
 //---------------------------------------------------------------------------
 namespace {
@@ -471,6 +449,27 @@ static void loadFacts(DatabaseBuilder& builder,TempFile& facts)
    // Load the facts
 {
    cout << "Loading triples..." << endl;
+
+   // Load all orders concurrently if requested. This needs all sorted orders at the same time
+   if (Scheduler::getMaxThreads()) {
+      TempFile sorted132(facts.getBaseFile()),sorted321(facts.getBaseFile()),sorted312(facts.getBaseFile()),sorted213(facts.getBaseFile()),sorted231(facts.getBaseFile());
+      Sorter::sortTriples(facts,sorted132,Sorter::Order132);
+      Sorter::sortTriples(facts,sorted321,Sorter::Order321);
+      Sorter::sortTriples(facts,sorted312,Sorter::Order312);
+      Sorter::sortTriples(facts,sorted213,Sorter::Order213);
+      Sorter::sortTriples(facts,sorted231,Sorter::Order231);
+
+      Load123 loader123(facts);
+      Load132 loader132(sorted132);
+      Load321 loader321(sorted321);
+      Load312 loader312(sorted312);
+      Load213 loader213(sorted213);
+      Load231 loader231(sorted231);
+      DatabaseBuilder::FactsReader* readers[6]={&loader123,&loader132,&loader321,&loader312,&loader213,&loader231};
+      builder.loadFacts(readers);
+      return;
+   }
+
    // Order 0
    {
       Load123 loader(facts);
@@ -479,35 +478,35 @@ static void loadFacts(DatabaseBuilder& builder,TempFile& facts)
    // Order 1
    {
       TempFile sorted(facts.getBaseFile());
-      Sorter::sort(facts,sorted,skipIdIdId,compare132);
+      Sorter::sortTriples(facts,sorted,Sorter::Order132);
       Load132 loader(sorted);
       builder.loadFacts(1,loader);
    }
    // Order 2
    {
       TempFile sorted(facts.getBaseFile());
-      Sorter::sort(facts,sorted,skipIdIdId,compare321);
+      Sorter::sortTriples(facts,sorted,Sorter::Order321);
       Load321 loader(sorted);
       builder.loadFacts(2,loader);
    }
    // Order 3
    {
       TempFile sorted(facts.getBaseFile());
-      Sorter::sort(facts,sorted,skipIdIdId,compare312);
+      Sorter::sortTriples(facts,sorted,Sorter::Order312);
       Load312 loader(sorted);
       builder.loadFacts(3,loader);
    }
    // Order 4
    {
       TempFile sorted(facts.getBaseFile());
-      Sorter::sort(facts,sorted,skipIdIdId,compare213);
+      Sorter::sortTriples(facts,sorted,Sorter::Order213);
       Load213 loader(sorted);
       builder.loadFacts(4,loader);
    }
    // Order 5
    {
       TempFile sorted(facts.getBaseFile());
-      Sorter::sort(facts,sorted,skipIdIdId,compare231);
+      Sorter::sortTriples(facts,sorted,Sorter::Order231);
       Load231 loader(sorted);
       builder.loadFacts(5,loader);
    }
@@ -617,6 +616,62 @@ bool StringHashesReader::next(unsigned& v1,unsigned& v2)
    return true;
 }
 //---------------------------------------------------------------------------
+/// Read the strings sorted by value
+class StringIndexReader : public DatabaseBuilder::StringIndexReader
+{
+   private:
+   /// The input
+   MemoryMappedFile in;
+   /// Points into the data
+   const char* iter,*limit;
+
+   public:
+   /// Constructor
+   StringIndexReader(TempFile& file) { file.close(); ensure(in.open(file.getFile().c_str())); iter=in.getBegin(); limit=in.getEnd(); }
+
+   /// Read the next entry
+   bool next(unsigned& len,const char*& data,unsigned& id);
+};
+//---------------------------------------------------------------------------
+bool StringIndexReader::next(unsigned& len,const char*& data,unsigned& id)
+   // Read the next entry
+{
+   if (iter==limit)
+      return false;
+   uint64_t i;
+   iter=TempFile::readId(TempFile::readString(iter,len,data),i);
+   id=i;
+   return true;
+}
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+static void loadStringIndex(DatabaseBuilder& builder,TempFile& stringTable)
+   // Load the sorted string index
+{
+   cout << "Building the string index..." << endl;
+
+   // Collect the strings with their final ids, which are assigned in table order
+   TempFile unsorted(stringTable.getBaseFile());
+   {
+      stringTable.close();
+      MemoryMappedFile in;
+      ensure(in.open(stringTable.getFile().c_str()));
+      unsigned id=0;
+      for (const char* iter=in.getBegin(),*limit=in.getEnd();iter!=limit;++id) {
+         unsigned len; const char* data;
+         iter=TempFile::skipId(TempFile::readString(TempFile::skipId(iter),len,data));
+         unsorted.writeString(len,data);
+         unsorted.writeId(id);
+      }
+   }
+
+   // Sort by string and load
+   TempFile sorted(stringTable.getBaseFile());
+   Sorter::sort(unsorted,sorted,skipStringId,compareStringId);
+   unsorted.discard();
+   StringIndexReader reader(sorted);
+   builder.loadStringIndex(reader);
 }
 //---------------------------------------------------------------------------
 static void loadStrings(DatabaseBuilder& builder,TempFile& stringTable)
@@ -652,9 +707,10 @@ static void loadStatistics(DatabaseBuilder& builder,TempFile& facts)
    TempFile tmp(facts.getBaseFile());
    tmp.close();
    builder.computeExactStatistics(tmp.getFile().c_str());
+   builder.computePredicateSets();
 }
 //---------------------------------------------------------------------------
-static void loadDatabase(const char* name,TempFile& facts,TempFile& stringTable)
+static void loadDatabase(const char* name,TempFile& facts,TempFile& stringTable,bool stringIndex)
    // Load the database
 {
    cout << "Loading database into " << name << "..." << endl;
@@ -663,8 +719,11 @@ static void loadDatabase(const char* name,TempFile& facts,TempFile& stringTable)
    // Load the facts
    loadFacts(builder,facts);
 
-   // Load the strings
+   // Load the strings. The parser maps xsd:dateTime to Type::Date
    loadStrings(builder,stringTable);
+   builder.setTypedDates(true);
+   if (stringIndex)
+      loadStringIndex(builder,stringTable);
 
    // Compute the statistics
    loadStatistics(builder,facts);
@@ -680,10 +739,22 @@ int main(int argc,char* argv[])
    cerr << "RDF-3X turtle importer" << endl
         << "(c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x" << endl;
 
+   // Extract the options
+   bool stringIndex=false;
+   {
+      int used=1;
+      for (int index=1;index<argc;index++)
+         if (string(argv[index])=="--stringindex")
+            stringIndex=true; else
+            argv[used++]=argv[index];
+      argc=used;
+   }
+
    // Check the arguments
    if (argc<2) {
-      cerr <<  "usage: " << argv[0] << " <database> [input]" << endl
-           << "without input file data is read from stdin" << endl;
+      cerr <<  "usage: " << argv[0] << " [--stringindex] <database> [input]" << endl
+           << "without input file data is read from stdin" << endl
+           << "--stringindex builds a sorted string index for prefix searches" << endl;
       return 1;
    }
 
@@ -717,7 +788,7 @@ int main(int argc,char* argv[])
    stringIds.discard();
 
    // And start the load
-   loadDatabase(argv[1],facts,stringTable);
+   loadDatabase(argv[1],facts,stringTable,stringIndex);
 
    cout << "Done." << endl;
 }
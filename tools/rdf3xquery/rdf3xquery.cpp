@@ -1,7 +1,10 @@
 #include "cts/codegen/CodeGen.hpp"
 #include "cts/infra/QueryGraph.hpp"
+#include "cts/parser/PreparedQuery.hpp"
 #include "cts/parser/SPARQLLexer.hpp"
 #include "cts/parser/SPARQLParser.hpp"
+#include "cts/plangen/CardinalityFeedback.hpp"
+#include "cts/plangen/PlanCache.hpp"
 #include "cts/plangen/PlanGen.hpp"
 #include "cts/semana/SemanticAnalysis.hpp"
 #include "infra/osdep/Timestamp.hpp"
@@ -9,12 +12,15 @@
 #include "rts/runtime/Runtime.hpp"
 #include "rts/operator/Operator.hpp"
 #include "rts/operator/PlanPrinter.hpp"
+#include "rts/segment/DictionarySegment.hpp"
 #ifdef CONFIG_LINEEDITOR
 #include "lineeditor/LineInput.hpp"
 #endif
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cstdlib>
+#include <map>
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2008 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -27,6 +33,13 @@
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
+/// The observed cardinalities (if enabled)
+static CardinalityFeedback* feedback = 0;
+/// The file storing the observed cardinalities
+static const char* feedbackFile = 0;
+/// The number of changed estimates that are written together
+static const unsigned feedbackBatch = 16;
+//---------------------------------------------------------------------------
 bool smallAddressSpace()
    // Is the address space too small?
 {
@@ -69,10 +82,27 @@ static void showHelp()
         << "help          shows this help" << endl
         << "select ...    runs a SPARQL query" << endl
         << "explain ...   shows the execution plan for a SPARQL query" << endl
+        << "prepare n ... registers a SPARQL query with %placeholders as n" << endl
+        << "execute n ... runs query n with the given %x=value bindings" << endl
+        << "stats         shows dictionary cache statistics" << endl
         << "exit          exits the query interface" << endl;
 }
 //---------------------------------------------------------------------------
-static void runQuery(Database& db,const string& query,bool explain)
+static void showStats(Database& db,const PlanCache& planCache)
+   // Show runtime statistics
+{
+   DictionarySegment& dict=db.getDictionary();
+   uint64_t hits=dict.getCacheHits(),misses=dict.getCacheMisses();
+   cout << "dictionary cache: " << hits << " hits, " << misses << " misses";
+   if (hits+misses)
+      cout << ", hit rate " << (100.0*hits/(hits+misses)) << "%";
+   cout << endl;
+   cout << "plan cache: " << planCache.getSize() << " plans, " << planCache.getHits() << " hits, " << planCache.getMisses() << " misses, " << planCache.getReplans() << " replans" << endl;
+   if (feedback)
+      cout << "cardinality feedback: " << feedback->getSize() << " observations" << endl;
+}
+//---------------------------------------------------------------------------
+static void runQuery(Database& db,const string& query,bool explain,PlanCache* planCache=0,const string& key=string())
    // Evaluate a query
 {
    QueryGraph queryGraph;
@@ -98,14 +128,21 @@ static void runQuery(Database& db,const string& query,bool explain)
       if (queryGraph.knownEmpty()) {
          if (explain)
             cerr << "static analysis determined that the query result will be empty" << endl; else
+         if ((queryGraph.getDuplicateHandling()==QueryGraph::CountDuplicates)&&(queryGraph.projectionBegin()==queryGraph.projectionEnd()))
+            cout << " 0" << endl; else
             cout << "<empty result>" << endl;
          return;
       }
    }
 
-   // Run the optimizer
+   // Run the optimizer. Cached plans are only used for execution
    PlanGen plangen;
-   Plan* plan=plangen.translate(db,queryGraph);
+   plangen.setFeedback(feedback);
+   const QueryGraph* planGraph=&queryGraph;
+   Plan* plan;
+   if (planCache&&(!explain))
+      plan=planCache->translate(db,key,queryGraph,planGraph); else
+      plan=plangen.translate(db,queryGraph);
    //plan->print(6);
    if (!plan) {
       cerr << "internal error plan generation failed" << endl;
@@ -114,22 +151,81 @@ static void runQuery(Database& db,const string& query,bool explain)
 
    // Build a physical plan
    Runtime runtime(db);
-   Operator* operatorTree=CodeGen().translate(runtime,queryGraph,plan,false);
+   Operator* operatorTree=CodeGen().translate(runtime,*planGraph,plan,false);
 
    // Explain if requested
    if (explain) {
       DebugPlanPrinter out(runtime,false);
       operatorTree->print(out);
+      cerr << "planning time: " << plangen.getPlanningTime() << " ms, " << plangen.getJoinPairs() << " join pairs" << (plangen.usedGreedy()?" (greedy)":"") << endl;
    } else {
       // Else execute it
       if (operatorTree->first()) {
          while (operatorTree->next()) ;
       }
+
+      // Remember the observed cardinalities
+      if (feedback) {
+         feedback->observe(runtime,*planGraph,operatorTree);
+         if (!feedback->storeChanges(feedbackFile,feedbackBatch))
+            cerr << "unable to write " << feedbackFile << endl;
+      }
    }
 
    delete operatorTree;
 }
 //---------------------------------------------------------------------------
+static bool splitCommand(const string& command,string& name,string& rest)
+   // Split a command of the form 'keyword name rest'
+{
+   istringstream in(command);
+   string keyword;
+   if (!(in >> keyword >> name))
+      return false;
+   getline(in,rest,'\0');
+   return true;
+}
+//---------------------------------------------------------------------------
+static void prepareQuery(map<string,PreparedQuery>& prepared,const string& command)
+   // Register a query template
+{
+   string name,text;
+   if (!splitCommand(command,name,text)) {
+      cerr << "usage: prepare <name> <query>" << endl;
+      return;
+   }
+   try {
+      prepared[name]=PreparedQuery(text);
+   } catch (const SPARQLParser::ParserException& e) {
+      cerr << "parse error: " << e.message << endl;
+   }
+}
+//---------------------------------------------------------------------------
+static void executeQuery(Database& db,PlanCache& planCache,const map<string,PreparedQuery>& prepared,const string& command)
+   // Evaluate a query template with bound placeholders
+{
+   string name,bindingText;
+   if (!splitCommand(command,name,bindingText)) {
+      cerr << "usage: execute <name> %placeholder=value ..." << endl;
+      return;
+   }
+   map<string,PreparedQuery>::const_iterator pos=prepared.find(name);
+   if (pos==prepared.end()) {
+      cerr << "unknown prepared query " << name << endl;
+      return;
+   }
+   string query;
+   try {
+      PreparedQuery::Bindings bindings;
+      PreparedQuery::parseBindings(bindingText,bindings);
+      query=(*pos).second.instantiate(bindings);
+   } catch (const SPARQLParser::ParserException& e) {
+      cerr << "parse error: " << e.message << endl;
+      return;
+   }
+   runQuery(db,query,false,&planCache,(*pos).second.getKey());
+}
+//---------------------------------------------------------------------------
 int main(int argc,char* argv[])
 {
    // Warn first
@@ -154,6 +250,13 @@ int main(int argc,char* argv[])
       return 1;
    }
 
+   // Learn from executed queries?
+   if (getenv("FEEDBACK")&&(*getenv("FEEDBACK"))) {
+      feedbackFile=getenv("FEEDBACK");
+      feedback=new CardinalityFeedback();
+      feedback->load(db,feedbackFile);
+   }
+
    // Execute a single query?
    if (argc==3) {
       ifstream in(argv[2]);
@@ -169,6 +272,9 @@ int main(int argc,char* argv[])
       }
    } else {
       // No, accept user input
+      PlanCache planCache;
+      planCache.setFeedback(feedback);
+      map<string,PreparedQuery> prepared;
       cerr << "Enter 'help' for instructions" << endl;
       while (true) {
          string query;
@@ -180,13 +286,24 @@ int main(int argc,char* argv[])
             break;
          } else if (query=="help") {
             showHelp();
+         } else if (query=="stats") {
+            showStats(db,planCache);
          } else if (query.substr(0,8)=="explain ") {
             runQuery(db,query.substr(8),true);
+         } else if (query.substr(0,8)=="prepare ") {
+            prepareQuery(prepared,query);
+         } else if (query.substr(0,8)=="execute ") {
+            executeQuery(db,planCache,prepared,query);
          } else {
-            runQuery(db,query,false);
+            runQuery(db,query,false,&planCache,PreparedQuery::normalize(query));
          }
          cout.flush();
       }
    }
+
+   // Write the remaining observations
+   if (feedback&&(!feedback->storeChanges(feedbackFile,1)))
+      cerr << "unable to write " << feedbackFile << endl;
+   delete feedback;
 }
 //---------------------------------------------------------------------------
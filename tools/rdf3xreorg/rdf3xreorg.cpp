@@ -1,14 +1,17 @@
 #include "rts/database/DatabaseBuilder.hpp"
 #include "rts/operator/IndexScan.hpp"
+#include "rts/operator/Scheduler.hpp"
 #include "rts/runtime/Runtime.hpp"
 #include "rts/segment/DictionarySegment.hpp"
 #include "rts/segment/FullyAggregatedFactsSegment.hpp"
 #include "infra/osdep/MemoryMappedFile.hpp"
 #include "../rdf3xload/Sorter.hpp"
 #include "../rdf3xload/TempFile.hpp"
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <set>
+#include <cstring>
 //---------------------------------------------------------------------------
 // RDF-3X
 // (c) 2009 Thomas Neumann. Web site: http://www.mpi-inf.mpg.de/~neumann/rdf3x
@@ -74,8 +77,8 @@ static void reorderIds(Database& db,TempFile& idMap,TempFile& dictionary)
    {
       DictionarySegment& dict=db.getDictionary();
       for (unsigned index=0,limit=dict.getNextId();index<limit;++index) {
-         const char* start,*stop; Type::ID type; unsigned subType;
-         if (dict.lookupById(index,start,stop,type,subType)&&Type::hasSubType(type))
+         const char* start,*stop; Type::ID type; unsigned subType; string buffer;
+         if (dict.lookupById(index,start,stop,type,subType,buffer)&&Type::hasSubType(type))
             subTypes[subType];
       }
    }
@@ -152,8 +155,8 @@ static void reorderIds(Database& db,TempFile& idMap,TempFile& dictionary)
             subTypes[id]=newId;
 
          // And produce the new dictionary entry
-         const char* start,*stop; Type::ID type; unsigned subType;
-         if (dict.lookupById(id,start,stop,type,subType)) {
+         const char* start,*stop; Type::ID type; unsigned subType; string buffer;
+         if (dict.lookupById(id,start,stop,type,subType,buffer)) {
             dictionary.writeString(stop-start,start);
             if (Type::hasSubType(type))
                dictionary.writeId(static_cast<uint64_t>(type)|(static_cast<uint64_t>(subTypes[subType])<<8)); else
@@ -192,82 +195,28 @@ static int compareValue(const char* left,const char* right)
    return 0;
 }
 //---------------------------------------------------------------------------
-static inline int cmpValue(uint64_t l,uint64_t r) { return (l<r)?-1:((l>r)?1:0); }
-//---------------------------------------------------------------------------
-static inline int cmpTriples(uint64_t l1,uint64_t l2,uint64_t l3,uint64_t r1,uint64_t r2,uint64_t r3)
-   // Compar two triples
-{
-   int c=cmpValue(l1,r1);
-   if (c) return c;
-   c=cmpValue(l2,r2);
-   if (c) return c;
-   return cmpValue(l3,r3);
-}
-//---------------------------------------------------------------------------
-static inline void loadTriple(const char* data,uint64_t& v1,uint64_t& v2,uint64_t& v3)
-   // Load a triple
+static const char* skipStringId(const char* reader)
+   // Skip a materialized string/id pair
 {
-   TempFile::readId(TempFile::readId(TempFile::readId(data,v1),v2),v3);
+   return TempFile::skipId(TempFile::skipString(reader));
 }
 //---------------------------------------------------------------------------
-static int compare123(const char* left,const char* right)
-   // Sort by id
+static int compareStringId(const char* left,const char* right)
+   // Sort by string, and within same strings by id
 {
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l1,l2,l3,r1,r2,r3);
-}
-//---------------------------------------------------------------------------
-static int compare132(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l1,l3,l2,r1,r3,r2);
-}
-//---------------------------------------------------------------------------
-static int compare213(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l2,l1,l3,r2,r1,r3);
-}
-//---------------------------------------------------------------------------
-static int compare231(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l2,l3,l1,r2,r3,r1);
-}
-//---------------------------------------------------------------------------
-static int compare312(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l3,l1,l2,r3,r1,r2);
-}
-//---------------------------------------------------------------------------
-static int compare321(const char* left,const char* right)
-   // Sort by id
-{
-   uint64_t l1,l2,l3,r1,r2,r3;
-   loadTriple(left,l1,l2,l3);
-   loadTriple(right,r1,r2,r3);
-
-   return cmpTriples(l3,l2,l1,r3,r2,r1);
+   // Read the string length
+   uint64_t leftLen,rightLen;
+   left=TempFile::readId(left,leftLen);
+   right=TempFile::readId(right,rightLen);
+
+   // Compare the strings
+   int cmp=memcmp(left,right,min(leftLen,rightLen));
+   if (cmp) return cmp;
+   if (leftLen<rightLen) return -1;
+   if (leftLen>rightLen) return 1;
+
+   // Compare the ids
+   return compareValue(left+leftLen,right+rightLen);
 }
 //---------------------------------------------------------------------------
 static void remapFacts(Database& db,const TempFile& idMap,TempFile& facts)
@@ -295,7 +244,7 @@ static void remapFacts(Database& db,const TempFile& idMap,TempFile& facts)
 
    // Sort by predicate
    TempFile sortedByPredicate(idMap.getBaseFile());
-   Sorter::sort(subjectResolved,sortedByPredicate,skipIdIdId,compareValue);
+   Sorter::sortTriples(subjectResolved,sortedByPredicate,Sorter::Order123);
    subjectResolved.discard();
 
    // Resolve the predicate
@@ -322,7 +271,7 @@ static void remapFacts(Database& db,const TempFile& idMap,TempFile& facts)
 
    // Sort by object
    TempFile sortedByObject(idMap.getBaseFile());
-   Sorter::sort(predicateResolved,sortedByObject,skipIdIdId,compareValue);
+   Sorter::sortTriples(predicateResolved,sortedByObject,Sorter::Order123);
    predicateResolved.discard();
 
    // Resolve the object
@@ -348,7 +297,7 @@ static void remapFacts(Database& db,const TempFile& idMap,TempFile& facts)
    sortedByObject.discard();
 
    // Final sort by subject, predicate, object, eliminaing duplicates
-   Sorter::sort(objectResolved,facts,skipIdIdId,compare123,true);
+   Sorter::sortTriples(objectResolved,facts,Sorter::Order123,true);
 }
 //---------------------------------------------------------------------------
 namespace {
@@ -381,6 +330,27 @@ static void loadFacts(DatabaseBuilder& builder,TempFile& facts)
    // Load the facts
 {
    cout << "Loading triples..." << endl;
+
+   // Load all orders concurrently if requested. This needs all sorted orders at the same time
+   if (Scheduler::getMaxThreads()) {
+      TempFile sorted132(facts.getBaseFile()),sorted321(facts.getBaseFile()),sorted312(facts.getBaseFile()),sorted213(facts.getBaseFile()),sorted231(facts.getBaseFile());
+      Sorter::sortTriples(facts,sorted132,Sorter::Order132);
+      Sorter::sortTriples(facts,sorted321,Sorter::Order321);
+      Sorter::sortTriples(facts,sorted312,Sorter::Order312);
+      Sorter::sortTriples(facts,sorted213,Sorter::Order213);
+      Sorter::sortTriples(facts,sorted231,Sorter::Order231);
+
+      Load123 loader123(facts);
+      Load132 loader132(sorted132);
+      Load321 loader321(sorted321);
+      Load312 loader312(sorted312);
+      Load213 loader213(sorted213);
+      Load231 loader231(sorted231);
+      DatabaseBuilder::FactsReader* readers[6]={&loader123,&loader132,&loader321,&loader312,&loader213,&loader231};
+      builder.loadFacts(readers);
+      return;
+   }
+
    // Order 0
    {
       Load123 loader(facts);
@@ -389,35 +359,35 @@ static void loadFacts(DatabaseBuilder& builder,TempFile& facts)
    // Order 1
    {
       TempFile sorted(facts.getBaseFile());
-      Sorter::sort(facts,sorted,skipIdIdId,compare132);
+      Sorter::sortTriples(facts,sorted,Sorter::Order132);
       Load132 loader(sorted);
       builder.loadFacts(1,loader);
    }
    // Order 2
    {
       TempFile sorted(facts.getBaseFile());
-      Sorter::sort(facts,sorted,skipIdIdId,compare321);
+      Sorter::sortTriples(facts,sorted,Sorter::Order321);
       Load321 loader(sorted);
       builder.loadFacts(2,loader);
    }
    // Order 3
    {
       TempFile sorted(facts.getBaseFile());
-      Sorter::sort(facts,sorted,skipIdIdId,compare312);
+      Sorter::sortTriples(facts,sorted,Sorter::Order312);
       Load312 loader(sorted);
       builder.loadFacts(3,loader);
    }
    // Order 4
    {
       TempFile sorted(facts.getBaseFile());
-      Sorter::sort(facts,sorted,skipIdIdId,compare213);
+      Sorter::sortTriples(facts,sorted,Sorter::Order213);
       Load213 loader(sorted);
       builder.loadFacts(4,loader);
    }
    // Order 5
    {
       TempFile sorted(facts.getBaseFile());
-      Sorter::sort(facts,sorted,skipIdIdId,compare231);
+      Sorter::sortTriples(facts,sorted,Sorter::Order231);
       Load231 loader(sorted);
       builder.loadFacts(5,loader);
    }
@@ -527,6 +497,34 @@ bool StringHashesReader::next(unsigned& v1,unsigned& v2)
    return true;
 }
 //---------------------------------------------------------------------------
+/// Read the strings sorted by value
+class StringIndexReader : public DatabaseBuilder::StringIndexReader
+{
+   private:
+   /// The input
+   MemoryMappedFile in;
+   /// Points into the data
+   const char* iter,*limit;
+
+   public:
+   /// Constructor
+   StringIndexReader(TempFile& file) { file.close(); if (!in.open(file.getFile().c_str())) throw; iter=in.getBegin(); limit=in.getEnd(); }
+
+   /// Read the next entry
+   bool next(unsigned& len,const char*& data,unsigned& id);
+};
+//---------------------------------------------------------------------------
+bool StringIndexReader::next(unsigned& len,const char*& data,unsigned& id)
+   // Read the next entry
+{
+   if (iter==limit)
+      return false;
+   uint64_t i;
+   iter=TempFile::readId(TempFile::readString(iter,len,data),i);
+   id=i;
+   return true;
+}
+//---------------------------------------------------------------------------
 }
 //---------------------------------------------------------------------------
 static void loadStrings(DatabaseBuilder& builder,TempFile& stringTable)
@@ -554,6 +552,34 @@ static void loadStrings(DatabaseBuilder& builder,TempFile& stringTable)
    }
 }
 //---------------------------------------------------------------------------
+static void loadStringIndex(DatabaseBuilder& builder,TempFile& stringTable)
+   // Load the sorted string index
+{
+   cout << "Building the string index..." << endl;
+
+   // Collect the strings with their new ids, which are assigned in table order
+   TempFile unsorted(stringTable.getBaseFile());
+   {
+      stringTable.close();
+      MemoryMappedFile in;
+      if (!in.open(stringTable.getFile().c_str())) throw;
+      unsigned id=0;
+      for (const char* iter=in.getBegin(),*limit=in.getEnd();iter!=limit;++id) {
+         unsigned len; const char* data;
+         iter=TempFile::skipId(TempFile::readString(iter,len,data));
+         unsorted.writeString(len,data);
+         unsorted.writeId(id);
+      }
+   }
+
+   // Sort by string and load
+   TempFile sorted(stringTable.getBaseFile());
+   Sorter::sort(unsorted,sorted,skipStringId,compareStringId);
+   unsorted.discard();
+   StringIndexReader reader(sorted);
+   builder.loadStringIndex(reader);
+}
+//---------------------------------------------------------------------------
 static void loadStatistics(DatabaseBuilder& builder,TempFile& facts)
    // Compute the statistics
 {
@@ -562,6 +588,7 @@ static void loadStatistics(DatabaseBuilder& builder,TempFile& facts)
    TempFile tmp(facts.getBaseFile());
    tmp.close();
    builder.computeExactStatistics(tmp.getFile().c_str());
+   builder.computePredicateSets();
 }
 //---------------------------------------------------------------------------
 int main(int argc,char* argv[])
@@ -587,6 +614,9 @@ int main(int argc,char* argv[])
       return 1;
    }
 
+   // Keep the sorted string index if there is one, and the encoding of dates
+   bool stringIndex=db.getDictionary().hasStringIndex(),typedDates=db.getDictionary().hasTypedDates();
+
    // Reorder the ids
    TempFile idMap(argv[1]),dictionary(argv[1]);
    reorderIds(db,idMap,dictionary);
@@ -607,6 +637,9 @@ int main(int argc,char* argv[])
 
    // Load the strings
    loadStrings(builder,dictionary);
+   builder.setTypedDates(typedDates);
+   if (stringIndex)
+      loadStringIndex(builder,dictionary);
    dictionary.discard();
 
    // Load the statistics
@@ -43,8 +43,8 @@ typedef ApproxPathEngine::set_path set_path;
 static string lookupLiteral(Database& db,unsigned id)
    // Lookup a literal value
 {
-   const char* start=0,*end=start; Type::ID type; unsigned subType;
-   db.getDictionary().lookupById(id,start,end,type,subType);
+   const char* start=0,*end=start; Type::ID type; unsigned subType; string buffer;
+   db.getDictionary().lookupById(id,start,end,type,subType,buffer);
    return string(start,end);
 }
 